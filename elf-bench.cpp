@@ -0,0 +1,1213 @@
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "elf.hpp"
+
+/*
+ * Benchmarks for the hot paths of elf.hpp: opening a file, parsing the
+ * dynamic segment, parsing relocations, symbol lookups that hit and miss
+ * through whichever hash table a file has, the same lookups through a
+ * basic_elf_file view, and whole directory scans.
+ *
+ * Every run covers a fixed corpus of synthetic 32 and 64-bit libraries with
+ * SysV only, GNU only and both hash tables, plus one of each class in the
+ * foreign byte order, written to a temporary directory, plus any real
+ * libraries named on the command line.
+ *
+ * Usage: elf-bench [-n iterations] [-s symbols] [-d directory]... [lib]...
+ */
+
+/*
+ * Synthetic libraries
+ */
+
+enum class hash_style
+{
+    sysv = 0,
+    gnu,
+    both
+};
+
+const char *hash_style_str(hash_style style)
+{
+  switch (style)
+  {
+    case hash_style::sysv:
+      return "sysv";
+    case hash_style::gnu:
+      return "gnu";
+    case hash_style::both:
+      return "both";
+  }
+  return "unknown";
+}
+
+/*
+ * What a synthetic library of one class and byte order is made of. Little
+ * endian files are i386 and x86_64, big endian ones MIPS and PPC64
+ */
+template<elf::byte Class, std::endian Endian>
+struct synthetic_layout : elf::elf_layout<Class, Endian>
+{
+    inline static constexpr bool is_64_bit = Class == elf::elf_ident::ELFCLASS64;
+    inline static constexpr bool has_addend = is_64_bit;  /* i386 and MIPS relocations have no addend */
+    using Relocation = std::conditional_t<has_addend, typename elf::elf_layout<Class, Endian>::Rela, typename elf::elf_layout<Class, Endian>::Rel>;
+    using bloom_word = typename elf::elf_layout<Class, Endian>::Addr;
+    inline static constexpr std::uint16_t machine = Endian == std::endian::little ? (is_64_bit ? elf::elf_header::EM_X86_64 : elf::elf_header::EM_386)
+                                                                                  : (is_64_bit ? elf::elf_header::EM_PPC64 : elf::elf_header::EM_MIPS);
+    inline static constexpr std::uint32_t bloom_shift = is_64_bit ? 6 : 5;
+
+    static auto r_info(std::uint32_t symbol, std::uint32_t type)
+    {
+      if constexpr (is_64_bit)
+      {
+        return static_cast<std::uint64_t>(symbol) << 32 | type;
+      } else
+      {
+        return symbol << 8 | type;
+      }
+    }
+
+    /*
+     * Put an on-disk structure built in our byte order into the file's.
+     * get() is its own inverse, so it encodes as well as decodes
+     */
+    template<typename T>
+    static T encode(T value) requires std::is_integral_v<T>
+    {
+      return synthetic_layout::get(value);
+    }
+
+    static typename synthetic_layout::Ehdr encode(typename synthetic_layout::Ehdr header)
+    {
+      header.e_type = encode(header.e_type);
+      header.e_machine = encode(header.e_machine);
+      header.e_version = encode(header.e_version);
+      header.e_entry = encode(header.e_entry);
+      header.e_phoff = encode(header.e_phoff);
+      header.e_shoff = encode(header.e_shoff);
+      header.e_flags = encode(header.e_flags);
+      header.e_ehsize = encode(header.e_ehsize);
+      header.e_phentsize = encode(header.e_phentsize);
+      header.e_phnum = encode(header.e_phnum);
+      header.e_shentsize = encode(header.e_shentsize);
+      header.e_shnum = encode(header.e_shnum);
+      header.e_shstrndx = encode(header.e_shstrndx);
+      return header;
+    }
+
+    static typename synthetic_layout::Phdr encode(typename synthetic_layout::Phdr program_header)
+    {
+      program_header.p_type = encode(program_header.p_type);
+      program_header.p_flags = encode(program_header.p_flags);
+      program_header.p_offset = encode(program_header.p_offset);
+      program_header.p_vaddr = encode(program_header.p_vaddr);
+      program_header.p_paddr = encode(program_header.p_paddr);
+      program_header.p_filesz = encode(program_header.p_filesz);
+      program_header.p_memsz = encode(program_header.p_memsz);
+      program_header.p_align = encode(program_header.p_align);
+      return program_header;
+    }
+
+    static typename synthetic_layout::Shdr encode(typename synthetic_layout::Shdr section_header)
+    {
+      section_header.sh_name = encode(section_header.sh_name);
+      section_header.sh_type = encode(section_header.sh_type);
+      section_header.sh_flags = encode(section_header.sh_flags);
+      section_header.sh_addr = encode(section_header.sh_addr);
+      section_header.sh_offset = encode(section_header.sh_offset);
+      section_header.sh_size = encode(section_header.sh_size);
+      section_header.sh_link = encode(section_header.sh_link);
+      section_header.sh_info = encode(section_header.sh_info);
+      section_header.sh_addralign = encode(section_header.sh_addralign);
+      section_header.sh_entsize = encode(section_header.sh_entsize);
+      return section_header;
+    }
+
+    static typename synthetic_layout::Sym encode(typename synthetic_layout::Sym symbol)
+    {
+      symbol.st_name = encode(symbol.st_name);
+      symbol.st_shndx = encode(symbol.st_shndx);
+      symbol.st_value = encode(symbol.st_value);
+      symbol.st_size = encode(symbol.st_size);
+      return symbol;
+    }
+
+    static typename synthetic_layout::Dyn encode(typename synthetic_layout::Dyn dynamic_entry)
+    {
+      dynamic_entry.d_tag = encode(dynamic_entry.d_tag);
+      dynamic_entry.d_un.d_val = encode(dynamic_entry.d_un.d_val);
+      return dynamic_entry;
+    }
+
+    static Relocation encode(Relocation relocation)
+    {
+      relocation.r_offset = encode(relocation.r_offset);
+      relocation.r_info = encode(relocation.r_info);
+      if constexpr (has_addend)
+      {
+        relocation.r_addend = encode(relocation.r_addend);
+      }
+      return relocation;
+    }
+
+    template<typename T>
+    static std::vector<T> encode(std::vector<T> entries)
+    {
+      for (auto &entry: entries)
+      {
+        entry = encode(entry);
+      }
+      return entries;
+    }
+};
+
+/*
+ * Relocation types shared by i386 and x86_64. Big endian files reuse them,
+ * nothing here applies relocations
+ */
+inline constexpr std::uint32_t R_GLOB_DAT = 6;
+inline constexpr std::uint32_t R_JUMP_SLOT = 7;
+inline constexpr std::uint32_t R_RELATIVE = 8;
+
+/*
+ * A growing file image that tables are appended to
+ */
+class image_writer
+{
+public:
+    template<typename T>
+    std::uint64_t append(const std::vector<T> &entries, std::size_t alignment = alignof(T))
+    {
+      this->align(alignment);
+      const std::uint64_t offset = this->bytes.size();
+      this->bytes.resize(offset + entries.size() * sizeof(T));
+      if (!entries.empty())
+      {
+        std::memcpy(this->bytes.data() + offset, entries.data(), entries.size() * sizeof(T));
+      }
+      return offset;
+    }
+
+    template<typename T>
+    void write(std::uint64_t offset, const T &value)
+    {
+      std::memcpy(this->bytes.data() + offset, &value, sizeof(T));
+    }
+
+    void align(std::size_t alignment)
+    {
+      this->bytes.resize((this->bytes.size() + alignment - 1) / alignment * alignment);
+    }
+
+    std::uint64_t size() const
+    {
+      return this->bytes.size();
+    }
+
+    std::vector<char> bytes;
+};
+
+/*
+ * Deterministic Itanium-mangled looking names of varied length
+ */
+std::vector<std::string> make_symbol_names(std::size_t count, const char *prefix, std::mt19937_64 &rng)
+{
+  static constexpr char alphabet[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_0123456789";
+  std::vector<std::string> names;
+  names.reserve(count);
+  for (std::size_t i = 0; i < count; i++)
+  {
+    std::string name = "_ZN";
+    const std::string unique = std::string(prefix) + std::to_string(i);
+    name += std::to_string(unique.size()) + unique;
+    const std::size_t segments = 1 + rng() % 4;
+    for (std::size_t segment = 0; segment < segments; segment++)
+    {
+      std::string identifier(1, alphabet[rng() % 52]);
+      const std::size_t length = 2 + rng() % 14;
+      for (std::size_t c = 1; c < length; c++)
+      {
+        identifier += alphabet[rng() % (sizeof(alphabet) - 1)];
+      }
+      name += std::to_string(identifier.size()) + identifier;
+    }
+    name += "Ev";
+    names.push_back(std::move(name));
+  }
+  return names;
+}
+
+/*
+ * Build a shared object exporting symbol_count functions and importing a
+ * tenth as many, with dynamic and PLT relocations against them. Addresses
+ * equal file offsets and there is no code, so it is only fit for parsing
+ */
+template<typename Layout>
+std::vector<char> make_synthetic_elf(const std::string &so_name, std::size_t symbol_count, hash_style style)
+{
+  using Ehdr = typename Layout::Ehdr;
+  using Phdr = typename Layout::Phdr;
+  using Shdr = typename Layout::Shdr;
+  using Sym = typename Layout::Sym;
+  using Dyn = typename Layout::Dyn;
+  using Rel = typename Layout::Relocation;
+  using bloom_word = typename Layout::bloom_word;
+  constexpr std::uint32_t bloom_word_bits = sizeof(bloom_word) * 8;
+  constexpr std::size_t function_size = 16;
+
+  std::mt19937_64 rng(symbol_count * 3 + static_cast<std::size_t>(style) + Layout::elf_class + static_cast<std::size_t>(Layout::is_native));
+  const std::vector<std::string> exports = make_symbol_names(symbol_count, "export", rng);
+  const std::vector<std::string> imports = make_symbol_names(std::max<std::size_t>(symbol_count / 10, 1), "import", rng);
+  const std::size_t first_export = 1 + imports.size();
+  const std::size_t dynamic_symbol_count = first_export + exports.size();
+
+  /*
+   * Exports are ordered by GNU hash bucket, as the GNU hash table requires
+   */
+  const std::uint32_t gnu_bucket_count = static_cast<std::uint32_t>(std::max<std::size_t>(exports.size() / 4, 1));
+  std::vector<std::uint32_t> export_hashes(exports.size());
+  std::vector<std::size_t> export_order(exports.size());
+  for (std::size_t i = 0; i < exports.size(); i++)
+  {
+    export_hashes[i] = static_cast<std::uint32_t>(elf::gnu_hash(exports[i].c_str()));
+    export_order[i] = i;
+  }
+  std::stable_sort(export_order.begin(), export_order.end(), [&](std::size_t a, std::size_t b) {
+      return export_hashes[a] % gnu_bucket_count < export_hashes[b] % gnu_bucket_count;
+  });
+
+  image_writer image;
+  std::vector<Shdr> sections(1, Shdr{});
+  std::string section_names(1, '\0');
+  const auto add_section = [&](const char *name, std::uint32_t type, std::uint64_t flags, std::uint64_t offset, std::uint64_t size,
+                               std::uint32_t link = 0, std::uint32_t info = 0, std::uint64_t entry_size = 0) {
+      Shdr section{};
+      section.sh_name = static_cast<std::uint32_t>(section_names.size());
+      section.sh_type = type;
+      section.sh_flags = flags;
+      section.sh_addr = flags & elf::elf_section_header::SHF_ALLOC ? offset : 0;
+      section.sh_offset = offset;
+      section.sh_size = size;
+      section.sh_link = link;
+      section.sh_info = info;
+      section.sh_addralign = sizeof(bloom_word);
+      section.sh_entsize = entry_size;
+      section_names += name;
+      section_names += '\0';
+      sections.push_back(section);
+      return static_cast<std::uint32_t>(sections.size() - 1);
+  };
+  image.append(std::vector<char>(sizeof(Ehdr) + 2 * sizeof(Phdr)));
+
+  /*
+   * .text, one zeroed function per export
+   */
+  const std::uint64_t text_offset = image.append(std::vector<char>(exports.size() * function_size), 16);
+  const std::uint32_t text_index = add_section(".text", elf::elf_section_header::SHT_PROGBITS,
+                                               elf::elf_section_header::SHF_ALLOC | elf::elf_section_header::SHF_EXECINSTR,
+                                               text_offset, exports.size() * function_size);
+
+  /*
+   * .dynstr and .dynsym
+   */
+  std::string strings(1, '\0');
+  const auto add_string = [&](const std::string &string) {
+      const auto offset = static_cast<std::uint32_t>(strings.size());
+      strings += string;
+      strings += '\0';
+      return offset;
+  };
+  const std::uint32_t so_name_offset = add_string(so_name);
+  const std::uint32_t needed_offset = add_string("libc.so.6");
+  std::vector<Sym> symbols(dynamic_symbol_count, Sym{});
+  for (std::size_t i = 0; i < imports.size(); i++)
+  {
+    symbols[1 + i].st_name = add_string(imports[i]);
+    symbols[1 + i].st_info = elf::elf_symbol::STB_GLOBAL << 4 | elf::elf_symbol::STT_FUNC;
+  }
+  for (std::size_t i = 0; i < exports.size(); i++)
+  {
+    Sym &symbol = symbols[first_export + i];
+    symbol.st_name = add_string(exports[export_order[i]]);
+    symbol.st_info = elf::elf_symbol::STB_GLOBAL << 4 | elf::elf_symbol::STT_FUNC;
+    symbol.st_shndx = static_cast<std::uint16_t>(text_index);
+    symbol.st_value = text_offset + i * function_size;
+    symbol.st_size = function_size;
+  }
+  const std::uint64_t symbols_offset = image.append(Layout::encode(symbols), sizeof(bloom_word));
+  const std::uint32_t symbols_index = add_section(".dynsym", elf::elf_section_header::SHT_DYNSYM, elf::elf_section_header::SHF_ALLOC,
+                                                  symbols_offset, symbols.size() * sizeof(Sym), 0, 1, sizeof(Sym));
+  const std::uint64_t strings_offset = image.append(std::vector<char>(strings.begin(), strings.end()));
+  const std::uint32_t strings_index = add_section(".dynstr", elf::elf_section_header::SHT_STRTAB, elf::elf_section_header::SHF_ALLOC,
+                                                  strings_offset, strings.size());
+  sections[symbols_index].sh_link = strings_index;
+
+  /*
+   * .hash: nbucket, nchain, buckets, chains
+   */
+  std::uint64_t hash_offset = 0;
+  if (style != hash_style::gnu)
+  {
+    const auto bucket_count = static_cast<std::uint32_t>(std::max<std::size_t>(dynamic_symbol_count / 2, 1));
+    std::vector<std::uint32_t> table(2 + bucket_count + dynamic_symbol_count);
+    table[0] = bucket_count;
+    table[1] = static_cast<std::uint32_t>(dynamic_symbol_count);
+    std::uint32_t *buckets = table.data() + 2;
+    std::uint32_t *chains = buckets + bucket_count;
+    for (std::size_t i = 1; i < dynamic_symbol_count; i++)
+    {
+      const std::uint32_t bucket = static_cast<std::uint32_t>(elf::elf_hash(strings.c_str() + symbols[i].st_name)) % bucket_count;
+      chains[i] = buckets[bucket];
+      buckets[bucket] = static_cast<std::uint32_t>(i);
+    }
+    hash_offset = image.append(Layout::encode(table), sizeof(bloom_word));
+    add_section(".hash", elf::elf_section_header::SHT_HASH, elf::elf_section_header::SHF_ALLOC,
+                hash_offset, table.size() * sizeof(std::uint32_t), symbols_index, 0, sizeof(std::uint32_t));
+  }
+
+  /*
+   * .gnu.hash: header, bloom words, buckets, hash values of the exports
+   */
+  std::uint64_t gnu_hash_offset = 0;
+  if (style != hash_style::sysv)
+  {
+    const auto bloom_size = static_cast<std::uint32_t>(std::max<std::size_t>(std::bit_ceil(exports.size() * 8) / bloom_word_bits, 1));
+    std::vector<bloom_word> bloom(bloom_size);
+    std::vector<std::uint32_t> buckets(gnu_bucket_count);
+    std::vector<std::uint32_t> values(exports.size());
+    for (std::size_t i = 0; i < exports.size(); i++)
+    {
+      const std::uint32_t hash = export_hashes[export_order[i]];
+      bloom[hash / bloom_word_bits % bloom_size] |= static_cast<bloom_word>(1) << (hash % bloom_word_bits)
+                                                    | static_cast<bloom_word>(1) << ((hash >> Layout::bloom_shift) % bloom_word_bits);
+      const std::uint32_t bucket = hash % gnu_bucket_count;
+      if (buckets[bucket] == 0)
+      {
+        buckets[bucket] = static_cast<std::uint32_t>(first_export + i);
+      }
+      const bool last_in_bucket = i + 1 == exports.size() || export_hashes[export_order[i + 1]] % gnu_bucket_count != bucket;
+      values[i] = last_in_bucket ? hash | 1 : hash & ~1u;
+    }
+    const std::vector<std::uint32_t> header = {gnu_bucket_count, static_cast<std::uint32_t>(first_export), bloom_size, Layout::bloom_shift};
+    gnu_hash_offset = image.append(Layout::encode(header), sizeof(bloom_word));
+    image.append(Layout::encode(bloom));
+    image.append(Layout::encode(buckets));
+    const std::uint64_t gnu_hash_end = image.append(Layout::encode(values)) + values.size() * sizeof(std::uint32_t);
+    add_section(".gnu.hash", elf::elf_section_header::SHT_GNU_HASH, elf::elf_section_header::SHF_ALLOC,
+                gnu_hash_offset, gnu_hash_end - gnu_hash_offset, symbols_index);
+  }
+
+  /*
+   * Relative and GOT relocations in .rel(a).dyn, one jump slot per import in .rel(a).plt
+   */
+  const std::size_t relocation_count = exports.size() / 2 + exports.size() / 10 + imports.size();
+  const std::uint64_t loaded_tables_size = (relocation_count + 2) * sizeof(Rel) + 16 * sizeof(Dyn);
+  const std::uint64_t data_address = (image.size() + loaded_tables_size + 0xfff) / 0x1000 * 0x1000;
+  std::uint64_t next_slot = data_address;
+  const auto make_relocation = [&](std::size_t symbol, std::uint32_t type) {
+      Rel relocation{};
+      relocation.r_offset = next_slot;
+      relocation.r_info = Layout::r_info(static_cast<std::uint32_t>(symbol), type);
+      if constexpr (Layout::has_addend)
+      {
+        relocation.r_addend = type == R_RELATIVE ? static_cast<std::int64_t>(text_offset) : 0;
+      }
+      next_slot += sizeof(bloom_word);
+      return relocation;
+  };
+  std::vector<Rel> dynamic_relocations;
+  for (std::size_t i = 0; i < exports.size() / 2; i++)
+  {
+    dynamic_relocations.push_back(make_relocation(0, R_RELATIVE));
+  }
+  for (std::size_t i = 0; i < exports.size() / 10; i++)
+  {
+    dynamic_relocations.push_back(make_relocation(first_export + i * 7 % exports.size(), R_GLOB_DAT));
+  }
+  std::vector<Rel> plt_relocations;
+  for (std::size_t i = 0; i < imports.size(); i++)
+  {
+    plt_relocations.push_back(make_relocation(1 + i, R_JUMP_SLOT));
+  }
+  const std::uint32_t relocation_type = Layout::has_addend ? elf::elf_section_header::SHT_RELA : elf::elf_section_header::SHT_REL;
+  const std::uint64_t dynamic_relocations_offset = image.append(Layout::encode(dynamic_relocations));
+  add_section(Layout::has_addend ? ".rela.dyn" : ".rel.dyn", relocation_type, elf::elf_section_header::SHF_ALLOC,
+              dynamic_relocations_offset, dynamic_relocations.size() * sizeof(Rel), symbols_index, 0, sizeof(Rel));
+  const std::uint64_t plt_relocations_offset = image.append(Layout::encode(plt_relocations));
+  add_section(Layout::has_addend ? ".rela.plt" : ".rel.plt", relocation_type,
+              elf::elf_section_header::SHF_ALLOC | elf::elf_section_header::SHF_INFO_LINK,
+              plt_relocations_offset, plt_relocations.size() * sizeof(Rel), symbols_index, 0, sizeof(Rel));
+
+  /*
+   * .dynamic
+   */
+  std::vector<Dyn> dynamic;
+  const auto add_dynamic = [&](std::int64_t tag, std::uint64_t value) {
+      Dyn entry{};
+      entry.d_tag = static_cast<decltype(entry.d_tag)>(tag);
+      entry.d_un.d_val = static_cast<decltype(entry.d_un.d_val)>(value);
+      dynamic.push_back(entry);
+  };
+  add_dynamic(elf::elf_dynamic::DT_NEEDED, needed_offset);
+  add_dynamic(elf::elf_dynamic::DT_SONAME, so_name_offset);
+  if (hash_offset != 0)
+  {
+    add_dynamic(elf::elf_dynamic::DT_HASH, hash_offset);
+  }
+  if (gnu_hash_offset != 0)
+  {
+    add_dynamic(elf::elf_dynamic::DT_GNU_HASH, gnu_hash_offset);
+  }
+  add_dynamic(elf::elf_dynamic::DT_STRTAB, strings_offset);
+  add_dynamic(elf::elf_dynamic::DT_SYMTAB, symbols_offset);
+  add_dynamic(elf::elf_dynamic::DT_STRSZ, strings.size());
+  add_dynamic(elf::elf_dynamic::DT_SYMENT, sizeof(Sym));
+  add_dynamic(Layout::has_addend ? elf::elf_dynamic::DT_RELA : elf::elf_dynamic::DT_REL, dynamic_relocations_offset);
+  add_dynamic(Layout::has_addend ? elf::elf_dynamic::DT_RELASZ : elf::elf_dynamic::DT_RELSZ, dynamic_relocations.size() * sizeof(Rel));
+  add_dynamic(Layout::has_addend ? elf::elf_dynamic::DT_RELAENT : elf::elf_dynamic::DT_RELENT, sizeof(Rel));
+  add_dynamic(elf::elf_dynamic::DT_JMPREL, plt_relocations_offset);
+  add_dynamic(elf::elf_dynamic::DT_PLTRELSZ, plt_relocations.size() * sizeof(Rel));
+  add_dynamic(elf::elf_dynamic::DT_PLTREL, Layout::has_addend ? elf::elf_dynamic::DT_RELA : elf::elf_dynamic::DT_REL);
+  add_dynamic(elf::elf_dynamic::DT_NULL, 0);
+  const std::uint64_t dynamic_offset = image.append(Layout::encode(dynamic));
+  add_section(".dynamic", elf::elf_section_header::SHT_DYNAMIC, elf::elf_section_header::SHF_ALLOC | elf::elf_section_header::SHF_WRITE,
+              dynamic_offset, dynamic.size() * sizeof(Dyn), strings_index, 0, sizeof(Dyn));
+  const std::uint64_t load_size = image.size();
+
+  /*
+   * .shstrtab and the section headers, outside the loaded segment
+   */
+  const std::uint32_t section_names_index = add_section(".shstrtab", elf::elf_section_header::SHT_STRTAB, 0, 0, 0);
+  sections[section_names_index].sh_size = section_names.size();
+  sections[section_names_index].sh_offset = image.append(std::vector<char>(section_names.begin(), section_names.end()));
+  sections[section_names_index].sh_addralign = 1;
+  const std::uint64_t sections_offset = image.append(Layout::encode(sections), sizeof(bloom_word));
+
+  Ehdr header{};
+  header.e_ident.ei_magic[0] = elf::elf_ident::ELFMAG0;
+  header.e_ident.ei_magic[1] = elf::elf_ident::ELFMAG1;
+  header.e_ident.ei_magic[2] = elf::elf_ident::ELFMAG2;
+  header.e_ident.ei_magic[3] = elf::elf_ident::ELFMAG3;
+  header.e_ident.ei_class = Layout::elf_class;
+  header.e_ident.ei_data = Layout::endian == std::endian::little ? elf::elf_ident::ELFDATA2LSB : elf::elf_ident::ELFDATA2MSB;
+  header.e_ident.ei_version = elf::elf_ident::EV_CURRENT;
+  header.e_type = elf::elf_header::ET_DYN;
+  header.e_machine = Layout::machine;
+  header.e_version = elf::elf_ident::EV_CURRENT;
+  header.e_phoff = sizeof(Ehdr);
+  header.e_shoff = sections_offset;
+  header.e_ehsize = sizeof(Ehdr);
+  header.e_phentsize = sizeof(Phdr);
+  header.e_phnum = 2;
+  header.e_shentsize = sizeof(Shdr);
+  header.e_shnum = static_cast<std::uint16_t>(sections.size());
+  header.e_shstrndx = static_cast<std::uint16_t>(section_names_index);
+  image.write(0, Layout::encode(header));
+
+  Phdr load{};
+  load.p_type = elf::elf_program_header::PT_LOAD;
+  load.p_flags = 0x7;
+  load.p_filesz = load_size;
+  load.p_memsz = next_slot;
+  load.p_align = 0x1000;
+  image.write(sizeof(Ehdr), Layout::encode(load));
+  Phdr dynamic_segment{};
+  dynamic_segment.p_type = elf::elf_program_header::PT_DYNAMIC;
+  dynamic_segment.p_flags = 0x6;
+  dynamic_segment.p_offset = dynamic_segment.p_vaddr = dynamic_segment.p_paddr = dynamic_offset;
+  dynamic_segment.p_filesz = dynamic_segment.p_memsz = dynamic.size() * sizeof(Dyn);
+  dynamic_segment.p_align = sizeof(bloom_word);
+  image.write(sizeof(Ehdr) + sizeof(Phdr), Layout::encode(dynamic_segment));
+
+  return std::move(image.bytes);
+}
+
+/*
+ * Write libsynthetic-{32,64}-{sysv,gnu,both}.so in our byte order and
+ * libsynthetic-{32,64}be-both.so, or -le when we are big endian, into
+ * directory
+ */
+std::vector<std::filesystem::path> write_corpus(const std::filesystem::path &directory, std::size_t symbol_count)
+{
+  constexpr std::endian foreign = std::endian::native == std::endian::little ? std::endian::big : std::endian::little;
+  constexpr const char *foreign_suffix = foreign == std::endian::big ? "be" : "le";
+  std::filesystem::create_directories(directory);
+  std::vector<std::filesystem::path> paths;
+  const auto write = [&](const std::string &name, const std::vector<char> &image) {
+      std::ofstream file(directory / name, std::ios::binary | std::ios::trunc);
+      file.write(image.data(), static_cast<std::streamsize>(image.size()));
+      paths.push_back(directory / name);
+  };
+  for (const int bits: {32, 64})
+  {
+    for (const hash_style style: {hash_style::sysv, hash_style::gnu, hash_style::both})
+    {
+      const std::string name = "libsynthetic-" + std::to_string(bits) + "-" + hash_style_str(style) + ".so";
+      write(name, bits == 32 ? make_synthetic_elf<synthetic_layout<elf::elf_ident::ELFCLASS32, std::endian::native>>(name, symbol_count, style)
+                             : make_synthetic_elf<synthetic_layout<elf::elf_ident::ELFCLASS64, std::endian::native>>(name, symbol_count, style));
+    }
+    const std::string name = "libsynthetic-" + std::to_string(bits) + foreign_suffix + "-both.so";
+    write(name, bits == 32 ? make_synthetic_elf<synthetic_layout<elf::elf_ident::ELFCLASS32, foreign>>(name, symbol_count, hash_style::both)
+                           : make_synthetic_elf<synthetic_layout<elf::elf_ident::ELFCLASS64, foreign>>(name, symbol_count, hash_style::both));
+  }
+  return paths;
+}
+
+/*
+ * Timing
+ */
+
+/*
+ * Best of iterations runs of run(setup()) in milliseconds, only run is
+ * timed. Negative when a run fails
+ */
+template<typename Setup, typename Run>
+double time_best(std::size_t iterations, Setup &&setup, Run &&run)
+{
+  double best = -1;
+  for (std::size_t i = 0; i < iterations; i++)
+  {
+    auto state = setup();
+    const auto start = std::chrono::steady_clock::now();
+    if (!run(state))
+    {
+      return -1;
+    }
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    best = best < 0 ? elapsed.count() : std::min(best, elapsed.count());
+  }
+  return best;
+}
+
+template<typename Run>
+double time_best(std::size_t iterations, Run &&run)
+{
+  return time_best(iterations, []() { return 0; }, [&](int) { return run(); });
+}
+
+void print_case(const char *name, double ms, std::size_t operations = 0)
+{
+  std::cout << "  " << name << ": ";
+  if (ms < 0)
+  {
+    std::cout << "failed" << std::endl;
+    return;
+  }
+  std::cout << ms << " ms";
+  if (operations != 0)
+  {
+    std::cout << " (" << ms * 1e6 / static_cast<double>(operations) << " ns/op)";
+  }
+  std::cout << std::endl;
+}
+
+/*
+ * Reference reader doing a seek and a read for every section header and
+ * symbol, the way the 64-bit tables used to be loaded
+ */
+template<typename Layout>
+bool read_per_entry(std::ifstream &file, std::size_t &name_bytes)
+{
+  using Ehdr = typename Layout::Ehdr;
+  using Shdr = typename Layout::Shdr;
+  using Sym = typename Layout::Sym;
+
+  Ehdr header;
+  if (!file.seekg(0) || !file.read(reinterpret_cast<char *>(&header), sizeof(header)))
+  {
+    return false;
+  }
+
+  std::vector<Shdr> section_headers(Layout::get(header.e_shnum));
+  for (std::size_t i = 0; i < section_headers.size(); i++)
+  {
+    if (!file.seekg(Layout::get(header.e_shoff) + i * sizeof(Shdr)) || !file.read(reinterpret_cast<char *>(&section_headers[i]), sizeof(Shdr)))
+    {
+      return false;
+    }
+  }
+  if (Layout::get(header.e_shstrndx) >= section_headers.size())
+  {
+    return false;
+  }
+
+  const auto read_string_table = [&](const Shdr &section_header, std::vector<char> &strings) {
+      strings.resize(Layout::get(section_header.sh_size));
+      return file.seekg(Layout::get(section_header.sh_offset)) && file.read(strings.data(), static_cast<std::streamsize>(strings.size()));
+  };
+  std::vector<char> section_names;
+  if (!read_string_table(section_headers[Layout::get(header.e_shstrndx)], section_names))
+  {
+    return false;
+  }
+  for (const auto &section_header: section_headers)
+  {
+    const std::size_t name = Layout::get(section_header.sh_name);
+    name_bytes += name < section_names.size() ? std::strlen(section_names.data() + name) : 0;
+  }
+
+  for (const auto &section_header: section_headers)
+  {
+    if (Layout::get(section_header.sh_type) != elf::elf_section_header::SHT_DYNSYM || Layout::get(section_header.sh_link) >= section_headers.size())
+    {
+      continue;
+    }
+    std::vector<char> symbol_names;
+    if (!read_string_table(section_headers[Layout::get(section_header.sh_link)], symbol_names))
+    {
+      return false;
+    }
+    const std::size_t symbol_count = Layout::get(section_header.sh_size) / sizeof(Sym);
+    for (std::size_t i = 0; i < symbol_count; i++)
+    {
+      Sym symbol;
+      if (!file.seekg(Layout::get(section_header.sh_offset) + i * sizeof(Sym)) || !file.read(reinterpret_cast<char *>(&symbol), sizeof(Sym)))
+      {
+        return false;
+      }
+      const std::size_t name = Layout::get(symbol.st_name);
+      name_bytes += name < symbol_names.size() ? std::strlen(symbol_names.data() + name) : 0;
+    }
+  }
+  return true;
+}
+
+bool bench_per_entry(const std::filesystem::path &path, std::size_t &name_bytes)
+{
+  std::ifstream file(path, std::ios::binary);
+  elf::elf_ident ident;
+  if (!file.read(reinterpret_cast<char *>(&ident), sizeof(ident)))
+  {
+    return false;
+  }
+  const bool big_endian = ident.ei_data == elf::elf_ident::ELFDATA2MSB;
+  if (ident.ei_class == elf::elf_ident::ELFCLASS64)
+  {
+    return big_endian ? read_per_entry<elf::elf_layout<elf::elf_ident::ELFCLASS64, std::endian::big>>(file, name_bytes)
+                      : read_per_entry<elf::elf_layout<elf::elf_ident::ELFCLASS64, std::endian::little>>(file, name_bytes);
+  }
+  return big_endian ? read_per_entry<elf::elf_layout<elf::elf_ident::ELFCLASS32, std::endian::big>>(file, name_bytes)
+                    : read_per_entry<elf::elf_layout<elf::elf_ident::ELFCLASS32, std::endian::little>>(file, name_bytes);
+}
+
+bool bench_bulk(const std::filesystem::path &path, std::size_t &name_bytes)
+{
+  elf::load_options options;
+  options.lazy = true;
+  elf::elf_file lib(path, options);
+  const auto &section_headers = lib.get_section_headers();
+  const auto &dynamic_symbols = lib.get_dynamic_symbols();
+  if (lib.error())
+  {
+    return false;
+  }
+  for (const auto &section_header: section_headers)
+  {
+    name_bytes += std::strlen(section_header.sh_name_str);
+  }
+  for (const auto &symbol: dynamic_symbols)
+  {
+    name_bytes += std::strlen(symbol.st_name_str);
+  }
+  return true;
+}
+
+/*
+ * Replace to with a copy of from followed by padding zero bytes, the way a
+ * linker writes a new file and renames it into place
+ */
+bool replace_padded(const std::filesystem::path &from, const std::filesystem::path &to, std::size_t padding)
+{
+  std::ifstream input(from, std::ios::binary);
+  std::vector<char> contents((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+  contents.resize(contents.size() + padding);
+  std::filesystem::path temporary_path = to;
+  temporary_path += ".tmp";
+  {
+    std::ofstream output(temporary_path, std::ios::binary | std::ios::trunc);
+    if (!output.write(contents.data(), static_cast<std::streamsize>(contents.size())))
+    {
+      return false;
+    }
+  }
+  std::error_code ec;
+  std::filesystem::rename(temporary_path, to, ec);
+  return !ec;
+}
+
+/*
+ * Benchmarks for a single file
+ */
+void bench_file(const std::filesystem::path &path, std::size_t iterations)
+{
+  elf::elf_file lib(path);
+  if (lib.error() || !lib.parse_dynamic_segment())
+  {
+    std::cerr << path.string() << ": " << lib.error_message() << std::endl;
+    return;
+  }
+  const auto &dynamic_symbols = lib.get_dynamic_symbols();
+  const auto &section_headers = lib.get_section_headers();
+  const bool has_gnu_hash = std::any_of(section_headers.begin(), section_headers.end(), [](const auto &section_header) {
+      return section_header.sh_type == elf::elf_section_header::SHT_GNU_HASH;
+  });
+  const bool has_sysv_hash = std::any_of(section_headers.begin(), section_headers.end(), [](const auto &section_header) {
+      return section_header.sh_type == elf::elf_section_header::SHT_HASH;
+  });
+  const std::size_t relocation_count = lib.get_relocations().size() + lib.get_relocations_with_addend().size() +
+                                       lib.get_plt_relocations().size() + lib.get_plt_relocations_with_addend().size();
+
+  /*
+   * Look up every defined symbol in a fixed shuffled order, and as many
+   * names that aren't there
+   */
+  std::vector<std::string> hit_names, miss_names;
+  for (const auto &symbol: dynamic_symbols)
+  {
+    if (symbol.st_shndx != 0 && symbol.st_name_str[0] != '\0')
+    {
+      hit_names.emplace_back(symbol.st_name_str);
+      miss_names.emplace_back(std::string(symbol.st_name_str) + "$missing");
+    }
+  }
+  std::shuffle(hit_names.begin(), hit_names.end(), std::mt19937_64(42));
+  std::vector<const char *> hit_pointers, miss_pointers;
+  for (std::size_t i = 0; i < hit_names.size(); i++)
+  {
+    hit_pointers.push_back(hit_names[i].c_str());
+    miss_pointers.push_back(miss_names[i].c_str());
+  }
+
+  std::cout << path.filename().string() << ": " << (lib.is_64_bit() ? 64 : 32) << "-bit, " << dynamic_symbols.size() << " dynamic symbols, "
+            << relocation_count << " relocations, hash tables:" << (has_sysv_hash ? " sysv" : "") << (has_gnu_hash ? " gnu" : "") << std::endl;
+
+  /*
+   * A cache of everything parse_dynamic_segment produces, to time loading
+   * it instead of parsing
+   */
+  const std::filesystem::path cache_path = std::filesystem::temp_directory_path() / ("elf-bench-" + lib.get_cache_key() + ".elfcache");
+  const bool cached = lib.save_cache(cache_path);
+  lib.clear_error();
+
+  std::uint64_t relocation_checksum = 0;
+  for (const elf::backend backend: {elf::backend::stream, elf::backend::mapped})
+  {
+    elf::load_options options;
+    options.backend = backend;
+    const bool mapped = backend == elf::backend::mapped;
+    print_case(mapped ? "Open (mapped)" : "Open (stream)", time_best(iterations, [&]() {
+        elf::elf_file file(path, options);
+        return !file.error();
+    }));
+    print_case(mapped ? "parse_dynamic_segment (mapped)" : "parse_dynamic_segment (stream)", time_best(iterations, [&]() {
+        return std::make_unique<elf::elf_file>(path, options);
+    }, [](const std::unique_ptr<elf::elf_file> &file) {
+        return file->parse_dynamic_segment();
+    }));
+    elf::elf_file reused(path, options);
+    print_case(mapped ? "parse_dynamic_segment, reopened (mapped)" : "parse_dynamic_segment, reopened (stream)", time_best(iterations, [&]() {
+        return reused.reopen(path) && reused.parse_dynamic_segment();
+    }));
+
+    /*
+     * Parse everything, perfect hash and address index included, on the
+     * calling thread and then split over the default executor
+     */
+    elf::load_options parallel_options = options;
+    parallel_options.perfect_hash = true;
+    for (elf::executor *executor: {static_cast<elf::executor *>(nullptr), &elf::default_executor()})
+    {
+      parallel_options.executor = executor;
+      const char *name = executor == nullptr ? (mapped ? "Full parse, one thread (mapped)" : "Full parse, one thread (stream)")
+                                             : (mapped ? "Full parse, default_executor (mapped)" : "Full parse, default_executor (stream)");
+      print_case(name, time_best(iterations, [&]() {
+          return std::make_unique<elf::elf_file>(path, parallel_options);
+      }, [](const std::unique_ptr<elf::elf_file> &file) {
+          file->symbol_for_address(0);
+          return file->parse_dynamic_segment() && !file->error();
+      }));
+    }
+
+    /*
+     * Refresh a copy of the file, with its perfect hash and address index
+     * built, while it is unchanged and after it is replaced by one with
+     * bytes appended that no table was read from. Against opening the
+     * replaced file again and dropping the old one
+     */
+    const std::filesystem::path copy_path = std::filesystem::temp_directory_path() / ("elf-bench-refresh-" + path.filename().string());
+    const auto prepare = [](elf::elf_file &file) {
+        file.symbol_for_address(0);
+        return file.parse_dynamic_segment() && file.build_perfect_hash();
+    };
+    if (replace_padded(path, copy_path, 0))
+    {
+      auto copy = std::make_unique<elf::elf_file>(copy_path, options);
+      prepare(*copy);
+      print_case(mapped ? "refresh, unchanged (mapped)" : "refresh, unchanged (stream)", time_best(iterations, [&]() {
+          return copy->refresh() == elf::refresh_result::unchanged;
+      }));
+      std::size_t padding = 0;
+      print_case(mapped ? "Open again, replaced (mapped)" : "Open again, replaced (stream)", time_best(iterations, [&]() {
+          return replace_padded(path, copy_path, ++padding);
+      }, [&](bool replaced) {
+          copy = std::make_unique<elf::elf_file>(copy_path, options);
+          return replaced && prepare(*copy);
+      }));
+      print_case(mapped ? "refresh, replaced (mapped)" : "refresh, replaced (stream)", time_best(iterations, [&]() {
+          return replace_padded(path, copy_path, ++padding);
+      }, [&](bool replaced) {
+          return replaced && copy->refresh() == elf::refresh_result::updated;
+      }));
+      copy.reset();
+      std::filesystem::remove(copy_path);
+    }
+    options.lazy = true;
+    if (cached)
+    {
+      print_case(mapped ? "Open + load_cache (mapped)" : "Open + load_cache (stream)", time_best(iterations, [&]() {
+          elf::elf_file file(path, options);
+          return file.load_cache(cache_path);
+      }));
+    }
+    print_case(mapped ? "Relocations (mapped)" : "Relocations (stream)", time_best(iterations, [&]() {
+        auto file = std::make_unique<elf::elf_file>(path, options);
+        file->get_section_headers();
+        return file;
+    }, [](const std::unique_ptr<elf::elf_file> &file) {
+        file->get_relocations();
+        return !file->error();
+    }));
+    print_case(mapped ? "Relocations, streamed (mapped)" : "Relocations, streamed (stream)", time_best(iterations, [&]() {
+        auto file = std::make_unique<elf::elf_file>(path, options);
+        file->get_dynamic_entries();
+        return file;
+    }, [&](const std::unique_ptr<elf::elf_file> &file) {
+        for (const elf::relocation_kind kind: {elf::relocation_kind::dynamic, elf::relocation_kind::plt, elf::relocation_kind::relative})
+        {
+          for (const elf::elf_rela &relocation: file->get_relocation_range(kind))
+          {
+            relocation_checksum += relocation.r_offset;
+          }
+        }
+        return !file->error();
+    }));
+  }
+
+  if (cached)
+  {
+    std::filesystem::remove(cache_path);
+  }
+
+#if defined(ELF_HPP_POSIX)
+  /*
+   * Map and relocate the file, binding every symbol to one address
+   */
+  if (lib.get_header().e_type == elf::elf_header::ET_DYN)
+  {
+    elf::image_options image_options;
+    image_options.skip_unsupported = true;
+    image_options.resolver = [](const elf::elf_symbol &, std::uint64_t &address) {
+        address = 0x1000;
+        return true;
+    };
+    std::size_t applied = 0;
+    const double image_ms = time_best(iterations, [&]() {
+        const elf::image image(lib, image_options);
+        applied = image.get_relocation_count();
+        return !image.error();
+    });
+    print_case("elf::image, map + relocate", image_ms, applied);
+  }
+#endif
+
+  std::size_t per_entry_bytes = 0, bulk_bytes = 0;
+  print_case("Sections + dynsym, per-entry reads", time_best(iterations, [&]() { return bench_per_entry(path, per_entry_bytes); }));
+  print_case("Sections + dynsym, bulk reads", time_best(iterations, [&]() { return bench_bulk(path, bulk_bytes); }));
+  if (per_entry_bytes != bulk_bytes)
+  {
+    std::cerr << path.string() << ": per-entry and bulk readers disagree" << std::endl;
+  }
+
+  const char *lookup_path = has_gnu_hash ? "gnu" : "sysv";
+  const auto time_lookups = [&](const std::vector<const char *> &names, std::size_t &found) {
+      return time_best(iterations, [&]() {
+          found = 0;
+          for (const char *name: names)
+          {
+            found += lib.get_symbol(name) != dynamic_symbols.cend();
+          }
+          return true;
+      });
+  };
+  std::size_t hits = 0, misses = 0, batch_hits = 0;
+  const double hit_ms = time_lookups(hit_pointers, hits);
+  const double miss_ms = time_lookups(miss_pointers, misses);
+  std::vector<const elf::elf_symbol *> batch_results(hit_pointers.size());
+  const double batch_ms = time_best(iterations, [&]() {
+      batch_hits = lib.get_symbols(hit_pointers, batch_results);
+      return true;
+  });
+  const std::string hit_case = std::string("get_symbol hit (") + lookup_path + ", " + std::to_string(hits) + "/" + std::to_string(hit_pointers.size()) + " found)";
+  const std::string miss_case = std::string("get_symbol miss (") + lookup_path + ", " + std::to_string(misses) + "/" + std::to_string(miss_pointers.size()) + " found)";
+  const std::string batch_case = std::string("get_symbols hit batch (") + std::to_string(batch_hits) + "/" + std::to_string(hit_pointers.size()) + " found)";
+  print_case(hit_case.c_str(), hit_ms, hit_pointers.size());
+  print_case(miss_case.c_str(), miss_ms, miss_pointers.size());
+  print_case(batch_case.c_str(), batch_ms, hit_pointers.size());
+
+  /*
+   * The same lookups once a perfect hash has been built over the symbols
+   */
+  elf::load_options perfect_hash_options;
+  perfect_hash_options.perfect_hash = true;
+  elf::elf_file indexed(path, perfect_hash_options);
+  print_case("Build perfect hash", time_best(iterations, [&]() {
+      return std::make_unique<elf::elf_file>(path);
+  }, [](const std::unique_ptr<elf::elf_file> &file) {
+      return file->parse_dynamic_segment() && file->build_perfect_hash();
+  }));
+  if (indexed.parse_dynamic_segment())
+  {
+    std::size_t indexed_hits = 0, indexed_misses = 0, indexed_batch_hits = 0;
+    const auto time_indexed_lookups = [&](const std::vector<const char *> &names, std::size_t &found) {
+        return time_best(iterations, [&]() {
+            found = 0;
+            for (const char *name: names)
+            {
+              found += indexed.get_symbol(name) != indexed.get_dynamic_symbols().cend();
+            }
+            return true;
+        });
+    };
+    const double indexed_hit_ms = time_indexed_lookups(hit_pointers, indexed_hits);
+    const double indexed_miss_ms = time_indexed_lookups(miss_pointers, indexed_misses);
+    const double indexed_batch_ms = time_best(iterations, [&]() {
+        indexed_batch_hits = indexed.get_symbols(hit_pointers, batch_results);
+        return true;
+    });
+    const std::string indexed_hit_case = "get_symbol hit (perfect hash, " + std::to_string(indexed_hits) + "/" + std::to_string(hit_pointers.size()) + " found)";
+    const std::string indexed_miss_case = "get_symbol miss (perfect hash, " + std::to_string(indexed_misses) + "/" + std::to_string(miss_pointers.size()) + " found)";
+    const std::string indexed_batch_case = "get_symbols hit batch (perfect hash, " + std::to_string(indexed_batch_hits) + "/" + std::to_string(hit_pointers.size()) + " found)";
+    print_case(indexed_hit_case.c_str(), indexed_hit_ms, hit_pointers.size());
+    print_case(indexed_miss_case.c_str(), indexed_miss_ms, miss_pointers.size());
+    print_case(indexed_batch_case.c_str(), indexed_batch_ms, hit_pointers.size());
+  }
+
+  /*
+   * The same lookups through basic_elf_file, which views the mapped image
+   * instead of widening the symbol table into elf_symbols
+   */
+  elf::mapped_file image;
+  if (!image.open(path))
+  {
+    return;
+  }
+  print_case("basic_elf_file view", time_best(iterations, [&]() {
+      return elf::visit_image(image.data(), [](const auto &view) { return !view.error(); });
+  }));
+  std::size_t view_hits = 0;
+  std::size_t view_bytes = 0;
+  const double view_ms = time_best(iterations, [&]() {
+      return elf::visit_image(image.data(), [&](const auto &view) {
+          view_hits = 0;
+          view_bytes = view.get_dynamic_symbols().size_bytes();
+          for (const char *name: hit_pointers)
+          {
+            view_hits += view.get_symbol(name) != nullptr;
+          }
+          return !view.error();
+      });
+  });
+  const std::string view_case = std::string("basic_elf_file get_symbol hit (") + std::to_string(view_hits) + "/" + std::to_string(hit_pointers.size()) + " found)";
+  print_case(view_case.c_str(), view_ms, hit_pointers.size());
+  std::cout << "  Symbol table footprint: " << dynamic_symbols.size() * sizeof(elf::elf_symbol) << " bytes widened, "
+            << view_bytes << " bytes viewed in place" << std::endl;
+}
+
+#if defined(ELF_HPP_POSIX)
+/*
+ * Drop paths from the page cache so the next read of them goes to disk
+ */
+int evict_files(const std::vector<std::filesystem::path> &paths)
+{
+  for (const auto &path: paths)
+  {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd >= 0)
+    {
+      ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+      ::close(fd);
+    }
+  }
+  return 0;
+}
+#endif
+
+/*
+ * Parse every file in directory, serially, on the default executor and
+ * through async_loader
+ */
+void bench_scan(const std::filesystem::path &directory, std::size_t iterations)
+{
+  std::atomic<std::size_t> files = 0, symbols = 0;
+  const auto scan = [&](elf::executor &executor) {
+      elf::scan_options options;
+      options.executor = &executor;
+      files = 0;
+      symbols = 0;
+      elf::scan_directory(directory, [&](const std::filesystem::path &, const elf::elf_file &file) {
+          if (!file.error())
+          {
+            files++;
+            symbols += file.get_dynamic_symbols().size();
+          }
+      }, options);
+      return true;
+  };
+
+  elf::inline_executor serial;
+  const double serial_ms = time_best(iterations, [&]() { return scan(serial); });
+  const double parallel_ms = time_best(iterations, [&]() { return scan(elf::default_executor()); });
+  std::cout << "Scan " << directory.string() << ": " << files << " ELF files, " << symbols << " dynamic symbols" << std::endl;
+  print_case("Serial", serial_ms, files);
+  const std::string parallel_case = "default_executor (" + std::to_string(elf::default_executor().concurrency()) + " workers)";
+  print_case(parallel_case.c_str(), parallel_ms, files);
+
+  std::vector<std::filesystem::path> paths;
+  std::error_code ec;
+  for (std::filesystem::recursive_directory_iterator it(directory, std::filesystem::directory_options::skip_permission_denied, ec), end; !ec && it != end; it.increment(ec))
+  {
+    std::error_code entry_ec;
+    if (it->is_regular_file(entry_ec) && !it->is_symlink(entry_ec))
+    {
+      paths.push_back(it->path());
+    }
+  }
+  const auto load = [&](bool io_uring) {
+      elf::async_loader loader({.io_uring = io_uring});
+      for (const auto &path: paths)
+      {
+        loader.submit(path);
+      }
+      files = 0;
+      symbols = 0;
+      loader.wait_all([&](const std::filesystem::path &, const elf::elf_file &file) {
+          if (!file.error())
+          {
+            files++;
+            symbols += file.get_dynamic_symbols().size();
+          }
+      });
+      return files != 0;
+  };
+  const bool async = elf::async_loader().is_async();
+  print_case(async ? "async_loader, io_uring" : "async_loader, io_uring unavailable", time_best(iterations, [&]() { return load(true); }), files);
+  print_case("async_loader, synchronous", time_best(iterations, [&]() { return load(false); }), files);
+#if defined(ELF_HPP_POSIX)
+  /*
+   * With the files evicted first, which is where reading them through
+   * io_uring pays
+   */
+  print_case("async_loader, io_uring, evicted", time_best(iterations, [&]() { return evict_files(paths); }, [&](int) { return load(true); }), files);
+  print_case("async_loader, synchronous, evicted", time_best(iterations, [&]() { return evict_files(paths); }, [&](int) { return load(false); }), files);
+#endif
+
+  /*
+   * Every dynamic symbol of the directory as elf_symbol entries and as a
+   * symbol_store, filtered for defined functions
+   */
+  std::vector<elf::elf_symbol> entries;
+  elf::symbol_store store;
+  for (const auto &path: paths)
+  {
+    elf::elf_file file(path);
+    if (!file.error() && file.parse_dynamic_segment())
+    {
+      const auto &dynamic_symbols = file.get_dynamic_symbols();
+      entries.insert(entries.end(), dynamic_symbols.begin(), dynamic_symbols.end());
+      store.add(dynamic_symbols);
+    }
+  }
+  store.shrink_to_fit();
+  std::cout << "  symbol_store: " << store.size() << " symbols, " << store.memory_usage() - store.get_names().size() << " bytes of columns and " \
+ << store.get_names().size() << " of names, elf_symbol entries: " << entries.size() * sizeof(elf::elf_symbol) << " bytes" << std::endl;
+  std::vector<std::uint32_t> matches;
+  matches.reserve(entries.size());
+  print_case("Filter defined functions, elf_symbol", time_best(iterations, [&]() {
+      matches.clear();
+      for (std::size_t i = 0; i < entries.size(); i++)
+      {
+        if (entries[i].get_type() == elf::elf_symbol::STT_FUNC && entries[i].st_shndx != elf::elf_section_header::SHN_UNDEF)
+        {
+          matches.push_back(static_cast<std::uint32_t>(i));
+        }
+      }
+      return true;
+  }), entries.size());
+  elf::symbol_filter functions;
+  functions.types = 1 << elf::elf_symbol::STT_FUNC;
+  functions.defined = true;
+  print_case("Filter defined functions, symbol_store", time_best(iterations, [&]() {
+      matches.clear();
+      store.filter(functions, matches);
+      return true;
+  }), store.size());
+}
+
+int main(int argc, char *argv[])
+{
+  std::size_t iterations = 10;
+  std::size_t symbol_count = 20000;
+  std::vector<std::filesystem::path> lib_paths, scan_directories;
+  for (int i = 1; i < argc; i++)
+  {
+    const bool has_value = i + 1 < argc;
+    if (std::strcmp(argv[i], "-n") == 0 && has_value)
+    {
+      iterations = std::max(1, std::atoi(argv[++i]));
+    } else if (std::strcmp(argv[i], "-s") == 0 && has_value)
+    {
+      symbol_count = std::max(1, std::atoi(argv[++i]));
+    } else if (std::strcmp(argv[i], "-d") == 0 && has_value)
+    {
+      scan_directories.emplace_back(argv[++i]);
+    } else if (argv[i][0] == '-')
+    {
+      std::cerr << "Usage: " << std::filesystem::path(argv[0]).filename().string() << " [-n iterations] [-s symbols] [-d directory]... [lib]..." << std::endl;
+      return 1;
+    } else
+    {
+      lib_paths.emplace_back(argv[i]);
+    }
+  }
+
+  const std::filesystem::path corpus_directory = std::filesystem::temp_directory_path() / "elf-bench-corpus";
+  const std::vector<std::filesystem::path> corpus = write_corpus(corpus_directory, symbol_count);
+  for (const auto &path: corpus)
+  {
+    bench_file(path, iterations);
+  }
+  for (const auto &path: lib_paths)
+  {
+    bench_file(path, iterations);
+  }
+  bench_scan(corpus_directory, iterations);
+  for (const auto &directory: scan_directories)
+  {
+    bench_scan(directory, iterations);
+  }
+
+  std::error_code ec;
+  std::filesystem::remove_all(corpus_directory, ec);
+  return 0;
+}
@@ -1,11 +1,74 @@
+#include <atomic>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <sstream>
+#include <tuple>
 #include "elf.hpp"
 
+/*
+ * Count how the tables parse_dynamic_segment reads differ between two
+ * files: one for each symbol, relocation or needed library that differs,
+ * and for each named symbol get_symbol finds at a different index
+ */
+std::size_t count_differences(const elf::elf_file &file, const elf::elf_file &expected)
+{
+  const auto name_of = [](const char *name) { return std::string_view(name != nullptr ? name : ""); };
+  std::size_t differences = name_of(file.get_so_name()) != name_of(expected.get_so_name());
+
+  const auto &symbols = file.get_dynamic_symbols();
+  const auto &expected_symbols = expected.get_dynamic_symbols();
+  differences += symbols.size() != expected_symbols.size();
+  for (std::size_t i = 0; i < std::min(symbols.size(), expected_symbols.size()); i++)
+  {
+    const auto &symbol = symbols[i];
+    const auto &expected_symbol = expected_symbols[i];
+    differences += symbol.get_name() != expected_symbol.get_name() || symbol.st_value != expected_symbol.st_value ||
+                   symbol.st_size != expected_symbol.st_size || symbol.st_info != expected_symbol.st_info ||
+                   symbol.st_other != expected_symbol.st_other || symbol.st_shndx != expected_symbol.st_shndx;
+    if (!expected_symbol.get_name().empty())
+    {
+      differences += file.get_symbol(expected_symbol.get_name()) - symbols.begin() !=
+                     expected.get_symbol(expected_symbol.get_name()) - expected_symbols.begin();
+    }
+  }
+
+  const auto compare_relocations = [&differences](const auto &relocations, const auto &expected_relocations) {
+      differences += relocations.size() != expected_relocations.size();
+      for (std::size_t i = 0; i < std::min(relocations.size(), expected_relocations.size()); i++)
+      {
+        const auto &relocation = relocations[i];
+        const auto &expected_relocation = expected_relocations[i];
+        bool same = relocation.r_offset == expected_relocation.r_offset && relocation.r_type == expected_relocation.r_type &&
+                    relocation.r_sym == expected_relocation.r_sym;
+        if constexpr (std::is_same_v<std::decay_t<decltype(relocation)>, elf::elf_rela>)
+        {
+          same = same && relocation.r_addend == expected_relocation.r_addend;
+        }
+        differences += !same;
+      }
+  };
+  compare_relocations(file.get_relocations(), expected.get_relocations());
+  compare_relocations(file.get_relocations_with_addend(), expected.get_relocations_with_addend());
+  compare_relocations(file.get_plt_relocations(), expected.get_plt_relocations());
+  compare_relocations(file.get_plt_relocations_with_addend(), expected.get_plt_relocations_with_addend());
+
+  const auto &needed = file.get_needed_libraries();
+  const auto &expected_needed = expected.get_needed_libraries();
+  differences += needed.size() != expected_needed.size();
+  for (std::size_t i = 0; i < std::min(needed.size(), expected_needed.size()); i++)
+  {
+    differences += name_of(needed[i]) != name_of(expected_needed[i]);
+  }
+  return differences;
+}
+
 int main(int argc, char *argv[])
 {
   if (argc < 2)
   {
-    std::cerr << "Usage: " << std::filesystem::path(argv[0]).filename().string() << " <lib>" << std::endl;
+    std::cerr << "Usage: " << std::filesystem::path(argv[0]).filename().string() << " <lib> [scan lib]..." << std::endl;
     return 1;
   }
 
@@ -35,7 +98,8 @@ int main(int argc, char *argv[])
  << "  Is 32-bit: " << lib.is_32_bit() << "\n" \
  << "  Is 64-bit: " << lib.is_64_bit() << "\n" \
  << "  Is little-endian: " << lib.is_little_endian() << "\n" \
- << "  Is big-endian: " << lib.is_big_endian() << "\n";
+ << "  Is big-endian: " << lib.is_big_endian() << "\n" \
+ << "  Cache key: " << lib.get_cache_key() << "\n";
 
   const auto &program_headers = lib.get_program_headers();
   std::cout << "Program headers: Start=" << header.e_phoff << " Count=" << header.e_phnum << " Size=" << header.e_phentsize << "\n";
@@ -95,6 +159,8 @@ int main(int argc, char *argv[])
  << "  Relocations with addend: " << lib.get_relocations_with_addend().size() << "\n" \
  << "  PLT relocations without addend: " << lib.get_plt_relocations().size() << "\n" \
  << "  PLT relocations with addend: " << lib.get_plt_relocations_with_addend().size() << "\n";
+  const auto relative_relocations = lib.get_relocation_range(elf::relocation_kind::relative);
+  std::cout << "  Packed relative relocations: " << std::distance(relative_relocations.begin(), relative_relocations.end()) << "\n";
   if (lib.get_symbol("thisisnotasymbol 1337") != lib.get_dynamic_symbols().cend())
   {
     std::cerr << "Found symbol that should not exist" << std::endl;
@@ -106,5 +172,424 @@ int main(int argc, char *argv[])
   std::cout << "Misc:\n" \
  << "  Base Address: 0x" << std::hex << lib.get_base_address() << std::dec << "\n" \
  << "  Initiation functions count: " << lib.get_init_functions().size() << "\n" \
- << "  Termination functions count: " << lib.get_fini_functions().size() << "\n";
+ << "  Termination functions count: " << lib.get_fini_functions().size() << "\n" \
+ << "  Static symbols count: " << lib.get_symbol_table().size() << "\n";
+  const auto *entry_symbol = lib.symbol_for_address(header.e_entry);
+  std::cout << "  Entry point symbol: " << (entry_symbol != nullptr ? entry_symbol->st_name_str : "(none)") << "\n";
+
+#if defined(ELF_HPP_STATS)
+  const elf::parse_stats stats = lib.get_stats();
+  std::cout << "Stats:\n";
+  for (std::size_t i = 0; i < stats.phases.size(); i++)
+  {
+    const elf::phase_stats &phase = stats.phases[i];
+    if (phase.calls == 0)
+    {
+      continue;
+    }
+    std::cout << "  " << elf::parse_phase_str(static_cast<elf::parse_phase>(i)) << ": " << phase.nanoseconds / 1000 << "us, " \
+ << phase.read_calls << " reads of " << phase.bytes_read << " bytes, " << phase.bytes_viewed << " bytes viewed, " \
+ << phase.allocations << " allocations of " << phase.bytes_allocated << " bytes\n";
+  }
+  const std::pair<const char *, const elf::lookup_stats &> lookups[] = {{"GNU hash", stats.gnu_hash}, {"ELF hash", stats.elf_hash}, {"Perfect hash", stats.perfect_hash}};
+  for (const auto &[name, lookup]: lookups)
+  {
+    std::cout << "  " << name << " lookups: " << lookup.lookups << ", " << lookup.hits << " found, " << lookup.filter_rejects << " filtered, " \
+ << lookup.average_chain_length() << " average chain, " << lookup.string_compares << " string compares\n";
+  }
+#endif
+
+  const std::filesystem::path search_paths[] = {lib_path.parent_path()};
+  elf::link_map link_map;
+  if (!link_map.load(lib_path, search_paths) && link_map.get_files().empty())
+  {
+    std::cerr << "Failed to build link map: " << link_map.error_message() << std::endl;
+    return 1;
+  }
+  const auto &plt_relocations = link_map.get_files().front().get_plt_relocations_with_addend();
+  std::vector<elf::resolved_symbol> resolved(plt_relocations.size());
+  const std::size_t resolved_count = link_map.resolve_relocations(0, plt_relocations, resolved);
+  std::cout << "Link map:\n" \
+ << "  Loaded files: " << link_map.get_files().size() << "\n" \
+ << "  Exported symbols: " << link_map.get_symbol_count() << "\n" \
+ << "  Resolved PLT relocations: " << resolved_count << "/" << plt_relocations.size() << "\n";
+  if (link_map.error())
+  {
+    std::cout << "  " << link_map.error_message() << "\n";
+  }
+
+  /*
+   * Parse the scan libs, or lib, across files and within each file on one
+   * pool. Tables of more than 16384 entries are split, so workers wait in
+   * batches nested inside the scan's and must not pick up another file
+   * meanwhile. Every file must match a serial parse of it
+   */
+  std::vector<std::filesystem::path> scan_paths;
+  for (int round = 0; round < 4; round++)
+  {
+    for (int i = 2; i < argc; i++)
+    {
+      scan_paths.emplace_back(argv[i]);
+    }
+    if (argc < 3)
+    {
+      scan_paths.push_back(lib_path);
+    }
+  }
+  elf::thread_pool pool(4);
+  elf::scan_options scan_options;
+  scan_options.executor = &pool;
+  scan_options.load.executor = &pool;
+  std::atomic<std::size_t> largest_table = 0;
+  const std::vector<std::size_t> differing = elf::scan_paths(scan_paths, [&largest_table](const std::filesystem::path &path, const elf::elf_file &file) {
+      elf::elf_file serial(path);
+      serial.parse_dynamic_segment();
+      const std::size_t size = file.get_dynamic_symbols().size();
+      std::size_t seen = largest_table.load();
+      while (seen < size && !largest_table.compare_exchange_weak(seen, size))
+      {
+      }
+      return count_differences(file, serial);
+  }, scan_options);
+  const auto mismatches = std::count_if(differing.begin(), differing.end(), [](std::size_t count) { return count != 0; });
+  std::cout << "Nested parallel scan:\n" \
+ << "  Files: " << scan_paths.size() << "\n" \
+ << "  Largest dynamic symbol table: " << largest_table << "\n" \
+ << "  Files differing from a serial parse: " << mismatches << "\n";
+  if (mismatches != 0)
+  {
+    std::cerr << "Nested parallel scan differs from a serial parse" << std::endl;
+    return 1;
+  }
+
+  /*
+   * Save lib's tables to a cache and map them back into a file that hasn't
+   * parsed anything, which must match the direct parse. A truncated cache
+   * and one keyed by another build ID must both be rejected
+   */
+  const std::filesystem::path cache_path = std::filesystem::temp_directory_path() / "elf-test.elfcache";
+  const std::filesystem::path bad_cache_path = std::filesystem::temp_directory_path() / "elf-test-bad.elfcache";
+  if (!lib.save_cache(cache_path))
+  {
+    std::cerr << "Failed to save cache: " << lib.error_message() << std::endl;
+    return 1;
+  }
+  elf::load_options lazy_options;
+  lazy_options.lazy = true;
+  elf::elf_file cached(lib_path, lazy_options);
+  const bool cache_loaded = cached.load_cache(cache_path);
+  const std::size_t cache_differences = cache_loaded ? count_differences(cached, lib) : 0;
+
+  std::ifstream cache_file(cache_path, std::ios::binary);
+  const std::string cache_contents((std::istreambuf_iterator<char>(cache_file)), std::istreambuf_iterator<char>());
+  const auto rejects = [&](const std::string &contents) {
+      std::ofstream(bad_cache_path, std::ios::binary | std::ios::trunc).write(contents.data(), static_cast<std::streamsize>(contents.size()));
+      elf::elf_file file(lib_path, lazy_options);
+      return !file.load_cache(bad_cache_path);
+  };
+  const bool truncated_rejected = rejects(cache_contents.substr(0, cache_contents.size() / 2));
+  std::string other_key_contents = cache_contents;
+  const std::string key = lib.get_cache_key();
+  const std::size_t key_position = key.empty() ? std::string::npos : other_key_contents.find(key);
+  if (key_position != std::string::npos)
+  {
+    other_key_contents[key_position] = other_key_contents[key_position] == '0' ? '1' : '0';
+  }
+  const bool other_key_rejected = key_position != std::string::npos && rejects(other_key_contents);
+  std::filesystem::remove(cache_path);
+  std::filesystem::remove(bad_cache_path);
+  std::cout << "Cache:\n" \
+ << "  Size: " << cache_contents.size() << "\n" \
+ << "  Loaded: " << cache_loaded << "\n" \
+ << "  Differences from a direct parse: " << cache_differences << "\n" \
+ << "  Truncated cache rejected: " << truncated_rejected << "\n" \
+ << "  Other build ID rejected: " << other_key_rejected << "\n";
+  if (!cache_loaded || cache_differences != 0 || !truncated_rejected || !other_key_rejected)
+  {
+    std::cerr << "Cache doesn't round trip" << std::endl;
+    return 1;
+  }
+
+  /*
+   * Refresh a copy of lib that hasn't changed, then after rewriting it in
+   * place with another library, then after replacing it with lib again.
+   * The other library is the first scan lib, or this program
+   */
+  const std::filesystem::path refresh_path = std::filesystem::temp_directory_path() / "elf-test-refresh.so";
+  const std::filesystem::path replacement_path = std::filesystem::temp_directory_path() / "elf-test-refresh.so.new";
+  const std::filesystem::path other_path = argc > 2 ? argv[2] : argv[0];
+  std::filesystem::copy_file(lib_path, refresh_path, std::filesystem::copy_options::overwrite_existing);
+  elf::elf_file refreshed(refresh_path);
+  refreshed.parse_dynamic_segment();
+  const elf::refresh_result untouched = refreshed.refresh();
+
+  const auto refresh_matches = [&refreshed, &refresh_path]() {
+      elf::elf_file fresh(refresh_path);
+      fresh.parse_dynamic_segment();
+      return !refreshed.error() && !fresh.error() && count_differences(refreshed, fresh) == 0 &&
+             refreshed.get_section_headers().size() == fresh.get_section_headers().size();
+  };
+  std::filesystem::copy_file(other_path, refresh_path, std::filesystem::copy_options::overwrite_existing);
+  const elf::refresh_result rewritten = refreshed.refresh();
+  const bool rewritten_matches = refresh_matches();
+  std::filesystem::copy_file(lib_path, replacement_path, std::filesystem::copy_options::overwrite_existing);
+  std::filesystem::rename(replacement_path, refresh_path);
+  const elf::refresh_result replaced = refreshed.refresh();
+  const bool replaced_matches = refresh_matches();
+  std::filesystem::remove(refresh_path);
+
+  const auto refresh_result_str = [](elf::refresh_result result) {
+      return result == elf::refresh_result::unchanged ? "unchanged" : result == elf::refresh_result::updated ? "updated" : "failed";
+  };
+  std::cout << "Refresh:\n" \
+ << "  Untouched: " << refresh_result_str(untouched) << "\n" \
+ << "  Rewritten with " << other_path.filename().string() << ": " << refresh_result_str(rewritten) << ", matches a fresh parse: " << rewritten_matches << "\n" \
+ << "  Replaced with " << lib_path.filename().string() << ": " << refresh_result_str(replaced) << ", matches a fresh parse: " << replaced_matches << "\n";
+  if (untouched != elf::refresh_result::unchanged || rewritten != elf::refresh_result::updated || !rewritten_matches ||
+      replaced != elf::refresh_result::updated || !replaced_matches)
+  {
+    std::cerr << "Refresh doesn't match the file on disk" << std::endl;
+    return 1;
+  }
+
+  /*
+   * Filter the dynamic symbols of lib and the scan libs in a symbol_store,
+   * through filter and through the kernel of every SIMD level this machine
+   * has, and compare the indices with a plain loop over the symbols
+   */
+  std::vector<elf::elf_file> filter_files;
+  filter_files.emplace_back(lib_path);
+  for (int i = 2; i < argc; i++)
+  {
+    filter_files.emplace_back(argv[i]);
+  }
+  elf::symbol_store store;
+  std::vector<const elf::elf_symbol *> stored_symbols;
+  for (auto &file: filter_files)
+  {
+    file.parse_dynamic_segment();
+    store.add(file.get_dynamic_symbols());
+    for (const auto &symbol: file.get_dynamic_symbols())
+    {
+      stored_symbols.push_back(&symbol);
+    }
+  }
+  std::vector<elf::symbol_filter> filters(6);
+  filters[1].types = 1 << elf::elf_symbol::STT_FUNC;
+  filters[2].types = 1 << elf::elf_symbol::STT_OBJECT;
+  filters[2].bindings = 1 << elf::elf_symbol::STB_WEAK;
+  filters[3].bindings = 1 << elf::elf_symbol::STB_GLOBAL;
+  filters[3].defined = true;
+  filters[4].section = stored_symbols.size() > 1 ? stored_symbols[1]->st_shndx : 0;
+  filters[5].section = 0x10000u + filters[4].section;
+  std::vector<elf::detail::simd_level> levels = {elf::detail::simd_level::scalar};
+  if (elf::detail::get_simd_level() == elf::detail::simd_level::neon)
+  {
+    levels.push_back(elf::detail::simd_level::neon);
+  } else if (elf::detail::get_simd_level() != elf::detail::simd_level::scalar)
+  {
+    levels.push_back(elf::detail::simd_level::sse4_2);
+    if (elf::detail::get_simd_level() == elf::detail::simd_level::avx2)
+    {
+      levels.push_back(elf::detail::simd_level::avx2);
+    }
+  }
+  std::size_t filter_mismatches = 0;
+  for (const auto &filter: filters)
+  {
+    std::vector<std::uint32_t> expected;
+    for (std::size_t i = 0; i < stored_symbols.size(); i++)
+    {
+      const elf::elf_symbol &symbol = *stored_symbols[i];
+      if ((filter.types >> (symbol.st_info & 0xf) & 1) != 0 && (filter.bindings >> (symbol.st_info >> 4) & 1) != 0 &&
+          (!filter.defined || symbol.st_shndx != elf::elf_section_header::SHN_UNDEF) &&
+          (filter.section == elf::symbol_filter::any_section || filter.section == symbol.st_shndx))
+      {
+        expected.push_back(static_cast<std::uint32_t>(i));
+      }
+    }
+    std::vector<std::uint32_t> found;
+    for (std::size_t file = 0; file < store.file_count(); file++)
+    {
+      store.filter(filter, found, store.file_begin(file), store.file_end(file));
+    }
+    filter_mismatches += found != expected;
+    for (const auto level: levels)
+    {
+      found.clear();
+      elf::detail::filter_symbols(store.get_infos().data(), store.get_section_indices().data(), store.size(), filter, 0, found, level);
+      filter_mismatches += found != expected;
+    }
+  }
+  std::cout << "Symbol store filters:\n" \
+ << "  Symbols: " << store.size() << " in " << store.file_count() << " files\n" \
+ << "  SIMD levels: " << levels.size() << "\n" \
+ << "  Results differing from a plain loop: " << filter_mismatches << "\n";
+  if (filter_mismatches != 0)
+  {
+    std::cerr << "Symbol store filters differ from a plain loop" << std::endl;
+    return 1;
+  }
+
+  /*
+   * Map lib and the scan libs as images. Every relative relocation,
+   * DT_RELR included, must leave the load bias plus its addend in the image,
+   * the addend of REL and DT_RELR entries being the word in an unrelocated
+   * image. Pages of a single segment must have its protections and
+   * PT_GNU_RELRO must be read-only
+   */
+  const long page_size = ::sysconf(_SC_PAGESIZE);
+  std::size_t relative_count = 0, relative_mismatches = 0, page_count = 0, page_mismatches = 0;
+  for (const auto &file: filter_files)
+  {
+    elf::image_options image_options;
+    image_options.skip_unsupported = true;
+    image_options.resolver = [](const elf::elf_symbol &, std::uint64_t &address) {
+        address = 0;
+        return true;
+    };
+    const elf::image relocated(file, image_options);
+    image_options.relocate = false;
+    const elf::image unrelocated(file, image_options);
+    if (!relocated.is_mapped() || !unrelocated.is_mapped())
+    {
+      std::cerr << "Failed to map " << file.get_path() << ": " << relocated.error_message() << unrelocated.error_message() << std::endl;
+      return 1;
+    }
+    const std::size_t word_size = file.is_64_bit() ? 8 : 4;
+    const std::uint32_t relative_type = file.get_header().e_machine == elf::elf_header::EM_386 ? elf::elf_rel::R_386_RELATIVE
+                                      : elf::elf_rel::R_X86_64_RELATIVE;
+    const bool addends[] = {!file.get_relocations_with_addend().empty(), !file.get_plt_relocations_with_addend().empty(), false};
+    const elf::relocation_kind kinds[] = {elf::relocation_kind::dynamic, elf::relocation_kind::plt, elf::relocation_kind::relative};
+    for (std::size_t k = 0; k < std::size(kinds); k++)
+    {
+      for (const auto &relocation: file.get_relocation_range(kinds[k]))
+      {
+        if (relocation.r_type != relative_type)
+        {
+          continue;
+        }
+        const void *word = relocated.get_address(relocation.r_offset);
+        const void *raw_word = unrelocated.get_address(relocation.r_offset);
+        relative_count++;
+        if (word == nullptr || raw_word == nullptr)
+        {
+          relative_mismatches++;
+          continue;
+        }
+        std::uint64_t value = 0, addend = 0;
+        std::memcpy(&value, word, word_size);
+        std::memcpy(&addend, raw_word, word_size);
+        if (addends[k])
+        {
+          addend = relocation.r_addend;
+        }
+        std::uint64_t expected = relocated.get_load_bias() + addend;
+        if (word_size == 4)
+        {
+          expected &= 0xffffffff;
+        }
+        relative_mismatches += value != expected;
+      }
+    }
+
+    std::vector<std::tuple<std::uintptr_t, std::uintptr_t, std::string>> mappings;
+    std::ifstream maps("/proc/self/maps");
+    std::string line;
+    while (std::getline(maps, line))
+    {
+      std::uintptr_t start = 0, end = 0;
+      char dash = 0;
+      std::string permissions;
+      std::istringstream fields(line);
+      fields >> std::hex >> start >> dash >> end >> permissions;
+      mappings.emplace_back(start, end, permissions.substr(0, 3));
+    }
+    const auto protection_of = [&](std::uintptr_t page) {
+        for (const auto &[start, end, permissions]: mappings)
+        {
+          if (page >= start && page < end)
+          {
+            return permissions;
+          }
+        }
+        return std::string("unmapped");
+    };
+    const auto page_of = [&](std::uint64_t virtual_address) {
+        return virtual_address & ~static_cast<std::uint64_t>(page_size - 1);
+    };
+    std::uint64_t relro_begin = 0, relro_end = 0;
+    for (const auto &header: file.get_program_headers())
+    {
+      if (header.p_type == elf::elf_program_header::PT_GNU_RELRO)
+      {
+        relro_begin = page_of(header.p_vaddr);
+        relro_end = page_of(header.p_vaddr + header.p_memsz);
+      }
+    }
+    for (const auto &header: file.get_program_headers())
+    {
+      if (header.p_type != elf::elf_program_header::PT_LOAD || header.p_memsz == 0)
+      {
+        continue;
+      }
+      const std::string expected = std::string(header.p_flags & elf::elf_program_header::PF_R ? "r" : "-") +
+                                   (header.p_flags & elf::elf_program_header::PF_W ? "w" : "-") +
+                                   (header.p_flags & elf::elf_program_header::PF_X ? "x" : "-");
+      for (std::uint64_t page = page_of(header.p_vaddr); page < header.p_vaddr + header.p_memsz; page += page_size)
+      {
+        bool shared = false;
+        for (const auto &other: file.get_program_headers())
+        {
+          shared |= &other != &header && other.p_type == elf::elf_program_header::PT_LOAD &&
+                    page < other.p_vaddr + other.p_memsz && page + page_size > other.p_vaddr;
+        }
+        const bool relro = page >= relro_begin && page < relro_end;
+        if (shared && !relro)
+        {
+          continue;
+        }
+        page_count++;
+        page_mismatches += protection_of(reinterpret_cast<std::uintptr_t>(relocated.get_address(page < header.p_vaddr ? header.p_vaddr : page)) &
+                                         ~static_cast<std::uintptr_t>(page_size - 1)) != (relro ? "r--" : expected);
+      }
+    }
+  }
+  std::cout << "Images:\n" \
+ << "  Relative relocations: " << relative_count << ", " << relative_mismatches << " not the load bias plus their addend\n" \
+ << "  Pages: " << page_count << ", " << page_mismatches << " with protections other than their segment's\n";
+  if (relative_mismatches != 0 || page_mismatches != 0)
+  {
+    std::cerr << "Images differ from their files" << std::endl;
+    return 1;
+  }
+
+  /*
+   * Load the scan paths through async_loader, with io_uring where it is
+   * available and synchronously. Every file must match a serial parse
+   */
+  std::cout << "Async loader:\n";
+  for (const bool io_uring: {true, false})
+  {
+    elf::async_load_options async_options;
+    async_options.io_uring = io_uring;
+    elf::async_loader loader(async_options);
+    for (const auto &path: scan_paths)
+    {
+      loader.submit(path);
+    }
+    std::size_t async_mismatches = 0;
+    const std::size_t delivered = loader.wait_all([&async_mismatches](const std::filesystem::path &path, const elf::elf_file &file) {
+        elf::elf_file serial(path);
+        serial.parse_dynamic_segment();
+        async_mismatches += count_differences(file, serial) != 0;
+    });
+    std::cout << "  " << (loader.is_async() ? "io_uring" : "Synchronous") << ": " << delivered << "/" << scan_paths.size() << " files, " \
+ << async_mismatches << " differing from a serial parse\n";
+    if (delivered != scan_paths.size() || async_mismatches != 0)
+    {
+      std::cerr << "Async loader differs from a serial parse" << std::endl;
+      return 1;
+    }
+  }
 }
@@ -19,10 +19,73 @@
 #include <fstream>
 #include <utility>
 #include <vector>
+#include <memory_resource>
+#include <deque>
 #include <cstdint>
+#include <cstddef>
 #include <variant>
 #include <cstring>
 #include <algorithm>
+#include <span>
+#include <array>
+#include <limits>
+#include <stdexcept>
+#include <functional>
+#include <memory>
+#include <new>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <semaphore>
+#include <type_traits>
+#include <bit>
+#include <iterator>
+#include <string_view>
+#include <numeric>
+#include "executor.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define ELF_HPP_POSIX 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#define ELF_HPP_INOTIFY 1
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+
+/*
+ * Define ELF_HPP_NO_IO_URING to have async_loader always load files synchronously
+ */
+#if !defined(ELF_HPP_NO_IO_URING) && defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define ELF_HPP_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#endif
+
+/*
+ * Define ELF_HPP_NO_SIMD to build the hash functions without SIMD
+ */
+#if !defined(ELF_HPP_NO_SIMD) && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define ELF_HPP_X86_SIMD 1
+#include <immintrin.h>
+#elif !defined(ELF_HPP_NO_SIMD) && defined(__aarch64__) && defined(__ARM_NEON)
+#define ELF_HPP_NEON 1
+#include <arm_neon.h>
+#endif
+
+/*
+ * Define ELF_HPP_STATS to have each elf_file record what its parse phases and symbol lookups cost, see get_stats.
+ * Without it the counters and timers compile out and get_stats returns zeroes
+ */
+#if defined(ELF_HPP_STATS)
+#include <chrono>
+#endif
 
 /*
  * References:
@@ -39,10 +102,6 @@
  * https://akkadia.org/drepper/dsohowto.pdf
  * https://docs.oracle.com/cd/E23824_01/html/819-0690/chapter6-54839.html
  * https://raw.githubusercontent.com/wiki/hjl-tools/x86-psABI/intel386-psABI-1.1.pdf
- *
- * TODO:
- * - Properly handle endianness
- * - Evaluate std::variant instead of always storing 64-bit values
  */
 
 namespace elf
@@ -50,9 +109,12 @@ namespace elf
     typedef std::uint8_t byte;
 
     /*
-     * All of our bitness-agnostic structures have the same initial layout as
-     * the 64-bit variants, allowing us to skip a copy when loading a 64-bit
-     * file. This means any new fields must be added at the end of the struct.
+     * Only the structures detail::shares_layout names, elf_program_header
+     * and elf_dynamic, plus elf_rel and elf_rela on little-endian hosts,
+     * have the layout of their Elf64 counterparts. Their tables are viewed
+     * in place when a 64-bit file is in our byte order, and static asserts
+     * keep their layouts fixed. Every other structure, such as elf_symbol
+     * with its resolved name, is decoded from the file and can change freely
      */
 
     typedef struct elf_ident
@@ -419,6 +481,12 @@ namespace elf
         std::uint64_t sh_entsize;    /* Size of entries, if section has table */
 
         const char *sh_name_str;     /* Resolved section name */
+        std::uint32_t sh_name_length;  /* Length of sh_name_str */
+
+        std::string_view get_name() const
+        {
+          return {this->sh_name_str, this->sh_name_length};
+        }
     } elf_section_header;
 
     inline static constexpr std::uint32_t GRP_COMDAT = 1;             /* Mark group as COMDAT */
@@ -470,15 +538,65 @@ namespace elf
 
     typedef struct elf_symbol
     {
-        std::uint32_t st_name;    /* Symbol name (string table index) */
-        std::uint64_t st_value;   /* Symbol value */
-        std::uint64_t st_size;    /* Symbol size */
-        ::elf::byte st_info;      /* Symbol type and binding */
-        ::elf::byte st_other;     /* Symbol visibility */
-        std::uint16_t st_shndx;   /* Section index */
-        const char *st_name_str;  /* Resolved symbol name */
+        std::uint32_t st_name;         /* Symbol name (string table index) */
+        std::uint32_t st_name_hash;    /* GNU hash of st_name_str when loaded with hash_names, otherwise 0 */
+        std::uint64_t st_value;        /* Symbol value */
+        std::uint64_t st_size;         /* Symbol size */
+        ::elf::byte st_info;           /* Symbol type and binding */
+        ::elf::byte st_other;          /* Symbol visibility */
+        std::uint16_t st_shndx;        /* Section index */
+        std::uint32_t st_name_length;  /* Length of st_name_str */
+        const char *st_name_str;       /* Resolved symbol name */
 
         inline static constexpr std::uint32_t STN_UNDEF = 0;  /* End of chain identifier */
+
+        inline static constexpr ::elf::byte STB_LOCAL = 0;        /* Local symbol */
+        inline static constexpr ::elf::byte STB_GLOBAL = 1;       /* Global symbol */
+        inline static constexpr ::elf::byte STB_WEAK = 2;         /* Weak symbol */
+        inline static constexpr ::elf::byte STB_GNU_UNIQUE = 10;  /* Unique symbol */
+
+        inline static constexpr ::elf::byte STT_NOTYPE = 0;       /* Symbol type is unspecified */
+        inline static constexpr ::elf::byte STT_OBJECT = 1;       /* Symbol is a data object */
+        inline static constexpr ::elf::byte STT_FUNC = 2;         /* Symbol is a code object */
+        inline static constexpr ::elf::byte STT_SECTION = 3;      /* Symbol associated with a section */
+        inline static constexpr ::elf::byte STT_FILE = 4;         /* Symbol's name is file name */
+        inline static constexpr ::elf::byte STT_COMMON = 5;       /* Symbol is a common data object */
+        inline static constexpr ::elf::byte STT_TLS = 6;          /* Symbol is thread-local data object */
+        inline static constexpr ::elf::byte STT_GNU_IFUNC = 10;   /* Symbol is indirect code object */
+
+        inline static constexpr ::elf::byte STV_DEFAULT = 0;      /* Default symbol visibility rules */
+        inline static constexpr ::elf::byte STV_INTERNAL = 1;     /* Processor specific hidden class */
+        inline static constexpr ::elf::byte STV_HIDDEN = 2;       /* Symbol unavailable in other modules */
+        inline static constexpr ::elf::byte STV_PROTECTED = 3;    /* Not preemptible, not exported */
+
+        /*
+         * Get the binding from st_info, one of STB_*
+         */
+        ::elf::byte get_binding() const
+        {
+          return this->st_info >> 4;
+        }
+
+        /*
+         * Get the type from st_info, one of STT_*
+         */
+        ::elf::byte get_type() const
+        {
+          return this->st_info & 0xf;
+        }
+
+        /*
+         * Get the visibility from st_other, one of STV_*
+         */
+        ::elf::byte get_visibility() const
+        {
+          return this->st_other & 0x3;
+        }
+
+        std::string_view get_name() const
+        {
+          return {this->st_name_str, this->st_name_length};
+        }
     } elf_symbol;
 
     typedef struct elf_dynamic
@@ -747,6 +865,31 @@ namespace elf
         std::int64_t r_addend;   /* Addend */
     } elf_rela;
 
+    /*
+     * The relocation tables named by the dynamic segment: DT_REL or
+     * DT_RELA, the PLT relocations at DT_JMPREL and the packed relative
+     * relocations at DT_RELR
+     */
+    enum class relocation_kind : std::uint8_t
+    {
+        dynamic = 0,
+        plt,
+        relative
+    };
+
+    typedef struct elf_note
+    {
+        inline static constexpr std::uint32_t NT_GNU_ABI_TAG = 1;          /* ABI information */
+        inline static constexpr std::uint32_t NT_GNU_HWCAP = 2;            /* Synthetic hwcap information */
+        inline static constexpr std::uint32_t NT_GNU_BUILD_ID = 3;         /* Build ID bits as generated by ld --build-id */
+        inline static constexpr std::uint32_t NT_GNU_GOLD_VERSION = 4;     /* Version note generated by GNU gold */
+        inline static constexpr std::uint32_t NT_GNU_PROPERTY_TYPE_0 = 5;  /* Program property */
+
+        std::uint32_t n_namesz;  /* Length of the note's name */
+        std::uint32_t n_descsz;  /* Length of the note's descriptor */
+        std::uint32_t n_type;    /* Type of the note */
+    } elf_note;
+
     /*
      * Standard ELF structures
      */
@@ -919,1290 +1062,8955 @@ namespace elf
             Elf64_Xword r_info;
             Elf64_Sxword r_addend;
         } Elf64_Rela;
-    }
 
-    /*
-     * Compute the ELF hash value for a symbol name
-     */
-    inline std::uint_fast32_t elf_hash(const char *name)
-    {
-      std::uint_fast32_t h = 0, g;
-      auto *uname = reinterpret_cast<const unsigned char *>(name);
-      while (*uname)
-      {
-        h = (h << 4) + *uname++;
-        if (g = h & 0xf0000000; g)
-          h ^= g >> 24;
-        h &= ~g;
-      }
-      return h;
+        typedef struct Elf32_Nhdr
+        {
+            Elf32_Word n_namesz;
+            Elf32_Word n_descsz;
+            Elf32_Word n_type;
+        } Elf32_Nhdr;
+
+        typedef struct Elf64_Nhdr
+        {
+            Elf64_Word n_namesz;
+            Elf64_Word n_descsz;
+            Elf64_Word n_type;
+        } Elf64_Nhdr;
     }
 
-    /*
-     * Compute the GNU hash value for a symbol name
-     *
-     * References:
-     *  https://blogs.oracle.com/solaris/post/gnu-hash-elf-sections
-     *  https://sourceware.org/legacy-ml/binutils/2006-10/msg00377.html
-     */
-    inline uint_fast32_t gnu_hash(const char *s)
+    namespace detail
     {
-      uint_fast32_t h = 5381;
+        template<typename T>
+        constexpr T byte_swap(T value)
+        {
+          static_assert(std::is_integral_v<T>, "byte_swap takes an integer");
+          using unsigned_type = std::make_unsigned_t<T>;
+          auto bits = static_cast<unsigned_type>(value);
+#if defined(__GNUC__) || defined(__clang__)
+          if constexpr (sizeof(T) == 2)
+          {
+            return static_cast<T>(__builtin_bswap16(bits));
+          } else if constexpr (sizeof(T) == 4)
+          {
+            return static_cast<T>(__builtin_bswap32(bits));
+          } else if constexpr (sizeof(T) == 8)
+          {
+            return static_cast<T>(__builtin_bswap64(bits));
+          }
+#endif
+          unsigned_type swapped = 0;
+          for (std::size_t i = 0; i < sizeof(T); i++)
+          {
+            swapped = static_cast<unsigned_type>(swapped << 8 | (bits & 0xff));
+            bits = static_cast<unsigned_type>(bits >> 8);
+          }
+          return static_cast<T>(swapped);
+        }
+
+        template<::elf::byte Class>
+        struct elf_class_types;
+
+        template<>
+        struct elf_class_types<::elf::elf_ident::ELFCLASS32>
+        {
+            using Ehdr = ::elf::types::Elf32_Ehdr;
+            using Phdr = ::elf::types::Elf32_Phdr;
+            using Shdr = ::elf::types::Elf32_Shdr;
+            using Sym = ::elf::types::Elf32_Sym;
+            using Dyn = ::elf::types::Elf32_Dyn;
+            using Rel = ::elf::types::Elf32_Rel;
+            using Rela = ::elf::types::Elf32_Rela;
+            using Addr = ::elf::types::Elf32_Addr;  /* Also the size of GNU hash bloom words */
+            using Nhdr = ::elf::types::Elf32_Nhdr;
+
+            static constexpr std::uint32_t r_type(::elf::types::Elf32_Word info)
+            {
+              return info & 0xff;
+            }
+
+            static constexpr std::uint32_t r_sym(::elf::types::Elf32_Word info)
+            {
+              return info >> 8;
+            }
+        };
+
+        template<>
+        struct elf_class_types<::elf::elf_ident::ELFCLASS64>
+        {
+            using Ehdr = ::elf::types::Elf64_Ehdr;
+            using Phdr = ::elf::types::Elf64_Phdr;
+            using Shdr = ::elf::types::Elf64_Shdr;
+            using Sym = ::elf::types::Elf64_Sym;
+            using Dyn = ::elf::types::Elf64_Dyn;
+            using Rel = ::elf::types::Elf64_Rel;
+            using Rela = ::elf::types::Elf64_Rela;
+            using Addr = ::elf::types::Elf64_Addr;
+            using Nhdr = ::elf::types::Elf64_Nhdr;
+
+            static constexpr std::uint32_t r_type(::elf::types::Elf64_Xword info)
+            {
+              return static_cast<std::uint32_t>(info & 0xffffffff);
+            }
 
-      for (unsigned char c = *s; c != '\0'; c = *++s)
-        h = h * 33 + c;
+            static constexpr std::uint32_t r_sym(::elf::types::Elf64_Xword info)
+            {
+              return static_cast<std::uint32_t>(info >> 32);
+            }
+        };
+
+        /*
+         * Whether a bitness-agnostic structure has the layout of the on-disk
+         * one, so a file in our byte order can be viewed without decoding
+         */
+        template<typename Raw, typename Entry>
+        inline constexpr bool shares_layout = std::is_same_v<Raw, Entry>;
+
+        template<>
+        inline constexpr bool shares_layout<::elf::types::Elf64_Phdr, ::elf::elf_program_header> = true;
+
+        template<>
+        inline constexpr bool shares_layout<::elf::types::Elf64_Dyn, ::elf::elf_dynamic> = true;
 
-      return h & 0xffffffff;
+        /*
+         * r_type and r_sym are the low and high halves of r_info
+         */
+        template<>
+        inline constexpr bool shares_layout<::elf::types::Elf64_Rel, ::elf::elf_rel> = std::endian::native == std::endian::little;
+
+        template<>
+        inline constexpr bool shares_layout<::elf::types::Elf64_Rela, ::elf::elf_rela> = std::endian::native == std::endian::little;
+
+        /*
+         * Tables of the types above are viewed in place, so a field added
+         * to one of them must break the build rather than misread a file
+         */
+        static_assert(sizeof(::elf::elf_program_header) == sizeof(::elf::types::Elf64_Phdr));
+        static_assert(offsetof(::elf::elf_program_header, p_type) == offsetof(::elf::types::Elf64_Phdr, p_type));
+        static_assert(offsetof(::elf::elf_program_header, p_flags) == offsetof(::elf::types::Elf64_Phdr, p_flags));
+        static_assert(offsetof(::elf::elf_program_header, p_offset) == offsetof(::elf::types::Elf64_Phdr, p_offset));
+        static_assert(offsetof(::elf::elf_program_header, p_vaddr) == offsetof(::elf::types::Elf64_Phdr, p_vaddr));
+        static_assert(offsetof(::elf::elf_program_header, p_paddr) == offsetof(::elf::types::Elf64_Phdr, p_paddr));
+        static_assert(offsetof(::elf::elf_program_header, p_filesz) == offsetof(::elf::types::Elf64_Phdr, p_filesz));
+        static_assert(offsetof(::elf::elf_program_header, p_memsz) == offsetof(::elf::types::Elf64_Phdr, p_memsz));
+        static_assert(offsetof(::elf::elf_program_header, p_align) == offsetof(::elf::types::Elf64_Phdr, p_align));
+
+        static_assert(sizeof(::elf::elf_dynamic) == sizeof(::elf::types::Elf64_Dyn));
+        static_assert(offsetof(::elf::elf_dynamic, d_tag) == offsetof(::elf::types::Elf64_Dyn, d_tag));
+        static_assert(offsetof(::elf::elf_dynamic, d_un) == offsetof(::elf::types::Elf64_Dyn, d_un));
+        static_assert(sizeof(::elf::elf_dynamic::d_un) == sizeof(::elf::types::Elf64_Dyn::d_un));
+
+        /*
+         * r_type and r_sym together cover r_info
+         */
+        static_assert(sizeof(::elf::elf_rel) == sizeof(::elf::types::Elf64_Rel));
+        static_assert(offsetof(::elf::elf_rel, r_offset) == offsetof(::elf::types::Elf64_Rel, r_offset));
+        static_assert(offsetof(::elf::elf_rel, r_type) == offsetof(::elf::types::Elf64_Rel, r_info));
+        static_assert(offsetof(::elf::elf_rel, r_sym) == offsetof(::elf::types::Elf64_Rel, r_info) + sizeof(std::uint32_t));
+
+        static_assert(sizeof(::elf::elf_rela) == sizeof(::elf::types::Elf64_Rela));
+        static_assert(offsetof(::elf::elf_rela, r_offset) == offsetof(::elf::types::Elf64_Rela, r_offset));
+        static_assert(offsetof(::elf::elf_rela, r_type) == offsetof(::elf::types::Elf64_Rela, r_info));
+        static_assert(offsetof(::elf::elf_rela, r_sym) == offsetof(::elf::types::Elf64_Rela, r_info) + sizeof(std::uint32_t));
+        static_assert(offsetof(::elf::elf_rela, r_addend) == offsetof(::elf::types::Elf64_Rela, r_addend));
     }
 
     /*
-     * Read and parse an ELF file into a set of structures
+     * The on-disk structures of one ELF class in one byte order. Readers are
+     * written once against a layout and instantiated for each kind of file,
+     * so nothing branches on the class per entry, and get() byte-swaps a
+     * field only when the file's byte order differs from ours
      */
-    class elf_file
+    template<::elf::byte Class, std::endian Endian>
+    struct elf_layout : ::elf::detail::elf_class_types<Class>
     {
-    public:
-        explicit elf_file(std::filesystem::path path) : path(std::move(path))
+        inline static constexpr ::elf::byte elf_class = Class;
+        inline static constexpr std::endian endian = Endian;
+        inline static constexpr bool is_native = Endian == std::endian::native;
+
+        template<typename T>
+        static constexpr T get(T value)
         {
-          if (!this->open_file())
+          if constexpr (is_native || sizeof(T) == 1)
           {
-            return;
-          }
-          if (
-                  !this->read_elf_header() ||
-                  !this->read_program_headers() ||
-                  !this->read_section_headers() ||
-                  !this->read_init_functions() ||
-                  !this->read_term_functions()
-                  )
+            return value;
+          } else
           {
-            return;
+            return ::elf::detail::byte_swap(value);
           }
-        };
+        }
+    };
 
+    namespace detail
+    {
         /*
-         * Check if an error occurred
+         * Instruction sets the hash kernels may use. x86 extensions are
+         * detected at runtime, NEON is part of the aarch64 baseline
          */
-        bool error() const
+        enum class simd_level
         {
-          return !this->last_error.empty();
+            scalar = 0,
+            sse4_2,
+            avx2,
+            neon,
+        };
+
+        inline simd_level detect_simd_level()
+        {
+#if defined(ELF_HPP_X86_SIMD)
+          __builtin_cpu_init();
+          if (__builtin_cpu_supports("avx2"))
+            return simd_level::avx2;
+          if (__builtin_cpu_supports("sse4.2"))
+            return simd_level::sse4_2;
+          return simd_level::scalar;
+#elif defined(ELF_HPP_NEON)
+          return simd_level::neon;
+#else
+          return simd_level::scalar;
+#endif
         }
 
         /*
-         * Get a message for the last error that occurred
+         * The level the hash functions dispatch on, detected once
          */
-        const std::string &error_message() const
+        inline simd_level get_simd_level()
         {
-          return this->last_error;
+          static const simd_level level = detect_simd_level();
+          return level;
         }
 
         /*
-         * Clear the current error
+         * 33^exponent modulo 2^32
          */
-        void clear_error()
+        constexpr std::uint32_t pow33(std::size_t exponent)
         {
-          this->last_error = "";
+          std::uint32_t result = 1, base = 33;
+          for (; exponent != 0; exponent >>= 1)
+          {
+            if (exponent & 1)
+              result *= base;
+            base *= base;
+          }
+          return result;
         }
 
         /*
-         * Get a bitness-agnostic Elf*_Ehdr structure
+         * Weight of each byte within one step of the vector GNU hash, 33 to
+         * the power of its distance from the end of the step
          */
-        const ::elf::elf_header &get_header() const
+        template<std::size_t Step>
+        constexpr std::array<std::uint32_t, Step> gnu_hash_weights()
         {
-          return this->header;
+          std::array<std::uint32_t, Step> weights{};
+          for (std::size_t i = 0; i < Step; i++)
+            weights[i] = pow33(Step - 1 - i);
+          return weights;
         }
 
+        inline constexpr std::array<std::uint32_t, 16> gnu_hash_weights_16 = gnu_hash_weights<16>();
+        inline constexpr std::array<std::uint32_t, 32> gnu_hash_weights_32 = gnu_hash_weights<32>();
+
         /*
-         * Get a vector of bitness-agnostic Elf*_Phdr structures
+         * Names at least this long are hashed one at a time with the vector
+         * GNU hash, shorter ones are spread across lanes
          */
-        const std::vector<::elf::elf_program_header> &get_program_headers() const
-        {
-          return this->program_headers;
-        }
+        inline constexpr std::size_t gnu_hash_vector_min_length = 32;
 
         /*
-         * Get a vector of bitness-agnostic Elf*_Shdr structures
+         * Longer names are hashed alone so they don't hold a group of lanes
          */
-        const std::vector<::elf::elf_section_header> &get_section_headers() const
+        inline constexpr std::size_t hash_lane_max_length = 4096;
+
+        inline std::uint32_t load_u32(const unsigned char *data)
         {
-          return this->section_headers;
+          std::uint32_t value;
+          std::memcpy(&value, data, sizeof(value));
+          return value;
         }
 
-        /*
-         * Get a vector of addresses of initialization functions. Addresses
-         * assume the file is loaded at its base address. They are in order
-         * of .preinit_array, .init, .init_array
-         */
-        const std::vector<std::uint64_t> &get_init_functions() const
+        inline std::uint32_t gnu_hash_scalar(const unsigned char *s, std::size_t length, std::uint32_t h = 5381)
         {
-          return this->init_functions;
+          for (std::size_t i = 0; i < length; i++)
+            h = h * 33 + s[i];
+          return h;
         }
 
-        /*
-         * Get a vector of addresses of termination functions. Addresses assume
-         * the file is loaded at its base address. They are in order of
-         * .fini_array (reversed), .fini
-         */
-        const std::vector<std::uint64_t> &get_fini_functions() const
+        inline std::uint32_t elf_hash_scalar(const unsigned char *s, std::size_t length, std::uint32_t h = 0)
         {
-          return this->fini_functions;
+          for (std::size_t i = 0; i < length; i++)
+          {
+            h = (h << 4) + s[i];
+            const std::uint32_t g = h & 0xf0000000;
+            h ^= g >> 24;
+            h &= ~g;
+          }
+          return h;
         }
 
         /*
-         * Get the expected base address. This is the virtual address of the
-         * lowest PT_LOAD segment. An executable should be loaded at this
-         * address. Shared libraries can be loaded anywhere as long as the
-         * internal layout and spacing remains the same.
+         * Check both bloom filter bits for a GNU hash. words_mask is the
+         * number of bloom words minus one
          */
-        std::uint64_t get_base_address() const
+        inline bool gnu_bloom_test_scalar(const std::uint64_t *words, std::uint64_t words_mask, std::uint32_t shift, bool is_64_bit, std::uint32_t hash1)
         {
-          return this->base_address;
+          const std::uint32_t bloom_word_size = is_64_bit ? 64 : 32;
+          const std::uint32_t hash2 = hash1 >> (shift % 32);
+          const std::uint64_t bitmask = (static_cast<std::uint64_t>(1) << (hash1 % bloom_word_size)) |
+                                        (static_cast<std::uint64_t>(1) << (hash2 % bloom_word_size));
+          return (words[(hash1 / bloom_word_size) & words_mask] & bitmask) == bitmask;
         }
 
         /*
-         * Check if the ELF file is little endian. Shorthand for
-         * get_header().e_ident.ei_data == ::elf::elf_ident::ELFDATA2LSB
+         * The vector GNU hash relies on
+         *  h(s) = 5381 * 33^n + sum(s[i] * 33^(n - 1 - i))
+         * Each lane of each accumulator owns one byte position within a step.
+         * Per step every lane is multiplied by 33^step and gains its next
+         * byte, then the lanes are scaled by their weight and summed. The
+         * bytes after the last full step continue the scalar recurrence
          */
-        bool is_little_endian() const
+#if defined(ELF_HPP_X86_SIMD)
+        __attribute__((target("sse4.2")))
+        inline std::uint32_t gnu_hash_sse4_2(const unsigned char *s, std::size_t length)
         {
-          return this->header.e_ident.ei_data == ::elf::elf_ident::ELFDATA2LSB;
+          const std::size_t steps = length / 16;
+          const __m128i step_multiplier = _mm_set1_epi32(static_cast<int>(pow33(16)));
+          __m128i acc0 = _mm_setzero_si128(), acc1 = _mm_setzero_si128(), acc2 = _mm_setzero_si128(), acc3 = _mm_setzero_si128();
+          for (std::size_t i = 0; i < steps; i++)
+          {
+            const unsigned char *p = s + i * 16;
+            acc0 = _mm_add_epi32(_mm_mullo_epi32(acc0, step_multiplier), _mm_cvtepu8_epi32(_mm_cvtsi32_si128(static_cast<int>(load_u32(p)))));
+            acc1 = _mm_add_epi32(_mm_mullo_epi32(acc1, step_multiplier), _mm_cvtepu8_epi32(_mm_cvtsi32_si128(static_cast<int>(load_u32(p + 4)))));
+            acc2 = _mm_add_epi32(_mm_mullo_epi32(acc2, step_multiplier), _mm_cvtepu8_epi32(_mm_cvtsi32_si128(static_cast<int>(load_u32(p + 8)))));
+            acc3 = _mm_add_epi32(_mm_mullo_epi32(acc3, step_multiplier), _mm_cvtepu8_epi32(_mm_cvtsi32_si128(static_cast<int>(load_u32(p + 12)))));
+          }
+          const auto *weights = reinterpret_cast<const __m128i *>(gnu_hash_weights_16.data());
+          __m128i sum = _mm_add_epi32(_mm_mullo_epi32(acc0, _mm_loadu_si128(weights)), _mm_mullo_epi32(acc1, _mm_loadu_si128(weights + 1)));
+          sum = _mm_add_epi32(sum, _mm_add_epi32(_mm_mullo_epi32(acc2, _mm_loadu_si128(weights + 2)), _mm_mullo_epi32(acc3, _mm_loadu_si128(weights + 3))));
+          sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4e));
+          sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xb1));
+          const std::uint32_t h = 5381 * pow33(steps * 16) + static_cast<std::uint32_t>(_mm_cvtsi128_si32(sum));
+          return gnu_hash_scalar(s + steps * 16, length - steps * 16, h);
         }
 
-        /*
-         * Check if the ELF file is big endian. Shorthand for
-         * get_header().e_ident.ei_data == ::elf::elf_ident::ELFDATA2MSB
-         */
-        bool is_big_endian() const
+        __attribute__((target("avx2")))
+        inline std::uint32_t gnu_hash_avx2(const unsigned char *s, std::size_t length)
         {
-          return this->header.e_ident.ei_data == ::elf::elf_ident::ELFDATA2MSB;
+          const std::size_t steps = length / 32;
+          const __m256i step_multiplier = _mm256_set1_epi32(static_cast<int>(pow33(32)));
+          __m256i acc0 = _mm256_setzero_si256(), acc1 = _mm256_setzero_si256(), acc2 = _mm256_setzero_si256(), acc3 = _mm256_setzero_si256();
+          for (std::size_t i = 0; i < steps; i++)
+          {
+            const unsigned char *p = s + i * 32;
+            acc0 = _mm256_add_epi32(_mm256_mullo_epi32(acc0, step_multiplier), _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p))));
+            acc1 = _mm256_add_epi32(_mm256_mullo_epi32(acc1, step_multiplier), _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p + 8))));
+            acc2 = _mm256_add_epi32(_mm256_mullo_epi32(acc2, step_multiplier), _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p + 16))));
+            acc3 = _mm256_add_epi32(_mm256_mullo_epi32(acc3, step_multiplier), _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p + 24))));
+          }
+          const auto *weights = reinterpret_cast<const __m256i *>(gnu_hash_weights_32.data());
+          __m256i sum = _mm256_add_epi32(_mm256_mullo_epi32(acc0, _mm256_loadu_si256(weights)), _mm256_mullo_epi32(acc1, _mm256_loadu_si256(weights + 1)));
+          sum = _mm256_add_epi32(sum, _mm256_add_epi32(_mm256_mullo_epi32(acc2, _mm256_loadu_si256(weights + 2)), _mm256_mullo_epi32(acc3, _mm256_loadu_si256(weights + 3))));
+          __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+          half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4e));
+          half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xb1));
+          const std::uint32_t h = 5381 * pow33(steps * 32) + static_cast<std::uint32_t>(_mm_cvtsi128_si32(half));
+          return gnu_hash_scalar(s + steps * 32, length - steps * 32, h);
         }
 
         /*
-         * Check if the ELF file is 32-bit. Shorthand for
-         * get_header().e_ident.ei_class == ::elf::elf_ident::ELFCLASS32
+         * One hash step on every lane, GNU or SysV
          */
-        bool is_32_bit() const
+        template<bool GnuHash>
+        __attribute__((target("sse4.2")))
+        inline __m128i hash_step_sse4_2(__m128i h, __m128i c)
         {
-          return this->header.e_ident.ei_class == ::elf::elf_ident::ELFCLASS32;
+          if constexpr (GnuHash)
+          {
+            return _mm_add_epi32(_mm_add_epi32(_mm_slli_epi32(h, 5), h), c);
+          } else
+          {
+            h = _mm_add_epi32(_mm_slli_epi32(h, 4), c);
+            const __m128i g = _mm_and_si128(h, _mm_set1_epi32(static_cast<int>(0xf0000000)));
+            return _mm_andnot_si128(g, _mm_xor_si128(h, _mm_srli_epi32(g, 24)));
+          }
+        }
+
+        template<bool GnuHash>
+        __attribute__((target("avx2")))
+        inline __m256i hash_step_avx2(__m256i h, __m256i c)
+        {
+          if constexpr (GnuHash)
+          {
+            return _mm256_add_epi32(_mm256_add_epi32(_mm256_slli_epi32(h, 5), h), c);
+          } else
+          {
+            h = _mm256_add_epi32(_mm256_slli_epi32(h, 4), c);
+            const __m256i g = _mm256_and_si256(h, _mm256_set1_epi32(static_cast<int>(0xf0000000)));
+            return _mm256_andnot_si256(g, _mm256_xor_si256(h, _mm256_srli_epi32(g, 24)));
+          }
         }
 
         /*
-         * Check if the ELF file is 64-bit. Shorthand for
-         * get_header().e_ident.ei_class == ::elf::elf_ident::ELFCLASS64
+         * Hash four names at once, one per lane. Lanes consume four bytes
+         * at a time while their name has four bytes left, then finish alone
          */
-        bool is_64_bit() const
+        template<bool GnuHash>
+        __attribute__((target("sse4.2")))
+        inline void hash_lanes_sse4_2(const unsigned char *const *names, const std::size_t *lengths, std::uint32_t *out)
         {
-          return this->header.e_ident.ei_class == ::elf::elf_ident::ELFCLASS64;
+          alignas(16) std::uint32_t lane_values[4];
+          std::size_t longest = 0;
+          for (std::size_t lane = 0; lane < 4; lane++)
+          {
+            lane_values[lane] = static_cast<std::uint32_t>(lengths[lane]);
+            longest = std::max(longest, lengths[lane] & ~static_cast<std::size_t>(3));
+          }
+          const __m128i lane_lengths = _mm_load_si128(reinterpret_cast<const __m128i *>(lane_values));
+          const __m128i byte_mask = _mm_set1_epi32(0xff);
+          __m128i h = _mm_set1_epi32(GnuHash ? 5381 : 0);
+          for (std::size_t offset = 0; offset < longest; offset += 4)
+          {
+            for (std::size_t lane = 0; lane < 4; lane++)
+              lane_values[lane] = offset + 4 <= lengths[lane] ? load_u32(names[lane] + offset) : 0;
+            const __m128i active = _mm_cmpgt_epi32(lane_lengths, _mm_set1_epi32(static_cast<int>(offset + 3)));
+            const __m128i chunk = _mm_load_si128(reinterpret_cast<const __m128i *>(lane_values));
+            __m128i next = hash_step_sse4_2<GnuHash>(h, _mm_and_si128(chunk, byte_mask));
+            next = hash_step_sse4_2<GnuHash>(next, _mm_and_si128(_mm_srli_epi32(chunk, 8), byte_mask));
+            next = hash_step_sse4_2<GnuHash>(next, _mm_and_si128(_mm_srli_epi32(chunk, 16), byte_mask));
+            next = hash_step_sse4_2<GnuHash>(next, _mm_srli_epi32(chunk, 24));
+            h = _mm_blendv_epi8(h, next, active);
+          }
+          _mm_store_si128(reinterpret_cast<__m128i *>(lane_values), h);
+          for (std::size_t lane = 0; lane < 4; lane++)
+          {
+            const std::size_t done = lengths[lane] & ~static_cast<std::size_t>(3);
+            out[lane] = GnuHash ? gnu_hash_scalar(names[lane] + done, lengths[lane] - done, lane_values[lane])
+                                : elf_hash_scalar(names[lane] + done, lengths[lane] - done, lane_values[lane]);
+          }
         }
 
         /*
-         * Get the underlying std::ifstream to read the binary file
+         * Hash eight names at once, gathering four bytes per lane per step.
+         * Lanes without four bytes left are masked out of the gather so
+         * nothing is read past the end of a name
          */
-        std::ifstream &get_binary_file()
+        template<bool GnuHash>
+        __attribute__((target("avx2")))
+        inline void hash_lanes_avx2(const unsigned char *const *names, const std::size_t *lengths, std::uint32_t *out)
         {
-          return this->binary_file;
+          alignas(32) long long addresses[8];
+          alignas(32) std::uint32_t lane_values[8];
+          std::size_t longest = 0;
+          for (std::size_t lane = 0; lane < 8; lane++)
+          {
+            addresses[lane] = static_cast<long long>(reinterpret_cast<std::uintptr_t>(names[lane]));
+            lane_values[lane] = static_cast<std::uint32_t>(lengths[lane]);
+            longest = std::max(longest, lengths[lane] & ~static_cast<std::size_t>(3));
+          }
+          const __m256i addresses_low = _mm256_load_si256(reinterpret_cast<const __m256i *>(addresses));
+          const __m256i addresses_high = _mm256_load_si256(reinterpret_cast<const __m256i *>(addresses + 4));
+          const __m256i lane_lengths = _mm256_load_si256(reinterpret_cast<const __m256i *>(lane_values));
+          const __m256i byte_mask = _mm256_set1_epi32(0xff);
+          __m256i h = _mm256_set1_epi32(GnuHash ? 5381 : 0);
+          for (std::size_t offset = 0; offset < longest; offset += 4)
+          {
+            const __m256i active = _mm256_cmpgt_epi32(lane_lengths, _mm256_set1_epi32(static_cast<int>(offset + 3)));
+            const __m256i offsets = _mm256_set1_epi64x(static_cast<long long>(offset));
+            const __m128i chunk_low = _mm256_mask_i64gather_epi32(_mm_setzero_si128(), nullptr, _mm256_add_epi64(addresses_low, offsets),
+                                                                  _mm256_castsi256_si128(active), 1);
+            const __m128i chunk_high = _mm256_mask_i64gather_epi32(_mm_setzero_si128(), nullptr, _mm256_add_epi64(addresses_high, offsets),
+                                                                   _mm256_extracti128_si256(active, 1), 1);
+            const __m256i chunk = _mm256_set_m128i(chunk_high, chunk_low);
+            __m256i next = hash_step_avx2<GnuHash>(h, _mm256_and_si256(chunk, byte_mask));
+            next = hash_step_avx2<GnuHash>(next, _mm256_and_si256(_mm256_srli_epi32(chunk, 8), byte_mask));
+            next = hash_step_avx2<GnuHash>(next, _mm256_and_si256(_mm256_srli_epi32(chunk, 16), byte_mask));
+            next = hash_step_avx2<GnuHash>(next, _mm256_srli_epi32(chunk, 24));
+            h = _mm256_blendv_epi8(h, next, active);
+          }
+          _mm256_store_si256(reinterpret_cast<__m256i *>(lane_values), h);
+          for (std::size_t lane = 0; lane < 8; lane++)
+          {
+            const std::size_t done = lengths[lane] & ~static_cast<std::size_t>(3);
+            out[lane] = GnuHash ? gnu_hash_scalar(names[lane] + done, lengths[lane] - done, lane_values[lane])
+                                : elf_hash_scalar(names[lane] + done, lengths[lane] - done, lane_values[lane]);
+          }
         }
 
         /*
-         * Parse the dynamic segment of the ELF file including symbols
+         * Bloom test four hashes at a time with a gather of their words.
+         * pass[i] is set to 1 when both bits of hashes[i] are present
          */
-        bool parse_dynamic_segment()
+        __attribute__((target("avx2")))
+        inline void gnu_bloom_test_avx2(const std::uint64_t *words, std::uint64_t words_mask, std::uint32_t shift, bool is_64_bit,
+                                        const std::uint32_t *hashes, std::size_t count, std::uint8_t *pass)
         {
-          if (!this->binary_file.is_open())
+          const __m128i word_shift = _mm_cvtsi32_si128(is_64_bit ? 6 : 5);
+          const __m128i hash2_shift = _mm_cvtsi32_si128(static_cast<int>(shift % 32));
+          const __m256i bit_mask = _mm256_set1_epi64x(is_64_bit ? 63 : 31);
+          const __m256i index_mask = _mm256_set1_epi64x(static_cast<long long>(words_mask));
+          const __m256i one = _mm256_set1_epi64x(1);
+          std::size_t i = 0;
+          for (; i + 4 <= count; i += 4)
           {
-            this->last_error = "Binary file is not open";
-            return false;
+            const __m256i hash1 = _mm256_cvtepu32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i *>(hashes + i)));
+            const __m256i hash2 = _mm256_srl_epi64(hash1, hash2_shift);
+            const __m256i index = _mm256_and_si256(_mm256_srl_epi64(hash1, word_shift), index_mask);
+            const __m256i word = _mm256_i64gather_epi64(reinterpret_cast<const long long *>(words), index, 8);
+            const __m256i bits = _mm256_or_si256(_mm256_sllv_epi64(one, _mm256_and_si256(hash1, bit_mask)),
+                                                 _mm256_sllv_epi64(one, _mm256_and_si256(hash2, bit_mask)));
+            const int hits = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(word, bits), bits)));
+            pass[i] = hits & 1;
+            pass[i + 1] = (hits >> 1) & 1;
+            pass[i + 2] = (hits >> 2) & 1;
+            pass[i + 3] = (hits >> 3) & 1;
           }
+          for (; i < count; i++)
+            pass[i] = gnu_bloom_test_scalar(words, words_mask, shift, is_64_bit, hashes[i]);
+        }
+#endif
 
-          /*
-           * Read the dynamic segment entries
-           */
-          const auto dynamic_header = std::find_if(this->program_headers.begin(), this->program_headers.end(),
-                                                   [](const elf::elf_program_header &program_header) {
-                                                       return program_header.p_type == ::elf::elf_program_header::PT_DYNAMIC;
-                                                   });
-          if (dynamic_header == this->program_headers.end())
+#if defined(ELF_HPP_NEON)
+        inline std::uint32_t gnu_hash_neon(const unsigned char *s, std::size_t length)
+        {
+          const std::size_t steps = length / 16;
+          const uint32x4_t step_multiplier = vdupq_n_u32(pow33(16));
+          uint32x4_t acc0 = vdupq_n_u32(0), acc1 = vdupq_n_u32(0), acc2 = vdupq_n_u32(0), acc3 = vdupq_n_u32(0);
+          for (std::size_t i = 0; i < steps; i++)
           {
-            return false;
+            const uint8x16_t bytes = vld1q_u8(s + i * 16);
+            const uint16x8_t low = vmovl_u8(vget_low_u8(bytes));
+            const uint16x8_t high = vmovl_u8(vget_high_u8(bytes));
+            acc0 = vmlaq_u32(vmovl_u16(vget_low_u16(low)), acc0, step_multiplier);
+            acc1 = vmlaq_u32(vmovl_u16(vget_high_u16(low)), acc1, step_multiplier);
+            acc2 = vmlaq_u32(vmovl_u16(vget_low_u16(high)), acc2, step_multiplier);
+            acc3 = vmlaq_u32(vmovl_u16(vget_high_u16(high)), acc3, step_multiplier);
           }
-          this->binary_file.clear();
-          this->binary_file.seekg(static_cast<std::streamoff>(dynamic_header->p_offset));
-          if (this->is_64_bit())
+          const std::uint32_t *weights = gnu_hash_weights_16.data();
+          uint32x4_t sum = vmulq_u32(acc0, vld1q_u32(weights));
+          sum = vmlaq_u32(sum, acc1, vld1q_u32(weights + 4));
+          sum = vmlaq_u32(sum, acc2, vld1q_u32(weights + 8));
+          sum = vmlaq_u32(sum, acc3, vld1q_u32(weights + 12));
+          const std::uint32_t h = 5381 * pow33(steps * 16) + vaddvq_u32(sum);
+          return gnu_hash_scalar(s + steps * 16, length - steps * 16, h);
+        }
+
+        template<bool GnuHash>
+        inline uint32x4_t hash_step_neon(uint32x4_t h, uint32x4_t c)
+        {
+          if constexpr (GnuHash)
           {
-            std::size_t dynamic_entry_size = sizeof(::elf::types::Elf64_Dyn);
-            std::size_t dynamic_entry_count = dynamic_header->p_filesz / dynamic_entry_size;
-            if (dynamic_header->p_filesz % dynamic_entry_size != 0)
-            {
-              this->last_error = "Invalid dynamic segment size";
-              return false;
-            }
-            this->dynamic_entries.resize(dynamic_entry_count);
-            this->binary_file.read(reinterpret_cast<char *>(this->dynamic_entries.data()), static_cast<std::streamsize>(dynamic_header->p_filesz));
-            if (this->binary_file.gcount() != dynamic_header->p_filesz)
-            {
-              this->last_error = "Failed to read dynamic segment";
-              return false;
-            }
-          } else if (this->is_32_bit())
+            return vaddq_u32(vaddq_u32(vshlq_n_u32(h, 5), h), c);
+          } else
           {
-            std::size_t dynamic_entry_size = sizeof(::elf::types::Elf32_Dyn);
-            std::size_t dynamic_entry_count = dynamic_header->p_filesz / dynamic_entry_size;
-            if (dynamic_header->p_filesz % dynamic_entry_size != 0)
-            {
-              this->last_error = "Invalid dynamic segment size";
-              return false;
-            }
-            this->dynamic_entries.resize(dynamic_entry_count);
-            std::vector<::elf::types::Elf32_Dyn> real_dynamic_segment(dynamic_entry_count);
-            this->binary_file.read(reinterpret_cast<char *>(real_dynamic_segment.data()), static_cast<std::streamsize>(dynamic_header->p_filesz));
-            if (this->binary_file.gcount() != dynamic_header->p_filesz)
-            {
-              this->last_error = "Failed to read dynamic segment";
-              return false;
-            }
-            for (std::size_t i = 0; i < dynamic_entry_count; i++)
+            h = vaddq_u32(vshlq_n_u32(h, 4), c);
+            const uint32x4_t g = vandq_u32(h, vdupq_n_u32(0xf0000000));
+            return vbicq_u32(veorq_u32(h, vshrq_n_u32(g, 24)), g);
+          }
+        }
+
+        template<bool GnuHash>
+        inline void hash_lanes_neon(const unsigned char *const *names, const std::size_t *lengths, std::uint32_t *out)
+        {
+          alignas(16) std::uint32_t lane_values[4];
+          std::size_t longest = 0;
+          for (std::size_t lane = 0; lane < 4; lane++)
+          {
+            lane_values[lane] = static_cast<std::uint32_t>(lengths[lane]);
+            longest = std::max(longest, lengths[lane] & ~static_cast<std::size_t>(3));
+          }
+          const uint32x4_t lane_lengths = vld1q_u32(lane_values);
+          const uint32x4_t byte_mask = vdupq_n_u32(0xff);
+          uint32x4_t h = vdupq_n_u32(GnuHash ? 5381 : 0);
+          for (std::size_t offset = 0; offset < longest; offset += 4)
+          {
+            for (std::size_t lane = 0; lane < 4; lane++)
+              lane_values[lane] = offset + 4 <= lengths[lane] ? load_u32(names[lane] + offset) : 0;
+            const uint32x4_t active = vcgtq_u32(lane_lengths, vdupq_n_u32(static_cast<std::uint32_t>(offset + 3)));
+            const uint32x4_t chunk = vld1q_u32(lane_values);
+            uint32x4_t next = hash_step_neon<GnuHash>(h, vandq_u32(chunk, byte_mask));
+            next = hash_step_neon<GnuHash>(next, vandq_u32(vshrq_n_u32(chunk, 8), byte_mask));
+            next = hash_step_neon<GnuHash>(next, vandq_u32(vshrq_n_u32(chunk, 16), byte_mask));
+            next = hash_step_neon<GnuHash>(next, vshrq_n_u32(chunk, 24));
+            h = vbslq_u32(active, next, h);
+          }
+          vst1q_u32(lane_values, h);
+          for (std::size_t lane = 0; lane < 4; lane++)
+          {
+            const std::size_t done = lengths[lane] & ~static_cast<std::size_t>(3);
+            out[lane] = GnuHash ? gnu_hash_scalar(names[lane] + done, lengths[lane] - done, lane_values[lane])
+                                : elf_hash_scalar(names[lane] + done, lengths[lane] - done, lane_values[lane]);
+          }
+        }
+#endif
+
+        /*
+         * Hash a single name of known length with the best kernel for level
+         */
+        template<bool GnuHash>
+        inline std::uint32_t hash_name(const unsigned char *name, std::size_t length, simd_level level)
+        {
+          if constexpr (GnuHash)
+          {
+            if (length >= gnu_hash_vector_min_length)
             {
-              this->dynamic_entries[i].d_tag = real_dynamic_segment[i].d_tag;
-              this->dynamic_entries[i].d_un.d_val = real_dynamic_segment[i].d_un.d_val;
+              switch (level)
+              {
+#if defined(ELF_HPP_X86_SIMD)
+                case simd_level::avx2:
+                  return gnu_hash_avx2(name, length);
+                case simd_level::sse4_2:
+                  return gnu_hash_sse4_2(name, length);
+#endif
+#if defined(ELF_HPP_NEON)
+                case simd_level::neon:
+                  return gnu_hash_neon(name, length);
+#endif
+                default:
+                  break;
+              }
             }
+            return gnu_hash_scalar(name, length);
           } else
           {
-            return false;
+            static_cast<void>(level);
+            return elf_hash_scalar(name, length);
           }
+        }
 
-          /*
-           * Extract the info we need. Apply the dynamic string table offset later
-           */
-          std::uintptr_t dynamic_string_table_offset = 0;
-          std::uint64_t dynamic_string_table_length = 0;
-          std::uintptr_t symbol_table_offset = 0;
-          std::uint64_t symbol_table_entry_size = 0;
-          for (const auto &dynamic_entry: this->dynamic_entries)
+        /*
+         * Hash a group of names, one per lane. The group is as wide as the
+         * lanes of level
+         */
+        template<bool GnuHash>
+        inline void hash_lanes(const unsigned char *const *names, const std::size_t *lengths, std::uint32_t *out, simd_level level)
+        {
+          switch (level)
           {
-            switch (dynamic_entry.d_tag)
+#if defined(ELF_HPP_X86_SIMD)
+            case simd_level::avx2:
+              hash_lanes_avx2<GnuHash>(names, lengths, out);
+              return;
+            case simd_level::sse4_2:
+              hash_lanes_sse4_2<GnuHash>(names, lengths, out);
+              return;
+#endif
+#if defined(ELF_HPP_NEON)
+            case simd_level::neon:
+              hash_lanes_neon<GnuHash>(names, lengths, out);
+              return;
+#endif
+            default:
+              break;
+          }
+        }
+
+        inline std::size_t hash_lane_count(simd_level level)
+        {
+          switch (level)
+          {
+            case simd_level::avx2:
+              return 8;
+            case simd_level::sse4_2:
+            case simd_level::neon:
+              return 4;
+            default:
+              return 0;
+          }
+        }
+
+        /*
+         * Hash many names. Every length is found first, names short enough
+         * are grouped into lanes and the rest go through hash_name
+         */
+        template<bool GnuHash>
+        inline void hash_names(std::span<const char *const> names, std::span<std::uint32_t> hashes, simd_level level)
+        {
+          static const unsigned char empty_name[1] = {0};
+          const std::size_t count = std::min(names.size(), hashes.size());
+          const std::size_t lanes = hash_lane_count(level);
+          const unsigned char *group_names[8]{};
+          std::size_t group_lengths[8]{};
+          std::size_t group_indices[8]{};
+          std::uint32_t group_hashes[8]{};
+          std::size_t group_size = 0;
+
+          for (std::size_t i = 0; i <= count; i++)
+          {
+            if (i < count)
             {
-              case ::elf::elf_dynamic::DT_STRTAB:
-              {
-                dynamic_string_table_offset = dynamic_entry.d_un.d_ptr - this->base_address;
-                break;
-              }
-              case ::elf::elf_dynamic::DT_STRSZ:
-              {
-                dynamic_string_table_length = dynamic_entry.d_un.d_val;
-                break;
-              }
-              case ::elf::elf_dynamic::DT_SYMTAB:
-              {
-                symbol_table_offset = dynamic_entry.d_un.d_ptr - this->base_address;
-                break;
-              }
-              case ::elf::elf_dynamic::DT_SYMENT:
-              {
-                symbol_table_entry_size = dynamic_entry.d_un.d_val;
-                break;
-              }
-              case ::elf::elf_dynamic::DT_SONAME:
-              {
-                this->so_name = reinterpret_cast<const char *>(static_cast<std::uintptr_t>(dynamic_entry.d_un.d_val));
-                break;
-              }
-              case ::elf::elf_dynamic::DT_NEEDED:
+              const auto *name = reinterpret_cast<const unsigned char *>(names[i]);
+              const std::size_t length = std::strlen(names[i]);
+              if (lanes == 0 || length >= hash_lane_max_length || (GnuHash && length >= gnu_hash_vector_min_length))
               {
-                this->needed_libraries.emplace_back(reinterpret_cast<const char *>(static_cast<std::uintptr_t>(dynamic_entry.d_un.d_val)));
-                break;
+                hashes[i] = hash_name<GnuHash>(name, length, level);
+                continue;
               }
+              group_names[group_size] = name;
+              group_lengths[group_size] = length;
+              group_indices[group_size++] = i;
+              if (group_size != lanes)
+                continue;
+            } else if (group_size == 0)
+            {
+              break;
+            }
+
+            for (std::size_t lane = group_size; lane < lanes; lane++)
+            {
+              group_names[lane] = empty_name;
+              group_lengths[lane] = 0;
             }
+            hash_lanes<GnuHash>(group_names, group_lengths, group_hashes, level);
+            for (std::size_t lane = 0; lane < group_size; lane++)
+              hashes[group_indices[lane]] = group_hashes[lane];
+            group_size = 0;
           }
-          if (dynamic_string_table_offset == 0 || dynamic_string_table_length == 0)
+        }
+
+        /*
+         * Bloom test many GNU hashes, setting pass[i] to 1 when hashes[i]
+         * passes
+         */
+        inline void gnu_bloom_test_many(const std::uint64_t *words, std::uint64_t words_mask, std::uint32_t shift, bool is_64_bit,
+                                        const std::uint32_t *hashes, std::size_t count, std::uint8_t *pass, simd_level level)
+        {
+#if defined(ELF_HPP_X86_SIMD)
+          if (level == simd_level::avx2)
           {
-            this->last_error = "Failed to find dynamic string table";
-            return false;
+            gnu_bloom_test_avx2(words, words_mask, shift, is_64_bit, hashes, count, pass);
+            return;
           }
-          if (symbol_table_offset == 0 || symbol_table_entry_size == 0)
+#endif
+          static_cast<void>(level);
+          for (std::size_t i = 0; i < count; i++)
+            pass[i] = gnu_bloom_test_scalar(words, words_mask, shift, is_64_bit, hashes[i]);
+        }
+    }
+
+    /*
+     * Compute the ELF hash value for a symbol name of known length
+     */
+    inline std::uint_fast32_t elf_hash(const char *name, std::size_t length)
+    {
+      return ::elf::detail::elf_hash_scalar(reinterpret_cast<const unsigned char *>(name), length);
+    }
+
+    /*
+     * Compute the ELF hash value for a symbol name
+     */
+    inline std::uint_fast32_t elf_hash(const char *name)
+    {
+      return elf_hash(name, std::strlen(name));
+    }
+
+    /*
+     * Compute the GNU hash value for a symbol name of known length. Long
+     * names are hashed with SIMD where the CPU supports it
+     *
+     * References:
+     *  https://blogs.oracle.com/solaris/post/gnu-hash-elf-sections
+     *  https://sourceware.org/legacy-ml/binutils/2006-10/msg00377.html
+     */
+    inline uint_fast32_t gnu_hash(const char *s, std::size_t length)
+    {
+      return ::elf::detail::hash_name<true>(reinterpret_cast<const unsigned char *>(s), length, ::elf::detail::get_simd_level());
+    }
+
+    /*
+     * Compute the GNU hash value for a symbol name
+     */
+    inline uint_fast32_t gnu_hash(const char *s)
+    {
+      return gnu_hash(s, std::strlen(s));
+    }
+
+    /*
+     * Compute the ELF hash of every name, hashes[i] = elf_hash(names[i]).
+     * Hashes min(names.size(), hashes.size()) names, several at a time
+     * where the CPU supports it
+     */
+    inline void elf_hash_many(std::span<const char *const> names, std::span<std::uint32_t> hashes)
+    {
+      ::elf::detail::hash_names<false>(names, hashes, ::elf::detail::get_simd_level());
+    }
+
+    /*
+     * Compute the GNU hash of every name, hashes[i] = gnu_hash(names[i]).
+     * Hashes min(names.size(), hashes.size()) names, several at a time
+     * where the CPU supports it
+     */
+    inline void gnu_hash_many(std::span<const char *const> names, std::span<std::uint32_t> hashes)
+    {
+      ::elf::detail::hash_names<true>(names, hashes, ::elf::detail::get_simd_level());
+    }
+
+    /*
+     * A read-only view of an entire file. Uses mmap where available,
+     * otherwise the file is read into memory once
+     */
+    class mapped_file
+    {
+    public:
+        mapped_file() = default;
+
+        explicit mapped_file(const std::filesystem::path &path)
+        {
+          this->open(path);
+        }
+
+        ~mapped_file()
+        {
+          this->close();
+        }
+
+        mapped_file(const mapped_file &copy) = delete;
+        mapped_file &operator=(const mapped_file &copy) = delete;
+
+        mapped_file(mapped_file &&move) noexcept
+        {
+          *this = std::move(move);
+        }
+
+        mapped_file &operator=(mapped_file &&move) noexcept
+        {
+          if (this != &move)
           {
-            this->last_error = "Failed to find symbol table";
-            return false;
+            this->close();
+            this->contents = std::exchange(move.contents, {});
+            this->opened = std::exchange(move.opened, false);
+#if !defined(ELF_HPP_POSIX)
+            this->buffer = std::move(move.buffer);
+#endif
           }
+          return *this;
+        }
 
-          /*
-           * Read the dynamic string table
-           */
-          this->dynamic_segment_string_table.resize(dynamic_string_table_length);
-          this->binary_file.seekg(static_cast<std::streamoff>(dynamic_string_table_offset));
-          this->binary_file.read(this->dynamic_segment_string_table.data(), static_cast<std::streamsize>(dynamic_string_table_length));
-          if (this->binary_file.gcount() != dynamic_string_table_length)
+        /*
+         * Map a file, replacing any existing mapping
+         */
+        bool open(const std::filesystem::path &path)
+        {
+          this->close();
+#if defined(ELF_HPP_POSIX)
+          const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+          if (fd < 0)
           {
-            this->last_error = "Failed to read dynamic string table";
             return false;
           }
-          const auto dynamic_string_table_base = reinterpret_cast<std::uintptr_t>(this->dynamic_segment_string_table.data());
-
-          /*
-           * Apply the dynamic string table offset to the strings we need
-           */
-          this->so_name = dynamic_string_table_base + this->so_name;
-          for (auto &needed: this->needed_libraries)
+          struct stat file_status{};
+          if (::fstat(fd, &file_status) != 0 || !S_ISREG(file_status.st_mode))
           {
-            needed = dynamic_string_table_base + needed;
+            ::close(fd);
+            return false;
           }
-
-          /*
-           * Validate the symbol table header
-           */
-          const auto symbol_table_header = std::find_if(this->section_headers.begin(), this->section_headers.end(),
-                                                        [](const elf::elf_section_header &section_header) {
-                                                            return section_header.sh_type == ::elf::elf_section_header::SHT_DYNSYM;
-                                                        });
-          if (symbol_table_header == this->section_headers.end())
+          const bool mapped = this->open(fd, static_cast<std::size_t>(file_status.st_size));
+          ::close(fd);
+          return mapped;
+#else
+          std::ifstream file(path, std::ios::binary | std::ios::in | std::ios::ate);
+          if (!file.is_open())
           {
-            this->last_error = "Failed to find dynamic symbol table";
             return false;
           }
-          if (symbol_table_offset != symbol_table_header->sh_offset)
+          const auto size = static_cast<std::size_t>(file.tellg());
+          this->buffer.resize(size);
+          file.seekg(0);
+          file.read(reinterpret_cast<char *>(this->buffer.data()), static_cast<std::streamsize>(size));
+          if (file.gcount() != static_cast<std::streamsize>(size))
           {
-            this->last_error = "Symbol table offsets don't match";
+            this->buffer.clear();
             return false;
           }
+          this->contents = this->buffer;
+#endif
+          this->opened = true;
+          return true;
+        }
 
-          /*
-           * Read the symbol table
-           */
-          std::uint64_t symbol_table_entry_count = symbol_table_header->sh_size / symbol_table_entry_size;
-          if (this->is_64_bit())
-          {
-            if (symbol_table_entry_size != sizeof(::elf::types::Elf64_Sym))
-            {
-              this->last_error = "Invalid symbol table entry size";
-              return false;
-            }
-            this->dynamic_symbols.resize(symbol_table_entry_count);
-            this->binary_file.seekg(static_cast<std::streamoff>(symbol_table_offset));
-            for (std::size_t i = 0; i < symbol_table_entry_count; i++)
-            {
-              this->binary_file.read(reinterpret_cast<char *>(&this->dynamic_symbols[i]), static_cast<std::streamsize>(symbol_table_entry_size));
-              if (this->binary_file.gcount() != symbol_table_entry_size)
-              {
-                this->last_error = "Failed to read dynamic symbol";
-                return false;
-              }
-              this->dynamic_symbols[i].st_name_str = this->dynamic_segment_string_table.data() + this->dynamic_symbols[i].st_name;
-            }
-          } else
+#if defined(ELF_HPP_POSIX)
+        /*
+         * Map the first size bytes of an open file, replacing any existing
+         * mapping. The descriptor stays open and owned by the caller
+         */
+        bool open(int descriptor, std::size_t size)
+        {
+          this->close();
+          if (size != 0)
           {
-            if (symbol_table_entry_size != sizeof(::elf::types::Elf32_Sym))
-            {
-              this->last_error = "Invalid symbol table entry size";
-              return false;
-            }
-            this->dynamic_symbols.resize(symbol_table_entry_count);
-            std::vector<::elf::types::Elf32_Sym> real_dynamic_symbols(symbol_table_entry_count);
-            const auto real_symbol_table_size = static_cast<std::streamsize>(symbol_table_entry_size * symbol_table_entry_count);
-            this->binary_file.seekg(static_cast<std::streamoff>(symbol_table_offset));
-            this->binary_file.read(reinterpret_cast<char *>(real_dynamic_symbols.data()), real_symbol_table_size);
-            if (this->binary_file.gcount() != real_symbol_table_size)
+            void *address = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+            if (address == MAP_FAILED)
             {
-              this->last_error = "Failed to read dynamic symbols";
               return false;
             }
-            for (std::size_t i = 0; i < symbol_table_entry_count; i++)
-            {
-              this->dynamic_symbols[i].st_name = real_dynamic_symbols[i].st_name;
-              this->dynamic_symbols[i].st_info = real_dynamic_symbols[i].st_info;
-              this->dynamic_symbols[i].st_other = real_dynamic_symbols[i].st_other;
-              this->dynamic_symbols[i].st_shndx = real_dynamic_symbols[i].st_shndx;
-              this->dynamic_symbols[i].st_value = real_dynamic_symbols[i].st_value;
-              this->dynamic_symbols[i].st_size = real_dynamic_symbols[i].st_size;
-              this->dynamic_symbols[i].st_name_str = this->dynamic_segment_string_table.data() + this->dynamic_symbols[i].st_name;
-            }
+            this->contents = std::span<const std::byte>(static_cast<const std::byte *>(address), size);
           }
+          this->opened = true;
+          return true;
+        }
+#endif
 
-          /*
-           * Parse whichever hash tables are present
-           */
-          if (!this->parse_hash_tables())
+        /*
+         * Release the mapping. Any views into it become invalid
+         */
+        void close()
+        {
+#if defined(ELF_HPP_POSIX)
+          if (!this->contents.empty())
           {
-            return false;
+            ::munmap(const_cast<std::byte *>(this->contents.data()), this->contents.size());
           }
+#else
+          this->buffer.clear();
+#endif
+          this->contents = {};
+          this->opened = false;
+        }
 
-          /*
-           * Parse rel and rela sections, whichever are present
-           */
-          if (!this->parse_relocations())
-          {
-            return false;
-          }
+        bool is_open() const
+        {
+          return this->opened;
+        }
 
-          return true;
+        std::span<const std::byte> data() const
+        {
+          return this->contents;
         }
 
-        /*
-         * Get a vector of bitness-agnostic Elf*_Dyn structures
-         */
-        const std::vector<::elf::elf_dynamic> &get_dynamic_entries() const
+    private:
+        std::span<const std::byte> contents;
+        bool opened = false;
+#if !defined(ELF_HPP_POSIX)
+        std::vector<std::byte> buffer;
+#endif
+    };
+
+    /*
+     * The vector type of elf_file tables, allocated from the file's memory
+     * resource
+     */
+    template<typename T>
+    using vector = std::pmr::vector<T>;
+
+    /*
+     * A bump allocator for elf_file tables. Deallocation does nothing and
+     * reset() makes all the memory available again, merging the blocks
+     * into one so a loop that parses a file, resets and parses the next
+     * stops allocating once the block is large enough. Not thread safe
+     */
+    class arena : public std::pmr::memory_resource
+    {
+    public:
+        explicit arena(std::size_t block_size = 64 * 1024, std::pmr::memory_resource *upstream = std::pmr::new_delete_resource())
+            : upstream(upstream), block_size(std::max<std::size_t>(block_size, 64))
         {
-          return this->dynamic_entries;
         }
 
-        /*
-         * Get the dynamic string table which contains symbol names amongst other things
-         */
-        const std::vector<char> &get_dynamic_string_table() const
+        ~arena() override
         {
-          return this->dynamic_segment_string_table;
+          this->release();
         }
 
+        arena(const arena &copy) = delete;
+        arena &operator=(const arena &copy) = delete;
+
         /*
-         * Get the value of DT_SONAME
+         * Make every allocation available for reuse. Anything allocated from
+         * the arena must no longer be in use
          */
-        const char *get_so_name() const
+        void reset()
         {
-          return this->so_name;
+          if (this->blocks.size() > 1)
+          {
+            const std::size_t total = this->capacity();
+            this->release();
+            this->add_block(total);
+          }
+          this->used_before_current = 0;
+          this->offset = 0;
         }
 
         /*
-         * Get a vector of DT_NEEDED values
+         * Return all memory to the upstream resource
          */
-        const std::vector<const char *> &get_needed_libraries() const
+        void release()
         {
-          return this->needed_libraries;
+          for (const auto &block: this->blocks)
+          {
+            this->upstream->deallocate(block.data, block.size, alignof(std::max_align_t));
+          }
+          this->blocks.clear();
+          this->used_before_current = 0;
+          this->offset = 0;
         }
 
         /*
-         * Get a vector of bitness-agnostic Elf*_Sym structures for all dynamic symbols
+         * Total size of the blocks held
          */
-        const std::vector<elf::elf_symbol> &get_dynamic_symbols() const
+        std::size_t capacity() const
         {
-          return this->dynamic_symbols;
+          std::size_t total = 0;
+          for (const auto &block: this->blocks)
+          {
+            total += block.size;
+          }
+          return total;
         }
 
         /*
-         * Get a symbol by its name using the GNU hash table and/or the ELF hash table
+         * Bytes handed out since the last reset, including alignment padding
+         * and space skipped at the end of earlier blocks
          */
-        std::vector<::elf::elf_symbol>::const_iterator get_symbol(const char *name) const
+        std::size_t used() const
         {
-          auto symbol = this->lookup_gnu_symbol(name);
-          if (symbol == this->dynamic_symbols.cend())
+          return this->used_before_current + this->offset;
+        }
+
+    protected:
+        void *do_allocate(std::size_t bytes, std::size_t alignment) override
+        {
+          if (!this->blocks.empty())
           {
-            symbol = this->lookup_elf_symbol(name);
+            const block &current = this->blocks.back();
+            const auto address = reinterpret_cast<std::uintptr_t>(current.data) + this->offset;
+            const std::size_t padding = (alignment - address % alignment) % alignment;
+            if (padding <= current.size - this->offset && bytes <= current.size - this->offset - padding)
+            {
+              this->offset += padding + bytes;
+              return current.data + this->offset - bytes;
+            }
           }
-          return symbol;
+
+          /*
+           * Blocks double so a file needs few of them, and reset merges them
+           */
+          std::size_t size = this->blocks.empty() ? this->block_size : this->blocks.back().size * 2;
+          size = std::max(size, bytes + alignment);
+          if (!this->blocks.empty())
+          {
+            this->used_before_current += this->blocks.back().size;
+          }
+          this->add_block(size);
+          const block &current = this->blocks.back();
+          const auto address = reinterpret_cast<std::uintptr_t>(current.data);
+          const std::size_t padding = (alignment - address % alignment) % alignment;
+          this->offset = padding + bytes;
+          return current.data + padding;
         }
 
-        /*
-         * Get dynamic symbol relocations without addend (non PLT)
-         */
-        const std::vector<::elf::elf_rel> &get_relocations() const
+        void do_deallocate(void *pointer, std::size_t bytes, std::size_t alignment) override
+        {
+          static_cast<void>(pointer);
+          static_cast<void>(bytes);
+          static_cast<void>(alignment);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+        {
+          return this == &other;
+        }
+
+    private:
+        typedef struct block
+        {
+            std::byte *data;
+            std::size_t size;
+        } block;
+
+        std::pmr::memory_resource *upstream;
+        std::size_t block_size;
+        std::vector<block> blocks;
+        std::size_t used_before_current = 0;
+        std::size_t offset = 0;
+
+        void add_block(std::size_t size)
         {
-          return this->dyn_rel_entries;
+          auto *data = static_cast<std::byte *>(this->upstream->allocate(size, alignof(std::max_align_t)));
+          this->blocks.push_back({data, size});
         }
+    };
 
+    namespace detail
+    {
         /*
-         * Get dynamic symbol relocations with addend (non PLT)
+         * Hint that an address will be read soon
          */
-        const std::vector<::elf::elf_rela> &get_relocations_with_addend() const
+        inline void prefetch(const void *address)
         {
-          return this->dyn_rela_entries;
+#if defined(__GNUC__) || defined(__clang__)
+          __builtin_prefetch(address);
+#else
+          static_cast<void>(address);
+#endif
         }
 
         /*
-         * Get PLT relocations without addend
+         * The string at offset in a string table, empty when offset is
+         * outside it. A string missing its terminator ends with the table
          */
-        const std::vector<::elf::elf_rel> &get_plt_relocations() const
+        inline std::string_view string_at(std::span<const char> strings, std::uint64_t offset)
         {
-          return this->plt_rel_entries;
+          if (offset >= strings.size())
+          {
+            return "";
+          }
+          const char *string = strings.data() + offset;
+          const std::size_t remaining = strings.size() - static_cast<std::size_t>(offset);
+          const void *terminator = std::memchr(string, '\0', remaining);
+          return {string, terminator != nullptr ? static_cast<std::size_t>(static_cast<const char *>(terminator) - string) : remaining};
         }
 
         /*
-         * Get PLT relocations with addend
+         * Move a pointer into from to the same offset in to, leaving any
+         * other pointer alone
          */
-        const std::vector<::elf::elf_rela> &get_plt_relocations_with_addend() const
+        template<typename T>
+        const T *rebase(const T *pointer, std::span<const std::byte> from, std::span<const std::byte> to)
         {
-          return this->plt_rela_entries;
+          const auto address = reinterpret_cast<std::uintptr_t>(pointer);
+          const auto start = reinterpret_cast<std::uintptr_t>(from.data());
+          if (pointer == nullptr || address < start || address - start >= from.size())
+          {
+            return pointer;
+          }
+          return reinterpret_cast<const T *>(to.data() + (address - start));
         }
 
-    private:
-        const std::filesystem::path path;
-        std::ifstream binary_file;
-        std::string last_error;
-
-        ::elf::elf_header header{0};
-        std::vector<::elf::elf_program_header> program_headers;
-        std::vector<::elf::elf_section_header> section_headers;
-        std::vector<char> section_header_string_table;
-        std::vector<::elf::elf_dynamic> dynamic_entries;
-        std::vector<char> dynamic_segment_string_table;
-        const char *so_name = nullptr;
-        std::vector<const char *> needed_libraries;
-        std::vector<elf::elf_symbol> dynamic_symbols;
-        std::vector<std::uint64_t> init_functions;
-        std::vector<std::uint64_t> fini_functions;
-        std::uint64_t base_address = 0;
-
-        std::vector<std::uint32_t> hash_buckets;
-        std::vector<std::uint32_t> hash_chains;
-        std::vector<std::uint32_t> gnu_hash_buckets;
-        std::vector<std::uint32_t> gnu_hash_values;
-        std::uint32_t gnu_hash_bloom_shift = 0;
-        std::uint32_t gnu_hash_omitted_symbols_count = 0;
-        std::vector<std::uint64_t> gnu_hash_bloom_words;
-
-        std::vector<::elf::elf_rel> plt_rel_entries;
-        std::vector<::elf::elf_rel> dyn_rel_entries;
-        std::vector<::elf::elf_rela> plt_rela_entries;
-        std::vector<::elf::elf_rela> dyn_rela_entries;
-
-    private:
-        bool open_file()
+        /*
+         * A table of on-disk structures. The entries are either owned or, for
+         * memory-backed files whose layout matches, a view straight into the
+         * image
+         */
+        template<typename T>
+        class table
         {
-          if (!std::filesystem::exists(this->path))
-          {
-            this->last_error = "File does not exist";
-            return false;
-          }
-
-          this->binary_file.open(this->path, std::ios::binary | std::ios::in);
-          if (!this->binary_file.is_open())
-          {
-            this->last_error = "Failed to open library file";
-            return false;
-          }
+        public:
+            explicit table(std::pmr::memory_resource *resource = std::pmr::get_default_resource()) : storage(resource)
+            {
+            }
 
-          return true;
-        }
+            /*
+             * Allocate owned storage for count entries and return it for filling
+             */
+            T *assign(std::size_t count)
+            {
+              this->storage.resize(count);
+              this->entries = std::span<const T>(this->storage.data(), count);
+              return this->storage.data();
+            }
 
-        bool read_elf_header()
-        {
-          if (!this->binary_file.is_open())
-          {
-            this->last_error = "Binary file is not open";
-            return false;
-          }
-          this->binary_file.clear();
-          this->binary_file.seekg(0);
-          this->binary_file.read(reinterpret_cast<char *>(&this->header.e_ident), sizeof(this->header.e_ident));
-          if (this->binary_file.gcount() != sizeof(this->header.e_ident))
-          {
-            this->last_error = "Failed to read ELF identification";
-            return false;
-          }
+            /*
+             * View entries owned by someone else
+             */
+            void assign_view(const T *data, std::size_t count)
+            {
+              this->storage.clear();
+              this->entries = std::span<const T>(data, count);
+            }
 
-          if (this->is_64_bit())
-          {
-            this->binary_file.seekg(0);
-            this->binary_file.read(reinterpret_cast<char *>(&this->header), sizeof(this->header));
-            if (this->binary_file.gcount() != sizeof(this->header))
+            void clear()
             {
-              this->last_error = "Failed to read ELF header";
-              return false;
+              this->storage.clear();
+              this->entries = {};
             }
-          } else if (this->is_32_bit())
-          {
-            ::elf::types::Elf32_Ehdr real_header{0};
-            this->binary_file.seekg(0);
-            this->binary_file.read(reinterpret_cast<char *>(&real_header), sizeof(real_header));
-            if (this->binary_file.gcount() != sizeof(real_header))
+
+            /*
+             * Point a view into from at the same offset in to
+             */
+            void rebase(std::span<const std::byte> from, std::span<const std::byte> to)
             {
-              this->last_error = "Failed to read ELF header";
-              return false;
+              if (this->storage.empty())
+              {
+                this->entries = std::span<const T>(::elf::detail::rebase(this->entries.data(), from, to), this->entries.size());
+              }
             }
-            this->header.e_type = real_header.e_type;
-            this->header.e_machine = real_header.e_machine;
-            this->header.e_version = real_header.e_version;
-            this->header.e_entry = real_header.e_entry;
-            this->header.e_phoff = real_header.e_phoff;
-            this->header.e_shoff = real_header.e_shoff;
-            this->header.e_flags = real_header.e_flags;
-            this->header.e_ehsize = real_header.e_ehsize;
-            this->header.e_phentsize = real_header.e_phentsize;
-            this->header.e_phnum = real_header.e_phnum;
-            this->header.e_shentsize = real_header.e_shentsize;
-            this->header.e_shnum = real_header.e_shnum;
-            this->header.e_shstrndx = real_header.e_shstrndx;
-          } else
-          {
-            this->last_error = "Invalid ELF class";
-            return false;
-          }
 
-          return true;
-        }
+            std::span<const T> span() const
+            {
+              return this->entries;
+            }
 
-        bool read_program_headers()
-        {
-          if (!this->binary_file.is_open())
-          {
-            this->last_error = "Binary file is not open";
-            return false;
-          }
-          this->binary_file.clear();
-          this->binary_file.seekg(static_cast<std::streamoff>(this->header.e_phoff));
-          this->program_headers.resize(this->header.e_phnum);
+            const T *data() const
+            {
+              return this->entries.data();
+            }
 
-          if (this->is_64_bit())
-          {
-            if (this->header.e_phentsize != sizeof(::elf::types::Elf64_Phdr))
+            std::size_t size() const
             {
-              this->last_error = "Invalid program header size";
-              return false;
+              return this->entries.size();
             }
-            auto program_headers_size = static_cast<std::streamsize>(this->header.e_phnum * this->header.e_phentsize);
-            this->binary_file.read(reinterpret_cast<char *>(this->program_headers.data()), program_headers_size);
-            if (this->binary_file.gcount() != program_headers_size)
+
+            bool empty() const
             {
-              this->last_error = "Failed to read program headers";
-              return false;
+              return this->entries.empty();
             }
-          } else
-          {
-            if (this->header.e_phentsize != sizeof(::elf::types::Elf32_Phdr))
+
+            const T &operator[](std::size_t idx) const
             {
-              this->last_error = "Invalid program header size";
-              return false;
+              return this->entries[idx];
             }
-            std::vector<::elf::types::Elf32_Phdr> real_program_headers(this->header.e_phnum);
-            auto real_program_headers_size = static_cast<std::streamsize>(this->header.e_phnum * this->header.e_phentsize);
-            this->binary_file.read(reinterpret_cast<char *>(real_program_headers.data()), real_program_headers_size);
-            if (this->binary_file.gcount() != real_program_headers_size)
+
+            const T &at(std::size_t idx) const
             {
-              this->last_error = "Failed to read program headers";
-              return false;
+              if (idx >= this->entries.size())
+              {
+                throw std::out_of_range("elf::detail::table::at");
+              }
+              return this->entries[idx];
             }
-            for (std::size_t i = 0; i < this->header.e_phnum; i++)
+
+            typename std::span<const T>::iterator begin() const
             {
-              this->program_headers[i].p_type = real_program_headers[i].p_type;
-              this->program_headers[i].p_flags = real_program_headers[i].p_flags;
-              this->program_headers[i].p_offset = real_program_headers[i].p_offset;
-              this->program_headers[i].p_vaddr = real_program_headers[i].p_vaddr;
-              this->program_headers[i].p_paddr = real_program_headers[i].p_paddr;
-              this->program_headers[i].p_filesz = real_program_headers[i].p_filesz;
-              this->program_headers[i].p_memsz = real_program_headers[i].p_memsz;
-              this->program_headers[i].p_align = real_program_headers[i].p_align;
+              return this->entries.begin();
             }
-          }
 
-          this->base_address = 0xFFFFFFFFFFFFFFFF;
-          for (const auto &program_header: this->program_headers)
-          {
-            if (program_header.p_type == ::elf::elf_program_header::PT_LOAD)
+            typename std::span<const T>::iterator end() const
             {
-              this->base_address = std::min(this->base_address, program_header.p_vaddr);
+              return this->entries.end();
             }
-          }
 
-          return true;
-        }
+        private:
+            ::elf::vector<T> storage;
+            std::span<const T> entries;
+        };
 
-        bool read_section_headers()
+        /*
+         * 64-bit hash of a name for perfect_hash, mixing in a word at a time
+         */
+        inline std::uint64_t name_hash64(std::string_view name_view)
         {
-          if (!this->binary_file.is_open())
+          const char *name = name_view.data();
+          const std::size_t length = name_view.size();
+          std::uint64_t h = 0x9e3779b97f4a7c15 ^ (length * 0xff51afd7ed558ccd);
+          const auto mix = [&h](std::uint64_t word) {
+              h = (h ^ word) * 0xbf58476d1ce4e5b9;
+              h ^= h >> 29;
+          };
+          std::size_t i = 0;
+          for (; i + sizeof(std::uint64_t) <= length; i += sizeof(std::uint64_t))
           {
-            this->last_error = "Binary file is not open";
-            return false;
+            std::uint64_t word;
+            std::memcpy(&word, name + i, sizeof(word));
+            mix(word);
           }
-          this->binary_file.clear();
-          this->binary_file.seekg(static_cast<std::streamoff>(this->header.e_shoff));
-          this->section_headers.resize(this->header.e_shnum);
-
-          if (this->is_64_bit())
+          if (i < length)
           {
-            if (this->header.e_shentsize != sizeof(::elf::types::Elf64_Shdr))
+            std::uint64_t word = 0;
+            std::memcpy(&word, name + i, length - i);
+            mix(word);
+          }
+          h ^= h >> 33;
+          h *= 0xff51afd7ed558ccd;
+          h ^= h >> 33;
+          return h;
+        }
+
+        /*
+         * A minimal perfect hash over a set of distinct 64-bit key hashes,
+         * built by hash and displace: keys are split into buckets of about
+         * keys_per_bucket, and each bucket, largest first, gets the first
+         * pilot that sends all of its keys to free slots. position() maps
+         * each key to its own slot in [0, size()) with two memory reads and
+         * maps anything else to some slot, so the caller keeps something to
+         * compare against in each slot
+         */
+        class perfect_hash
+        {
+        public:
+            inline static constexpr std::size_t keys_per_bucket = 4;
+            inline static constexpr std::uint32_t max_pilot = 1 << 24;
+            inline static constexpr std::uint64_t max_seeds = 4;
+
+            explicit perfect_hash(std::pmr::memory_resource *resource = std::pmr::get_default_resource()) : pilots(resource)
             {
-              this->last_error = "Invalid section header size";
-              return false;
             }
-            for (std::size_t i = 0; i < this->header.e_shnum; i++)
+
+            /*
+             * Build over hashes, which must be distinct and fewer than 2^32.
+             * Fails if no pilots are found within max_seeds attempts
+             */
+            bool build(std::span<const std::uint64_t> hashes)
             {
-              this->binary_file.read(reinterpret_cast<char *>(&this->section_headers[i]), this->header.e_shentsize);
-              if (this->binary_file.gcount() != this->header.e_shentsize)
+              this->slot_count = static_cast<std::uint32_t>(hashes.size());
+              this->bucket_count = static_cast<std::uint32_t>(std::max<std::size_t>(1, hashes.size() / keys_per_bucket));
+              for (this->seed = 0; this->seed < max_seeds; this->seed++)
               {
-                this->last_error = "Failed to read section header";
-                return false;
+                if (this->place(hashes))
+                {
+                  return true;
+                }
               }
-            }
-          } else
-          {
-            if (this->header.e_shentsize != sizeof(::elf::types::Elf32_Shdr))
-            {
-              this->last_error = "Invalid section header size";
+              this->pilots.clear();
+              this->slot_count = 0;
               return false;
             }
-            std::vector<::elf::types::Elf32_Shdr> real_section_headers(this->header.e_shnum);
-            const auto real_section_headers_size = static_cast<std::streamsize>(this->header.e_shnum * this->header.e_shentsize);
-            this->binary_file.read(reinterpret_cast<char *>(real_section_headers.data()), real_section_headers_size);
-            if (this->binary_file.gcount() != real_section_headers_size)
+
+            std::uint32_t size() const
             {
-              this->last_error = "Failed to read section headers";
-              return false;
+              return this->slot_count;
             }
-            for (std::size_t i = 0; i < this->header.e_shnum; i++)
+
+            /*
+             * The bucket of a key, whose pilot position() reads
+             */
+            const std::uint32_t *pilot_of(std::uint64_t hash) const
             {
-              this->section_headers[i].sh_name = real_section_headers[i].sh_name;
-              this->section_headers[i].sh_type = real_section_headers[i].sh_type;
-              this->section_headers[i].sh_flags = real_section_headers[i].sh_flags;
-              this->section_headers[i].sh_addr = real_section_headers[i].sh_addr;
-              this->section_headers[i].sh_offset = real_section_headers[i].sh_offset;
-              this->section_headers[i].sh_size = real_section_headers[i].sh_size;
-              this->section_headers[i].sh_link = real_section_headers[i].sh_link;
-              this->section_headers[i].sh_info = real_section_headers[i].sh_info;
-              this->section_headers[i].sh_addralign = real_section_headers[i].sh_addralign;
-              this->section_headers[i].sh_entsize = real_section_headers[i].sh_entsize;
+              return &this->pilots[reduce(static_cast<std::uint32_t>(hash >> 32), this->bucket_count)];
             }
-          }
 
-          std::uint32_t section_header_string_table_idx = this->header.e_shstrndx;
-          if (section_header_string_table_idx == ::elf::elf_section_header::SHN_XINDEX)
-          {
-            section_header_string_table_idx = this->section_headers[0].sh_link;
-          }
-          const auto &section_header_string_table_header = this->section_headers[section_header_string_table_idx];
-          this->section_header_string_table.resize(section_header_string_table_header.sh_size);
-          const auto section_header_string_table_offset = static_cast<std::streamoff>(section_header_string_table_header.sh_offset);
-          const auto section_header_string_table_size = static_cast<std::streamsize>(section_header_string_table_header.sh_size);
-          this->binary_file.seekg(section_header_string_table_offset);
-          this->binary_file.read(this->section_header_string_table.data(), section_header_string_table_size);
-          if (this->binary_file.gcount() != section_header_string_table_size)
-          {
-            this->last_error = "Failed to read section header string table";
-            return false;
-          }
+            std::uint32_t position(std::uint64_t hash) const
+            {
+              return this->slot(hash, *this->pilot_of(hash));
+            }
 
-          for (auto &section_header: this->section_headers)
-          {
-            section_header.sh_name_str = this->section_header_string_table.data() + section_header.sh_name;
-          }
+        private:
+            ::elf::vector<std::uint32_t> pilots;
+            std::uint32_t slot_count = 0;
+            std::uint32_t bucket_count = 0;
+            std::uint64_t seed = 0;
 
-          return true;
-        }
+            /*
+             * Map x onto [0, range) without a division
+             */
+            static std::uint32_t reduce(std::uint32_t x, std::uint32_t range)
+            {
+              return static_cast<std::uint32_t>((static_cast<std::uint64_t>(x) * range) >> 32);
+            }
 
-        bool parse_hash_tables()
-        {
-          if (!this->binary_file.is_open())
-          {
-            this->last_error = "Binary file is not open";
-            return false;
-          }
+            std::uint32_t slot(std::uint64_t hash, std::uint32_t pilot) const
+            {
+              std::uint64_t h = hash ^ (this->seed << 32) ^ ((pilot + 1) * 0x9e3779b97f4a7c15);
+              h ^= h >> 31;
+              h *= 0xbf58476d1ce4e5b9;
+              h ^= h >> 29;
+              return reduce(static_cast<std::uint32_t>(h), this->slot_count);
+            }
 
-          for (const auto &section_header: this->section_headers)
-          {
-            switch (section_header.sh_type)
+            bool place(std::span<const std::uint64_t> hashes)
             {
-              case ::elf::elf_section_header::SHT_HASH:
+              /*
+               * Group the keys by bucket, then order the buckets by size
+               */
+              std::vector<std::uint32_t> bucket_starts(this->bucket_count + 1, 0);
+              for (const std::uint64_t hash: hashes)
               {
-                typedef struct hash_table_header
-                {
-                    std::uint32_t nbucket;
-                    std::uint32_t nchain;
-                } hash_table_header;
-
-                hash_table_header table_header;
-                this->binary_file.seekg(static_cast<std::streamoff>(section_header.sh_offset));
-                this->binary_file.read(reinterpret_cast<char *>(&table_header), sizeof(table_header));
-                if (this->binary_file.gcount() != sizeof(table_header))
-                {
-                  this->last_error = "Failed to read hash table header";
-                  return false;
-                }
-
-                if (table_header.nbucket == 0 || table_header.nchain == 0)
-                {
-                  this->last_error = "Invalid hash table header";
-                  return false;
-                }
-
-                this->hash_buckets.resize(table_header.nbucket);
-                this->binary_file.read(reinterpret_cast<char *>(this->hash_buckets.data()),
-                                       static_cast<std::streamsize>(sizeof(std::uint32_t) * table_header.nbucket));
-                if (this->binary_file.gcount() != sizeof(std::uint32_t) * table_header.nbucket)
-                {
-                  this->last_error = "Failed to read hash table buckets";
-                  return false;
-                }
-                this->hash_chains.resize(table_header.nchain);
-                this->binary_file.read(reinterpret_cast<char *>(this->hash_chains.data()),
-                                       static_cast<std::streamsize>(sizeof(std::uint32_t) * table_header.nchain));
-                if (this->binary_file.gcount() != sizeof(std::uint32_t) * table_header.nchain)
-                {
-                  this->last_error = "Failed to read hash table chains";
-                  return false;
-                }
-
-                break;
+                bucket_starts[reduce(static_cast<std::uint32_t>(hash >> 32), this->bucket_count) + 1]++;
               }
-              case ::elf::elf_section_header::SHT_GNU_HASH:
+              std::size_t largest = 0;
+              for (std::uint32_t b = 0; b < this->bucket_count; b++)
               {
-                typedef struct gnu_hash_table_header
-                {
-                    std::uint32_t nbuckets;
-                    std::uint32_t omitted_symbols_count;
-                    std::uint32_t bloom_size;
-                    std::uint32_t bloom_shift;
-                } gnu_hash_table_header;
-
-                gnu_hash_table_header table_header;
-                this->binary_file.seekg(static_cast<std::streamoff>(section_header.sh_offset));
-                this->binary_file.read(reinterpret_cast<char *>(&table_header), sizeof(table_header));
-                if (this->binary_file.gcount() != sizeof(table_header))
+                largest = std::max<std::size_t>(largest, bucket_starts[b + 1]);
+                bucket_starts[b + 1] += bucket_starts[b];
+              }
+              std::vector<std::uint64_t> keys(hashes.size());
+              std::vector<std::uint32_t> fill(bucket_starts.begin(), bucket_starts.end() - 1);
+              for (const std::uint64_t hash: hashes)
+              {
+                keys[fill[reduce(static_cast<std::uint32_t>(hash >> 32), this->bucket_count)]++] = hash;
+              }
+              std::vector<std::uint32_t> order(this->bucket_count);
+              for (std::uint32_t b = 0; b < this->bucket_count; b++)
+              {
+                order[b] = b;
+              }
+              std::stable_sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b) {
+                  return bucket_starts[a + 1] - bucket_starts[a] > bucket_starts[b + 1] - bucket_starts[b];
+              });
+
+              this->pilots.assign(this->bucket_count, 0);
+              std::vector<std::uint8_t> taken(this->slot_count, 0);
+              std::vector<std::uint32_t> slots(largest);
+              for (const std::uint32_t b: order)
+              {
+                const std::span<const std::uint64_t> bucket(keys.data() + bucket_starts[b], bucket_starts[b + 1] - bucket_starts[b]);
+                if (bucket.empty())
                 {
-                  this->last_error = "Failed to read gnu hash table header";
-                  return false;
+                  break;
                 }
-                this->gnu_hash_bloom_shift = table_header.bloom_shift;
-                this->gnu_hash_omitted_symbols_count = table_header.omitted_symbols_count;
-
-                if (this->is_64_bit())
+                std::uint32_t pilot = 0;
+                for (; pilot < max_pilot; pilot++)
                 {
-                  this->gnu_hash_bloom_words.resize(table_header.bloom_size);
-                  const auto bloom_words_size = static_cast<std::streamsize>(sizeof(std::uint64_t) * table_header.bloom_size);
-                  this->binary_file.read(reinterpret_cast<char *>(this->gnu_hash_bloom_words.data()), bloom_words_size);
-                  if (this->binary_file.gcount() != bloom_words_size)
+                  std::size_t placed = 0;
+                  for (; placed < bucket.size(); placed++)
                   {
-                    this->last_error = "Failed to read gnu hash table bloom words";
-                    return false;
+                    const std::uint32_t slot = this->slot(bucket[placed], pilot);
+                    if (taken[slot])
+                    {
+                      break;
+                    }
+                    taken[slot] = 1;
+                    slots[placed] = slot;
                   }
-                } else if (this->is_32_bit())
-                {
-                  std::vector<std::uint32_t> real_bloom_words(table_header.bloom_size);
-                  const auto real_bloom_words_size = static_cast<std::streamsize>(sizeof(std::uint32_t) * table_header.bloom_size);
-                  this->binary_file.read(reinterpret_cast<char *>(real_bloom_words.data()), real_bloom_words_size);
-                  if (this->binary_file.gcount() != real_bloom_words_size)
+                  if (placed == bucket.size())
                   {
-                    this->last_error = "Failed to read gnu hash table bloom words";
-                    return false;
+                    break;
                   }
-                  this->gnu_hash_bloom_words.resize(table_header.bloom_size);
-                  for (std::size_t i = 0; i < table_header.bloom_size; i++)
+                  for (std::size_t i = 0; i < placed; i++)
                   {
-                    this->gnu_hash_bloom_words[i] = real_bloom_words[i];
+                    taken[slots[i]] = 0;
                   }
-                } else
-                {
-                  this->last_error = "Invalid ELF class";
-                  return false;
                 }
-
-                this->gnu_hash_buckets.resize(table_header.nbuckets);
-                const auto buckets_size = static_cast<std::streamsize>(sizeof(std::uint32_t) * table_header.nbuckets);
-                this->binary_file.read(reinterpret_cast<char *>(this->gnu_hash_buckets.data()), buckets_size);
-                if (this->binary_file.gcount() != buckets_size)
+                if (pilot == max_pilot)
                 {
-                  this->last_error = "Failed to read gnu hash table buckets";
                   return false;
                 }
+                this->pilots[b] = pilot;
+              }
+              return true;
+            }
+        };
+    }
 
-                std::size_t hash_values_count = this->dynamic_symbols.size() - this->gnu_hash_omitted_symbols_count;
-                const auto hash_values_size = static_cast<std::streamsize>(sizeof(std::uint32_t) * hash_values_count);
-                this->gnu_hash_values.resize(hash_values_count);
-                this->binary_file.read(reinterpret_cast<char *>(this->gnu_hash_values.data()), hash_values_size);
-                if (this->binary_file.gcount() != hash_values_size)
-                {
-                  this->last_error = "Failed to read gnu hash table values";
-                  return false;
-                }
+    /*
+     * Where an elf_file reads its data from
+     */
+    enum class backend
+    {
+        stream = 0,  /* std::ifstream, every table is copied into owned memory */
+        mapped       /* Memory-mapped file, on-disk tables are viewed in place */
+    };
+
+    /*
+     * What elf_file::refresh found
+     */
+    enum class refresh_result
+    {
+        unchanged = 0,  /* The file's size, modification time and inode are as they were */
+        updated,        /* The file changed and the tables that differ were read again */
+        failed          /* The new file couldn't be read, see error_message */
+    };
+
+    /*
+     * The steps reading a file is split into. Every table load is one phase, so with lazy loading a phase runs when
+     * its first accessor is called
+     */
+    enum class parse_phase
+    {
+        open = 0,               /* Opening and mapping the file */
+        headers,                /* The ELF header and program headers */
+        build_id,
+        section_headers,        /* Section headers and their names */
+        init_fini_functions,
+        dynamic_entries,        /* The dynamic segment, its needed libraries and soname */
+        dynamic_symbols,        /* The dynamic symbols, excluding their hash tables */
+        hash_tables,            /* DT_HASH and DT_GNU_HASH */
+        relocations,
+        symbol_table,           /* .symtab */
+        address_index,
+        perfect_hash,
+        cache,                  /* Loading or saving the cache directory */
+        refresh,                /* Comparing the file to the one refresh replaced */
+        count
+    };
+
+    inline const char *parse_phase_str(::elf::parse_phase phase)
+    {
+      constexpr std::array<const char *, static_cast<std::size_t>(::elf::parse_phase::count)> names = {
+              "open", "headers", "build id", "section headers", "init/fini functions", "dynamic entries",
+              "dynamic symbols", "hash tables", "relocations", "symbol table", "address index", "perfect hash",
+              "cache", "refresh"
+      };
+      const auto index = static_cast<std::size_t>(phase);
+      return index < names.size() ? names[index] : "unknown";
+    }
+
+    /*
+     * What one parse phase cost. Time is exclusive, a phase that runs inside another (the hash tables inside the
+     * dynamic symbols, for example) is only counted once. Viewed bytes are tables used in place from a mapping
+     * rather than read
+     */
+    typedef struct phase_stats
+    {
+        std::uint64_t nanoseconds = 0;
+        std::uint64_t calls = 0;
+        std::uint64_t read_calls = 0;
+        std::uint64_t bytes_read = 0;
+        std::uint64_t bytes_viewed = 0;
+        std::uint64_t allocations = 0;
+        std::uint64_t bytes_allocated = 0;
+    } phase_stats;
+
+    /*
+     * The work done by symbol lookups through one kind of table. Filter rejects are names the GNU bloom filter or the
+     * perfect hash fingerprint ruled out before any chain was walked, string compares are the strcmp calls made
+     */
+    typedef struct lookup_stats
+    {
+        std::uint64_t lookups = 0;
+        std::uint64_t hits = 0;
+        std::uint64_t filter_rejects = 0;
+        std::uint64_t chain_entries = 0;
+        std::uint64_t string_compares = 0;
+
+        double average_chain_length() const
+        {
+          const std::uint64_t walked = this->lookups - this->filter_rejects;
+          return walked == 0 ? 0.0 : static_cast<double>(this->chain_entries) / static_cast<double>(walked);
+        }
+    } lookup_stats;
+
+    typedef struct parse_stats
+    {
+        std::array<::elf::phase_stats, static_cast<std::size_t>(::elf::parse_phase::count)> phases{};
+        ::elf::lookup_stats gnu_hash;
+        ::elf::lookup_stats elf_hash;
+        ::elf::lookup_stats perfect_hash;
+
+        const ::elf::phase_stats &operator[](::elf::parse_phase phase) const
+        {
+          return this->phases[static_cast<std::size_t>(phase)];
+        }
+    } parse_stats;
+
+    /*
+     * The executor layer is shared with luhns.hpp, so both run on one pool
+     */
+    using executor = ::exec::executor;
+    using inline_executor = ::exec::inline_executor;
+    using thread_pool = ::exec::thread_pool;
+    using ::exec::default_executor;
+
+    /*
+     * Options controlling how an elf_file is loaded
+     */
+    typedef struct load_options
+    {
+        ::elf::backend backend = ::elf::backend::stream;  /* Ignored when loading from a memory image */
+        /*
+         * Only read the ELF header and program headers up front. Every other
+         * table is parsed the first time its accessor is called and then
+         * cached, so lazily loaded files must not be shared between threads
+         */
+        bool lazy = false;
+        /*
+         * Where every table of the file is allocated from, the default
+         * resource when null. Must outlive the file
+         */
+        std::pmr::memory_resource *memory_resource = nullptr;
+        /*
+         * Load the file from a cache written by save_cache in this
+         * directory when there is one for it, skipping the parsing, and
+         * write one after parse_dynamic_segment when there isn't. Lazily
+         * loaded files only read caches
+         */
+        std::filesystem::path cache_directory;
+        /*
+         * Build a minimal perfect hash over the dynamic symbols after
+         * parse_dynamic_segment, or on the first lookup when lazy, so
+         * get_symbol takes one probe and one compare. Worth it for files
+         * that are looked up in many times
+         */
+        bool perfect_hash = false;
+        /*
+         * Store the GNU hash of every symbol's name in st_name_hash, so
+         * lookups through the ELF hash table compare hashes before names.
+         * Costs a pass over the names when parsing
+         */
+        bool hash_names = false;
+        /*
+         * Decode large tables in chunks on this executor, and spread the
+         * work of building the address index and perfect hash over it, so
+         * one big file parses on every worker. Null parses everything on
+         * the calling thread. Must outlive the file
+         */
+        ::elf::executor *executor = nullptr;
+    } load_options;
+
+    /*
+     * Read and parse an ELF file into a set of structures
+     */
+    class elf_file
+    {
+    public:
+        explicit elf_file(std::filesystem::path path, const ::elf::load_options &options = {}) : path(std::move(path)), cache_directory(options.cache_directory), file_backend(options.backend), lazy(options.lazy), perfect_hash_requested(options.perfect_hash), hash_names(options.hash_names), parallel_executor(options.executor), resource(this->track_allocations(get_memory_resource(options)))
+        {
+          if (!this->open_file(options.backend))
+          {
+            return;
+          }
+          this->read_headers();
+        };
+
+        /*
+         * Parse an ELF image that is already in memory. The image is not
+         * copied and must outlive this object
+         */
+        explicit elf_file(std::span<const std::byte> image, const ::elf::load_options &options = {}) : cache_directory(options.cache_directory), image(image), memory_backed(true), lazy(options.lazy), perfect_hash_requested(options.perfect_hash), hash_names(options.hash_names), parallel_executor(options.executor), resource(this->track_allocations(get_memory_resource(options)))
+        {
+          this->read_headers();
+        };
+
+        elf_file(const elf_file &copy) = delete;
+        elf_file &operator=(const elf_file &copy) = delete;
+
+        /*
+         * Moving hands over the tables without copying them, so names and
+         * symbols taken from the file stay valid. A moved-from file can
+         * only be assigned to or destroyed
+         */
+        elf_file(elf_file &&move) noexcept = default;
+
+        elf_file &operator=(elf_file &&move) noexcept
+        {
+          if (this != &move)
+          {
+            /*
+             * The tables' allocators don't propagate on assignment, so
+             * taking over move's storage as it is means constructing again
+             */
+            this->~elf_file();
+            ::new (static_cast<void *>(this)) elf_file(std::move(move));
+          }
+          return *this;
+        }
+
+        /*
+         * Close the file and drop everything parsed from it, keeping the
+         * memory its tables have grown to so that a reused object doesn't
+         * allocate them again. Options and stats are kept
+         */
+        void reset()
+        {
+          for (std::size_t i = 0; i < group_count; i++)
+          {
+            this->reset_group(static_cast<table_group>(i));
+          }
+          this->binary_file.close();
+          this->binary_file.clear();
+          this->mapping.close();
+          this->cache_mapping.close();
+          this->path.clear();
+          this->image = {};
+          this->memory_backed = false;
+          this->status = {};
+          this->header = {};
+          this->program_headers.clear();
+          this->base_address = 0;
+          this->last_error.clear();
+        }
+
+        /*
+         * Parse the file at path in place of the current one, as if
+         * constructed again with the same options but reusing the tables'
+         * memory. Returns false if it couldn't be opened or parsed
+         */
+        bool reopen(std::filesystem::path path)
+        {
+          this->reset();
+          this->path = std::move(path);
+          if (this->open_file(this->file_backend))
+          {
+            this->read_headers();
+          }
+          return !this->error();
+        }
+
+        /*
+         * reopen for an ELF image that is already in memory. The image is
+         * not copied and must outlive this object
+         */
+        bool reopen(std::span<const std::byte> image)
+        {
+          this->reset();
+          this->image = image;
+          this->memory_backed = true;
+          this->read_headers();
+          return !this->error();
+        }
+
+        /*
+         * Check if an error occurred
+         */
+        bool error() const
+        {
+          return !this->last_error.empty();
+        }
+
+        /*
+         * Get a message for the last error that occurred
+         */
+        const std::string &error_message() const
+        {
+          return this->last_error;
+        }
+
+        /*
+         * Clear the current error
+         */
+        void clear_error()
+        {
+          this->last_error = "";
+        }
+
+        /*
+         * Get what each parse phase has cost and the work symbol lookups have
+         * done since the file was opened or reset_stats was last called.
+         * Lookups made while building the perfect hash count towards the hash
+         * tables they went through. All zero unless built with ELF_HPP_STATS
+         */
+        ::elf::parse_stats get_stats() const
+        {
+          ::elf::parse_stats stats{};
+#if defined(ELF_HPP_STATS)
+          if (this->stats == nullptr)
+          {
+            return stats;
+          }
+          stats.phases = this->stats->phases;
+          this->stats->lookups[gnu_hash_lookups].read(stats.gnu_hash);
+          this->stats->lookups[elf_hash_lookups].read(stats.elf_hash);
+          this->stats->lookups[perfect_hash_lookups].read(stats.perfect_hash);
+#endif
+          return stats;
+        }
+
+        /*
+         * Zero the counters get_stats reports
+         */
+        void reset_stats()
+        {
+#if defined(ELF_HPP_STATS)
+          if (this->stats == nullptr)
+          {
+            return;
+          }
+          this->stats->phases = {};
+          for (lookup_counters &counters : this->stats->lookups)
+          {
+            counters.reset();
+          }
+#endif
+        }
+
+        /*
+         * Get the path the file was opened from. Empty for memory images
+         */
+        const std::filesystem::path &get_path() const
+        {
+          return this->path;
+        }
+
+        /*
+         * Get a bitness-agnostic Elf*_Ehdr structure
+         */
+        const ::elf::elf_header &get_header() const
+        {
+          return this->header;
+        }
+
+        /*
+         * Get the bitness-agnostic Elf*_Phdr structures
+         */
+        std::span<const ::elf::elf_program_header> get_program_headers() const
+        {
+          return this->program_headers.span();
+        }
+
+        /*
+         * Get the NT_GNU_BUILD_ID note from the program headers, empty if the
+         * file has none
+         */
+        std::span<const std::byte> get_build_id() const
+        {
+          this->load_lazily(&elf_file::load_build_id);
+          return this->build_id;
+        }
+
+        /*
+         * Get the key save_cache and load_cache identify the file by: the hex
+         * build ID, or the device, inode, size and modification time of the
+         * file when it has none. Empty for memory images without a build ID
+         */
+        std::string get_cache_key() const
+        {
+          static constexpr char digits[] = "0123456789abcdef";
+          std::string key;
+          for (const std::byte value: this->get_build_id())
+          {
+            key += digits[std::to_integer<unsigned>(value) >> 4];
+            key += digits[std::to_integer<unsigned>(value) & 0xf];
+          }
+          if (!key.empty() || this->path.empty())
+          {
+            return key;
+          }
+#if defined(ELF_HPP_POSIX)
+          struct stat file_status{};
+          if (::stat(this->path.c_str(), &file_status) != 0)
+          {
+            return key;
+          }
+          return "file-" + std::to_string(file_status.st_dev) + "-" + std::to_string(file_status.st_ino) + "-" + std::to_string(file_status.st_size) + "-" +
+                 std::to_string(file_status.st_mtim.tv_sec) + "." + std::to_string(file_status.st_mtim.tv_nsec);
+#else
+          std::error_code error;
+          const auto size = std::filesystem::file_size(this->path, error);
+          const auto modified = std::filesystem::last_write_time(this->path, error);
+          const auto absolute = std::filesystem::absolute(this->path, error);
+          if (error)
+          {
+            return key;
+          }
+          return "file-" + std::to_string(std::hash<std::string>{}(absolute.string())) + "-" + std::to_string(size) + "-" +
+                 std::to_string(modified.time_since_epoch().count());
+#endif
+        }
+
+        /*
+         * Get a vector of bitness-agnostic Elf*_Shdr structures
+         */
+        const ::elf::vector<::elf::elf_section_header> &get_section_headers() const
+        {
+          this->load_section_headers();
+          return this->section_headers;
+        }
+
+        /*
+         * Find the first section with a name, or nullptr if there is none.
+         * Looks up an index built with the section headers
+         */
+        const ::elf::elf_section_header *find_section(std::string_view name) const
+        {
+          if (!this->load_section_headers())
+          {
+            return nullptr;
+          }
+          return this->find_section_header(name);
+        }
+
+        /*
+         * Get the indices into get_section_headers of every section of a
+         * type, such as SHT_NOTE, in file order
+         */
+        std::span<const std::uint32_t> sections_of_type(std::uint32_t type) const
+        {
+          if (!this->load_section_headers())
+          {
+            return {};
+          }
+          return this->section_indices_of_type(type);
+        }
+
+        /*
+         * Get a vector of addresses of initialization functions. Addresses
+         * assume the file is loaded at its base address. They are in order
+         * of .preinit_array, .init, .init_array
+         */
+        const ::elf::vector<std::uint64_t> &get_init_functions() const
+        {
+          this->load_init_fini_functions();
+          return this->init_functions;
+        }
+
+        /*
+         * Get a vector of addresses of termination functions. Addresses assume
+         * the file is loaded at its base address. They are in order of
+         * .fini_array (reversed), .fini
+         */
+        const ::elf::vector<std::uint64_t> &get_fini_functions() const
+        {
+          this->load_init_fini_functions();
+          return this->fini_functions;
+        }
+
+        /*
+         * Check if tables are parsed on first access rather than up front
+         */
+        bool is_lazy() const
+        {
+          return this->lazy;
+        }
+
+        /*
+         * Get the expected base address. This is the virtual address of the
+         * lowest PT_LOAD segment. An executable should be loaded at this
+         * address. Shared libraries can be loaded anywhere as long as the
+         * internal layout and spacing remains the same.
+         */
+        std::uint64_t get_base_address() const
+        {
+          return this->base_address;
+        }
+
+        /*
+         * Check if the ELF file is little endian. Shorthand for
+         * get_header().e_ident.ei_data == ::elf::elf_ident::ELFDATA2LSB
+         */
+        bool is_little_endian() const
+        {
+          return this->header.e_ident.ei_data == ::elf::elf_ident::ELFDATA2LSB;
+        }
+
+        /*
+         * Check if the ELF file is big endian. Shorthand for
+         * get_header().e_ident.ei_data == ::elf::elf_ident::ELFDATA2MSB
+         */
+        bool is_big_endian() const
+        {
+          return this->header.e_ident.ei_data == ::elf::elf_ident::ELFDATA2MSB;
+        }
+
+        /*
+         * Check if the ELF file is 32-bit. Shorthand for
+         * get_header().e_ident.ei_class == ::elf::elf_ident::ELFCLASS32
+         */
+        bool is_32_bit() const
+        {
+          return this->header.e_ident.ei_class == ::elf::elf_ident::ELFCLASS32;
+        }
+
+        /*
+         * Check if the ELF file is 64-bit. Shorthand for
+         * get_header().e_ident.ei_class == ::elf::elf_ident::ELFCLASS64
+         */
+        bool is_64_bit() const
+        {
+          return this->header.e_ident.ei_class == ::elf::elf_ident::ELFCLASS64;
+        }
+
+        /*
+         * Check if the file is readable, either through the stream or as a
+         * memory image
+         */
+        bool is_open() const
+        {
+          return this->memory_backed || this->binary_file.is_open();
+        }
+
+        /*
+         * Check if the file is read from memory (mapped or caller-owned)
+         * rather than through std::ifstream
+         */
+        bool is_memory_backed() const
+        {
+          return this->memory_backed;
+        }
+
+        /*
+         * Get the memory image the file is read from. Empty when streaming
+         */
+        std::span<const std::byte> get_image() const
+        {
+          return this->image;
+        }
+
+        /*
+         * Get the underlying std::ifstream to read the binary file. It is
+         * never opened for memory-backed files
+         */
+        std::ifstream &get_binary_file()
+        {
+          return this->binary_file;
+        }
+
+        /*
+         * Parse the dynamic segment of the ELF file including symbols. In lazy
+         * mode only the dynamic entries and dynamic string table are read,
+         * symbols, hash tables and relocations wait for their accessors
+         */
+        bool parse_dynamic_segment()
+        {
+          if (!this->load_dynamic_entries())
+          {
+            return false;
+          }
+          if (this->lazy)
+          {
+            return true;
+          }
+          if (!this->load_dynamic_symbols() || !this->load_relocations())
+          {
+            return false;
+          }
+          if (!this->cache_directory.empty() && !this->cache_mapping.is_open())
+          {
+            this->write_cache_directory();
+          }
+          if (this->perfect_hash_requested)
+          {
+            this->load_perfect_hash();
+          }
+          return true;
+        }
+
+        /*
+         * Build a minimal perfect hash over the dynamic symbols that
+         * get_symbol and get_symbols use from then on, with the same
+         * results. Fails when the symbols can't be loaded or, very rarely,
+         * no perfect hash is found, leaving lookups on the hash tables. Call
+         * before sharing the file between threads
+         */
+        bool build_perfect_hash()
+        {
+          return this->load_perfect_hash();
+        }
+
+        /*
+         * Get the bitness-agnostic Elf*_Dyn structures
+         */
+        std::span<const ::elf::elf_dynamic> get_dynamic_entries() const
+        {
+          this->load_lazily(&elf_file::load_dynamic_entries);
+          return this->dynamic_entries.span();
+        }
+
+        /*
+         * Get the dynamic string table which contains symbol names amongst other things
+         */
+        std::span<const char> get_dynamic_string_table() const
+        {
+          this->load_lazily(&elf_file::load_dynamic_entries);
+          return this->dynamic_segment_string_table.span();
+        }
+
+        /*
+         * Get the value of DT_SONAME
+         */
+        const char *get_so_name() const
+        {
+          this->load_lazily(&elf_file::load_dynamic_entries);
+          return this->so_name;
+        }
+
+        /*
+         * Get a vector of DT_NEEDED values
+         */
+        const ::elf::vector<const char *> &get_needed_libraries() const
+        {
+          this->load_lazily(&elf_file::load_dynamic_entries);
+          return this->needed_libraries;
+        }
+
+        /*
+         * Get a vector of bitness-agnostic Elf*_Sym structures for all dynamic symbols
+         */
+        const ::elf::vector<::elf::elf_symbol> &get_dynamic_symbols() const
+        {
+          this->load_lazily(&elf_file::load_dynamic_symbols);
+          return this->dynamic_symbols;
+        }
+
+        /*
+         * Get a symbol by its name using the GNU hash table and/or the ELF hash table
+         */
+        ::elf::vector<::elf::elf_symbol>::const_iterator get_symbol(const char *name) const
+        {
+          return this->get_symbol(std::string_view(name));
+        }
+
+        /*
+         * get_symbol for a name of known length. Candidates whose name is a
+         * different length are rejected without reading their names
+         */
+        ::elf::vector<::elf::elf_symbol>::const_iterator get_symbol(std::string_view name) const
+        {
+          this->load_lazily(&elf_file::load_dynamic_symbols);
+          if (this->perfect_hash_requested)
+          {
+            this->load_lazily(&elf_file::load_perfect_hash);
+          }
+          if (this->perfect_hash_stage == stage::loaded)
+          {
+            return this->symbol_iterator(this->lookup_perfect_hash(name));
+          }
+          auto symbol = this->lookup_gnu_symbol(name);
+          if (symbol == this->dynamic_symbols.cend())
+          {
+            symbol = this->lookup_elf_symbol(name);
+          }
+          return symbol;
+        }
+
+        /*
+         * Resolve many symbols at once, setting out[i] to the symbol named
+         * names[i] or nullptr if there is none. Results match get_symbol, but
+         * each block of names is hashed, bloom filtered and has its buckets
+         * prefetched before any chain is walked, so the cache misses overlap.
+         * Resolves min(names.size(), out.size()) names and returns how many
+         * were found
+         */
+        std::size_t get_symbols(std::span<const char *const> names, std::span<const ::elf::elf_symbol *> out) const
+        {
+          this->load_lazily(&elf_file::load_dynamic_symbols);
+          const std::size_t count = std::min(names.size(), out.size());
+          if (this->perfect_hash_requested)
+          {
+            this->load_lazily(&elf_file::load_perfect_hash);
+          }
+          if (this->perfect_hash_stage == stage::loaded)
+          {
+            return this->lookup_perfect_hash_many(names.first(count), out.first(count));
+          }
+          const bool have_gnu_hash = this->has_gnu_hash_table();
+          const bool have_elf_hash = !this->hash_buckets.empty();
+          lookup_tally gnu_tally(*this, gnu_hash_lookups);
+          lookup_tally elf_tally(*this, elf_hash_lookups);
+
+          std::array<std::uint32_t, symbol_batch_size> block_hashes{};
+          std::array<std::uint8_t, symbol_batch_size> bloom_passes{};
+          std::array<std::uint32_t, symbol_batch_size> hashes{};
+          std::array<std::uint32_t, symbol_batch_size> chain_starts{};
+          std::array<std::size_t, symbol_batch_size> candidates{};
+          std::array<std::size_t, symbol_batch_size> misses{};
+          std::array<const char *, symbol_batch_size> miss_names{};
+          std::size_t found = 0;
+
+          for (std::size_t block = 0; block < count; block += symbol_batch_size)
+          {
+            const std::size_t block_size = std::min(symbol_batch_size, count - block);
+            std::size_t candidates_count = 0;
+            std::size_t misses_count = 0;
+
+            if (have_gnu_hash)
+            {
+              /*
+               * Hash every name and drop the ones the bloom filter rejects
+               */
+              gnu_hash_many(names.subspan(block, block_size), std::span(block_hashes).first(block_size));
+              this->gnu_bloom_test_many(block_hashes.data(), block_size, bloom_passes.data());
+              gnu_tally.lookup(block_size);
+              for (std::size_t i = 0; i < block_size; i++)
+              {
+                out[block + i] = nullptr;
+                const std::uint32_t hash = block_hashes[i];
+                if (bloom_passes[i])
+                {
+                  hashes[candidates_count] = hash;
+                  candidates[candidates_count++] = block + i;
+                  ::elf::detail::prefetch(&this->gnu_hash_buckets[hash % this->gnu_hash_buckets.size()]);
+                } else
+                {
+                  gnu_tally.filter_reject();
+                  misses[misses_count++] = block + i;
+                }
+              }
+
+              /*
+               * Fetch the chain starts and prefetch the chains themselves
+               */
+              for (std::size_t i = 0; i < candidates_count; i++)
+              {
+                const std::uint32_t start_idx = this->gnu_hash_buckets[hashes[i] % this->gnu_hash_buckets.size()];
+                chain_starts[i] = start_idx;
+                if (start_idx >= this->gnu_hash_omitted_symbols_count && start_idx < this->dynamic_symbols.size())
+                {
+                  ::elf::detail::prefetch(&this->gnu_hash_values[start_idx - this->gnu_hash_omitted_symbols_count]);
+                  ::elf::detail::prefetch(&this->dynamic_symbols[start_idx]);
+                }
+              }
+
+              for (std::size_t i = 0; i < candidates_count; i++)
+              {
+                const std::size_t name_idx = candidates[i];
+                out[name_idx] = this->walk_gnu_chain(names[name_idx], hashes[i], chain_starts[i], gnu_tally);
+                if (out[name_idx] != nullptr)
+                {
+                  found++;
+                } else
+                {
+                  misses[misses_count++] = name_idx;
+                }
+              }
+            } else
+            {
+              for (std::size_t i = 0; i < block_size; i++)
+              {
+                out[block + i] = nullptr;
+                misses[misses_count++] = block + i;
+              }
+            }
+
+            /*
+             * Anything the GNU hash table didn't find falls back to the ELF
+             * hash table, the same as get_symbol
+             */
+            if (have_elf_hash && misses_count != 0)
+            {
+              for (std::size_t i = 0; i < misses_count; i++)
+                miss_names[i] = names[misses[i]];
+              elf_hash_many(std::span(miss_names).first(misses_count), std::span(hashes).first(misses_count));
+              elf_tally.lookup(misses_count);
+              for (std::size_t i = 0; i < misses_count; i++)
+              {
+                hashes[i] %= this->hash_buckets.size();
+                ::elf::detail::prefetch(&this->hash_buckets[hashes[i]]);
+              }
+              for (std::size_t i = 0; i < misses_count; i++)
+              {
+                const std::size_t name_idx = misses[i];
+                std::uint32_t name_hash = 0;
+                if (this->hash_names)
+                {
+                  name_hash = have_gnu_hash ? block_hashes[name_idx - block] : static_cast<std::uint32_t>(gnu_hash(names[name_idx]));
+                }
+                out[name_idx] = this->walk_elf_chain(names[name_idx], this->hash_buckets[hashes[i]], name_hash, elf_tally);
+                if (out[name_idx] != nullptr)
+                {
+                  found++;
+                }
+              }
+            }
+          }
+
+          return found;
+        }
+
+        /*
+         * Get the static symbol table (SHT_SYMTAB), parsed on first use.
+         * Empty for stripped files
+         */
+        const ::elf::vector<::elf::elf_symbol> &get_symbol_table() const
+        {
+          this->load_symbol_table();
+          return this->symbol_table;
+        }
+
+        /*
+         * Find the symbol whose range contains a virtual address, searching
+         * both the static and dynamic symbol tables in O(log n). Addresses
+         * are as they appear in the file, not relocated to a load address.
+         * Zero-sized symbols extend to the next symbol or the end of their
+         * section. Where several symbols start at the same address a sized
+         * one wins, then global over weak over local. The index is built on
+         * first use, so call this once before sharing the file between
+         * threads
+         */
+        const ::elf::elf_symbol *symbol_for_address(std::uint64_t address) const
+        {
+          if (!this->load_address_index())
+          {
+            return nullptr;
+          }
+          const auto &starts = this->address_index.starts;
+          const auto after = std::upper_bound(starts.begin(), starts.end(), address);
+          if (after == starts.begin())
+          {
+            return nullptr;
+          }
+          return this->address_index_lookup(static_cast<std::size_t>(after - starts.begin()) - 1, address);
+        }
+
+        /*
+         * Symbolize many addresses in one merge pass over the index, setting
+         * out[i] to the symbol containing addresses[i] or nullptr. Addresses
+         * should be sorted ascending, any that go backwards cost a binary
+         * search. Resolves min(addresses.size(), out.size()) addresses and
+         * returns how many were found
+         */
+        std::size_t symbol_for_address(std::span<const std::uint64_t> addresses, std::span<const ::elf::elf_symbol *> out) const
+        {
+          const std::size_t count = std::min(addresses.size(), out.size());
+          if (!this->load_address_index())
+          {
+            std::fill(out.begin(), out.begin() + static_cast<std::ptrdiff_t>(count), nullptr);
+            return 0;
+          }
+          const auto &starts = this->address_index.starts;
+          std::size_t position = 0;
+          std::size_t found = 0;
+          for (std::size_t i = 0; i < count; i++)
+          {
+            const std::uint64_t address = addresses[i];
+            if (i != 0 && address < addresses[i - 1])
+            {
+              const auto after = std::upper_bound(starts.begin(), starts.end(), address);
+              position = after == starts.begin() ? 0 : static_cast<std::size_t>(after - starts.begin()) - 1;
+            }
+            while (position + 1 < starts.size() && starts[position + 1] <= address)
+            {
+              position++;
+            }
+            out[i] = position < starts.size() && starts[position] <= address ? this->address_index_lookup(position, address) : nullptr;
+            if (out[i] != nullptr)
+            {
+              found++;
+            }
+          }
+          return found;
+        }
+
+        /*
+         * A relocation table decoded as it is iterated instead of being
+         * copied out. Entries of a mapped or in-memory file are read from
+         * the image, otherwise the table is read in chunks of chunk_size
+         * bytes. Every entry is widened to an elf_rela, with a zero addend
+         * for tables without one. DT_RELR addresses come out as relative
+         * relocations of the file's machine, R_X86_64_NONE for machines we
+         * have no types for. The file must outlive the range and its
+         * iterators, and a range may only be iterated by one thread
+         */
+        class relocation_range
+        {
+        public:
+            inline static constexpr std::size_t chunk_size = 4096;
+
+            class iterator
+            {
+            public:
+                using iterator_category = std::forward_iterator_tag;
+                using value_type = ::elf::elf_rela;
+                using difference_type = std::ptrdiff_t;
+                using pointer = const ::elf::elf_rela *;
+                using reference = const ::elf::elf_rela &;
+
+                iterator() = default;
+
+                reference operator*() const
+                {
+                  return this->current;
+                }
+
+                pointer operator->() const
+                {
+                  return &this->current;
+                }
+
+                iterator &operator++()
+                {
+                  this->advance();
+                  return *this;
+                }
+
+                iterator operator++(int)
+                {
+                  iterator previous = *this;
+                  this->advance();
+                  return previous;
+                }
+
+                bool operator==(const iterator &other) const
+                {
+                  return this->next == other.next && this->bitmap == other.bitmap;
+                }
+
+            private:
+                friend class relocation_range;
+
+                inline static constexpr std::uint64_t end_position = std::numeric_limits<std::uint64_t>::max();
+
+                const relocation_range *range = nullptr;
+                std::uint64_t next = end_position;  /* Offset of the next entry or word in the table */
+                std::uint64_t bitmap = 0;           /* DT_RELR: bits of the current bitmap word not yet visited */
+                std::uint64_t bitmap_base = 0;      /* DT_RELR: address of bit 0 of bitmap */
+                std::uint64_t base = 0;             /* DT_RELR: address the next bitmap word starts at */
+                ::elf::elf_rela current{};
+
+                explicit iterator(const relocation_range *range) : range(range), next(0)
+                {
+                  this->current.r_type = range->relative_type;
+                  this->advance();
+                }
+
+                void advance()
+                {
+                  if (this->range->kind != ::elf::relocation_kind::relative)
+                  {
+                    const std::byte *entry = this->next < this->range->size ? this->range->fetch(this->next, this->range->entry_size) : nullptr;
+                    if (entry == nullptr)
+                    {
+                      this->next = end_position;
+                      return;
+                    }
+                    this->range->decode(entry, this->current);
+                    this->next += this->range->entry_size;
+                    return;
+                  }
+
+                  /*
+                   * An even word is an address to relocate. An odd word is a
+                   * bitmap of which of the next word_bits - 1 words after the
+                   * last address or bitmap to relocate
+                   */
+                  const std::uint64_t word_size = this->range->entry_size;
+                  while (this->bitmap == 0)
+                  {
+                    const std::byte *entry = this->next < this->range->size ? this->range->fetch(this->next, word_size) : nullptr;
+                    if (entry == nullptr)
+                    {
+                      this->next = end_position;
+                      return;
+                    }
+                    const std::uint64_t word = this->range->decode_word(entry);
+                    this->next += word_size;
+                    if ((word & 1) == 0)
+                    {
+                      this->current.r_offset = word;
+                      this->base = word + word_size;
+                      return;
+                    }
+                    this->bitmap = word >> 1;
+                    this->bitmap_base = this->base;
+                    this->base += (word_size * 8 - 1) * word_size;
+                  }
+                  this->current.r_offset = this->bitmap_base + std::countr_zero(this->bitmap) * word_size;
+                  this->bitmap &= this->bitmap - 1;
+                }
+            };
+
+            using const_iterator = iterator;
+
+            relocation_range() = default;
+
+            iterator begin() const
+            {
+              return this->size == 0 ? iterator() : iterator(this);
+            }
+
+            iterator end() const
+            {
+              return {};
+            }
+
+            bool empty() const
+            {
+              return this->size == 0;
+            }
+
+            ::elf::relocation_kind get_kind() const
+            {
+              return this->kind;
+            }
+
+            /*
+             * Check if the entries have an explicit addend
+             */
+            bool has_addend() const
+            {
+              return this->addend;
+            }
+
+            /*
+             * Size of the table in bytes
+             */
+            std::uint64_t size_bytes() const
+            {
+              return this->size;
+            }
+
+        private:
+            friend class elf_file;
+
+            const elf_file *file = nullptr;
+            ::elf::relocation_kind kind = ::elf::relocation_kind::dynamic;
+            bool addend = false;
+            std::uint32_t relative_type = 0;
+            std::uint64_t offset = 0;
+            std::uint64_t size = 0;
+            std::uint64_t entry_size = 0;
+            void (*decode)(const std::byte *entry, ::elf::elf_rela &relocation) = nullptr;
+            std::uint64_t (*decode_word)(const std::byte *entry) = nullptr;
+            mutable std::array<std::byte, chunk_size> chunk;
+            mutable std::uint64_t chunk_offset = 0;
+            mutable std::uint64_t chunk_length = 0;
+
+            /*
+             * Get length bytes at position in the table, refilling the chunk
+             * from position when they are not in it. Read failures are
+             * reported through the file
+             */
+            const std::byte *fetch(std::uint64_t position, std::uint64_t length) const
+            {
+              if (this->file->memory_backed)
+              {
+                return this->file->image.data() + this->offset + position;
+              }
+              if (position < this->chunk_offset || position + length > this->chunk_offset + this->chunk_length)
+              {
+                this->chunk_offset = position;
+                this->chunk_length = std::min<std::uint64_t>(chunk_size, this->size - position);
+                if (!this->file->read_bytes(this->offset + position, this->chunk_length, this->chunk.data()))
+                {
+                  this->chunk_length = 0;
+                  this->file->last_error = "Failed to read relocation entries";
+                  return nullptr;
+                }
+              }
+              return this->chunk.data() + (position - this->chunk_offset);
+            }
+        };
+
+        /*
+         * Get dynamic symbol relocations without addend (non PLT)
+         */
+        std::span<const ::elf::elf_rel> get_relocations() const
+        {
+          this->load_lazily(&elf_file::load_relocations);
+          return this->dyn_rel_entries.span();
+        }
+
+        /*
+         * Get dynamic symbol relocations with addend (non PLT)
+         */
+        std::span<const ::elf::elf_rela> get_relocations_with_addend() const
+        {
+          this->load_lazily(&elf_file::load_relocations);
+          return this->dyn_rela_entries.span();
+        }
+
+        /*
+         * Get PLT relocations without addend
+         */
+        std::span<const ::elf::elf_rel> get_plt_relocations() const
+        {
+          this->load_lazily(&elf_file::load_relocations);
+          return this->plt_rel_entries.span();
+        }
+
+        /*
+         * Get PLT relocations with addend
+         */
+        std::span<const ::elf::elf_rela> get_plt_relocations_with_addend() const
+        {
+          this->load_lazily(&elf_file::load_relocations);
+          return this->plt_rela_entries.span();
+        }
+
+        /*
+         * Get one of the relocation tables named by the dynamic segment as a
+         * range that decodes entries while it is iterated. The range is
+         * empty if the file has no such table or it is invalid, in which
+         * case an error is set
+         */
+        relocation_range get_relocation_range(::elf::relocation_kind kind) const
+        {
+          relocation_range range;
+          range.file = this;
+          range.kind = kind;
+          this->load_lazily(&elf_file::load_dynamic_entries);
+          if (this->dynamic_entries_stage != stage::loaded)
+          {
+            return range;
+          }
+          const relocation_table &table = this->relocation_tables[static_cast<std::size_t>(kind)];
+          if (table.size == 0)
+          {
+            return range;
+          }
+          if (this->memory_backed && (table.offset > this->image.size() || table.size > this->image.size() - table.offset))
+          {
+            this->last_error = "Failed to read relocation entries";
+            return range;
+          }
+          const bool valid = this->visit_layout([&](auto layout) {
+              using Layout = decltype(layout);
+              const std::uint64_t entry_size = kind == ::elf::relocation_kind::relative ? sizeof(typename Layout::Addr)
+                                             : table.addend ? sizeof(typename Layout::Rela)
+                                             : sizeof(typename Layout::Rel);
+              if ((table.entry_size != 0 && table.entry_size != entry_size) || table.size % entry_size != 0)
+              {
+                return false;
+              }
+              range.entry_size = entry_size;
+              range.decode = table.addend ? &elf_file::decode_relocation<Layout, true> : &elf_file::decode_relocation<Layout, false>;
+              range.decode_word = &elf_file::decode_relocation_word<Layout>;
+              return true;
+          });
+          if (!valid)
+          {
+            this->last_error = "Invalid relocation entry size";
+            return range;
+          }
+          range.addend = table.addend;
+          range.offset = table.offset;
+          range.size = table.size;
+          if (kind == ::elf::relocation_kind::relative)
+          {
+            range.relative_type = this->header.e_machine == ::elf::elf_header::EM_386 ? ::elf::elf_rel::R_386_RELATIVE
+                                : this->header.e_machine == ::elf::elf_header::EM_X86_64 ? ::elf::elf_rel::R_X86_64_RELATIVE
+                                : ::elf::elf_rel::R_X86_64_NONE;
+          }
+          return range;
+        }
+
+        /*
+         * Write everything parse_dynamic_segment produces, along with the
+         * section headers and init/fini arrays, to a cache file that
+         * load_cache can map instead of parsing the file again. The cache is
+         * specific to this version of elf.hpp and to the host's byte order,
+         * and is replaced atomically
+         */
+        bool save_cache(const std::filesystem::path &cache_path) const
+        {
+          const phase_scope scope(*this, ::elf::parse_phase::cache);
+          if (!this->load_section_headers() || !this->load_init_fini_functions() || !this->load_dynamic_entries() || !this->load_dynamic_symbols() ||
+              !this->load_relocations())
+          {
+            if (this->last_error.empty())
+            {
+              this->last_error = "Failed to find dynamic segment";
+            }
+            return false;
+          }
+          const std::string key = this->get_cache_key();
+          if (key.empty())
+          {
+            this->last_error = "Failed to find a cache key";
+            return false;
+          }
+
+          cache_header header = this->make_cache_header();
+          std::vector<std::byte> contents(sizeof(cache_header));
+          const auto append = [&](cache_table_index idx, auto entries) {
+              contents.resize((contents.size() + cache_table_alignment - 1) & ~(cache_table_alignment - 1));
+              header.tables[idx] = {contents.size(), entries.size()};
+              contents.resize(contents.size() + entries.size_bytes());
+              if (!entries.empty())
+              {
+                std::memcpy(contents.data() + header.tables[idx].offset, entries.data(), entries.size_bytes());
+              }
+          };
+
+          /*
+           * Pointers into string tables are stored as offsets or rebuilt from
+           * the name offsets on load
+           */
+          const char *dynamic_strings = this->dynamic_segment_string_table.data();
+          ::elf::vector<::elf::elf_section_header> section_headers(this->section_headers, this->resource);
+          for (auto &section_header: section_headers)
+          {
+            section_header.sh_name_str = nullptr;
+          }
+          ::elf::vector<::elf::elf_symbol> dynamic_symbols(this->dynamic_symbols, this->resource);
+          for (auto &symbol: dynamic_symbols)
+          {
+            symbol.st_name_str = nullptr;
+          }
+          ::elf::vector<std::uint64_t> needed_libraries(this->resource);
+          for (const char *needed: this->needed_libraries)
+          {
+            needed_libraries.push_back(static_cast<std::uint64_t>(needed - dynamic_strings));
+          }
+          header.so_name = static_cast<std::uint64_t>(this->so_name - dynamic_strings);
+
+          append(cache_key, std::span<const char>(key));
+          append(cache_section_headers, std::span<const ::elf::elf_section_header>(section_headers));
+          append(cache_section_header_string_table, this->section_header_string_table.span());
+          append(cache_init_functions, std::span<const std::uint64_t>(this->init_functions));
+          append(cache_fini_functions, std::span<const std::uint64_t>(this->fini_functions));
+          append(cache_dynamic_entries, this->dynamic_entries.span());
+          append(cache_dynamic_string_table, this->dynamic_segment_string_table.span());
+          append(cache_needed_libraries, std::span<const std::uint64_t>(needed_libraries));
+          append(cache_dynamic_symbols, std::span<const ::elf::elf_symbol>(dynamic_symbols));
+          append(cache_hash_buckets, this->hash_buckets.span());
+          append(cache_hash_chains, this->hash_chains.span());
+          append(cache_gnu_hash_buckets, this->gnu_hash_buckets.span());
+          append(cache_gnu_hash_values, this->gnu_hash_values.span());
+          append(cache_gnu_hash_bloom_words, this->gnu_hash_bloom_words.span());
+          append(cache_relocation_tables, std::span<const relocation_table>(this->relocation_tables));
+          append(cache_plt_rel_entries, this->plt_rel_entries.span());
+          append(cache_dyn_rel_entries, this->dyn_rel_entries.span());
+          append(cache_plt_rela_entries, this->plt_rela_entries.span());
+          append(cache_dyn_rela_entries, this->dyn_rela_entries.span());
+          std::memcpy(contents.data(), &header, sizeof(header));
+
+          /*
+           * Write next to the cache and rename over it so readers never see
+           * part of one
+           */
+          std::filesystem::path temporary_path = cache_path;
+          temporary_path += ".tmp" + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+          {
+            std::ofstream cache_file(temporary_path, std::ios::binary | std::ios::trunc);
+            cache_file.write(reinterpret_cast<const char *>(contents.data()), static_cast<std::streamsize>(contents.size()));
+            if (!cache_file.good())
+            {
+              cache_file.close();
+              std::error_code error;
+              std::filesystem::remove(temporary_path, error);
+              this->last_error = "Failed to write cache file";
+              return false;
+            }
+          }
+          std::error_code error;
+          std::filesystem::rename(temporary_path, cache_path, error);
+          if (error)
+          {
+            std::filesystem::remove(temporary_path, error);
+            this->last_error = "Failed to write cache file";
+            return false;
+          }
+          return true;
+        }
+
+        /*
+         * Load the tables save_cache writes from a cache file instead of
+         * parsing them. Most tables view the mapped cache, but the symbols
+         * and section headers are copied to resolve their names. Returns
+         * false without an error when the cache is missing, stale or was
+         * written for another file, host or version. Combine with lazy
+         * loading so the constructor doesn't parse what the cache holds
+         */
+        bool load_cache(const std::filesystem::path &cache_path)
+        {
+          const phase_scope scope(*this, ::elf::parse_phase::cache);
+          ::elf::mapped_file cache;
+          if (!cache.open(cache_path))
+          {
+            return false;
+          }
+          const std::span<const std::byte> contents = cache.data();
+          cache_header header;
+          if (contents.size() < sizeof(header))
+          {
+            return false;
+          }
+          std::memcpy(&header, contents.data(), sizeof(header));
+          const cache_header expected = this->make_cache_header();
+          if (std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 || header.version != expected.version ||
+              header.layout != expected.layout || header.ei_class != expected.ei_class || header.ei_data != expected.ei_data ||
+              header.e_machine != expected.e_machine || header.base_address != expected.base_address)
+          {
+            return false;
+          }
+
+          /*
+           * Check every table lies in the cache before touching any state
+           */
+          std::span<const char> key, section_header_strings, dynamic_strings;
+          std::span<const ::elf::elf_section_header> section_headers;
+          std::span<const std::uint64_t> init_functions, fini_functions, needed_libraries, gnu_hash_bloom_words;
+          std::span<const ::elf::elf_dynamic> dynamic_entries;
+          std::span<const ::elf::elf_symbol> dynamic_symbols;
+          std::span<const std::uint32_t> hash_buckets, hash_chains, gnu_hash_buckets, gnu_hash_values;
+          std::span<const relocation_table> relocation_tables;
+          std::span<const ::elf::elf_rel> plt_rel_entries, dyn_rel_entries;
+          std::span<const ::elf::elf_rela> plt_rela_entries, dyn_rela_entries;
+          const bool valid = cache_table_view(contents, header, cache_key, key) &&
+                             cache_table_view(contents, header, cache_section_headers, section_headers) &&
+                             cache_table_view(contents, header, cache_section_header_string_table, section_header_strings) &&
+                             cache_table_view(contents, header, cache_init_functions, init_functions) &&
+                             cache_table_view(contents, header, cache_fini_functions, fini_functions) &&
+                             cache_table_view(contents, header, cache_dynamic_entries, dynamic_entries) &&
+                             cache_table_view(contents, header, cache_dynamic_string_table, dynamic_strings) &&
+                             cache_table_view(contents, header, cache_needed_libraries, needed_libraries) &&
+                             cache_table_view(contents, header, cache_dynamic_symbols, dynamic_symbols) &&
+                             cache_table_view(contents, header, cache_hash_buckets, hash_buckets) &&
+                             cache_table_view(contents, header, cache_hash_chains, hash_chains) &&
+                             cache_table_view(contents, header, cache_gnu_hash_buckets, gnu_hash_buckets) &&
+                             cache_table_view(contents, header, cache_gnu_hash_values, gnu_hash_values) &&
+                             cache_table_view(contents, header, cache_gnu_hash_bloom_words, gnu_hash_bloom_words) &&
+                             cache_table_view(contents, header, cache_relocation_tables, relocation_tables) &&
+                             cache_table_view(contents, header, cache_plt_rel_entries, plt_rel_entries) &&
+                             cache_table_view(contents, header, cache_dyn_rel_entries, dyn_rel_entries) &&
+                             cache_table_view(contents, header, cache_plt_rela_entries, plt_rela_entries) &&
+                             cache_table_view(contents, header, cache_dyn_rela_entries, dyn_rela_entries);
+          if (!valid || std::string_view(key.data(), key.size()) != this->get_cache_key() || relocation_tables.size() != this->relocation_tables.size() ||
+              dynamic_strings.empty() || dynamic_strings.back() != '\0' || header.so_name >= dynamic_strings.size() ||
+              (!section_header_strings.empty() && section_header_strings.back() != '\0') ||
+              std::any_of(needed_libraries.begin(), needed_libraries.end(), [&](std::uint64_t needed) { return needed >= dynamic_strings.size(); }))
+          {
+            return false;
+          }
+
+          /*
+           * Stored lengths are only trusted when they end inside the string
+           * table, the hashes only when the cache was written with them
+           */
+          const auto resolve = [](std::span<const char> strings, std::uint32_t name, std::uint32_t &length) {
+              if (name >= strings.size() || length > strings.size() - name)
+              {
+                const std::string_view string = ::elf::detail::string_at(strings, name);
+                length = static_cast<std::uint32_t>(string.size());
+                return string.data();
+              }
+              return strings.data() + name;
+          };
+          this->section_headers.assign(section_headers.begin(), section_headers.end());
+          for (auto &section_header: this->section_headers)
+          {
+            section_header.sh_name_str = resolve(section_header_strings, section_header.sh_name, section_header.sh_name_length);
+          }
+          this->index_section_headers();
+          this->section_header_string_table.assign_view(section_header_strings.data(), section_header_strings.size());
+          this->init_functions.assign(init_functions.begin(), init_functions.end());
+          this->fini_functions.assign(fini_functions.begin(), fini_functions.end());
+          this->dynamic_entries.assign_view(dynamic_entries.data(), dynamic_entries.size());
+          this->dynamic_segment_string_table.assign_view(dynamic_strings.data(), dynamic_strings.size());
+          this->so_name = dynamic_strings.data() + header.so_name;
+          this->needed_libraries.clear();
+          for (const std::uint64_t needed: needed_libraries)
+          {
+            this->needed_libraries.push_back(dynamic_strings.data() + needed);
+          }
+          this->symbol_table_offset = header.symbol_table_offset;
+          this->symbol_table_entry_size = header.symbol_table_entry_size;
+          this->dynamic_symbols.assign(dynamic_symbols.begin(), dynamic_symbols.end());
+          const bool rehash = this->hash_names && (header.flags & cache_names_hashed) == 0;
+          this->for_each_chunk(this->dynamic_symbols.size(), [&](std::size_t begin, std::size_t end) {
+              for (std::size_t i = begin; i < end; i++)
+              {
+                auto &symbol = this->dynamic_symbols[i];
+                symbol.st_name_str = resolve(dynamic_strings, symbol.st_name, symbol.st_name_length);
+                if (rehash)
+                {
+                  symbol.st_name_hash = static_cast<std::uint32_t>(gnu_hash(symbol.st_name_str, symbol.st_name_length));
+                } else if (!this->hash_names)
+                {
+                  symbol.st_name_hash = 0;
+                }
+              }
+          });
+          this->hash_buckets.assign_view(hash_buckets.data(), hash_buckets.size());
+          this->hash_chains.assign_view(hash_chains.data(), hash_chains.size());
+          this->gnu_hash_buckets.assign_view(gnu_hash_buckets.data(), gnu_hash_buckets.size());
+          this->gnu_hash_values.assign_view(gnu_hash_values.data(), gnu_hash_values.size());
+          this->gnu_hash_bloom_words.assign_view(gnu_hash_bloom_words.data(), gnu_hash_bloom_words.size());
+          this->gnu_hash_bloom_shift = header.gnu_hash_bloom_shift;
+          this->gnu_hash_omitted_symbols_count = header.gnu_hash_omitted_symbols_count;
+          std::copy(relocation_tables.begin(), relocation_tables.end(), this->relocation_tables.begin());
+          this->plt_rel_entries.assign_view(plt_rel_entries.data(), plt_rel_entries.size());
+          this->dyn_rel_entries.assign_view(dyn_rel_entries.data(), dyn_rel_entries.size());
+          this->plt_rela_entries.assign_view(plt_rela_entries.data(), plt_rela_entries.size());
+          this->dyn_rela_entries.assign_view(dyn_rela_entries.data(), dyn_rela_entries.size());
+
+          this->section_headers_stage = stage::loaded;
+          this->init_fini_functions_stage = stage::loaded;
+          this->dynamic_entries_stage = stage::loaded;
+          this->dynamic_symbols_stage = stage::loaded;
+          this->relocations_stage = stage::loaded;
+          this->cache_mapping = std::move(cache);
+          return true;
+        }
+
+        /*
+         * Bring the tables up to date with the file on disk. Nothing is read
+         * unless its size, modification time or inode changed. Otherwise the
+         * file is opened again next to the old one and each group of tables
+         * is kept if the bytes it was read from are unchanged, along with
+         * the groups it was built from, and loaded again if not (or left
+         * for its accessor when lazy). Files rewritten in place rather than
+         * replaced leave nothing to compare, so everything is loaded again,
+         * as are tables that came from a cache. When the new file's headers
+         * can't be read the old one is kept and refresh can be retried.
+         * Invalidates references and iterators into the tables, and
+         * relocation ranges
+         */
+        ::elf::refresh_result refresh()
+        {
+          if (this->path.empty())
+          {
+            this->last_error = "Memory images can't be refreshed";
+            return ::elf::refresh_result::failed;
+          }
+          const phase_scope scope(*this, ::elf::parse_phase::refresh);
+          file_status current{};
+          if (!read_file_status(this->path, current))
+          {
+            this->last_error = "File does not exist";
+            return ::elf::refresh_result::failed;
+          }
+          const bool was_open = this->is_open();
+          if (was_open && current == this->status)
+          {
+            return ::elf::refresh_result::unchanged;
+          }
+
+          /*
+           * Open the new file, keeping the old one to compare against
+           */
+          const file_status previous_status = this->status;
+          std::ifstream previous_file;
+          this->binary_file.swap(previous_file);
+          ::elf::mapped_file previous_mapping = std::move(this->mapping);
+          const std::span<const std::byte> previous_image = this->image;
+          const ::elf::elf_header previous_header = this->header;
+          ::elf::detail::table<::elf::elf_program_header> previous_program_headers = std::move(this->program_headers);
+          const std::uint64_t previous_base_address = this->base_address;
+          this->image = {};
+          this->last_error.clear();
+          if (!this->open_file(this->file_backend) || !this->read_elf_header() ||
+              !this->visit_layout([this](auto layout) { return this->read_program_headers(layout); }))
+          {
+            const std::string error = this->last_error;
+            this->binary_file.swap(previous_file);
+            this->mapping = std::move(previous_mapping);
+            this->image = previous_image;
+            this->header = previous_header;
+            this->program_headers = std::move(previous_program_headers);
+            this->base_address = previous_base_address;
+            this->status = previous_status;
+            this->last_error = error;
+            return ::elf::refresh_result::failed;
+          }
+
+          /*
+           * The old contents are only still there if the file was replaced
+           * rather than written over. Without inodes, only mapped_file's own
+           * copy can be trusted
+           */
+#if defined(ELF_HPP_POSIX)
+          const bool replaced = current.device != previous_status.device || current.inode != previous_status.inode;
+#else
+          const bool replaced = this->memory_backed;
+#endif
+          const std::array<file_range, 2> header_ranges{{
+              {0, previous_header.e_ehsize},
+              {previous_header.e_phoff, static_cast<std::uint64_t>(previous_header.e_phnum) * previous_header.e_phentsize}
+          }};
+          const bool comparable = was_open && replaced && this->same_bytes(header_ranges, previous_file, previous_image);
+
+          typedef struct refresh_group
+          {
+              stage *state;
+              const ::elf::vector<file_range> *ranges;  /* Null for tables built from other tables */
+              std::uint32_t built_from;                 /* Mask of table_group */
+              bool (elf_file::*load)() const;
+              bool cached;                              /* Written by save_cache */
+          } refresh_group;
+          const std::array<refresh_group, group_count> groups{{
+              {&this->build_id_stage, &this->build_id_ranges, 0, &elf_file::load_build_id, false},
+              {&this->section_headers_stage, &this->section_headers_ranges, 0, &elf_file::load_section_headers, true},
+              {&this->init_fini_functions_stage, &this->init_fini_functions_ranges, 1u << group_section_headers, &elf_file::load_init_fini_functions, true},
+              {&this->dynamic_entries_stage, &this->dynamic_entries_ranges, 0, &elf_file::load_dynamic_entries, true},
+              {&this->dynamic_symbols_stage, &this->dynamic_symbols_ranges, 1u << group_dynamic_entries | 1u << group_section_headers,
+               &elf_file::load_dynamic_symbols, true},
+              {&this->relocations_stage, &this->relocations_ranges, 1u << group_dynamic_entries | 1u << group_section_headers, &elf_file::load_relocations, true},
+              {&this->symbol_table_stage, &this->symbol_table_ranges, 1u << group_section_headers, &elf_file::load_symbol_table, false},
+              {&this->address_index_stage, nullptr, 1u << group_symbol_table | 1u << group_dynamic_symbols | 1u << group_section_headers,
+               &elf_file::load_address_index, false},
+              {&this->perfect_hash_stage, nullptr, 1u << group_dynamic_symbols, &elf_file::load_perfect_hash, false}
+          }};
+
+          const bool from_cache = this->cache_mapping.is_open();
+          std::uint32_t kept = 0, reset = 0;
+          for (std::size_t i = 0; i < groups.size(); i++)
+          {
+            const refresh_group &group = groups[i];
+            const bool keep = *group.state == stage::pending ||
+                              (*group.state == stage::loaded && comparable && (group.built_from & ~kept) == 0 && !(group.cached && from_cache) &&
+                               (group.ranges == nullptr || this->same_bytes(*group.ranges, previous_file, previous_image)));
+            if (keep)
+            {
+              kept |= 1u << i;
+              continue;
+            }
+            reset |= 1u << i;
+            this->reset_group(static_cast<table_group>(i));
+          }
+          if (this->memory_backed)
+          {
+            this->rebase_tables(previous_image, this->image);
+          }
+          if (from_cache)
+          {
+            this->cache_mapping.close();
+          }
+
+          /*
+           * Load what was loaded before, as the constructor and
+           * parse_dynamic_segment would have
+           */
+          if (!this->lazy)
+          {
+            for (std::size_t i = 0; i < groups.size(); i++)
+            {
+              if ((reset & 1u << i) != 0)
+              {
+                (this->*groups[i].load)();
+              }
+            }
+            if (!this->cache_directory.empty() && (reset & 1u << group_dynamic_symbols) != 0 && this->dynamic_symbols_stage == stage::loaded &&
+                this->relocations_stage == stage::loaded)
+            {
+              this->write_cache_directory();
+            }
+          }
+          return this->last_error.empty() ? ::elf::refresh_result::updated : ::elf::refresh_result::failed;
+        }
+
+    private:
+        /*
+         * Number of names get_symbols hashes and prefetches before walking chains
+         */
+        inline static constexpr std::size_t symbol_batch_size = 64;
+
+        /*
+         * Largest PT_NOTE segment searched for a build ID
+         */
+        inline static constexpr std::uint64_t max_note_segment_size = 1 << 20;
+
+        /*
+         * Parse state of a group of tables. Everything past the program
+         * headers may be loaded from a const accessor in lazy mode, so those
+         * tables are mutable
+         */
+        enum class stage : std::uint8_t
+        {
+            pending = 0,
+            loaded,
+            failed
+        };
+
+        /*
+         * Bytes of the file a group of tables was read from, so refresh can
+         * tell whether they changed
+         */
+        typedef struct file_range
+        {
+            std::uint64_t offset;
+            std::uint64_t size;
+        } file_range;
+
+        /*
+         * The sections of one type, as a run of section_type_order
+         */
+        typedef struct section_type_range
+        {
+            std::uint32_t sh_type;
+            std::uint32_t begin;
+            std::uint32_t count;
+        } section_type_range;
+
+        /*
+         * What refresh compares to decide if the file changed at all. Device
+         * and inode are 0 where they aren't available
+         */
+        typedef struct file_status
+        {
+            std::uint64_t device;
+            std::uint64_t inode;
+            std::uint64_t size;
+            std::int64_t modified;  /* Nanoseconds */
+
+            bool operator==(const file_status &other) const = default;
+        } file_status;
+
+        /*
+         * Groups of tables refresh keeps or reads again as a whole, in the
+         * order they are loaded
+         */
+        enum table_group : std::size_t
+        {
+            group_build_id = 0,
+            group_section_headers,
+            group_init_fini_functions,
+            group_dynamic_entries,
+            group_dynamic_symbols,
+            group_relocations,
+            group_symbol_table,
+            group_address_index,
+            group_perfect_hash,
+            group_count
+        };
+
+        /*
+         * Bytes refresh compares at a time when streaming
+         */
+        inline static constexpr std::size_t refresh_chunk_size = 1 << 16;
+
+        /*
+         * Entries each task decodes when parsing on an executor. Tables
+         * smaller than two chunks are decoded on the calling thread
+         */
+        inline static constexpr std::size_t parallel_chunk_size = 1 << 13;
+
+        std::filesystem::path path;
+        std::filesystem::path cache_directory;
+        ::elf::backend file_backend = ::elf::backend::stream;
+        mutable std::ifstream binary_file;
+        ::elf::mapped_file mapping;
+        std::span<const std::byte> image;
+        bool memory_backed = false;
+        bool lazy = false;
+        bool perfect_hash_requested = false;
+        bool hash_names = false;
+        ::elf::executor *parallel_executor = nullptr;
+#if defined(ELF_HPP_STATS)
+        class stats_counters;
+        std::unique_ptr<stats_counters> stats;
+#endif
+        std::pmr::memory_resource *resource;
+        mutable std::string last_error;
+        file_status status{};
+
+        /*
+         * Where read_bytes and read_table note what they read while a group
+         * of tables is loading, null otherwise
+         */
+        mutable ::elf::vector<file_range> *recorded_ranges = nullptr;
+
+        ::elf::elf_header header{0};
+        ::elf::detail::table<::elf::elf_program_header> program_headers{this->resource};
+        std::uint64_t base_address = 0;
+
+        mutable stage build_id_stage = stage::pending;
+        mutable ::elf::vector<file_range> build_id_ranges{this->resource};
+        mutable ::elf::vector<std::byte> build_id{this->resource};
+
+        /*
+         * The cache the tables were loaded from, which they may view
+         */
+        ::elf::mapped_file cache_mapping;
+
+        mutable stage section_headers_stage = stage::pending;
+        mutable ::elf::vector<file_range> section_headers_ranges{this->resource};
+        mutable ::elf::vector<::elf::elf_section_header> section_headers{this->resource};
+        mutable ::elf::detail::table<char> section_header_string_table{this->resource};
+
+        /*
+         * Indices of the section headers: an open-addressed table of index
+         * plus one keyed by the GNU hash of each name, and every index
+         * ordered by type with the run each type covers
+         */
+        mutable ::elf::vector<std::uint32_t> section_name_slots{this->resource};
+        mutable ::elf::vector<std::uint32_t> section_type_order{this->resource};
+        mutable ::elf::vector<section_type_range> section_type_ranges{this->resource};
+
+        mutable stage init_fini_functions_stage = stage::pending;
+        mutable ::elf::vector<file_range> init_fini_functions_ranges{this->resource};
+        mutable ::elf::vector<std::uint64_t> init_functions{this->resource};
+        mutable ::elf::vector<std::uint64_t> fini_functions{this->resource};
+
+        mutable stage dynamic_entries_stage = stage::pending;
+        mutable ::elf::vector<file_range> dynamic_entries_ranges{this->resource};
+        mutable ::elf::detail::table<::elf::elf_dynamic> dynamic_entries{this->resource};
+        mutable ::elf::detail::table<char> dynamic_segment_string_table{this->resource};
+        mutable const char *so_name = nullptr;
+        mutable ::elf::vector<const char *> needed_libraries{this->resource};
+        mutable std::uint64_t symbol_table_offset = 0;
+        mutable std::uint64_t symbol_table_entry_size = 0;
+
+        mutable stage dynamic_symbols_stage = stage::pending;
+        mutable ::elf::vector<file_range> dynamic_symbols_ranges{this->resource};
+        mutable ::elf::vector<::elf::elf_symbol> dynamic_symbols{this->resource};
+        mutable ::elf::detail::table<std::uint32_t> hash_buckets{this->resource};
+        mutable ::elf::detail::table<std::uint32_t> hash_chains{this->resource};
+        mutable ::elf::detail::table<std::uint32_t> gnu_hash_buckets{this->resource};
+        mutable ::elf::detail::table<std::uint32_t> gnu_hash_values{this->resource};
+        mutable std::uint32_t gnu_hash_bloom_shift = 0;
+        mutable std::uint32_t gnu_hash_omitted_symbols_count = 0;
+        mutable ::elf::detail::table<std::uint64_t> gnu_hash_bloom_words{this->resource};
+
+        /*
+         * Where a relocation table named by the dynamic segment is, indexed
+         * by relocation_kind. An entry size of 0 means DT_*ENT was missing
+         */
+        typedef struct relocation_table
+        {
+            std::uint64_t offset;
+            std::uint64_t size;
+            std::uint64_t entry_size;
+            bool addend;
+        } relocation_table;
+
+        mutable std::array<relocation_table, 3> relocation_tables{};
+
+        /*
+         * Tables in a cache file, in the order save_cache writes them
+         */
+        enum cache_table_index : std::size_t
+        {
+            cache_key = 0,
+            cache_section_headers,
+            cache_section_header_string_table,
+            cache_init_functions,
+            cache_fini_functions,
+            cache_dynamic_entries,
+            cache_dynamic_string_table,
+            cache_needed_libraries,
+            cache_dynamic_symbols,
+            cache_hash_buckets,
+            cache_hash_chains,
+            cache_gnu_hash_buckets,
+            cache_gnu_hash_values,
+            cache_gnu_hash_bloom_words,
+            cache_relocation_tables,
+            cache_plt_rel_entries,
+            cache_dyn_rel_entries,
+            cache_plt_rela_entries,
+            cache_dyn_rela_entries,
+            cache_table_count
+        };
+
+        inline static constexpr std::uint32_t cache_version = 2;
+        inline static constexpr std::uint32_t cache_names_hashed = 1;  /* cache_header flag, st_name_hash is set */
+        inline static constexpr std::size_t cache_table_alignment = 8;
+
+        /*
+         * Start of a cache file. Tables are stored as they are in memory,
+         * aligned to cache_table_alignment
+         */
+        typedef struct cache_header
+        {
+            char magic[8];                            /* "ELFHPPC" */
+            std::uint32_t version;                    /* cache_version */
+            std::uint32_t layout;                     /* Our byte order and structure sizes, see make_cache_header */
+            ::elf::byte ei_class;
+            ::elf::byte ei_data;
+            std::uint16_t e_machine;
+            std::uint32_t gnu_hash_bloom_shift;
+            std::uint32_t gnu_hash_omitted_symbols_count;
+            std::uint32_t flags;                      /* cache_names_hashed */
+            std::uint64_t base_address;
+            std::uint64_t so_name;                    /* Offset into the dynamic string table */
+            std::uint64_t symbol_table_offset;
+            std::uint64_t symbol_table_entry_size;
+            struct
+            {
+                std::uint64_t offset;
+                std::uint64_t count;
+            } tables[cache_table_count];
+        } cache_header;
+
+        mutable stage relocations_stage = stage::pending;
+        mutable ::elf::vector<file_range> relocations_ranges{this->resource};
+        mutable ::elf::detail::table<::elf::elf_rel> plt_rel_entries{this->resource};
+        mutable ::elf::detail::table<::elf::elf_rel> dyn_rel_entries{this->resource};
+        mutable ::elf::detail::table<::elf::elf_rela> plt_rela_entries{this->resource};
+        mutable ::elf::detail::table<::elf::elf_rela> dyn_rela_entries{this->resource};
+
+        mutable stage symbol_table_stage = stage::pending;
+        mutable ::elf::vector<file_range> symbol_table_ranges{this->resource};
+        mutable ::elf::vector<::elf::elf_symbol> symbol_table{this->resource};
+        mutable ::elf::detail::table<char> symbol_string_table{this->resource};
+
+        /*
+         * Symbols sorted by start address for symbol_for_address. Each
+         * entry refers to symbol_table, or to dynamic_symbols when the top
+         * bit is set
+         */
+        typedef struct address_ranges
+        {
+            explicit address_ranges(std::pmr::memory_resource *resource) : starts(resource), sizes(resource), symbols(resource)
+            {
+            }
+
+            ::elf::vector<std::uint64_t> starts;
+            ::elf::vector<std::uint32_t> sizes;
+            ::elf::vector<std::uint32_t> symbols;
+
+            inline static constexpr std::uint32_t dynamic_symbol = 0x80000000;
+        } address_ranges;
+
+        mutable stage address_index_stage = stage::pending;
+        mutable address_ranges address_index{this->resource};
+
+        /*
+         * A slot of the perfect hash over the dynamic symbols: the low half
+         * of the name's hash, so most misses never touch the symbol, and the
+         * symbol's index
+         */
+        typedef struct perfect_hash_slot
+        {
+            std::uint32_t fingerprint;
+            std::uint32_t symbol;
+        } perfect_hash_slot;
+
+        mutable stage perfect_hash_stage = stage::pending;
+        mutable ::elf::detail::perfect_hash symbol_perfect_hash{this->resource};
+        mutable ::elf::vector<perfect_hash_slot> perfect_hash_slots{this->resource};
+
+    private:
+        static std::pmr::memory_resource *get_memory_resource(const ::elf::load_options &options)
+        {
+          return options.memory_resource != nullptr ? options.memory_resource : std::pmr::get_default_resource();
+        }
+
+        enum lookup_table
+        {
+            gnu_hash_lookups = 0,
+            elf_hash_lookups,
+            perfect_hash_lookups,
+            lookup_table_count
+        };
+
+#if defined(ELF_HPP_STATS)
+        /*
+         * Lookups are const and may run on many threads at once, so their
+         * counters are atomic. Phases only run while a table loads, which
+         * callers already serialise
+         */
+        typedef struct lookup_counters
+        {
+            std::atomic<std::uint64_t> lookups{0};
+            std::atomic<std::uint64_t> hits{0};
+            std::atomic<std::uint64_t> filter_rejects{0};
+            std::atomic<std::uint64_t> chain_entries{0};
+            std::atomic<std::uint64_t> string_compares{0};
+
+            void read(::elf::lookup_stats &stats) const
+            {
+              stats.lookups = this->lookups.load(std::memory_order_relaxed);
+              stats.hits = this->hits.load(std::memory_order_relaxed);
+              stats.filter_rejects = this->filter_rejects.load(std::memory_order_relaxed);
+              stats.chain_entries = this->chain_entries.load(std::memory_order_relaxed);
+              stats.string_compares = this->string_compares.load(std::memory_order_relaxed);
+            }
+
+            void reset()
+            {
+              this->lookups.store(0, std::memory_order_relaxed);
+              this->hits.store(0, std::memory_order_relaxed);
+              this->filter_rejects.store(0, std::memory_order_relaxed);
+              this->chain_entries.store(0, std::memory_order_relaxed);
+              this->string_compares.store(0, std::memory_order_relaxed);
+            }
+        } lookup_counters;
+
+        class phase_scope;
+
+        /*
+         * Everything get_stats reports. Tables allocate through it so each
+         * allocation is counted against the phase running, and it lives on
+         * the heap so resource stays valid when the file is moved
+         */
+        class stats_counters : public std::pmr::memory_resource
+        {
+        public:
+            explicit stats_counters(std::pmr::memory_resource *upstream) : upstream(upstream)
+            {
+            }
+
+            std::pmr::memory_resource *const upstream;
+            std::array<::elf::phase_stats, static_cast<std::size_t>(::elf::parse_phase::count)> phases{};
+            std::array<lookup_counters, lookup_table_count> lookups;
+            phase_scope *current = nullptr;
+
+        private:
+            void *do_allocate(std::size_t bytes, std::size_t alignment) override
+            {
+              if (this->current != nullptr)
+              {
+                ::elf::phase_stats &phase = this->phases[static_cast<std::size_t>(this->current->phase)];
+                phase.allocations++;
+                phase.bytes_allocated += bytes;
+              }
+              return this->upstream->allocate(bytes, alignment);
+            }
+
+            void do_deallocate(void *pointer, std::size_t bytes, std::size_t alignment) override
+            {
+              this->upstream->deallocate(pointer, bytes, alignment);
+            }
+
+            bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+            {
+              return this == &other;
+            }
+        };
+
+        /*
+         * Times a phase while in scope. Phases nest, the time a nested phase
+         * takes is taken off the phase around it
+         */
+        class phase_scope
+        {
+        public:
+            phase_scope(const elf_file &file, ::elf::parse_phase phase) : phase(phase), stats(*file.stats), outer(std::exchange(file.stats->current, this))
+            {
+              this->stats.phases[static_cast<std::size_t>(phase)].calls++;
+              this->start = std::chrono::steady_clock::now();
+            }
+
+            ~phase_scope()
+            {
+              const auto elapsed = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - this->start).count());
+              this->stats.phases[static_cast<std::size_t>(this->phase)].nanoseconds += elapsed - std::min(elapsed, this->nested);
+              if (this->outer != nullptr)
+              {
+                this->outer->nested += elapsed;
+              }
+              this->stats.current = this->outer;
+            }
+
+            phase_scope(const phase_scope &) = delete;
+            phase_scope &operator=(const phase_scope &) = delete;
+
+            const ::elf::parse_phase phase;
+
+        private:
+            stats_counters &stats;
+            phase_scope *const outer;
+            std::chrono::steady_clock::time_point start;
+            std::uint64_t nested = 0;
+        };
+
+        /*
+         * Counts the work of one lookup, or one batch of them, locally and
+         * adds it to the file's counters once at the end
+         */
+        class lookup_tally
+        {
+        public:
+            lookup_tally(const elf_file &file, lookup_table table) : counters(file.stats->lookups[table])
+            {
+            }
+
+            ~lookup_tally()
+            {
+              add(this->counters.lookups, this->lookups);
+              add(this->counters.hits, this->hits);
+              add(this->counters.filter_rejects, this->filter_rejects);
+              add(this->counters.chain_entries, this->chain_entries);
+              add(this->counters.string_compares, this->string_compares);
+            }
+
+            lookup_tally(const lookup_tally &) = delete;
+            lookup_tally &operator=(const lookup_tally &) = delete;
+
+            void lookup(std::uint64_t count = 1) { this->lookups += count; }
+            void hit() { this->hits++; }
+            void filter_reject() { this->filter_rejects++; }
+            void chain_entry() { this->chain_entries++; }
+            void string_compare() { this->string_compares++; }
+
+        private:
+            static void add(std::atomic<std::uint64_t> &counter, std::uint64_t value)
+            {
+              if (value != 0)
+              {
+                counter.fetch_add(value, std::memory_order_relaxed);
+              }
+            }
+
+            lookup_counters &counters;
+            std::uint64_t lookups = 0;
+            std::uint64_t hits = 0;
+            std::uint64_t filter_rejects = 0;
+            std::uint64_t chain_entries = 0;
+            std::uint64_t string_compares = 0;
+        };
+
+        std::pmr::memory_resource *track_allocations(std::pmr::memory_resource *upstream)
+        {
+          this->stats = std::make_unique<stats_counters>(upstream);
+          return this->stats.get();
+        }
+
+        void count_read(std::uint64_t size) const
+        {
+          if (this->stats->current != nullptr)
+          {
+            ::elf::phase_stats &phase = this->stats->phases[static_cast<std::size_t>(this->stats->current->phase)];
+            phase.read_calls++;
+            phase.bytes_read += size;
+          }
+        }
+
+        void count_view(std::uint64_t size) const
+        {
+          if (this->stats->current != nullptr)
+          {
+            this->stats->phases[static_cast<std::size_t>(this->stats->current->phase)].bytes_viewed += size;
+          }
+        }
+#else
+        class phase_scope
+        {
+        public:
+            phase_scope(const elf_file &, ::elf::parse_phase)
+            {
+            }
+        };
+
+        class lookup_tally
+        {
+        public:
+            lookup_tally(const elf_file &, lookup_table)
+            {
+            }
+
+            void lookup(std::uint64_t = 1) {}
+            void hit() {}
+            void filter_reject() {}
+            void chain_entry() {}
+            void string_compare() {}
+        };
+
+        static std::pmr::memory_resource *track_allocations(std::pmr::memory_resource *upstream)
+        {
+          return upstream;
+        }
+
+        void count_read(std::uint64_t) const
+        {
+        }
+
+        void count_view(std::uint64_t) const
+        {
+        }
+#endif
+
+        bool open_file(::elf::backend backend)
+        {
+          const phase_scope scope(*this, ::elf::parse_phase::open);
+          /*
+           * Taken before opening, so a file replaced in between looks
+           * changed to refresh rather than unchanged
+           */
+          if (!read_file_status(this->path, this->status))
+          {
+            this->last_error = "File does not exist";
+            return false;
+          }
+
+          if (backend == ::elf::backend::mapped)
+          {
+            if (!this->mapping.open(this->path))
+            {
+              this->last_error = "Failed to map library file";
+              return false;
+            }
+            this->image = this->mapping.data();
+            this->memory_backed = true;
+            return true;
+          }
+
+          this->binary_file.open(this->path, std::ios::binary | std::ios::in);
+          if (!this->binary_file.is_open())
+          {
+            this->last_error = "Failed to open library file";
+            return false;
+          }
+
+          return true;
+        }
+
+        static bool read_file_status(const std::filesystem::path &path, file_status &status)
+        {
+#if defined(ELF_HPP_POSIX)
+          struct stat file_status{};
+          if (::stat(path.c_str(), &file_status) != 0)
+          {
+            return false;
+          }
+          status.device = static_cast<std::uint64_t>(file_status.st_dev);
+          status.inode = static_cast<std::uint64_t>(file_status.st_ino);
+          status.size = static_cast<std::uint64_t>(file_status.st_size);
+          status.modified = static_cast<std::int64_t>(file_status.st_mtim.tv_sec) * 1000000000 + file_status.st_mtim.tv_nsec;
+          return true;
+#else
+          std::error_code error;
+          status.device = 0;
+          status.inode = 0;
+          status.size = std::filesystem::file_size(path, error);
+          status.modified = static_cast<std::int64_t>(std::filesystem::last_write_time(path, error).time_since_epoch().count());
+          return !error;
+#endif
+        }
+
+        /*
+         * Check ranges hold the same bytes in the file as in a previous
+         * version of it, read through previous_file or previous_image
+         */
+        bool same_bytes(std::span<const file_range> ranges, std::ifstream &previous_file, std::span<const std::byte> previous_image) const
+        {
+          std::vector<std::byte> previous_chunk, chunk;
+          for (const file_range &range: ranges)
+          {
+            if (this->memory_backed)
+            {
+              const auto contains = [&range](std::span<const std::byte> contents) {
+                  return range.offset <= contents.size() && range.size <= contents.size() - range.offset;
+              };
+              if (!contains(previous_image) || !contains(this->image) ||
+                  std::memcmp(previous_image.data() + range.offset, this->image.data() + range.offset, range.size) != 0)
+              {
+                return false;
+              }
+              continue;
+            }
+            previous_chunk.resize(refresh_chunk_size);
+            chunk.resize(refresh_chunk_size);
+            for (std::uint64_t position = 0; position < range.size; position += refresh_chunk_size)
+            {
+              const std::uint64_t length = std::min<std::uint64_t>(refresh_chunk_size, range.size - position);
+              previous_file.clear();
+              previous_file.seekg(static_cast<std::streamoff>(range.offset + position));
+              previous_file.read(reinterpret_cast<char *>(previous_chunk.data()), static_cast<std::streamsize>(length));
+              if (previous_file.gcount() != static_cast<std::streamsize>(length) || !this->read_bytes(range.offset + position, length, chunk.data()) ||
+                  std::memcmp(previous_chunk.data(), chunk.data(), length) != 0)
+              {
+                return false;
+              }
+            }
+          }
+          return true;
+        }
+
+        /*
+         * Empty a group of tables and mark it for loading again
+         */
+        void reset_group(table_group group)
+        {
+          switch (group)
+          {
+            case group_build_id:
+              this->build_id_stage = stage::pending;
+              this->build_id_ranges.clear();
+              this->build_id.clear();
+              break;
+            case group_section_headers:
+              this->section_headers_stage = stage::pending;
+              this->section_headers_ranges.clear();
+              this->section_headers.clear();
+              this->section_header_string_table.clear();
+              this->section_name_slots.clear();
+              this->section_type_order.clear();
+              this->section_type_ranges.clear();
+              break;
+            case group_init_fini_functions:
+              this->init_fini_functions_stage = stage::pending;
+              this->init_fini_functions_ranges.clear();
+              this->init_functions.clear();
+              this->fini_functions.clear();
+              break;
+            case group_dynamic_entries:
+              this->dynamic_entries_stage = stage::pending;
+              this->dynamic_entries_ranges.clear();
+              this->dynamic_entries.clear();
+              this->dynamic_segment_string_table.clear();
+              this->so_name = nullptr;
+              this->needed_libraries.clear();
+              this->symbol_table_offset = 0;
+              this->symbol_table_entry_size = 0;
+              this->relocation_tables = {};
+              break;
+            case group_dynamic_symbols:
+              this->dynamic_symbols_stage = stage::pending;
+              this->dynamic_symbols_ranges.clear();
+              this->dynamic_symbols.clear();
+              this->hash_buckets.clear();
+              this->hash_chains.clear();
+              this->gnu_hash_buckets.clear();
+              this->gnu_hash_values.clear();
+              this->gnu_hash_bloom_shift = 0;
+              this->gnu_hash_omitted_symbols_count = 0;
+              this->gnu_hash_bloom_words.clear();
+              break;
+            case group_relocations:
+              this->relocations_stage = stage::pending;
+              this->relocations_ranges.clear();
+              this->plt_rel_entries.clear();
+              this->dyn_rel_entries.clear();
+              this->plt_rela_entries.clear();
+              this->dyn_rela_entries.clear();
+              break;
+            case group_symbol_table:
+              this->symbol_table_stage = stage::pending;
+              this->symbol_table_ranges.clear();
+              this->symbol_table.clear();
+              this->symbol_string_table.clear();
+              break;
+            case group_address_index:
+              this->address_index_stage = stage::pending;
+              this->address_index.starts.clear();
+              this->address_index.sizes.clear();
+              this->address_index.symbols.clear();
+              break;
+            case group_perfect_hash:
+              this->perfect_hash_stage = stage::pending;
+              this->perfect_hash_slots.clear();
+              break;
+            case group_count:
+              break;
+          }
+        }
+
+        /*
+         * Point every table and name viewing the previous image at the same
+         * place in the new one
+         */
+        void rebase_tables(std::span<const std::byte> from, std::span<const std::byte> to)
+        {
+          const auto rebase_names = [&](::elf::vector<::elf::elf_symbol> &symbols) {
+              for (auto &symbol: symbols)
+              {
+                symbol.st_name_str = ::elf::detail::rebase(symbol.st_name_str, from, to);
+              }
+          };
+          this->section_header_string_table.rebase(from, to);
+          for (auto &section_header: this->section_headers)
+          {
+            section_header.sh_name_str = ::elf::detail::rebase(section_header.sh_name_str, from, to);
+          }
+          this->dynamic_entries.rebase(from, to);
+          this->dynamic_segment_string_table.rebase(from, to);
+          this->so_name = ::elf::detail::rebase(this->so_name, from, to);
+          for (auto &needed: this->needed_libraries)
+          {
+            needed = ::elf::detail::rebase(needed, from, to);
+          }
+          rebase_names(this->dynamic_symbols);
+          this->hash_buckets.rebase(from, to);
+          this->hash_chains.rebase(from, to);
+          this->gnu_hash_buckets.rebase(from, to);
+          this->gnu_hash_values.rebase(from, to);
+          this->gnu_hash_bloom_words.rebase(from, to);
+          this->plt_rel_entries.rebase(from, to);
+          this->dyn_rel_entries.rebase(from, to);
+          this->plt_rela_entries.rebase(from, to);
+          this->dyn_rela_entries.rebase(from, to);
+          this->symbol_string_table.rebase(from, to);
+          rebase_names(this->symbol_table);
+        }
+
+        bool read_headers()
+        {
+          {
+            const phase_scope scope(*this, ::elf::parse_phase::headers);
+            if (!this->read_elf_header() || !this->visit_layout([this](auto layout) { return this->read_program_headers(layout); }))
+            {
+              return false;
+            }
+          }
+          if (!this->lazy)
+          {
+            this->load_build_id();
+          }
+          if (!this->cache_directory.empty())
+          {
+            const std::string key = this->get_cache_key();
+            if (!key.empty() && this->load_cache(this->cache_directory / (key + ".elfcache")))
+            {
+              return true;
+            }
+          }
+          if (this->lazy)
+          {
+            return true;
+          }
+          return this->load_section_headers() && this->load_init_fini_functions();
+        }
+
+        /*
+         * Write a cache into cache_directory after parsing. Failing to is not
+         * an error of the file
+         */
+        void write_cache_directory() const
+        {
+          const std::string key = this->get_cache_key();
+          std::error_code error;
+          std::filesystem::create_directories(this->cache_directory, error);
+          if (key.empty() || error)
+          {
+            return;
+          }
+          const std::string previous_error = this->last_error;
+          if (!this->save_cache(this->cache_directory / (key + ".elfcache")))
+          {
+            this->last_error = previous_error;
+          }
+        }
+
+        cache_header make_cache_header() const
+        {
+          cache_header header{};
+          std::memcpy(header.magic, "ELFHPPC", sizeof(header.magic));
+          header.version = cache_version;
+          header.layout = (std::endian::native == std::endian::little ? 1u : 2u) << 24 | static_cast<std::uint32_t>(sizeof(void *)) << 16 |
+                          static_cast<std::uint32_t>(sizeof(::elf::elf_symbol)) << 8 | static_cast<std::uint32_t>(sizeof(::elf::elf_section_header));
+          header.ei_class = this->header.e_ident.ei_class;
+          header.ei_data = this->header.e_ident.ei_data;
+          header.e_machine = this->header.e_machine;
+          header.gnu_hash_bloom_shift = this->gnu_hash_bloom_shift;
+          header.gnu_hash_omitted_symbols_count = this->gnu_hash_omitted_symbols_count;
+          header.flags = this->hash_names ? cache_names_hashed : 0;
+          header.base_address = this->base_address;
+          header.symbol_table_offset = this->symbol_table_offset;
+          header.symbol_table_entry_size = this->symbol_table_entry_size;
+          return header;
+        }
+
+        /*
+         * View a table of a cache file, checking it lies inside it
+         */
+        template<typename T>
+        static bool cache_table_view(std::span<const std::byte> contents, const cache_header &header, cache_table_index idx, std::span<const T> &entries)
+        {
+          const auto &table = header.tables[idx];
+          if (table.offset % alignof(T) != 0 || table.offset > contents.size() || table.count > (contents.size() - table.offset) / sizeof(T))
+          {
+            return false;
+          }
+          entries = std::span<const T>(reinterpret_cast<const T *>(contents.data() + table.offset), table.count);
+          return true;
+        }
+
+        /*
+         * Run a loader once as phase, remembering whether it succeeded and
+         * noting the parts of the file it read in ranges. Tables built from
+         * other tables rather than the file pass null
+         */
+        template<typename Loader>
+        bool load_stage(stage &state, ::elf::parse_phase phase, ::elf::vector<file_range> *ranges, Loader &&loader) const
+        {
+          if (state == stage::pending)
+          {
+            const phase_scope scope(*this, phase);
+            if (ranges != nullptr)
+            {
+              ranges->clear();
+            }
+            ::elf::vector<file_range> *const outer_ranges = std::exchange(this->recorded_ranges, ranges);
+            state = loader() ? stage::loaded : stage::failed;
+            this->recorded_ranges = outer_ranges;
+          }
+          return state == stage::loaded;
+        }
+
+        /*
+         * Called by accessors so lazily loaded files parse on first use. Eager
+         * files only populate tables through the constructor and
+         * parse_dynamic_segment
+         */
+        void load_lazily(bool (elf_file::*loader)() const) const
+        {
+          if (this->lazy)
+          {
+            (this->*loader)();
+          }
+        }
+
+        bool load_build_id() const
+        {
+          return this->load_stage(this->build_id_stage, ::elf::parse_phase::build_id, &this->build_id_ranges, [this]() {
+              return this->visit_layout([this](auto layout) { return this->read_build_id(layout); });
+          });
+        }
+
+        bool load_section_headers() const
+        {
+          return this->load_stage(this->section_headers_stage, ::elf::parse_phase::section_headers, &this->section_headers_ranges, [this]() {
+              return this->visit_layout([this](auto layout) { return this->read_section_headers(layout); });
+          });
+        }
+
+        bool load_init_fini_functions() const
+        {
+          return this->load_stage(this->init_fini_functions_stage, ::elf::parse_phase::init_fini_functions, &this->init_fini_functions_ranges, [this]() {
+              return this->load_section_headers() && this->visit_layout([this](auto layout) {
+                  return this->read_init_functions(layout) && this->read_term_functions(layout);
+              });
+          });
+        }
+
+        bool load_dynamic_entries() const
+        {
+          return this->load_stage(this->dynamic_entries_stage, ::elf::parse_phase::dynamic_entries, &this->dynamic_entries_ranges, [this]() {
+              return this->visit_layout([this](auto layout) { return this->read_dynamic_entries(layout); });
+          });
+        }
+
+        bool load_dynamic_symbols() const
+        {
+          return this->load_stage(this->dynamic_symbols_stage, ::elf::parse_phase::dynamic_symbols, &this->dynamic_symbols_ranges, [this]() {
+              return this->visit_layout([this](auto layout) { return this->read_dynamic_symbols(layout); });
+          });
+        }
+
+        bool load_relocations() const
+        {
+          return this->load_stage(this->relocations_stage, ::elf::parse_phase::relocations, &this->relocations_ranges, [this]() {
+              return this->visit_layout([this](auto layout) { return this->parse_relocations(layout); });
+          });
+        }
+
+        bool load_symbol_table() const
+        {
+          return this->load_stage(this->symbol_table_stage, ::elf::parse_phase::symbol_table, &this->symbol_table_ranges, [this]() {
+              return this->load_section_headers() && this->visit_layout([this](auto layout) { return this->read_symbol_table(layout); });
+          });
+        }
+
+        bool load_perfect_hash() const
+        {
+          return this->load_stage(this->perfect_hash_stage, ::elf::parse_phase::perfect_hash, nullptr, [this]() {
+              return this->load_dynamic_symbols() && this->build_symbol_perfect_hash();
+          });
+        }
+
+        bool load_address_index() const
+        {
+          return this->load_stage(this->address_index_stage, ::elf::parse_phase::address_index, nullptr, [this]() {
+              return this->load_symbol_table() && this->build_address_index();
+          });
+        }
+
+        /*
+         * Note that the group of tables loading read size bytes at offset,
+         * merging reads that follow on from the last
+         */
+        void record_range(std::uint64_t offset, std::uint64_t size) const
+        {
+          if (this->recorded_ranges == nullptr || size == 0)
+          {
+            return;
+          }
+          auto &ranges = *this->recorded_ranges;
+          if (!ranges.empty() && ranges.back().offset + ranges.back().size == offset)
+          {
+            ranges.back().size += size;
+            return;
+          }
+          ranges.push_back({offset, size});
+        }
+
+        /*
+         * Copy size bytes at offset into destination from either the stream
+         * or the memory image
+         */
+        bool read_bytes(std::uint64_t offset, std::uint64_t size, void *destination) const
+        {
+          this->record_range(offset, size);
+          this->count_read(size);
+          if (this->memory_backed)
+          {
+            if (offset > this->image.size() || size > this->image.size() - offset)
+            {
+              return false;
+            }
+            if (size != 0)
+            {
+              std::memcpy(destination, this->image.data() + offset, size);
+            }
+            return true;
+          }
+
+          this->binary_file.clear();
+          this->binary_file.seekg(static_cast<std::streamoff>(offset));
+          this->binary_file.read(reinterpret_cast<char *>(destination), static_cast<std::streamsize>(size));
+          return this->binary_file.gcount() == static_cast<std::streamsize>(size);
+        }
+
+        /*
+         * Load count entries at offset into a table. Memory-backed files view
+         * the entries in place when they are suitably aligned, so T must have
+         * the same layout as the on-disk structure
+         */
+        template<typename T>
+        bool read_table(::elf::detail::table<T> &table, std::uint64_t offset, std::uint64_t count) const
+        {
+          if (count > std::numeric_limits<std::uint64_t>::max() / sizeof(T))
+          {
+            return false;
+          }
+          const std::uint64_t size = count * sizeof(T);
+          if (this->memory_backed)
+          {
+            if (offset > this->image.size() || size > this->image.size() - offset)
+            {
+              return false;
+            }
+            const std::byte *entries = this->image.data() + offset;
+            if (reinterpret_cast<std::uintptr_t>(entries) % alignof(T) == 0)
+            {
+              this->record_range(offset, size);
+              this->count_view(size);
+              table.assign_view(reinterpret_cast<const T *>(entries), count);
+              return true;
+            }
+          }
+          return this->read_bytes(offset, size, table.assign(count));
+        }
+
+        /*
+         * Load count on-disk Raw entries at offset into table. They are
+         * viewed or copied as they are when the file is in our byte order and
+         * Entry shares the layout of Raw, otherwise each one is decoded
+         */
+        template<typename Layout, typename Raw, typename Entry, typename Decode>
+        bool read_table_as(Layout, ::elf::detail::table<Entry> &table, std::uint64_t offset, std::uint64_t count, Decode &&decode) const
+        {
+          if constexpr (Layout::is_native && ::elf::detail::shares_layout<Raw, Entry>)
+          {
+            return this->read_table(table, offset, count);
+          } else
+          {
+            ::elf::detail::table<Raw> real_entries(this->resource);
+            if (!this->read_table(real_entries, offset, count))
+            {
+              return false;
+            }
+            Entry *entries = table.assign(real_entries.size());
+            this->for_each_chunk(real_entries.size(), [&](std::size_t begin, std::size_t end) {
+                for (std::size_t i = begin; i < end; i++)
+                {
+                  decode(real_entries[i], entries[i]);
+                }
+            });
+            return true;
+          }
+        }
+
+        /*
+         * Read a whole on-disk table of Raw entries in one go, viewing it in
+         * place where possible, then decode each one into entries
+         */
+        template<typename Raw, typename Entry, typename Decode>
+        bool read_entries(std::uint64_t offset, std::uint64_t count, ::elf::vector<Entry> &entries, Decode &&decode) const
+        {
+          ::elf::detail::table<Raw> real_entries(this->resource);
+          if (!this->read_table(real_entries, offset, count))
+          {
+            return false;
+          }
+          entries.resize(real_entries.size());
+          this->for_each_chunk(real_entries.size(), [&](std::size_t begin, std::size_t end) {
+              for (std::size_t i = begin; i < end; i++)
+              {
+                decode(real_entries[i], entries[i]);
+              }
+          });
+          return true;
+        }
+
+        /*
+         * Call chunk(begin, end) over ranges covering [0, count), split
+         * across the executor when there is one and count is large enough.
+         * Chunks run at the same time, so they may only write their own
+         * entries of tables sized beforehand, never allocate or set
+         * last_error
+         */
+        template<typename Chunk>
+        void for_each_chunk(std::size_t count, Chunk &&chunk) const
+        {
+          if (this->parallel_executor == nullptr || count < 2 * parallel_chunk_size)
+          {
+            chunk(0, count);
+            return;
+          }
+          this->parallel_executor->for_each((count + parallel_chunk_size - 1) / parallel_chunk_size, [&](std::size_t i, std::size_t) {
+              chunk(i * parallel_chunk_size, std::min(count, (i + 1) * parallel_chunk_size));
+          });
+        }
+
+        /*
+         * Call visitor with the elf_layout of this file, so readers are
+         * compiled once for each class and byte order rather than branching
+         * on them for every entry
+         */
+        template<typename Visitor>
+        bool visit_layout(Visitor &&visitor) const
+        {
+          const bool big_endian = this->is_big_endian();
+          if (this->is_64_bit())
+          {
+            return big_endian ? visitor(::elf::elf_layout<::elf::elf_ident::ELFCLASS64, std::endian::big>{})
+                              : visitor(::elf::elf_layout<::elf::elf_ident::ELFCLASS64, std::endian::little>{});
+          }
+          if (this->is_32_bit())
+          {
+            return big_endian ? visitor(::elf::elf_layout<::elf::elf_ident::ELFCLASS32, std::endian::big>{})
+                              : visitor(::elf::elf_layout<::elf::elf_ident::ELFCLASS32, std::endian::little>{});
+          }
+          this->last_error = this->is_open() ? "Invalid ELF class" : "Binary file is not open";
+          return false;
+        }
+
+        bool read_elf_header()
+        {
+          if (!this->is_open())
+          {
+            this->last_error = "Binary file is not open";
+            return false;
+          }
+          if (!this->read_bytes(0, sizeof(this->header.e_ident), &this->header.e_ident))
+          {
+            this->last_error = "Failed to read ELF identification";
+            return false;
+          }
+          if (!this->is_little_endian() && !this->is_big_endian())
+          {
+            this->last_error = "Invalid ELF data encoding";
+            return false;
+          }
+
+          return this->visit_layout([this](auto layout) {
+              using Layout = decltype(layout);
+              typename Layout::Ehdr real_header;
+              if (!this->read_bytes(0, sizeof(real_header), &real_header))
+              {
+                this->last_error = "Failed to read ELF header";
+                return false;
+              }
+              this->header.e_type = Layout::get(real_header.e_type);
+              this->header.e_machine = Layout::get(real_header.e_machine);
+              this->header.e_version = Layout::get(real_header.e_version);
+              this->header.e_entry = Layout::get(real_header.e_entry);
+              this->header.e_phoff = Layout::get(real_header.e_phoff);
+              this->header.e_shoff = Layout::get(real_header.e_shoff);
+              this->header.e_flags = Layout::get(real_header.e_flags);
+              this->header.e_ehsize = Layout::get(real_header.e_ehsize);
+              this->header.e_phentsize = Layout::get(real_header.e_phentsize);
+              this->header.e_phnum = Layout::get(real_header.e_phnum);
+              this->header.e_shentsize = Layout::get(real_header.e_shentsize);
+              this->header.e_shnum = Layout::get(real_header.e_shnum);
+              this->header.e_shstrndx = Layout::get(real_header.e_shstrndx);
+              return true;
+          });
+        }
+
+        template<typename Layout>
+        bool read_program_headers(Layout layout)
+        {
+          if (!this->is_open())
+          {
+            this->last_error = "Binary file is not open";
+            return false;
+          }
+          if (this->header.e_phentsize != sizeof(typename Layout::Phdr))
+          {
+            this->last_error = "Invalid program header size";
+            return false;
+          }
+
+          const auto decode = [](const typename Layout::Phdr &real_program_header, ::elf::elf_program_header &program_header) {
+              program_header.p_type = Layout::get(real_program_header.p_type);
+              program_header.p_flags = Layout::get(real_program_header.p_flags);
+              program_header.p_offset = Layout::get(real_program_header.p_offset);
+              program_header.p_vaddr = Layout::get(real_program_header.p_vaddr);
+              program_header.p_paddr = Layout::get(real_program_header.p_paddr);
+              program_header.p_filesz = Layout::get(real_program_header.p_filesz);
+              program_header.p_memsz = Layout::get(real_program_header.p_memsz);
+              program_header.p_align = Layout::get(real_program_header.p_align);
+          };
+          if (!this->read_table_as<Layout, typename Layout::Phdr>(layout, this->program_headers, this->header.e_phoff, this->header.e_phnum, decode))
+          {
+            this->last_error = "Failed to read program headers";
+            return false;
+          }
+
+          this->base_address = 0xFFFFFFFFFFFFFFFF;
+          for (const auto &program_header: this->program_headers)
+          {
+            if (program_header.p_type == ::elf::elf_program_header::PT_LOAD)
+            {
+              this->base_address = std::min(this->base_address, program_header.p_vaddr);
+            }
+          }
+
+          return true;
+        }
+
+        /*
+         * Find the NT_GNU_BUILD_ID note in the PT_NOTE segments. A file
+         * without one, or with malformed notes, just has no build ID
+         */
+        template<typename Layout>
+        bool read_build_id(Layout) const
+        {
+          this->build_id.clear();
+          for (const auto &program_header: this->program_headers)
+          {
+            if (program_header.p_type != ::elf::elf_program_header::PT_NOTE || program_header.p_filesz > max_note_segment_size)
+            {
+              continue;
+            }
+            ::elf::detail::table<std::byte> notes(this->resource);
+            if (!this->read_table(notes, program_header.p_offset, program_header.p_filesz))
+            {
+              continue;
+            }
+            const std::uint64_t alignment = program_header.p_align == 8 ? 8 : 4;
+            const auto align = [alignment](std::uint64_t value) {
+                return (value + alignment - 1) & ~(alignment - 1);
+            };
+            std::uint64_t position = 0;
+            while (position + sizeof(typename Layout::Nhdr) <= notes.size())
+            {
+              typename Layout::Nhdr note;
+              std::memcpy(&note, notes.data() + position, sizeof(note));
+              const std::uint64_t name_size = Layout::get(note.n_namesz);
+              const std::uint64_t descriptor_size = Layout::get(note.n_descsz);
+              const std::uint64_t name = position + sizeof(note);
+              const std::uint64_t descriptor = align(name + name_size);
+              if (descriptor > notes.size() || descriptor_size > notes.size() - descriptor)
+              {
+                break;
+              }
+              if (Layout::get(note.n_type) == ::elf::elf_note::NT_GNU_BUILD_ID && name_size == 4 && std::memcmp(notes.data() + name, "GNU", 4) == 0)
+              {
+                this->build_id.assign(notes.data() + descriptor, notes.data() + descriptor + descriptor_size);
+                return true;
+              }
+              position = align(descriptor + descriptor_size);
+            }
+          }
+          return true;
+        }
+
+        template<typename Layout>
+        bool read_section_headers(Layout) const
+        {
+          if (!this->is_open())
+          {
+            this->last_error = "Binary file is not open";
+            return false;
+          }
+          if (this->header.e_shentsize != sizeof(typename Layout::Shdr))
+          {
+            this->last_error = "Invalid section header size";
+            return false;
+          }
+
+          const auto decode = [](const typename Layout::Shdr &real_section_header, ::elf::elf_section_header &section_header) {
+              section_header.sh_name = Layout::get(real_section_header.sh_name);
+              section_header.sh_type = Layout::get(real_section_header.sh_type);
+              section_header.sh_flags = Layout::get(real_section_header.sh_flags);
+              section_header.sh_addr = Layout::get(real_section_header.sh_addr);
+              section_header.sh_offset = Layout::get(real_section_header.sh_offset);
+              section_header.sh_size = Layout::get(real_section_header.sh_size);
+              section_header.sh_link = Layout::get(real_section_header.sh_link);
+              section_header.sh_info = Layout::get(real_section_header.sh_info);
+              section_header.sh_addralign = Layout::get(real_section_header.sh_addralign);
+              section_header.sh_entsize = Layout::get(real_section_header.sh_entsize);
+          };
+
+          /*
+           * With 0xff00 or more sections e_shnum is 0 and the real count is
+           * the size of the first section header
+           */
+          std::uint64_t section_count = this->header.e_shnum;
+          if (section_count == 0 && this->header.e_shoff != 0)
+          {
+            if (!this->read_entries<typename Layout::Shdr>(this->header.e_shoff, 1, this->section_headers, decode))
+            {
+              this->last_error = "Failed to read section headers";
+              return false;
+            }
+            section_count = this->section_headers[0].sh_size;
+          }
+          if (!this->read_entries<typename Layout::Shdr>(this->header.e_shoff, section_count, this->section_headers, decode))
+          {
+            this->last_error = "Failed to read section headers";
+            return false;
+          }
+          if (this->section_headers.empty())
+          {
+            return true;
+          }
+          if (this->section_headers.size() > std::numeric_limits<std::uint32_t>::max() / 2)
+          {
+            this->last_error = "Too many section headers";
+            return false;
+          }
+
+          std::uint32_t section_header_string_table_idx = this->header.e_shstrndx;
+          if (section_header_string_table_idx == ::elf::elf_section_header::SHN_XINDEX)
+          {
+            section_header_string_table_idx = this->section_headers[0].sh_link;
+          }
+          if (section_header_string_table_idx >= this->section_headers.size())
+          {
+            this->last_error = "Invalid section header string table index";
+            return false;
+          }
+          const auto &section_header_string_table_header = this->section_headers[section_header_string_table_idx];
+          if (!this->read_table(this->section_header_string_table, section_header_string_table_header.sh_offset, section_header_string_table_header.sh_size))
+          {
+            this->last_error = "Failed to read section header string table";
+            return false;
+          }
+
+          const auto strings = this->section_header_string_table.span();
+          for (auto &section_header: this->section_headers)
+          {
+            const std::string_view name = ::elf::detail::string_at(strings, section_header.sh_name);
+            section_header.sh_name_str = name.data();
+            section_header.sh_name_length = static_cast<std::uint32_t>(name.size());
+          }
+          this->index_section_headers();
+
+          return true;
+        }
+
+        template<typename Layout>
+        bool read_dynamic_entries(Layout layout) const
+        {
+          if (!this->is_open())
+          {
+            this->last_error = "Binary file is not open";
+            return false;
+          }
+
+          /*
+           * Read the dynamic segment entries
+           */
+          const auto dynamic_header = std::find_if(this->program_headers.begin(), this->program_headers.end(),
+                                                   [](const elf::elf_program_header &program_header) {
+                                                       return program_header.p_type == ::elf::elf_program_header::PT_DYNAMIC;
+                                                   });
+          if (dynamic_header == this->program_headers.end())
+          {
+            return false;
+          }
+          if (dynamic_header->p_filesz % sizeof(typename Layout::Dyn) != 0)
+          {
+            this->last_error = "Invalid dynamic segment size";
+            return false;
+          }
+          const auto decode = [](const typename Layout::Dyn &real_dynamic_entry, ::elf::elf_dynamic &dynamic_entry) {
+              dynamic_entry.d_tag = Layout::get(real_dynamic_entry.d_tag);
+              dynamic_entry.d_un.d_val = Layout::get(real_dynamic_entry.d_un.d_val);
+          };
+          if (!this->read_table_as<Layout, typename Layout::Dyn>(layout, this->dynamic_entries, dynamic_header->p_offset,
+                                                                 dynamic_header->p_filesz / sizeof(typename Layout::Dyn), decode))
+          {
+            this->last_error = "Failed to read dynamic segment";
+            return false;
+          }
+
+
+          /*
+           * Extract the info we need. Apply the dynamic string table offset later
+           */
+          std::uintptr_t dynamic_string_table_offset = 0;
+          std::uint64_t dynamic_string_table_length = 0;
+          this->symbol_table_offset = 0;
+          this->symbol_table_entry_size = 0;
+          relocation_table relocations{}, relocations_with_addend{}, plt_relocations{}, relative_relocations{};
+          std::int64_t plt_relocation_type = 0;
+          for (const auto &dynamic_entry: this->dynamic_entries)
+          {
+            switch (dynamic_entry.d_tag)
+            {
+              case ::elf::elf_dynamic::DT_REL:
+              {
+                relocations.offset = dynamic_entry.d_un.d_ptr - this->base_address;
+                break;
+              }
+              case ::elf::elf_dynamic::DT_RELSZ:
+              {
+                relocations.size = dynamic_entry.d_un.d_val;
+                break;
+              }
+              case ::elf::elf_dynamic::DT_RELENT:
+              {
+                relocations.entry_size = dynamic_entry.d_un.d_val;
+                break;
+              }
+              case ::elf::elf_dynamic::DT_RELA:
+              {
+                relocations_with_addend.offset = dynamic_entry.d_un.d_ptr - this->base_address;
+                break;
+              }
+              case ::elf::elf_dynamic::DT_RELASZ:
+              {
+                relocations_with_addend.size = dynamic_entry.d_un.d_val;
+                break;
+              }
+              case ::elf::elf_dynamic::DT_RELAENT:
+              {
+                relocations_with_addend.entry_size = dynamic_entry.d_un.d_val;
+                break;
+              }
+              case ::elf::elf_dynamic::DT_JMPREL:
+              {
+                plt_relocations.offset = dynamic_entry.d_un.d_ptr - this->base_address;
+                break;
+              }
+              case ::elf::elf_dynamic::DT_PLTRELSZ:
+              {
+                plt_relocations.size = dynamic_entry.d_un.d_val;
+                break;
+              }
+              case ::elf::elf_dynamic::DT_PLTREL:
+              {
+                plt_relocation_type = static_cast<std::int64_t>(dynamic_entry.d_un.d_val);
+                break;
+              }
+              case ::elf::elf_dynamic::DT_RELR:
+              {
+                relative_relocations.offset = dynamic_entry.d_un.d_ptr - this->base_address;
+                break;
+              }
+              case ::elf::elf_dynamic::DT_RELRSZ:
+              {
+                relative_relocations.size = dynamic_entry.d_un.d_val;
+                break;
+              }
+              case ::elf::elf_dynamic::DT_RELRENT:
+              {
+                relative_relocations.entry_size = dynamic_entry.d_un.d_val;
+                break;
+              }
+              case ::elf::elf_dynamic::DT_STRTAB:
+              {
+                dynamic_string_table_offset = dynamic_entry.d_un.d_ptr - this->base_address;
+                break;
+              }
+              case ::elf::elf_dynamic::DT_STRSZ:
+              {
+                dynamic_string_table_length = dynamic_entry.d_un.d_val;
+                break;
+              }
+              case ::elf::elf_dynamic::DT_SYMTAB:
+              {
+                this->symbol_table_offset = dynamic_entry.d_un.d_ptr - this->base_address;
+                break;
+              }
+              case ::elf::elf_dynamic::DT_SYMENT:
+              {
+                this->symbol_table_entry_size = dynamic_entry.d_un.d_val;
+                break;
+              }
+              case ::elf::elf_dynamic::DT_SONAME:
+              {
+                this->so_name = reinterpret_cast<const char *>(static_cast<std::uintptr_t>(dynamic_entry.d_un.d_val));
+                break;
+              }
+              case ::elf::elf_dynamic::DT_NEEDED:
+              {
+                this->needed_libraries.emplace_back(reinterpret_cast<const char *>(static_cast<std::uintptr_t>(dynamic_entry.d_un.d_val)));
+                break;
+              }
+            }
+          }
+          if (dynamic_string_table_offset == 0 || dynamic_string_table_length == 0)
+          {
+            this->last_error = "Failed to find dynamic string table";
+            return false;
+          }
+          if (this->symbol_table_offset == 0 || this->symbol_table_entry_size == 0)
+          {
+            this->last_error = "Failed to find symbol table";
+            return false;
+          }
+
+          /*
+           * A file has either DT_REL or DT_RELA relocations. Some linkers
+           * count the PLT relocations at the end of them in DT_RELSZ or
+           * DT_RELASZ as well, so leave those out as the dynamic linker does
+           */
+          relocations_with_addend.addend = true;
+          relocation_table &dynamic_relocations = relocations_with_addend.size != 0 ? relocations_with_addend : relocations;
+          plt_relocations.addend = plt_relocation_type == ::elf::elf_dynamic::DT_RELA;
+          if (plt_relocations.size != 0 && plt_relocations.addend == dynamic_relocations.addend)
+          {
+            plt_relocations.entry_size = dynamic_relocations.entry_size;
+            if (plt_relocations.offset >= dynamic_relocations.offset && plt_relocations.offset + plt_relocations.size == dynamic_relocations.offset + dynamic_relocations.size)
+            {
+              dynamic_relocations.size -= plt_relocations.size;
+            }
+          }
+          this->relocation_tables[static_cast<std::size_t>(::elf::relocation_kind::dynamic)] = dynamic_relocations;
+          this->relocation_tables[static_cast<std::size_t>(::elf::relocation_kind::plt)] = plt_relocations;
+          this->relocation_tables[static_cast<std::size_t>(::elf::relocation_kind::relative)] = relative_relocations;
+
+          /*
+           * Read the dynamic string table
+           */
+          if (!this->read_table(this->dynamic_segment_string_table, dynamic_string_table_offset, dynamic_string_table_length))
+          {
+            this->last_error = "Failed to read dynamic string table";
+            return false;
+          }
+          const auto dynamic_string_table_base = reinterpret_cast<std::uintptr_t>(this->dynamic_segment_string_table.data());
+
+          /*
+           * Apply the dynamic string table offset to the strings we need
+           */
+          this->so_name = dynamic_string_table_base + this->so_name;
+          for (auto &needed: this->needed_libraries)
+          {
+            needed = dynamic_string_table_base + needed;
+          }
+
+          return true;
+        }
+
+        template<typename Layout>
+        bool read_dynamic_symbols(Layout layout) const
+        {
+          if (!this->load_dynamic_entries() || !this->load_section_headers())
+          {
+            return false;
+          }
+
+          /*
+           * Validate the symbol table header
+           */
+          const auto *symbol_table_header = this->first_section_of_type(::elf::elf_section_header::SHT_DYNSYM);
+          if (symbol_table_header == nullptr)
+          {
+            this->last_error = "Failed to find dynamic symbol table";
+            return false;
+          }
+          if (this->symbol_table_offset != symbol_table_header->sh_offset)
+          {
+            this->last_error = "Symbol table offsets don't match";
+            return false;
+          }
+
+          /*
+           * Read the symbol table
+           */
+          if (this->symbol_table_entry_size != sizeof(typename Layout::Sym))
+          {
+            this->last_error = "Invalid symbol table entry size";
+            return false;
+          }
+          if (!this->read_symbol_entries(layout, this->symbol_table_offset, symbol_table_header->sh_size / sizeof(typename Layout::Sym),
+                                         this->dynamic_segment_string_table.span(), this->dynamic_symbols))
+          {
+            this->last_error = "Failed to read dynamic symbols";
+            return false;
+          }
+
+          /*
+           * Parse whichever hash tables are present
+           */
+          const phase_scope scope(*this, ::elf::parse_phase::hash_tables);
+          return this->parse_hash_tables(layout);
+        }
+
+        template<typename Layout>
+        bool parse_hash_tables(Layout layout) const
+        {
+          if (!this->is_open())
+          {
+            this->last_error = "Binary file is not open";
+            return false;
+          }
+
+          const auto decode_word = [](std::uint32_t real_word, std::uint32_t &word) { word = Layout::get(real_word); };
+          for (const auto &section_header: this->section_headers)
+          {
+            switch (section_header.sh_type)
+            {
+              case ::elf::elf_section_header::SHT_HASH:
+              {
+                typedef struct hash_table_header
+                {
+                    std::uint32_t nbucket;
+                    std::uint32_t nchain;
+                } hash_table_header;
+
+                hash_table_header table_header;
+                if (!this->read_bytes(section_header.sh_offset, sizeof(table_header), &table_header))
+                {
+                  this->last_error = "Failed to read hash table header";
+                  return false;
+                }
+                table_header.nbucket = Layout::get(table_header.nbucket);
+                table_header.nchain = Layout::get(table_header.nchain);
+
+                if (table_header.nbucket == 0 || table_header.nchain == 0)
+                {
+                  this->last_error = "Invalid hash table header";
+                  return false;
+                }
+
+                const std::uint64_t buckets_offset = section_header.sh_offset + sizeof(table_header);
+                if (!this->read_table_as<Layout, std::uint32_t>(layout, this->hash_buckets, buckets_offset, table_header.nbucket, decode_word))
+                {
+                  this->last_error = "Failed to read hash table buckets";
+                  return false;
+                }
+                const std::uint64_t chains_offset = buckets_offset + sizeof(std::uint32_t) * table_header.nbucket;
+                if (!this->read_table_as<Layout, std::uint32_t>(layout, this->hash_chains, chains_offset, table_header.nchain, decode_word))
+                {
+                  this->last_error = "Failed to read hash table chains";
+                  return false;
+                }
+
+                break;
+              }
+              case ::elf::elf_section_header::SHT_GNU_HASH:
+              {
+                typedef struct gnu_hash_table_header
+                {
+                    std::uint32_t nbuckets;
+                    std::uint32_t omitted_symbols_count;
+                    std::uint32_t bloom_size;
+                    std::uint32_t bloom_shift;
+                } gnu_hash_table_header;
+
+                gnu_hash_table_header table_header;
+                if (!this->read_bytes(section_header.sh_offset, sizeof(table_header), &table_header))
+                {
+                  this->last_error = "Failed to read gnu hash table header";
+                  return false;
+                }
+                table_header.nbuckets = Layout::get(table_header.nbuckets);
+                table_header.omitted_symbols_count = Layout::get(table_header.omitted_symbols_count);
+                table_header.bloom_size = Layout::get(table_header.bloom_size);
+                table_header.bloom_shift = Layout::get(table_header.bloom_shift);
+                this->gnu_hash_bloom_shift = table_header.bloom_shift;
+                this->gnu_hash_omitted_symbols_count = table_header.omitted_symbols_count;
+
+                /*
+                 * Bloom words are the size of an address, 32-bit ones are widened
+                 */
+                const std::uint64_t bloom_words_offset = section_header.sh_offset + sizeof(table_header);
+                const auto decode_bloom_word = [](typename Layout::Addr real_word, std::uint64_t &word) { word = Layout::get(real_word); };
+                if (!this->read_table_as<Layout, typename Layout::Addr>(layout, this->gnu_hash_bloom_words, bloom_words_offset, table_header.bloom_size,
+                                                                        decode_bloom_word))
+                {
+                  this->last_error = "Failed to read gnu hash table bloom words";
+                  return false;
+                }
+
+                const std::uint64_t buckets_offset = bloom_words_offset + sizeof(typename Layout::Addr) * table_header.bloom_size;
+                if (!this->read_table_as<Layout, std::uint32_t>(layout, this->gnu_hash_buckets, buckets_offset, table_header.nbuckets, decode_word))
+                {
+                  this->last_error = "Failed to read gnu hash table buckets";
+                  return false;
+                }
+
+                const std::uint64_t hash_values_offset = buckets_offset + sizeof(std::uint32_t) * table_header.nbuckets;
+                std::size_t hash_values_count = this->dynamic_symbols.size() - this->gnu_hash_omitted_symbols_count;
+                if (!this->read_table_as<Layout, std::uint32_t>(layout, this->gnu_hash_values, hash_values_offset, hash_values_count, decode_word))
+                {
+                  this->last_error = "Failed to read gnu hash table values";
+                  return false;
+                }
+
+                break;
+              }
+            }
+          }
+
+          return true;
+        }
+
+        /*
+         * Decode one possibly unaligned on-disk relocation for relocation_range
+         */
+        template<typename Layout, bool Addend>
+        static void decode_relocation(const std::byte *entry, ::elf::elf_rela &relocation)
+        {
+          using Real = std::conditional_t<Addend, typename Layout::Rela, typename Layout::Rel>;
+          Real real_relocation;
+          std::memcpy(&real_relocation, entry, sizeof(Real));
+          const auto info = Layout::get(real_relocation.r_info);
+          relocation.r_offset = Layout::get(real_relocation.r_offset);
+          relocation.r_type = Layout::r_type(info);
+          relocation.r_sym = Layout::r_sym(info);
+          if constexpr (Addend)
+          {
+            relocation.r_addend = Layout::get(real_relocation.r_addend);
+          } else
+          {
+            relocation.r_addend = 0;
+          }
+        }
+
+        /*
+         * Decode one possibly unaligned DT_RELR word for relocation_range
+         */
+        template<typename Layout>
+        static std::uint64_t decode_relocation_word(const std::byte *entry)
+        {
+          typename Layout::Addr word;
+          std::memcpy(&word, entry, sizeof(word));
+          return Layout::get(word);
+        }
+
+        template<typename Layout>
+        bool parse_relocations(Layout layout) const
+        {
+          if (!this->is_open())
+          {
+            this->last_error = "Binary file is not open";
+            return false;
+          }
+
+          const auto decode_rel = [](const typename Layout::Rel &real_relocation, ::elf::elf_rel &relocation) {
+              const auto info = Layout::get(real_relocation.r_info);
+              relocation.r_offset = Layout::get(real_relocation.r_offset);
+              relocation.r_type = Layout::r_type(info);
+              relocation.r_sym = Layout::r_sym(info);
+          };
+          const auto decode_rela = [](const typename Layout::Rela &real_relocation, ::elf::elf_rela &relocation) {
+              const auto info = Layout::get(real_relocation.r_info);
+              relocation.r_offset = Layout::get(real_relocation.r_offset);
+              relocation.r_type = Layout::r_type(info);
+              relocation.r_sym = Layout::r_sym(info);
+              relocation.r_addend = Layout::get(real_relocation.r_addend);
+          };
+
+          /*
+           * Files with a dynamic segment name their tables in it. Others,
+           * such as static executables, only have sections to go by
+           */
+          const bool has_dynamic_segment = std::any_of(this->program_headers.begin(), this->program_headers.end(), [](const auto &program_header) {
+              return program_header.p_type == ::elf::elf_program_header::PT_DYNAMIC;
+          });
+          if (has_dynamic_segment)
+          {
+            if (!this->load_dynamic_entries())
+            {
+              return false;
+            }
+            const auto read_relocations = [&](::elf::relocation_kind kind, auto &entries, auto &entries_with_addend) {
+                const relocation_table &table = this->relocation_tables[static_cast<std::size_t>(kind)];
+                if (table.size == 0)
+                {
+                  return true;
+                }
+                const std::uint64_t entry_size = table.addend ? sizeof(typename Layout::Rela) : sizeof(typename Layout::Rel);
+                if ((table.entry_size != 0 && table.entry_size != entry_size) || table.size % entry_size != 0)
+                {
+                  this->last_error = "Invalid relocation entry size";
+                  return false;
+                }
+                const bool read = table.addend ? this->read_table_as<Layout, typename Layout::Rela>(layout, entries_with_addend, table.offset, table.size / entry_size, decode_rela)
+                                               : this->read_table_as<Layout, typename Layout::Rel>(layout, entries, table.offset, table.size / entry_size, decode_rel);
+                if (!read)
+                {
+                  this->last_error = "Failed to read relocation entries";
+                  return false;
+                }
+                return true;
+            };
+            return read_relocations(::elf::relocation_kind::dynamic, this->dyn_rel_entries, this->dyn_rela_entries) &&
+                   read_relocations(::elf::relocation_kind::plt, this->plt_rel_entries, this->plt_rela_entries);
+          }
+          if (!this->load_section_headers())
+          {
+            return false;
+          }
+
+          /*
+           * Validate the entry size and pick the table from the section name
+           * before reading
+           */
+          const auto read_relocations = [&](const ::elf::elf_section_header &section_header, auto &plt_entries, auto &dyn_entries,
+                                            const char *plt_name, const char *dyn_name, auto real_entry, auto &&decode) {
+              using Real = decltype(real_entry);
+              if (section_header.sh_entsize != sizeof(Real))
+              {
+                this->last_error = "Invalid relocation entry size";
+                return false;
+              }
+              auto *entries = section_header.get_name() == plt_name ? &plt_entries
+                            : section_header.get_name() == dyn_name ? &dyn_entries
+                            : nullptr;
+              if (entries == nullptr)
+              {
+                this->last_error = "Invalid relocation section name";
+                return false;
+              }
+              if (!this->read_table_as<Layout, Real>(layout, *entries, section_header.sh_offset, section_header.sh_size / sizeof(Real), decode))
+              {
+                this->last_error = "Failed to read relocation entries";
+                return false;
+              }
+              return true;
+          };
+
+          for (const std::uint32_t idx: this->section_indices_of_type(::elf::elf_section_header::SHT_REL))
+          {
+            if (!read_relocations(this->section_headers[idx], this->plt_rel_entries, this->dyn_rel_entries, ".rel.plt", ".rel.dyn",
+                                  typename Layout::Rel{}, decode_rel))
+            {
+              return false;
+            }
+          }
+          for (const std::uint32_t idx: this->section_indices_of_type(::elf::elf_section_header::SHT_RELA))
+          {
+            if (!read_relocations(this->section_headers[idx], this->plt_rela_entries, this->dyn_rela_entries, ".rela.plt", ".rela.dyn",
+                                  typename Layout::Rela{}, decode_rela))
+            {
+              return false;
+            }
+          }
+
+          return true;
+        }
+
+        /*
+         * Append the addresses in an array section such as .init_array to
+         * functions, widening 32-bit ones
+         */
+        template<typename Layout>
+        bool read_function_array(Layout, const ::elf::elf_section_header &section_header, ::elf::vector<std::uint64_t> &functions,
+                                 const char *size_error, const char *read_error) const
+        {
+          if (section_header.sh_size % sizeof(typename Layout::Addr) != 0)
+          {
+            this->last_error = size_error;
+            return false;
+          }
+          ::elf::vector<std::uint64_t> entries(this->resource);
+          const auto decode = [](typename Layout::Addr real_address, std::uint64_t &address) { address = Layout::get(real_address); };
+          if (!this->read_entries<typename Layout::Addr>(section_header.sh_offset, section_header.sh_size / sizeof(typename Layout::Addr), entries, decode))
+          {
+            this->last_error = read_error;
+            return false;
+          }
+          functions.insert(functions.end(), entries.begin(), entries.end());
+          return true;
+        }
+
+        /*
+         * Build the name and type indices once the section headers and
+         * their names are in place. The name table keeps the first section
+         * with each name and is at most half full
+         */
+        void index_section_headers() const
+        {
+          const auto count = static_cast<std::uint32_t>(this->section_headers.size());
+          std::size_t slot_count = 16;
+          while (slot_count < static_cast<std::size_t>(count) * 2)
+          {
+            slot_count *= 2;
+          }
+          this->section_name_slots.assign(slot_count, 0);
+          for (std::uint32_t i = 0; i < count; i++)
+          {
+            const std::string_view name = this->section_headers[i].get_name();
+            std::size_t slot = gnu_hash(name.data(), name.size()) & (slot_count - 1);
+            while (this->section_name_slots[slot] != 0 && this->section_headers[this->section_name_slots[slot] - 1].get_name() != name)
+            {
+              slot = (slot + 1) & (slot_count - 1);
+            }
+            if (this->section_name_slots[slot] == 0)
+            {
+              this->section_name_slots[slot] = i + 1;
+            }
+          }
+
+          this->section_type_order.resize(count);
+          std::iota(this->section_type_order.begin(), this->section_type_order.end(), 0u);
+          std::stable_sort(this->section_type_order.begin(), this->section_type_order.end(), [this](std::uint32_t a, std::uint32_t b) {
+              return this->section_headers[a].sh_type < this->section_headers[b].sh_type;
+          });
+          this->section_type_ranges.clear();
+          for (std::uint32_t i = 0; i < count; i++)
+          {
+            const std::uint32_t type = this->section_headers[this->section_type_order[i]].sh_type;
+            if (this->section_type_ranges.empty() || this->section_type_ranges.back().sh_type != type)
+            {
+              this->section_type_ranges.push_back({type, i, 0});
+            }
+            this->section_type_ranges.back().count++;
+          }
+        }
+
+        const ::elf::elf_section_header *find_section_header(std::string_view name) const
+        {
+          if (this->section_name_slots.empty())
+          {
+            return nullptr;
+          }
+          const std::size_t mask = this->section_name_slots.size() - 1;
+          for (std::size_t slot = gnu_hash(name.data(), name.size()) & mask; this->section_name_slots[slot] != 0; slot = (slot + 1) & mask)
+          {
+            const auto &section_header = this->section_headers[this->section_name_slots[slot] - 1];
+            if (section_header.get_name() == name)
+            {
+              return &section_header;
+            }
+          }
+          return nullptr;
+        }
+
+        std::span<const std::uint32_t> section_indices_of_type(std::uint32_t type) const
+        {
+          const auto range = std::lower_bound(this->section_type_ranges.begin(), this->section_type_ranges.end(), type,
+                                              [](const section_type_range &entry, std::uint32_t value) { return entry.sh_type < value; });
+          if (range == this->section_type_ranges.end() || range->sh_type != type)
+          {
+            return {};
+          }
+          return std::span<const std::uint32_t>(this->section_type_order).subspan(range->begin, range->count);
+        }
+
+        /*
+         * The first section of a type, or nullptr
+         */
+        const ::elf::elf_section_header *first_section_of_type(std::uint32_t type) const
+        {
+          const auto indices = this->section_indices_of_type(type);
+          return indices.empty() ? nullptr : &this->section_headers[indices.front()];
+        }
+
+        template<typename Layout>
+        bool read_init_functions(Layout layout) const
+        {
+          if (!this->is_open())
+          {
+            this->last_error = "Binary file is not open";
+            return false;
+          }
+
+          const auto *preinit_array_section_header = this->find_section_header(".preinit_array");
+          if (preinit_array_section_header != nullptr &&
+              !this->read_function_array(layout, *preinit_array_section_header, this->init_functions, "Invalid preinit array size", "Failed to read preinit array"))
+          {
+            return false;
+          }
+
+          const auto *init_section_header = this->find_section_header(".init");
+          if (init_section_header != nullptr)
+          {
+            this->init_functions.emplace_back(init_section_header->sh_addr);
+          }
+
+          const auto *init_array_section_header = this->find_section_header(".init_array");
+          if (init_array_section_header != nullptr &&
+              !this->read_function_array(layout, *init_array_section_header, this->init_functions, "Invalid init array size", "Failed to read init array"))
+          {
+            return false;
+          }
+
+          return true;
+        }
+
+        template<typename Layout>
+        bool read_term_functions(Layout layout) const
+        {
+          const auto *fini_array_section_header = this->find_section_header(".fini_array");
+          if (fini_array_section_header != nullptr)
+          {
+            if (!this->read_function_array(layout, *fini_array_section_header, this->fini_functions, "Invalid fini array size", "Failed to read fini array"))
+            {
+              return false;
+            }
+            std::reverse(this->fini_functions.begin(), this->fini_functions.end());
+          }
+
+          const auto *fini_section_header = this->find_section_header(".fini");
+          if (fini_section_header != nullptr)
+          {
+            this->fini_functions.emplace_back(fini_section_header->sh_addr);
+          }
+
+          return true;
+        }
+
+        /*
+         * Decode count Elf*_Sym entries at offset into symbols, naming them
+         * from strings. Names outside the string table are left empty
+         */
+        template<typename Layout>
+        bool read_symbol_entries(Layout, std::uint64_t offset, std::uint64_t count, std::span<const char> strings, ::elf::vector<::elf::elf_symbol> &symbols) const
+        {
+          const auto decode = [strings, hash = this->hash_names](const typename Layout::Sym &real_symbol, ::elf::elf_symbol &symbol) {
+              symbol.st_name = Layout::get(real_symbol.st_name);
+              symbol.st_info = real_symbol.st_info;
+              symbol.st_other = real_symbol.st_other;
+              symbol.st_shndx = Layout::get(real_symbol.st_shndx);
+              symbol.st_value = Layout::get(real_symbol.st_value);
+              symbol.st_size = Layout::get(real_symbol.st_size);
+              const std::string_view name = ::elf::detail::string_at(strings, symbol.st_name);
+              symbol.st_name_str = name.data();
+              symbol.st_name_length = static_cast<std::uint32_t>(name.size());
+              symbol.st_name_hash = hash ? static_cast<std::uint32_t>(gnu_hash(name.data(), name.size())) : 0;
+          };
+          return this->read_entries<typename Layout::Sym>(offset, count, symbols, decode);
+        }
+
+        /*
+         * Read SHT_SYMTAB and the string table it links to. Having none is
+         * not an error
+         */
+        template<typename Layout>
+        bool read_symbol_table(Layout layout) const
+        {
+          const auto *symbol_table_header = this->first_section_of_type(::elf::elf_section_header::SHT_SYMTAB);
+          if (symbol_table_header == nullptr)
+          {
+            return true;
+          }
+
+          if (symbol_table_header->sh_entsize != sizeof(typename Layout::Sym))
+          {
+            this->last_error = "Invalid symbol table entry size";
+            return false;
+          }
+          if (symbol_table_header->sh_link >= this->section_headers.size() ||
+              this->section_headers[symbol_table_header->sh_link].sh_type != ::elf::elf_section_header::SHT_STRTAB)
+          {
+            this->last_error = "Invalid symbol string table index";
+            return false;
+          }
+
+          const auto &string_table_header = this->section_headers[symbol_table_header->sh_link];
+          if (!this->read_table(this->symbol_string_table, string_table_header.sh_offset, string_table_header.sh_size))
+          {
+            this->last_error = "Failed to read symbol string table";
+            return false;
+          }
+          if (!this->read_symbol_entries(layout, symbol_table_header->sh_offset, symbol_table_header->sh_size / sizeof(typename Layout::Sym),
+                                         this->symbol_string_table.span(), this->symbol_table))
+          {
+            this->last_error = "Failed to read symbol table";
+            return false;
+          }
+          return true;
+        }
+
+        /*
+         * Sort every symbol with an address into address_index
+         */
+        bool build_address_index() const
+        {
+          const bool has_dynamic_segment = std::any_of(this->program_headers.begin(), this->program_headers.end(),
+                                                       [](const ::elf::elf_program_header &program_header) {
+                                                           return program_header.p_type == ::elf::elf_program_header::PT_DYNAMIC;
+                                                       });
+          if (has_dynamic_segment && !this->load_dynamic_symbols())
+          {
+            return false;
+          }
+
+          typedef struct candidate
+          {
+              std::uint64_t start;
+              std::uint64_t size;
+              std::uint64_t section_end;
+              std::uint32_t symbol;
+              int rank;
+          } candidate;
+
+          ::elf::vector<candidate> candidates(this->resource);
+          const auto add_candidates = [&](const ::elf::vector<::elf::elf_symbol> &symbols, std::uint32_t flag) {
+              for (std::size_t i = 0; i < symbols.size() && i < address_ranges::dynamic_symbol; i++)
+              {
+                const auto &symbol = symbols[i];
+                const ::elf::byte type = symbol.get_type();
+                if (symbol.st_shndx == ::elf::elf_section_header::SHN_UNDEF || symbol.st_shndx >= ::elf::elf_section_header::SHN_LORESERVE ||
+                    symbol.st_shndx >= this->section_headers.size() || symbol.st_name_str[0] == '\0' ||
+                    (type != ::elf::elf_symbol::STT_NOTYPE && type != ::elf::elf_symbol::STT_OBJECT &&
+                     type != ::elf::elf_symbol::STT_FUNC && type != ::elf::elf_symbol::STT_GNU_IFUNC))
+                {
+                  continue;
+                }
+                const auto &section = this->section_headers[symbol.st_shndx];
+                if ((section.sh_flags & ::elf::elf_section_header::SHF_ALLOC) == 0)
+                {
+                  continue;
+                }
+                const ::elf::byte binding = symbol.get_binding();
+                const int rank = (symbol.st_size != 0 ? 4 : 0) + (binding == ::elf::elf_symbol::STB_LOCAL ? 0 : binding == ::elf::elf_symbol::STB_WEAK ? 1 : 2);
+                candidates.push_back({symbol.st_value, symbol.st_size, section.sh_addr + section.sh_size, static_cast<std::uint32_t>(i) | flag, rank});
+              }
+          };
+          add_candidates(this->symbol_table, 0);
+          add_candidates(this->dynamic_symbols, address_ranges::dynamic_symbol);
+
+          this->sort_in_chunks(candidates.begin(), candidates.end(), [](const candidate &a, const candidate &b) {
+              if (a.start != b.start)
+              {
+                return a.start < b.start;
+              }
+              return a.rank != b.rank ? a.rank > b.rank : a.symbol < b.symbol;
+          });
+
+          /*
+           * Keep the best symbol at each address. Zero-sized labels inside a
+           * sized symbol would hide it, so those are dropped
+           */
+          ::elf::vector<candidate> kept(this->resource);
+          kept.reserve(candidates.size());
+          std::uint64_t covered_end = 0;
+          for (const auto &entry: candidates)
+          {
+            if (!kept.empty() && kept.back().start == entry.start)
+            {
+              continue;
+            }
+            if (entry.size == 0 && entry.start < covered_end)
+            {
+              continue;
+            }
+            kept.push_back(entry);
+            covered_end = std::max(covered_end, entry.start + entry.size);
+          }
+
+          auto &index = this->address_index;
+          index.starts.resize(kept.size());
+          index.sizes.resize(kept.size());
+          index.symbols.resize(kept.size());
+          for (std::size_t i = 0; i < kept.size(); i++)
+          {
+            std::uint64_t size = kept[i].size;
+            if (size == 0)
+            {
+              const std::uint64_t end = i + 1 < kept.size() ? std::min(kept[i + 1].start, kept[i].section_end) : kept[i].section_end;
+              size = end > kept[i].start ? end - kept[i].start : 0;
+            }
+            index.starts[i] = kept[i].start;
+            index.sizes[i] = static_cast<std::uint32_t>(std::min<std::uint64_t>(size, std::numeric_limits<std::uint32_t>::max()));
+            index.symbols[i] = kept[i].symbol;
+          }
+          return true;
+        }
+
+        /*
+         * std::sort, except that with an executor runs of
+         * parallel_chunk_size are sorted and then merged in pairs on it.
+         * compare must be a total order for the result to match
+         */
+        template<typename Iterator, typename Compare>
+        void sort_in_chunks(Iterator first, Iterator last, Compare compare) const
+        {
+          const std::size_t count = static_cast<std::size_t>(last - first);
+          this->for_each_chunk(count, [&](std::size_t begin, std::size_t end) { std::sort(first + begin, first + end, compare); });
+          if (this->parallel_executor == nullptr)
+          {
+            return;
+          }
+          for (std::size_t width = parallel_chunk_size; width < count && count >= 2 * parallel_chunk_size; width *= 2)
+          {
+            this->parallel_executor->for_each((count + 2 * width - 1) / (2 * width), [&](std::size_t i, std::size_t) {
+                const std::size_t begin = i * 2 * width;
+                std::inplace_merge(first + begin, first + std::min(count, begin + width), first + std::min(count, begin + 2 * width), compare);
+            });
+          }
+        }
+
+        const ::elf::elf_symbol *address_index_lookup(std::size_t position, std::uint64_t address) const
+        {
+          const auto &index = this->address_index;
+          if (address - index.starts[position] >= index.sizes[position])
+          {
+            return nullptr;
+          }
+          const std::uint32_t symbol = index.symbols[position];
+          return (symbol & address_ranges::dynamic_symbol) != 0 ? &this->dynamic_symbols[symbol & ~address_ranges::dynamic_symbol]
+                                                                : &this->symbol_table[symbol];
+        }
+
+        ::elf::vector<::elf::elf_symbol>::const_iterator symbol_iterator(const ::elf::elf_symbol *symbol) const
+        {
+          if (symbol == nullptr)
+          {
+            return this->dynamic_symbols.cend();
+          }
+          return this->dynamic_symbols.cbegin() + (symbol - this->dynamic_symbols.data());
+        }
+
+        ::elf::vector<::elf::elf_symbol>::const_iterator lookup_elf_symbol(std::string_view name, bool *cyclic = nullptr) const
+        {
+          if (this->hash_buckets.empty())
+          {
+            return this->dynamic_symbols.cend();
+          }
+          lookup_tally tally(*this, elf_hash_lookups);
+          tally.lookup();
+          const std::uint32_t hash = elf_hash(name.data(), name.size());
+          const std::uint32_t name_hash = this->hash_names ? static_cast<std::uint32_t>(gnu_hash(name.data(), name.size())) : 0;
+          return this->symbol_iterator(this->walk_elf_chain(name, this->hash_buckets[hash % this->hash_buckets.size()], name_hash, tally, cyclic));
+        }
+
+        ::elf::vector<::elf::elf_symbol>::const_iterator lookup_gnu_symbol(std::string_view name) const
+        {
+          if (!this->has_gnu_hash_table())
+          {
+            return this->dynamic_symbols.cend();
+          }
+          lookup_tally tally(*this, gnu_hash_lookups);
+          tally.lookup();
+          const std::uint32_t hash = gnu_hash(name.data(), name.size());
+          if (!this->gnu_bloom_test(hash))
+          {
+            tally.filter_reject();
+            return this->dynamic_symbols.cend();
+          }
+          return this->symbol_iterator(this->walk_gnu_chain(name, hash, this->gnu_hash_buckets[hash % this->gnu_hash_buckets.size()], tally));
+        }
+
+        /*
+         * Hash every name get_symbol finds to the symbol it finds. Names are
+         * looked up through the hash tables once so duplicates and symbols
+         * missing from the tables resolve the same way they always have
+         */
+        bool build_symbol_perfect_hash() const
+        {
+          /*
+           * The lookups are independent, so they run in chunks and only
+           * collecting the symbols that found themselves is done in order
+           */
+          const std::size_t count = std::min<std::size_t>(this->dynamic_symbols.size(), std::uint64_t{std::numeric_limits<std::uint32_t>::max()} + 1);
+          ::elf::vector<std::uint64_t> name_hashes(count, this->resource);
+          ::elf::vector<std::uint8_t> found(count, this->resource);
+          std::atomic<bool> cyclic_chain = false;
+          this->for_each_chunk(count, [&](std::size_t begin, std::size_t end) {
+              for (std::size_t i = begin; i < end; i++)
+              {
+                const std::string_view name = this->dynamic_symbols[i].get_name();
+                if (name.empty())
+                {
+                  continue;
+                }
+                auto symbol = this->lookup_gnu_symbol(name);
+                if (symbol == this->dynamic_symbols.cend())
+                {
+                  bool cyclic = false;
+                  symbol = this->lookup_elf_symbol(name, &cyclic);
+                  if (cyclic)
+                  {
+                    cyclic_chain.store(true, std::memory_order_relaxed);
+                  }
+                }
+                if (symbol == this->dynamic_symbols.cbegin() + static_cast<std::ptrdiff_t>(i))
+                {
+                  name_hashes[i] = ::elf::detail::name_hash64(name);
+                  found[i] = 1;
+                }
+              }
+          });
+          if (cyclic_chain.load(std::memory_order_relaxed))
+          {
+            this->last_error = "Hash table chain is cyclic";
+            return false;
+          }
+          ::elf::vector<std::uint64_t> hashes(this->resource);
+          ::elf::vector<std::uint32_t> symbols(this->resource);
+          for (std::size_t i = 0; i < count; i++)
+          {
+            if (found[i])
+            {
+              hashes.push_back(name_hashes[i]);
+              symbols.push_back(static_cast<std::uint32_t>(i));
+            }
+          }
+
+          ::elf::vector<std::uint64_t> sorted(hashes, this->resource);
+          std::sort(sorted.begin(), sorted.end());
+          if (std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end() || !this->symbol_perfect_hash.build(hashes))
+          {
+            return false;
+          }
+          this->perfect_hash_slots.assign(hashes.size(), {});
+          for (std::size_t i = 0; i < hashes.size(); i++)
+          {
+            this->perfect_hash_slots[this->symbol_perfect_hash.position(hashes[i])] = {static_cast<std::uint32_t>(hashes[i]), symbols[i]};
+          }
+          return true;
+        }
+
+        const ::elf::elf_symbol *lookup_perfect_hash(std::string_view name) const
+        {
+          if (this->perfect_hash_slots.empty())
+          {
+            return nullptr;
+          }
+          lookup_tally tally(*this, perfect_hash_lookups);
+          tally.lookup();
+          const std::uint64_t hash = ::elf::detail::name_hash64(name);
+          const perfect_hash_slot &slot = this->perfect_hash_slots[this->symbol_perfect_hash.position(hash)];
+          if (slot.fingerprint != static_cast<std::uint32_t>(hash))
+          {
+            tally.filter_reject();
+            return nullptr;
+          }
+          tally.chain_entry();
+          const ::elf::elf_symbol &symbol = this->dynamic_symbols[slot.symbol];
+          if (symbol.st_name_length != name.size())
+          {
+            return nullptr;
+          }
+          tally.string_compare();
+          if (std::memcmp(symbol.st_name_str, name.data(), name.size()) != 0)
+          {
+            return nullptr;
+          }
+          tally.hit();
+          return &symbol;
+        }
+
+        /*
+         * get_symbols through the perfect hash, prefetching each level for a
+         * block of names before reading it
+         */
+        std::size_t lookup_perfect_hash_many(std::span<const char *const> names, std::span<const ::elf::elf_symbol *> out) const
+        {
+          std::array<std::uint64_t, symbol_batch_size> hashes{};
+          std::array<std::uint32_t, symbol_batch_size> positions{};
+          std::size_t found = 0;
+          lookup_tally tally(*this, perfect_hash_lookups);
+          for (std::size_t block = 0; block < names.size(); block += symbol_batch_size)
+          {
+            const std::size_t block_size = std::min(symbol_batch_size, names.size() - block);
+            if (this->perfect_hash_slots.empty())
+            {
+              std::fill_n(out.begin() + static_cast<std::ptrdiff_t>(block), block_size, nullptr);
+              continue;
+            }
+            tally.lookup(block_size);
+            for (std::size_t i = 0; i < block_size; i++)
+            {
+              hashes[i] = ::elf::detail::name_hash64(names[block + i]);
+              ::elf::detail::prefetch(this->symbol_perfect_hash.pilot_of(hashes[i]));
+            }
+            for (std::size_t i = 0; i < block_size; i++)
+            {
+              positions[i] = this->symbol_perfect_hash.position(hashes[i]);
+              ::elf::detail::prefetch(&this->perfect_hash_slots[positions[i]]);
+            }
+            for (std::size_t i = 0; i < block_size; i++)
+            {
+              const perfect_hash_slot &slot = this->perfect_hash_slots[positions[i]];
+              out[block + i] = slot.fingerprint == static_cast<std::uint32_t>(hashes[i]) ? &this->dynamic_symbols[slot.symbol] : nullptr;
+              if (out[block + i] != nullptr)
+              {
+                ::elf::detail::prefetch(out[block + i]->st_name_str);
+              } else
+              {
+                tally.filter_reject();
+              }
+            }
+            for (std::size_t i = 0; i < block_size; i++)
+            {
+              if (out[block + i] == nullptr)
+              {
+                continue;
+              }
+              tally.chain_entry();
+              const std::string_view name = names[block + i];
+              if (out[block + i]->st_name_length != name.size())
+              {
+                out[block + i] = nullptr;
+                continue;
+              }
+              tally.string_compare();
+              if (std::memcmp(out[block + i]->st_name_str, name.data(), name.size()) != 0)
+              {
+                out[block + i] = nullptr;
+                continue;
+              }
+              tally.hit();
+              found++;
+            }
+          }
+          return found;
+        }
+
+        bool has_gnu_hash_table() const
+        {
+          return !this->gnu_hash_buckets.empty() && !this->gnu_hash_bloom_words.empty();
+        }
+
+        /*
+         * Check both bloom filter bits for a GNU hash. Bloom words are the
+         * native word size of the file
+         */
+        bool gnu_bloom_test(std::uint32_t hash1) const
+        {
+          return ::elf::detail::gnu_bloom_test_scalar(this->gnu_hash_bloom_words.data(), this->gnu_hash_bloom_words.size() - 1,
+                                                      this->gnu_hash_bloom_shift, this->is_64_bit(), hash1);
+        }
+
+        /*
+         * Bloom test count hashes at once, pass[i] is set to 1 when hashes[i]
+         * passes
+         */
+        void gnu_bloom_test_many(const std::uint32_t *hashes, std::size_t count, std::uint8_t *pass) const
+        {
+          ::elf::detail::gnu_bloom_test_many(this->gnu_hash_bloom_words.data(), this->gnu_hash_bloom_words.size() - 1,
+                                             this->gnu_hash_bloom_shift, this->is_64_bit(), hashes, count, pass,
+                                             ::elf::detail::get_simd_level());
+        }
+
+        /*
+         * Walk a SysV hash chain starting at a bucket's symbol index. The
+         * chain holds no hashes of its own, so entries are rejected on the
+         * length of their name, and on its GNU hash for files loaded with
+         * hash_names, before it is compared. A chain can't be longer than
+         * the chain table, so one that is must loop and the walk gives up
+         * there, setting cyclic when given
+         */
+        const ::elf::elf_symbol *walk_elf_chain(std::string_view name, std::uint32_t index, std::uint32_t name_hash, lookup_tally &tally,
+                                                bool *cyclic = nullptr) const
+        {
+          for (std::size_t steps = 0; index != ::elf::elf_symbol::STN_UNDEF; steps++)
+          {
+            if (steps == this->hash_chains.size())
+            {
+              if (cyclic != nullptr)
+              {
+                *cyclic = true;
+              }
+              return nullptr;
+            }
+            const auto &symbol = this->dynamic_symbols.at(index);
+            tally.chain_entry();
+            if (symbol.st_name_length == name.size() && (!this->hash_names || symbol.st_name_hash == name_hash))
+            {
+              tally.string_compare();
+              if (std::memcmp(symbol.st_name_str, name.data(), name.size()) == 0)
+              {
+                tally.hit();
+                return &symbol;
+              }
+            }
+            index = this->hash_chains.at(index);
+          }
+          return nullptr;
+        }
+
+        /*
+         * Walk a GNU hash chain starting at a bucket's symbol index. The low
+         * bit of each hash value marks the end of the chain
+         */
+        const ::elf::elf_symbol *walk_gnu_chain(std::string_view name, std::uint32_t hash, std::size_t start_idx, lookup_tally &tally) const
+        {
+          if (start_idx == ::elf::elf_symbol::STN_UNDEF || start_idx < this->gnu_hash_omitted_symbols_count)
+          {
+            return nullptr;
+          }
+
+          hash &= ~1;
+          for (std::size_t idx = start_idx; idx < this->dynamic_symbols.size() && idx - this->gnu_hash_omitted_symbols_count < this->gnu_hash_values.size(); idx++)
+          {
+            const std::uint32_t chain_hash = this->gnu_hash_values[idx - this->gnu_hash_omitted_symbols_count];
+            tally.chain_entry();
+            const ::elf::elf_symbol &symbol = this->dynamic_symbols[idx];
+            if (hash == (chain_hash & ~1) && symbol.st_name_length == name.size())
+            {
+              tally.string_compare();
+              if (std::memcmp(symbol.st_name_str, name.data(), name.size()) == 0)
+              {
+                tally.hit();
+                return &symbol;
+              }
+            }
+            if (chain_hash & 1)
+            {
+              break;
+            }
+          }
+
+          return nullptr;
+        }
+    };
+
+    /*
+     * A zero-copy view of an ELF image of one class and byte order. Tables
+     * are spans of the on-disk structures, so nothing is widened or copied,
+     * but multi-byte fields are in the file's byte order and are read
+     * through get(). The image must outlive the view and its tables must be
+     * aligned for their structures, as a linker leaves them. visit_image
+     * picks the instantiation for an image at runtime
+     */
+    template<::elf::byte Class, std::endian Endian>
+    class basic_elf_file
+    {
+    public:
+        using layout = ::elf::elf_layout<Class, Endian>;
+        using Ehdr = typename layout::Ehdr;
+        using Phdr = typename layout::Phdr;
+        using Shdr = typename layout::Shdr;
+        using Sym = typename layout::Sym;
+        using Dyn = typename layout::Dyn;
+        using Addr = typename layout::Addr;
+
+        explicit basic_elf_file(std::span<const std::byte> image) : image(image)
+        {
+          this->parse();
+        }
+
+        bool error() const
+        {
+          return !this->last_error.empty();
+        }
+
+        const std::string &error_message() const
+        {
+          return this->last_error;
+        }
+
+        /*
+         * A field of one of the file's structures in our byte order
+         */
+        template<typename T>
+        static constexpr T get(T value)
+        {
+          return layout::get(value);
+        }
+
+        const Ehdr &get_header() const
+        {
+          return this->header;
+        }
+
+        std::span<const Phdr> get_program_headers() const
+        {
+          return this->program_headers;
+        }
+
+        std::span<const Shdr> get_section_headers() const
+        {
+          return this->section_headers;
+        }
+
+        /*
+         * The name of a section, empty if it is outside the section header string table
+         */
+        const char *get_section_name(const Shdr &section_header) const
+        {
+          return this->string_at(this->section_names, get(section_header.sh_name));
+        }
+
+        std::span<const Dyn> get_dynamic_entries() const
+        {
+          return this->dynamic_entries;
+        }
+
+        std::span<const Sym> get_dynamic_symbols() const
+        {
+          return this->dynamic_symbols;
+        }
+
+        /*
+         * The name of a dynamic symbol, empty if it is outside the dynamic string table
+         */
+        const char *get_symbol_name(const Sym &symbol) const
+        {
+          return this->string_at(this->dynamic_strings, get(symbol.st_name));
+        }
+
+        /*
+         * Get a dynamic symbol by its name using the GNU hash table and/or
+         * the ELF hash table, nullptr if there is none
+         */
+        const Sym *get_symbol(const char *name) const
+        {
+          const Sym *symbol = this->lookup_gnu_symbol(name);
+          if (symbol == nullptr)
+          {
+            symbol = this->lookup_elf_symbol(name);
+          }
+          return symbol;
+        }
+
+    private:
+        std::span<const std::byte> image;
+        std::string last_error;
+
+        Ehdr header{};
+        std::span<const Phdr> program_headers;
+        std::span<const Shdr> section_headers;
+        std::span<const char> section_names;
+        std::span<const Dyn> dynamic_entries;
+        std::span<const Sym> dynamic_symbols;
+        std::span<const char> dynamic_strings;
+        std::span<const std::uint32_t> hash_buckets;
+        std::span<const std::uint32_t> hash_chains;
+        std::span<const Addr> gnu_hash_bloom_words;
+        std::span<const std::uint32_t> gnu_hash_buckets;
+        std::span<const std::uint32_t> gnu_hash_values;
+        std::uint32_t gnu_hash_bloom_shift = 0;
+        std::uint32_t gnu_hash_omitted_symbols_count = 0;
+
+    private:
+        /*
+         * Point table at count entries at offset, if they are inside the image and aligned
+         */
+        template<typename T>
+        bool view(std::span<const T> &table, std::uint64_t offset, std::uint64_t count) const
+        {
+          if (count > std::numeric_limits<std::uint64_t>::max() / sizeof(T))
+          {
+            return false;
+          }
+          const std::uint64_t size = count * sizeof(T);
+          if (offset > this->image.size() || size > this->image.size() - offset)
+          {
+            return false;
+          }
+          const std::byte *entries = this->image.data() + offset;
+          if (reinterpret_cast<std::uintptr_t>(entries) % alignof(T) != 0)
+          {
+            return false;
+          }
+          table = std::span<const T>(reinterpret_cast<const T *>(entries), count);
+          return true;
+        }
+
+        /*
+         * parse() only keeps string tables ending in a null, so every
+         * pointer handed out is terminated within the table
+         */
+        static const char *string_at(std::span<const char> strings, std::uint64_t offset)
+        {
+          return offset < strings.size() ? strings.data() + offset : "";
+        }
+
+        const Shdr *find_section(std::uint32_t type) const
+        {
+          for (const auto &section_header: this->section_headers)
+          {
+            if (get(section_header.sh_type) == type)
+            {
+              return &section_header;
+            }
+          }
+          return nullptr;
+        }
+
+        bool parse()
+        {
+          if (this->image.size() < sizeof(Ehdr))
+          {
+            this->last_error = "Failed to read ELF header";
+            return false;
+          }
+          std::memcpy(&this->header, this->image.data(), sizeof(Ehdr));
+          const auto &ident = this->header.e_ident;
+          if (ident.ei_magic[0] != ::elf::elf_ident::ELFMAG0 || ident.ei_magic[1] != ::elf::elf_ident::ELFMAG1 ||
+              ident.ei_magic[2] != ::elf::elf_ident::ELFMAG2 || ident.ei_magic[3] != ::elf::elf_ident::ELFMAG3)
+          {
+            this->last_error = "Invalid ELF magic";
+            return false;
+          }
+          if (ident.ei_class != Class)
+          {
+            this->last_error = "ELF class does not match";
+            return false;
+          }
+          if (ident.ei_data != (Endian == std::endian::little ? ::elf::elf_ident::ELFDATA2LSB : ::elf::elf_ident::ELFDATA2MSB))
+          {
+            this->last_error = "ELF data encoding does not match";
+            return false;
+          }
+
+          /*
+           * Program headers and the dynamic segment
+           */
+          if (get(this->header.e_phnum) != 0)
+          {
+            if (get(this->header.e_phentsize) != sizeof(Phdr))
+            {
+              this->last_error = "Invalid program header size";
+              return false;
+            }
+            if (!this->view(this->program_headers, get(this->header.e_phoff), get(this->header.e_phnum)))
+            {
+              this->last_error = "Failed to read program headers";
+              return false;
+            }
+          }
+          for (const auto &program_header: this->program_headers)
+          {
+            if (get(program_header.p_type) == ::elf::elf_program_header::PT_DYNAMIC &&
+                !this->view(this->dynamic_entries, get(program_header.p_offset), get(program_header.p_filesz) / sizeof(Dyn)))
+            {
+              this->last_error = "Failed to read dynamic segment";
+              return false;
+            }
+          }
+
+          /*
+           * Section headers, with extended numbering when e_shnum is 0
+           */
+          if (get(this->header.e_shoff) == 0)
+          {
+            return true;
+          }
+          if (get(this->header.e_shentsize) != sizeof(Shdr))
+          {
+            this->last_error = "Invalid section header size";
+            return false;
+          }
+          std::uint64_t section_count = get(this->header.e_shnum);
+          if (section_count == 0)
+          {
+            if (!this->view(this->section_headers, get(this->header.e_shoff), 1))
+            {
+              this->last_error = "Failed to read section headers";
+              return false;
+            }
+            section_count = get(this->section_headers[0].sh_size);
+          }
+          if (!this->view(this->section_headers, get(this->header.e_shoff), section_count))
+          {
+            this->last_error = "Failed to read section headers";
+            return false;
+          }
+          if (this->section_headers.empty())
+          {
+            return true;
+          }
+          std::uint32_t section_header_string_table_idx = get(this->header.e_shstrndx);
+          if (section_header_string_table_idx == ::elf::elf_section_header::SHN_XINDEX)
+          {
+            section_header_string_table_idx = get(this->section_headers[0].sh_link);
+          }
+          if (section_header_string_table_idx >= this->section_headers.size())
+          {
+            this->last_error = "Invalid section header string table index";
+            return false;
+          }
+          const Shdr &section_names_header = this->section_headers[section_header_string_table_idx];
+          if (!this->view(this->section_names, get(section_names_header.sh_offset), get(section_names_header.sh_size)))
+          {
+            this->last_error = "Failed to read section header string table";
+            return false;
+          }
+          if (!this->section_names.empty() && this->section_names.back() != '\0')
+          {
+            this->last_error = "Section header string table is not null terminated";
+            return false;
+          }
+
+          /*
+           * Dynamic symbols and their string table
+           */
+          const Shdr *symbol_table_header = this->find_section(::elf::elf_section_header::SHT_DYNSYM);
+          if (symbol_table_header == nullptr)
+          {
+            return true;
+          }
+          if (get(symbol_table_header->sh_entsize) != sizeof(Sym))
+          {
+            this->last_error = "Invalid symbol table entry size";
+            return false;
+          }
+          if (!this->view(this->dynamic_symbols, get(symbol_table_header->sh_offset), get(symbol_table_header->sh_size) / sizeof(Sym)))
+          {
+            this->last_error = "Failed to read dynamic symbols";
+            return false;
+          }
+          const std::uint32_t string_table_idx = get(symbol_table_header->sh_link);
+          if (string_table_idx >= this->section_headers.size() ||
+              !this->view(this->dynamic_strings, get(this->section_headers[string_table_idx].sh_offset), get(this->section_headers[string_table_idx].sh_size)))
+          {
+            this->last_error = "Failed to read dynamic string table";
+            return false;
+          }
+          if (!this->dynamic_strings.empty() && this->dynamic_strings.back() != '\0')
+          {
+            this->last_error = "Dynamic string table is not null terminated";
+            return false;
+          }
+
+          /*
+           * Hash tables
+           */
+          const Shdr *hash_header = this->find_section(::elf::elf_section_header::SHT_HASH);
+          if (hash_header != nullptr)
+          {
+            std::span<const std::uint32_t> table_header;
+            if (!this->view(table_header, get(hash_header->sh_offset), 2) ||
+                !this->view(this->hash_buckets, get(hash_header->sh_offset) + 2 * sizeof(std::uint32_t), get(table_header[0])) ||
+                !this->view(this->hash_chains, get(hash_header->sh_offset) + (2 + this->hash_buckets.size()) * sizeof(std::uint32_t), get(table_header[1])))
+            {
+              this->last_error = "Failed to read hash table";
+              return false;
+            }
+          }
+          const Shdr *gnu_hash_header = this->find_section(::elf::elf_section_header::SHT_GNU_HASH);
+          if (gnu_hash_header != nullptr)
+          {
+            std::span<const std::uint32_t> table_header;
+            if (!this->view(table_header, get(gnu_hash_header->sh_offset), 4))
+            {
+              this->last_error = "Failed to read gnu hash table header";
+              return false;
+            }
+            this->gnu_hash_omitted_symbols_count = get(table_header[1]);
+            this->gnu_hash_bloom_shift = get(table_header[3]);
+            if (this->gnu_hash_omitted_symbols_count > this->dynamic_symbols.size() || this->gnu_hash_bloom_shift >= 32)
+            {
+              this->last_error = "Invalid gnu hash table header";
+              return false;
+            }
+            const std::uint64_t bloom_words_offset = get(gnu_hash_header->sh_offset) + 4 * sizeof(std::uint32_t);
+            const std::uint64_t buckets_offset = bloom_words_offset + sizeof(Addr) * get(table_header[2]);
+            const std::uint64_t hash_values_offset = buckets_offset + sizeof(std::uint32_t) * get(table_header[0]);
+            if (!this->view(this->gnu_hash_bloom_words, bloom_words_offset, get(table_header[2])) ||
+                !this->view(this->gnu_hash_buckets, buckets_offset, get(table_header[0])) ||
+                !this->view(this->gnu_hash_values, hash_values_offset, this->dynamic_symbols.size() - this->gnu_hash_omitted_symbols_count))
+            {
+              this->last_error = "Failed to read gnu hash table";
+              return false;
+            }
+          }
+
+          return true;
+        }
+
+        const Sym *lookup_gnu_symbol(const char *name) const
+        {
+          if (this->gnu_hash_buckets.empty() || this->gnu_hash_bloom_words.empty())
+          {
+            return nullptr;
+          }
+
+          constexpr std::uint32_t bloom_word_bits = sizeof(Addr) * 8;
+          const auto hash = static_cast<std::uint32_t>(::elf::gnu_hash(name));
+          const Addr bloom_word = get(this->gnu_hash_bloom_words[(hash / bloom_word_bits) % this->gnu_hash_bloom_words.size()]);
+          const Addr bloom_mask = static_cast<Addr>(1) << (hash % bloom_word_bits) | static_cast<Addr>(1) << ((hash >> this->gnu_hash_bloom_shift) % bloom_word_bits);
+          if ((bloom_word & bloom_mask) != bloom_mask)
+          {
+            return nullptr;
+          }
+
+          std::uint32_t symbol_idx = get(this->gnu_hash_buckets[hash % this->gnu_hash_buckets.size()]);
+          if (symbol_idx < this->gnu_hash_omitted_symbols_count)
+          {
+            return nullptr;
+          }
+          for (; symbol_idx < this->dynamic_symbols.size(); symbol_idx++)
+          {
+            const std::uint32_t symbol_hash = get(this->gnu_hash_values[symbol_idx - this->gnu_hash_omitted_symbols_count]);
+            if ((symbol_hash | 1) == (hash | 1) && std::strcmp(name, this->get_symbol_name(this->dynamic_symbols[symbol_idx])) == 0)
+            {
+              return &this->dynamic_symbols[symbol_idx];
+            }
+            if (symbol_hash & 1)
+            {
+              break;
+            }
+          }
+          return nullptr;
+        }
+
+        const Sym *lookup_elf_symbol(const char *name) const
+        {
+          if (this->hash_buckets.empty())
+          {
+            return nullptr;
+          }
+
+          const auto hash = static_cast<std::uint32_t>(::elf::elf_hash(name));
+          std::uint32_t symbol_idx = get(this->hash_buckets[hash % this->hash_buckets.size()]);
+          for (std::size_t steps = 0; symbol_idx != 0 && symbol_idx < this->dynamic_symbols.size() && symbol_idx < this->hash_chains.size() &&
+                                      steps < this->hash_chains.size(); steps++)
+          {
+            if (std::strcmp(name, this->get_symbol_name(this->dynamic_symbols[symbol_idx])) == 0)
+            {
+              return &this->dynamic_symbols[symbol_idx];
+            }
+            symbol_idx = get(this->hash_chains[symbol_idx]);
+          }
+          return nullptr;
+        }
+    };
+
+    using elf32le_file = ::elf::basic_elf_file<::elf::elf_ident::ELFCLASS32, std::endian::little>;
+    using elf32be_file = ::elf::basic_elf_file<::elf::elf_ident::ELFCLASS32, std::endian::big>;
+    using elf64le_file = ::elf::basic_elf_file<::elf::elf_ident::ELFCLASS64, std::endian::little>;
+    using elf64be_file = ::elf::basic_elf_file<::elf::elf_ident::ELFCLASS64, std::endian::big>;
+
+    /*
+     * Call visitor with the basic_elf_file matching the class and byte order
+     * of image, returning what it returns. Images of no known class or byte
+     * order are passed as an elf64le_file whose error() is set
+     */
+    template<typename Visitor>
+    decltype(auto) visit_image(std::span<const std::byte> image, Visitor &&visitor)
+    {
+      const auto ident_byte = [image](std::size_t offset) {
+          return offset < image.size() ? static_cast<::elf::byte>(image[offset]) : ::elf::byte{0};
+      };
+      const ::elf::byte elf_class = ident_byte(offsetof(::elf::elf_ident, ei_class));
+      const ::elf::byte elf_data = ident_byte(offsetof(::elf::elf_ident, ei_data));
+      if (elf_class == ::elf::elf_ident::ELFCLASS32 && elf_data == ::elf::elf_ident::ELFDATA2LSB)
+      {
+        return visitor(::elf::elf32le_file(image));
+      }
+      if (elf_class == ::elf::elf_ident::ELFCLASS32 && elf_data == ::elf::elf_ident::ELFDATA2MSB)
+      {
+        return visitor(::elf::elf32be_file(image));
+      }
+      if (elf_class == ::elf::elf_ident::ELFCLASS64 && elf_data == ::elf::elf_ident::ELFDATA2MSB)
+      {
+        return visitor(::elf::elf64be_file(image));
+      }
+      return visitor(::elf::elf64le_file(image));
+    }
+
+    /*
+     * A symbol definition found in a link_map. symbol is nullptr when
+     * nothing matched
+     */
+    typedef struct resolved_symbol
+    {
+        const ::elf::elf_file *file = nullptr;      /* File defining the symbol */
+        std::size_t file_index = 0;                 /* Index of file in the link map */
+        const ::elf::elf_symbol *symbol = nullptr;  /* The definition */
+    } resolved_symbol;
+
+    /*
+     * A set of ELF files searched as one global scope, the way ld.so does.
+     * Files keep the order they were added in and the first one to define a
+     * symbol wins, whether its binding is global or weak. Every exported
+     * definition goes in a single open-addressing index so a lookup is one
+     * probe sequence rather than a hash table walk per file.
+     * Symbol versions and DT_SYMBOLIC are not taken into account
+     */
+    class link_map
+    {
+    public:
+        link_map() = default;
+
+        link_map(const link_map &) = delete;
+        link_map &operator=(const link_map &) = delete;
+        link_map(link_map &&) = default;
+        link_map &operator=(link_map &&) = default;
+
+        /*
+         * Check if an error occurred
+         */
+        bool error() const
+        {
+          return !this->last_error.empty();
+        }
+
+        /*
+         * Get a message for the last error that occurred
+         */
+        const std::string &error_message() const
+        {
+          return this->last_error;
+        }
+
+        /*
+         * Clear the current error
+         */
+        void clear_error()
+        {
+          this->last_error = "";
+        }
+
+        /*
+         * Append a file to the end of the search order
+         */
+        bool add(const std::filesystem::path &path, const ::elf::load_options &options = {})
+        {
+          return this->add_file(path, path.string(), options) != nullptr;
+        }
+
+        /*
+         * Load an executable or library followed by everything it needs,
+         * breadth first in DT_NEEDED order like ld.so. Needed names without
+         * a slash are looked up in search_paths, skipping files of another
+         * class or machine, and names already loaded are not loaded again.
+         * Libraries that can't be found are reported through error_message,
+         * everything else is still loaded
+         */
+        bool load(const std::filesystem::path &path, std::span<const std::filesystem::path> search_paths, const ::elf::load_options &options = {})
+        {
+          std::size_t next = this->files.size();
+          if (this->add_file(path, path.string(), options) == nullptr)
+          {
+            return false;
+          }
+          const ::elf::elf_file &root = this->files[next];
+          std::string missing;
+
+          for (; next < this->files.size(); next++)
+          {
+            for (const char *needed: this->files[next].get_needed_libraries())
+            {
+              if (this->is_loaded(needed))
+              {
+                continue;
+              }
+              if (std::strchr(needed, '/') != nullptr)
+              {
+                if (this->add_file(needed, needed, options) == nullptr)
+                {
+                  missing += missing.empty() ? needed : std::string(", ") + needed;
+                }
+                continue;
+              }
+
+              bool found = false;
+              for (const auto &search_path: search_paths)
+              {
+                const std::filesystem::path candidate = search_path / needed;
+                std::error_code ec;
+                if (!std::filesystem::is_regular_file(candidate, ec))
+                {
+                  continue;
+                }
+                if (this->add_file(candidate, needed, options, &root) != nullptr)
+                {
+                  found = true;
+                  break;
+                }
+              }
+              if (!found)
+              {
+                missing += missing.empty() ? needed : std::string(", ") + needed;
+              }
+            }
+          }
+
+          this->last_error = missing.empty() ? "" : "Failed to find needed libraries: " + missing;
+          return missing.empty();
+        }
+
+        /*
+         * Get the loaded files in search order
+         */
+        const std::deque<::elf::elf_file> &get_files() const
+        {
+          return this->files;
+        }
+
+        /*
+         * Get the number of unique exported symbols
+         */
+        std::size_t get_symbol_count() const
+        {
+          return this->index_size;
+        }
+
+        /*
+         * Find the first definition of a symbol in search order
+         */
+        ::elf::resolved_symbol get_symbol(const char *name) const
+        {
+          return this->get_symbol(std::string_view(name));
+        }
+
+        ::elf::resolved_symbol get_symbol(std::string_view name) const
+        {
+          return this->find(name, static_cast<std::uint32_t>(gnu_hash(name.data(), name.size())));
+        }
+
+        /*
+         * Resolve symbol symbol_index of files[file_index], as a relocation
+         * referencing it would be. Local and protected definitions bind to
+         * themselves, anything else goes through the global scope
+         */
+        ::elf::resolved_symbol resolve(std::size_t file_index, std::uint32_t symbol_index) const
+        {
+          const ::elf::elf_symbol *reference = this->get_reference(file_index, symbol_index);
+          if (reference == nullptr)
+          {
+            return {};
+          }
+          if (this->binds_locally(*reference))
+          {
+            return {&this->files[file_index], file_index, reference};
+          }
+          return this->get_symbol(reference->get_name());
+        }
+
+        /*
+         * Resolve the symbol of every relocation of files[file_index] into
+         * out, which is filled for min(relocations.size(), out.size())
+         * entries. Relocations without a symbol resolve to nothing. Returns
+         * how many symbols were found
+         */
+        std::size_t resolve_relocations(std::size_t file_index, std::span<const ::elf::elf_rela> relocations, std::span<::elf::resolved_symbol> out) const
+        {
+          return this->resolve_many(file_index, relocations, out);
+        }
+
+        std::size_t resolve_relocations(std::size_t file_index, std::span<const ::elf::elf_rel> relocations, std::span<::elf::resolved_symbol> out) const
+        {
+          return this->resolve_many(file_index, relocations, out);
+        }
+
+    private:
+        /*
+         * One exported definition. Empty slots have a null symbol
+         */
+        typedef struct index_entry
+        {
+            std::uint32_t hash;
+            std::uint32_t file_index;
+            const ::elf::elf_symbol *symbol;
+        } index_entry;
+
+        /*
+         * Number of references resolve_relocations hashes and prefetches at once
+         */
+        inline static constexpr std::size_t resolve_batch_size = 64;
+
+        std::deque<::elf::elf_file> files;
+        std::vector<std::string> file_names;
+        std::vector<index_entry> index;
+        std::size_t index_size = 0;
+        std::string last_error;
+
+        /*
+         * Open a file, parse its dynamic segment and index its exports.
+         * name is what DT_NEEDED entries are matched against besides the
+         * soname. When like is set, files of a different class or machine
+         * are rejected
+         */
+        const ::elf::elf_file *add_file(const std::filesystem::path &path, std::string name, const ::elf::load_options &options,
+                                        const ::elf::elf_file *like = nullptr)
+        {
+          ::elf::elf_file &file = this->files.emplace_back(path, options);
+          if (file.error() || !file.parse_dynamic_segment() || file.get_dynamic_symbols().empty())
+          {
+            this->last_error = "Failed to load " + path.string() + ": " + (file.error() ? file.error_message() : "No dynamic symbols");
+            this->files.pop_back();
+            return nullptr;
+          }
+          if (like != nullptr && (file.is_64_bit() != like->is_64_bit() || file.get_header().e_machine != like->get_header().e_machine))
+          {
+            this->last_error = "Incompatible file " + path.string();
+            this->files.pop_back();
+            return nullptr;
+          }
+          this->file_names.push_back(std::move(name));
+          this->index_file(this->files.size() - 1);
+          return &file;
+        }
+
+        bool is_loaded(const char *name) const
+        {
+          for (std::size_t i = 0; i < this->files.size(); i++)
+          {
+            if (this->file_names[i] == name || std::strcmp(this->files[i].get_so_name(), name) == 0)
+            {
+              return true;
+            }
+          }
+          return false;
+        }
+
+        /*
+         * Whether a symbol is an exported definition other files can bind to
+         */
+        static bool is_exported(const ::elf::elf_symbol &symbol)
+        {
+          const ::elf::byte binding = symbol.get_binding();
+          return symbol.st_shndx != ::elf::elf_section_header::SHN_UNDEF &&
+                 symbol.st_name_str != nullptr && symbol.st_name_str[0] != '\0' &&
+                 (binding == ::elf::elf_symbol::STB_GLOBAL || binding == ::elf::elf_symbol::STB_WEAK || binding == ::elf::elf_symbol::STB_GNU_UNIQUE) &&
+                 (symbol.get_visibility() == ::elf::elf_symbol::STV_DEFAULT || symbol.get_visibility() == ::elf::elf_symbol::STV_PROTECTED);
+        }
+
+        /*
+         * Whether a reference to symbol never leaves its own file
+         */
+        static bool binds_locally(const ::elf::elf_symbol &symbol)
+        {
+          return symbol.st_shndx != ::elf::elf_section_header::SHN_UNDEF &&
+                 (symbol.get_binding() == ::elf::elf_symbol::STB_LOCAL || symbol.get_visibility() != ::elf::elf_symbol::STV_DEFAULT);
+        }
+
+        const ::elf::elf_symbol *get_reference(std::size_t file_index, std::uint32_t symbol_index) const
+        {
+          if (symbol_index == ::elf::elf_symbol::STN_UNDEF || file_index >= this->files.size())
+          {
+            return nullptr;
+          }
+          const auto &symbols = this->files[file_index].get_dynamic_symbols();
+          return symbol_index < symbols.size() ? &symbols[symbol_index] : nullptr;
+        }
+
+        /*
+         * Add every export of a file the index doesn't already have
+         */
+        void index_file(std::size_t file_index)
+        {
+          const auto &symbols = this->files[file_index].get_dynamic_symbols();
+          std::vector<const char *> names;
+          std::vector<const ::elf::elf_symbol *> exports;
+          for (const auto &symbol: symbols)
+          {
+            if (is_exported(symbol))
+            {
+              names.push_back(symbol.st_name_str);
+              exports.push_back(&symbol);
+            }
+          }
+          std::vector<std::uint32_t> hashes(names.size());
+          gnu_hash_many(names, hashes);
+
+          this->reserve(this->index_size + exports.size());
+          for (std::size_t i = 0; i < exports.size(); i++)
+          {
+            this->insert({hashes[i], static_cast<std::uint32_t>(file_index), exports[i]});
+          }
+        }
+
+        /*
+         * Grow the index so it stays at most half full with count entries
+         */
+        void reserve(std::size_t count)
+        {
+          std::size_t capacity = this->index.empty() ? 64 : this->index.size();
+          while (capacity < count * 2)
+          {
+            capacity *= 2;
+          }
+          if (capacity == this->index.size())
+          {
+            return;
+          }
+          std::vector<index_entry> old_index(capacity, index_entry{0, 0, nullptr});
+          old_index.swap(this->index);
+          this->index_size = 0;
+          for (const auto &entry: old_index)
+          {
+            if (entry.symbol != nullptr)
+            {
+              this->insert(entry);
+            }
+          }
+        }
+
+        /*
+         * Insert an entry unless an earlier file already defines the name
+         */
+        void insert(const index_entry &entry)
+        {
+          const std::size_t mask = this->index.size() - 1;
+          for (std::size_t slot = entry.hash & mask;; slot = (slot + 1) & mask)
+          {
+            index_entry &existing = this->index[slot];
+            if (existing.symbol == nullptr)
+            {
+              existing = entry;
+              this->index_size++;
+              return;
+            }
+            if (existing.hash == entry.hash && existing.symbol->get_name() == entry.symbol->get_name())
+            {
+              return;
+            }
+          }
+        }
+
+        ::elf::resolved_symbol find(std::string_view name, std::uint32_t hash) const
+        {
+          if (this->index.empty())
+          {
+            return {};
+          }
+          const std::size_t mask = this->index.size() - 1;
+          for (std::size_t slot = hash & mask;; slot = (slot + 1) & mask)
+          {
+            const index_entry &entry = this->index[slot];
+            if (entry.symbol == nullptr)
+            {
+              return {};
+            }
+            if (entry.hash == hash && entry.symbol->get_name() == name)
+            {
+              return {&this->files[entry.file_index], entry.file_index, entry.symbol};
+            }
+          }
+        }
+
+        /*
+         * Batched resolve. Names are hashed a block at a time and their
+         * first slots prefetched before any probing, so the misses overlap
+         */
+        template<typename Relocation>
+        std::size_t resolve_many(std::size_t file_index, std::span<const Relocation> relocations, std::span<::elf::resolved_symbol> out) const
+        {
+          const std::size_t count = std::min(relocations.size(), out.size());
+          const std::size_t mask = this->index.empty() ? 0 : this->index.size() - 1;
+          std::array<const char *, resolve_batch_size> names{};
+          std::array<const ::elf::elf_symbol *, resolve_batch_size> references{};
+          std::array<std::uint32_t, resolve_batch_size> hashes{};
+          std::array<std::size_t, resolve_batch_size> pending{};
+          std::size_t found = 0;
+
+          for (std::size_t block = 0; block < count; block += resolve_batch_size)
+          {
+            const std::size_t block_size = std::min(resolve_batch_size, count - block);
+            std::size_t pending_count = 0;
+            for (std::size_t i = block; i < block + block_size; i++)
+            {
+              out[i] = {};
+              const ::elf::elf_symbol *reference = this->get_reference(file_index, relocations[i].r_sym);
+              if (reference == nullptr)
+              {
+                continue;
+              }
+              if (binds_locally(*reference))
+              {
+                out[i] = {&this->files[file_index], file_index, reference};
+                found++;
+                continue;
+              }
+              names[pending_count] = reference->st_name_str;
+              references[pending_count] = reference;
+              pending[pending_count++] = i;
+            }
+            if (pending_count == 0 || this->index.empty())
+            {
+              continue;
+            }
+
+            gnu_hash_many(std::span(names).first(pending_count), std::span(hashes).first(pending_count));
+            for (std::size_t i = 0; i < pending_count; i++)
+            {
+              ::elf::detail::prefetch(&this->index[hashes[i] & mask]);
+            }
+            for (std::size_t i = 0; i < pending_count; i++)
+            {
+              out[pending[i]] = this->find(references[i]->get_name(), hashes[i]);
+              if (out[pending[i]].symbol != nullptr)
+              {
+                found++;
+              }
+            }
+          }
+
+          return found;
+        }
+    };
+
+    /*
+     * Which symbols symbol_store::filter keeps. Types and bindings are
+     * bitmasks with bit 1 << STT_* or 1 << STB_* set for each one to keep
+     */
+    typedef struct symbol_filter
+    {
+        inline static constexpr std::uint32_t any_section = 0xffffffff;
+
+        std::uint16_t types = 0xffff;           /* Types to keep */
+        std::uint16_t bindings = 0xffff;        /* Bindings to keep */
+        bool defined = false;                   /* Only keep symbols whose st_shndx isn't SHN_UNDEF */
+        std::uint32_t section = any_section;    /* Only keep symbols with this st_shndx */
+    } symbol_filter;
+
+    namespace detail
+    {
+        /*
+         * A symbol_filter as the tables the filter kernels look st_info up
+         * in, one byte of 0xff or 0 per type and per binding
+         */
+        typedef struct symbol_filter_tables
+        {
+            alignas(16) std::uint8_t types[16];
+            alignas(16) std::uint8_t bindings[16];
+            std::uint16_t section;
+            bool match_section;
+            bool defined;
+        } symbol_filter_tables;
+
+        inline symbol_filter_tables make_symbol_filter_tables(const ::elf::symbol_filter &filter)
+        {
+          symbol_filter_tables tables{};
+          for (std::size_t i = 0; i < 16; i++)
+          {
+            tables.types[i] = (filter.types >> i) & 1 ? 0xff : 0;
+            tables.bindings[i] = (filter.bindings >> i) & 1 ? 0xff : 0;
+          }
+          tables.match_section = filter.section != ::elf::symbol_filter::any_section;
+          tables.section = static_cast<std::uint16_t>(filter.section);
+          tables.defined = filter.defined;
+
+          /*
+           * No 16-bit st_shndx can equal a wider section, so nothing matches
+           */
+          if (tables.match_section && filter.section > 0xffff)
+          {
+            std::fill(std::begin(tables.types), std::end(tables.types), 0);
+          }
+          return tables;
+        }
+
+        inline void filter_symbols_scalar(const ::elf::byte *info, const std::uint16_t *shndx, std::size_t count, const symbol_filter_tables &tables,
+                                          std::uint32_t base, std::vector<std::uint32_t> &out)
+        {
+          for (std::size_t i = 0; i < count; i++)
+          {
+            if ((tables.types[info[i] & 0xf] & tables.bindings[info[i] >> 4]) != 0 && (!tables.match_section || shndx[i] == tables.section) &&
+                (!tables.defined || shndx[i] != 0))
+              out.push_back(base + static_cast<std::uint32_t>(i));
+          }
+        }
+
+        /*
+         * The filter kernels look the type and binding of a block of
+         * symbols up with a byte shuffle, compare their section indices and
+         * narrow those masks to bytes, then append the index of every byte
+         * left set. The symbols after the last full block are filtered one
+         * at a time
+         */
+#if defined(ELF_HPP_X86_SIMD)
+        __attribute__((target("sse4.2")))
+        inline __m128i section_mask_sse4_2(const std::uint16_t *entries, const symbol_filter_tables &tables)
+        {
+          const __m128i indices = _mm_loadu_si128(reinterpret_cast<const __m128i *>(entries));
+          const __m128i mask = tables.match_section ? _mm_cmpeq_epi16(indices, _mm_set1_epi16(static_cast<short>(tables.section))) : _mm_set1_epi8(-1);
+          return tables.defined ? _mm_andnot_si128(_mm_cmpeq_epi16(indices, _mm_setzero_si128()), mask) : mask;
+        }
+
+        __attribute__((target("sse4.2")))
+        inline void filter_symbols_sse4_2(const ::elf::byte *info, const std::uint16_t *shndx, std::size_t count, const symbol_filter_tables &tables,
+                                          std::uint32_t base, std::vector<std::uint32_t> &out)
+        {
+          const __m128i types = _mm_load_si128(reinterpret_cast<const __m128i *>(tables.types));
+          const __m128i bindings = _mm_load_si128(reinterpret_cast<const __m128i *>(tables.bindings));
+          const __m128i low_nibble = _mm_set1_epi8(0x0f);
+          std::size_t i = 0;
+          for (; i + 16 <= count; i += 16)
+          {
+            const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(info + i));
+            __m128i keep = _mm_and_si128(_mm_shuffle_epi8(types, _mm_and_si128(bytes, low_nibble)),
+                                         _mm_shuffle_epi8(bindings, _mm_and_si128(_mm_srli_epi16(bytes, 4), low_nibble)));
+            if (tables.match_section || tables.defined)
+              keep = _mm_and_si128(keep, _mm_packs_epi16(section_mask_sse4_2(shndx + i, tables), section_mask_sse4_2(shndx + i + 8, tables)));
+            for (auto mask = static_cast<std::uint32_t>(_mm_movemask_epi8(keep)); mask != 0; mask &= mask - 1)
+              out.push_back(base + static_cast<std::uint32_t>(i) + static_cast<std::uint32_t>(std::countr_zero(mask)));
+          }
+          filter_symbols_scalar(info + i, shndx + i, count - i, tables, base + static_cast<std::uint32_t>(i), out);
+        }
+
+        __attribute__((target("avx2")))
+        inline __m256i section_mask_avx2(const std::uint16_t *entries, const symbol_filter_tables &tables)
+        {
+          const __m256i indices = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(entries));
+          const __m256i mask = tables.match_section ? _mm256_cmpeq_epi16(indices, _mm256_set1_epi16(static_cast<short>(tables.section))) : _mm256_set1_epi8(-1);
+          return tables.defined ? _mm256_andnot_si256(_mm256_cmpeq_epi16(indices, _mm256_setzero_si256()), mask) : mask;
+        }
+
+        __attribute__((target("avx2")))
+        inline void filter_symbols_avx2(const ::elf::byte *info, const std::uint16_t *shndx, std::size_t count, const symbol_filter_tables &tables,
+                                        std::uint32_t base, std::vector<std::uint32_t> &out)
+        {
+          const __m256i types = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i *>(tables.types)));
+          const __m256i bindings = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i *>(tables.bindings)));
+          const __m256i low_nibble = _mm256_set1_epi8(0x0f);
+          std::size_t i = 0;
+          for (; i + 32 <= count; i += 32)
+          {
+            const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(info + i));
+            __m256i keep = _mm256_and_si256(_mm256_shuffle_epi8(types, _mm256_and_si256(bytes, low_nibble)),
+                                            _mm256_shuffle_epi8(bindings, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), low_nibble)));
+            if (tables.match_section || tables.defined)
+            {
+              /*
+               * Packing works within each 128-bit half, the permute puts
+               * the four quarters back in symbol order
+               */
+              const __m256i packed = _mm256_packs_epi16(section_mask_avx2(shndx + i, tables), section_mask_avx2(shndx + i + 16, tables));
+              keep = _mm256_and_si256(keep, _mm256_permute4x64_epi64(packed, 0xd8));
+            }
+            for (auto mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(keep)); mask != 0; mask &= mask - 1)
+              out.push_back(base + static_cast<std::uint32_t>(i) + static_cast<std::uint32_t>(std::countr_zero(mask)));
+          }
+          filter_symbols_scalar(info + i, shndx + i, count - i, tables, base + static_cast<std::uint32_t>(i), out);
+        }
+#endif
+
+#if defined(ELF_HPP_NEON)
+        inline uint16x8_t section_mask_neon(const std::uint16_t *entries, const symbol_filter_tables &tables)
+        {
+          const uint16x8_t indices = vld1q_u16(entries);
+          const uint16x8_t mask = tables.match_section ? vceqq_u16(indices, vdupq_n_u16(tables.section)) : vdupq_n_u16(0xffff);
+          return tables.defined ? vandq_u16(mask, vtstq_u16(indices, indices)) : mask;
+        }
+
+        inline void filter_symbols_neon(const ::elf::byte *info, const std::uint16_t *shndx, std::size_t count, const symbol_filter_tables &tables,
+                                        std::uint32_t base, std::vector<std::uint32_t> &out)
+        {
+          const uint8x16_t types = vld1q_u8(tables.types);
+          const uint8x16_t bindings = vld1q_u8(tables.bindings);
+          const uint8x16_t low_nibble = vdupq_n_u8(0x0f);
+          std::size_t i = 0;
+          for (; i + 16 <= count; i += 16)
+          {
+            const uint8x16_t bytes = vld1q_u8(info + i);
+            uint8x16_t keep = vandq_u8(vqtbl1q_u8(types, vandq_u8(bytes, low_nibble)), vqtbl1q_u8(bindings, vshrq_n_u8(bytes, 4)));
+            if (tables.match_section || tables.defined)
+              keep = vandq_u8(keep, vcombine_u8(vmovn_u16(section_mask_neon(shndx + i, tables)), vmovn_u16(section_mask_neon(shndx + i + 8, tables))));
+            /*
+             * Narrowing by 4 leaves a nibble per byte, keep one bit of each
+             */
+            std::uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(keep), 4)), 0) & 0x8888888888888888ull;
+            for (; mask != 0; mask &= mask - 1)
+              out.push_back(base + static_cast<std::uint32_t>(i) + static_cast<std::uint32_t>(std::countr_zero(mask) / 4));
+          }
+          filter_symbols_scalar(info + i, shndx + i, count - i, tables, base + static_cast<std::uint32_t>(i), out);
+        }
+#endif
+
+        /*
+         * Append base + i for every symbol i of count the filter keeps
+         */
+        inline void filter_symbols(const ::elf::byte *info, const std::uint16_t *shndx, std::size_t count, const ::elf::symbol_filter &filter,
+                                   std::uint32_t base, std::vector<std::uint32_t> &out, simd_level level)
+        {
+          const symbol_filter_tables tables = make_symbol_filter_tables(filter);
+          switch (level)
+          {
+#if defined(ELF_HPP_X86_SIMD)
+            case simd_level::avx2:
+              return filter_symbols_avx2(info, shndx, count, tables, base, out);
+            case simd_level::sse4_2:
+              return filter_symbols_sse4_2(info, shndx, count, tables, base, out);
+#endif
+#if defined(ELF_HPP_NEON)
+            case simd_level::neon:
+              return filter_symbols_neon(info, shndx, count, tables, base, out);
+#endif
+            default:
+              return filter_symbols_scalar(info, shndx, count, tables, base, out);
+          }
+        }
+    }
+
+    /*
+     * The symbols of any number of files stored as columns rather than as
+     * elf_symbol entries, for indexes too large to keep every file open.
+     * Names are copied into one pool and referred to by offset, alongside
+     * their GNU hash, so a symbol costs 28 bytes plus its name where an
+     * elf_symbol costs 40 plus the string table it points into. Scans only
+     * touch the columns they need, and filter tests many symbols at once
+     * with SIMD. Holds up to 2^32 - 1 symbols and name bytes
+     */
+    class symbol_store
+    {
+    public:
+        inline static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+        /*
+         * Append the symbols of one file, such as its get_dynamic_symbols.
+         * Returns the index of the file in the store, or npos without
+         * adding anything if the store would grow past its limits
+         */
+        std::size_t add(std::span<const ::elf::elf_symbol> symbols)
+        {
+          std::size_t name_bytes = 0;
+          for (const auto &symbol: symbols)
+          {
+            name_bytes += symbol.st_name_length == 0 ? 0 : symbol.st_name_length + 1;
+          }
+          constexpr std::size_t limit = std::numeric_limits<std::uint32_t>::max();
+          if (symbols.size() > limit - this->size() || name_bytes > limit - this->names.size())
+          {
+            return npos;
+          }
+
+          const std::size_t count = this->size() + symbols.size();
+          if (count > this->values.capacity() || this->names.size() + name_bytes > this->names.capacity())
+          {
+            this->reserve(std::max(count, this->values.capacity() * 2), std::max(this->names.size() + name_bytes, this->names.capacity() * 2));
+          }
+          for (const auto &symbol: symbols)
+          {
+            const std::string_view name = symbol.get_name();
+            if (name.empty())
+            {
+              this->name_offsets.push_back(0);
+            } else
+            {
+              this->name_offsets.push_back(static_cast<std::uint32_t>(this->names.size()));
+              this->names.insert(this->names.end(), name.begin(), name.end());
+              this->names.push_back('\0');
+            }
+            this->name_hashes.push_back(static_cast<std::uint32_t>(gnu_hash(name.data(), name.size())));
+            this->infos.push_back(symbol.st_info);
+            this->others.push_back(symbol.st_other);
+            this->section_indices.push_back(symbol.st_shndx);
+            this->values.push_back(symbol.st_value);
+            this->sizes.push_back(symbol.st_size);
+          }
+          this->file_offsets.push_back(static_cast<std::uint32_t>(count));
+          return this->file_offsets.size() - 2;
+        }
+
+        /*
+         * Make room for a total of symbols symbols and name_bytes bytes of
+         * names, counting a nul after each
+         */
+        void reserve(std::size_t symbols, std::size_t name_bytes)
+        {
+          this->name_offsets.reserve(symbols);
+          this->name_hashes.reserve(symbols);
+          this->infos.reserve(symbols);
+          this->others.reserve(symbols);
+          this->section_indices.reserve(symbols);
+          this->values.reserve(symbols);
+          this->sizes.reserve(symbols);
+          this->names.reserve(name_bytes);
+        }
+
+        /*
+         * Release the room add left for more symbols
+         */
+        void shrink_to_fit()
+        {
+          this->name_offsets.shrink_to_fit();
+          this->name_hashes.shrink_to_fit();
+          this->infos.shrink_to_fit();
+          this->others.shrink_to_fit();
+          this->section_indices.shrink_to_fit();
+          this->values.shrink_to_fit();
+          this->sizes.shrink_to_fit();
+          this->names.shrink_to_fit();
+          this->file_offsets.shrink_to_fit();
+        }
+
+        /*
+         * Remove every file and symbol
+         */
+        void clear()
+        {
+          *this = symbol_store();
+        }
+
+        std::size_t size() const
+        {
+          return this->values.size();
+        }
+
+        bool empty() const
+        {
+          return this->values.empty();
+        }
+
+        std::size_t file_count() const
+        {
+          return this->file_offsets.size() - 1;
+        }
+
+        /*
+         * Get the index of a file's first symbol, and one past its last
+         */
+        std::size_t file_begin(std::size_t file) const
+        {
+          return this->file_offsets.at(file);
+        }
+
+        std::size_t file_end(std::size_t file) const
+        {
+          return this->file_offsets.at(file + 1);
+        }
+
+        /*
+         * Get the file a symbol was added with
+         */
+        std::size_t file_of(std::size_t index) const
+        {
+          return static_cast<std::size_t>(std::upper_bound(this->file_offsets.begin(), this->file_offsets.end(), index) - this->file_offsets.begin()) - 1;
+        }
+
+        std::string_view get_name(std::size_t index) const
+        {
+          return this->names.data() + this->name_offsets[index];
+        }
+
+        /*
+         * Get a symbol as an elf_symbol naming it from the pool. st_name
+         * isn't kept and is 0
+         */
+        ::elf::elf_symbol get_symbol(std::size_t index) const
+        {
+          const std::string_view name = this->get_name(index);
+          ::elf::elf_symbol symbol{};
+          symbol.st_name_hash = this->name_hashes[index];
+          symbol.st_value = this->values[index];
+          symbol.st_size = this->sizes[index];
+          symbol.st_info = this->infos[index];
+          symbol.st_other = this->others[index];
+          symbol.st_shndx = this->section_indices[index];
+          symbol.st_name_length = static_cast<std::uint32_t>(name.size());
+          symbol.st_name_str = name.data();
+          return symbol;
+        }
+
+        /*
+         * The columns, indexed like the store
+         */
+        std::span<const std::uint32_t> get_name_offsets() const
+        {
+          return this->name_offsets;
+        }
+
+        std::span<const std::uint32_t> get_name_hashes() const
+        {
+          return this->name_hashes;
+        }
+
+        std::span<const ::elf::byte> get_infos() const
+        {
+          return this->infos;
+        }
+
+        std::span<const ::elf::byte> get_others() const
+        {
+          return this->others;
+        }
+
+        std::span<const std::uint16_t> get_section_indices() const
+        {
+          return this->section_indices;
+        }
+
+        std::span<const std::uint64_t> get_values() const
+        {
+          return this->values;
+        }
+
+        std::span<const std::uint64_t> get_sizes() const
+        {
+          return this->sizes;
+        }
+
+        /*
+         * The pool names are offsets into, each ending in a nul
+         */
+        std::span<const char> get_names() const
+        {
+          return this->names;
+        }
+
+        /*
+         * Find the first symbol of a file with a name, or npos. Scans the
+         * file's hashes and only compares names whose hash matches
+         */
+        std::size_t find(std::size_t file, std::string_view name) const
+        {
+          const auto hash = static_cast<std::uint32_t>(gnu_hash(name.data(), name.size()));
+          for (std::size_t i = this->file_begin(file), end = this->file_end(file); i < end; i++)
+          {
+            if (this->name_hashes[i] == hash && this->get_name(i) == name)
+            {
+              return i;
+            }
+          }
+          return npos;
+        }
+
+        /*
+         * Append the index of every symbol in [begin, end) the filter keeps
+         * to out, in order. Returns how many were appended
+         */
+        std::size_t filter(const ::elf::symbol_filter &filter, std::vector<std::uint32_t> &out, std::size_t begin = 0, std::size_t end = npos) const
+        {
+          end = std::min(end, this->size());
+          if (begin >= end)
+          {
+            return 0;
+          }
+          const std::size_t appended = out.size();
+          ::elf::detail::filter_symbols(this->infos.data() + begin, this->section_indices.data() + begin, end - begin, filter,
+                                        static_cast<std::uint32_t>(begin), out, ::elf::detail::get_simd_level());
+          return out.size() - appended;
+        }
+
+        /*
+         * Get the bytes the columns and names have allocated
+         */
+        std::size_t memory_usage() const
+        {
+          return this->name_offsets.capacity() * sizeof(std::uint32_t) + this->name_hashes.capacity() * sizeof(std::uint32_t) +
+                 this->infos.capacity() + this->others.capacity() + this->section_indices.capacity() * sizeof(std::uint16_t) +
+                 this->values.capacity() * sizeof(std::uint64_t) + this->sizes.capacity() * sizeof(std::uint64_t) + this->names.capacity() +
+                 this->file_offsets.capacity() * sizeof(std::uint32_t);
+        }
+
+    private:
+        std::vector<std::uint32_t> name_offsets;
+        std::vector<std::uint32_t> name_hashes;
+        std::vector<::elf::byte> infos;
+        std::vector<::elf::byte> others;
+        std::vector<std::uint16_t> section_indices;
+        std::vector<std::uint64_t> values;
+        std::vector<std::uint64_t> sizes;
+
+        /*
+         * Offset 0 is the empty name every unnamed symbol shares
+         */
+        std::vector<char> names = std::vector<char>(1, '\0');
+
+        /*
+         * Index of each file's first symbol, then the symbol count
+         */
+        std::vector<std::uint32_t> file_offsets = std::vector<std::uint32_t>(1, 0);
+    };
+
+#if defined(ELF_HPP_POSIX)
+    namespace detail
+    {
+        /*
+         * Add delta to count words in place, the inner loop of DT_RELR runs
+         */
+        template<typename Word>
+        inline void add_to_words_scalar(Word *words, std::size_t count, Word delta)
+        {
+          for (std::size_t i = 0; i < count; i++)
+            words[i] += delta;
+        }
+
+#if defined(ELF_HPP_X86_SIMD)
+        template<typename Word>
+        __attribute__((target("avx2")))
+        inline void add_to_words_avx2(Word *words, std::size_t count, Word delta)
+        {
+          constexpr std::size_t lanes = 32 / sizeof(Word);
+          const __m256i deltas = sizeof(Word) == 8 ? _mm256_set1_epi64x(static_cast<long long>(delta)) : _mm256_set1_epi32(static_cast<int>(delta));
+          std::size_t i = 0;
+          for (; i + lanes <= count; i += lanes)
+          {
+            auto *p = reinterpret_cast<__m256i *>(words + i);
+            const __m256i loaded = _mm256_loadu_si256(p);
+            _mm256_storeu_si256(p, sizeof(Word) == 8 ? _mm256_add_epi64(loaded, deltas) : _mm256_add_epi32(loaded, deltas));
+          }
+          add_to_words_scalar(words + i, count - i, delta);
+        }
+#endif
+
+#if defined(ELF_HPP_NEON)
+        template<typename Word>
+        inline void add_to_words_neon(Word *words, std::size_t count, Word delta)
+        {
+          std::size_t i = 0;
+          if constexpr (sizeof(Word) == 8)
+          {
+            const uint64x2_t deltas = vdupq_n_u64(delta);
+            for (; i + 2 <= count; i += 2)
+              vst1q_u64(reinterpret_cast<std::uint64_t *>(words + i), vaddq_u64(vld1q_u64(reinterpret_cast<const std::uint64_t *>(words + i)), deltas));
+          } else
+          {
+            const uint32x4_t deltas = vdupq_n_u32(delta);
+            for (; i + 4 <= count; i += 4)
+              vst1q_u32(reinterpret_cast<std::uint32_t *>(words + i), vaddq_u32(vld1q_u32(reinterpret_cast<const std::uint32_t *>(words + i)), deltas));
+          }
+          add_to_words_scalar(words + i, count - i, delta);
+        }
+#endif
+
+        template<typename Word>
+        inline void add_to_words(Word *words, std::size_t count, Word delta, simd_level level)
+        {
+          switch (level)
+          {
+#if defined(ELF_HPP_X86_SIMD)
+            case simd_level::avx2:
+              return add_to_words_avx2(words, count, delta);
+#endif
+#if defined(ELF_HPP_NEON)
+            case simd_level::neon:
+              return add_to_words_neon(words, count, delta);
+#endif
+            default:
+              return add_to_words_scalar(words, count, delta);
+          }
+        }
+    }
+
+    typedef struct image_options
+    {
+        /*
+         * Address the page of the lowest PT_LOAD segment is mapped at, 0 to
+         * let the kernel choose. Executables that aren't position
+         * independent can only be mapped at their own addresses
+         */
+        std::uint64_t base = 0;
+        bool relocate = true;           /* Apply relocations, otherwise the segments are only mapped */
+        /*
+         * Leave relocations image can't apply, such as TLS, COPY and IFUNC
+         * ones, instead of failing. They are counted by get_skipped_count
+         */
+        bool skip_unsupported = false;
+        /*
+         * Gives the run-time address of a symbol a relocation refers to,
+         * returning false when it has none. When empty, symbols defined in
+         * the file resolve to their rebased value and others are looked up
+         * with get_symbol. Unresolved weak symbols are 0
+         */
+        std::function<bool(const ::elf::elf_symbol &symbol, std::uint64_t &address)> resolver;
+    } image_options;
+
+    /*
+     * The PT_LOAD segments of an elf_file mapped into this process with
+     * their protections, and optionally relocated like ld.so would, for
+     * sandboxed loading and snapshotting. Nothing in the image is run.
+     * Relocations are read from the mapped segments the way ld.so reads
+     * them: relative ones in a tight loop over each table and DT_RELR
+     * bitmaps as runs of words updated with SIMD, symbolic ones resolved
+     * once per symbol. Writable while being relocated, the segments get
+     * their own protections afterwards and PT_GNU_RELRO becomes read-only.
+     * Relocations are applied for i386 and x86-64
+     */
+    class image
+    {
+    public:
+        image() = default;
+
+        /*
+         * Map a file's segments from its path. The file's dynamic segment
+         * must be parsed, or the file loaded lazily
+         */
+        explicit image(const ::elf::elf_file &file, const ::elf::image_options &options = {})
+        {
+          const int fd = ::open(file.get_path().c_str(), O_RDONLY | O_CLOEXEC);
+          if (fd < 0)
+          {
+            this->last_error = "Failed to open file";
+            return;
+          }
+          this->load(file, fd, {}, options);
+          ::close(fd);
+        }
+
+        /*
+         * Map a file's segments by copying them from its contents, for files
+         * parsed from memory
+         */
+        image(const ::elf::elf_file &file, std::span<const std::byte> contents, const ::elf::image_options &options = {})
+        {
+          this->load(file, -1, contents, options);
+        }
+
+        ~image()
+        {
+          this->unmap();
+        }
+
+        image(const image &copy) = delete;
+        image &operator=(const image &copy) = delete;
+
+        image(image &&move) noexcept
+        {
+          *this = std::move(move);
+        }
+
+        image &operator=(image &&move) noexcept
+        {
+          if (this != &move)
+          {
+            this->unmap();
+            this->mapping = std::exchange(move.mapping, nullptr);
+            this->mapping_size = std::exchange(move.mapping_size, 0);
+            this->load_bias = std::exchange(move.load_bias, 0);
+            this->lowest_address = std::exchange(move.lowest_address, 0);
+            this->relocation_count = std::exchange(move.relocation_count, 0);
+            this->skipped_count = std::exchange(move.skipped_count, 0);
+            this->init_functions = std::move(move.init_functions);
+            this->fini_functions = std::move(move.fini_functions);
+            this->last_error = std::move(move.last_error);
+          }
+          return *this;
+        }
+
+        /*
+         * Check if an error occurred
+         */
+        bool error() const
+        {
+          return !this->last_error.empty();
+        }
+
+        /*
+         * Get a message for the last error that occurred
+         */
+        const std::string &error_message() const
+        {
+          return this->last_error;
+        }
+
+        /*
+         * Clear the current error
+         */
+        void clear_error()
+        {
+          this->last_error = "";
+        }
+
+        bool is_mapped() const
+        {
+          return this->mapping != nullptr;
+        }
+
+        /*
+         * Release the mapping. Any pointers into it become invalid
+         */
+        void unmap()
+        {
+          if (this->mapping != nullptr)
+          {
+            ::munmap(this->mapping, this->mapping_size);
+          }
+          this->mapping = nullptr;
+          this->mapping_size = 0;
+          this->init_functions.clear();
+          this->fini_functions.clear();
+        }
+
+        /*
+         * Get the whole mapping, from the page of the lowest segment to the
+         * end of the highest
+         */
+        std::span<std::byte> data() const
+        {
+          return {static_cast<std::byte *>(this->mapping), this->mapping_size};
+        }
+
+        /*
+         * Get what was added to every virtual address of the file, so a
+         * symbol's run-time address is get_load_bias() + st_value
+         */
+        std::uint64_t get_load_bias() const
+        {
+          return this->load_bias;
+        }
+
+        /*
+         * Get a pointer to a virtual address of the file, or nullptr if it
+         * isn't in the image
+         */
+        void *get_address(std::uint64_t virtual_address) const
+        {
+          const std::uint64_t offset = virtual_address - this->lowest_address;
+          return this->mapping != nullptr && virtual_address >= this->lowest_address && offset < this->mapping_size
+                 ? static_cast<std::byte *>(this->mapping) + offset : nullptr;
+        }
+
+        /*
+         * Get the run-time addresses of the initialization functions, in
+         * the order of get_init_functions. Relocated images read DT_INIT
+         * and the arrays from the mapped segments, otherwise the file's
+         * addresses are rebased
+         */
+        std::span<const std::uint64_t> get_init_functions() const
+        {
+          return this->init_functions;
+        }
+
+        /*
+         * Get the run-time addresses of the termination functions, in the
+         * order of get_fini_functions
+         */
+        std::span<const std::uint64_t> get_fini_functions() const
+        {
+          return this->fini_functions;
+        }
+
+        /*
+         * Get how many relocations were applied
+         */
+        std::size_t get_relocation_count() const
+        {
+          return this->relocation_count;
+        }
+
+        /*
+         * Get how many relocations were left with skip_unsupported
+         */
+        std::size_t get_skipped_count() const
+        {
+          return this->skipped_count;
+        }
+
+    private:
+        void *mapping = nullptr;
+        std::size_t mapping_size = 0;
+        std::uint64_t load_bias = 0;
+        std::uint64_t lowest_address = 0;  /* Virtual address of the start of the mapping */
+        std::size_t relocation_count = 0;
+        std::size_t skipped_count = 0;
+        std::vector<std::uint64_t> init_functions;
+        std::vector<std::uint64_t> fini_functions;
+        std::string last_error;
+
+        /*
+         * What a relocation type does on the file's machine, with S the
+         * symbol's address, A the addend and B the load bias
+         */
+        enum class relocation_action
+        {
+            none,
+            relative,  /* B + A */
+            absolute,  /* S + A */
+            symbol,    /* S */
+            unsupported,
+        };
+
+        /*
+         * The parts of the dynamic segment relocating needs
+         */
+        typedef struct dynamic_tables
+        {
+            std::uint64_t rel = 0, rel_size = 0;
+            std::uint64_t rela = 0, rela_size = 0;
+            std::uint64_t jmprel = 0, jmprel_size = 0;
+            bool jmprel_addend = false;
+            std::uint64_t relr = 0, relr_size = 0;
+            std::uint64_t init = 0, fini = 0;
+            std::uint64_t preinit_array = 0, preinit_array_size = 0;
+            std::uint64_t init_array = 0, init_array_size = 0;
+            std::uint64_t fini_array = 0, fini_array_size = 0;
+        } dynamic_tables;
+
+        /*
+         * A mapped segment and the protection it ends up with
+         */
+        typedef struct segment_protection
+        {
+            std::uint64_t start;
+            std::uint64_t size;
+            int protection;
+        } segment_protection;
+
+        /*
+         * Symbol addresses already resolved, indexed by symbol
+         */
+        typedef struct symbol_cache
+        {
+            std::vector<std::uint64_t> addresses;
+            std::vector<std::uint8_t> states;  /* 0 unresolved yet, 1 resolved, 2 unsupported */
+        } symbol_cache;
+
+        static relocation_action get_action(std::uint16_t machine, std::uint32_t type)
+        {
+          if (machine == ::elf::elf_header::EM_X86_64)
+          {
+            switch (type)
+            {
+              case ::elf::elf_rel::R_X86_64_NONE:
+                return relocation_action::none;
+              case ::elf::elf_rel::R_X86_64_RELATIVE:
+                return relocation_action::relative;
+              case ::elf::elf_rel::R_X86_64_64:
+                return relocation_action::absolute;
+              case ::elf::elf_rel::R_X86_64_GLOB_DAT:
+              case ::elf::elf_rel::R_X86_64_JUMP_SLOT:
+                return relocation_action::symbol;
+              default:
+                return relocation_action::unsupported;
+            }
+          }
+          if (machine == ::elf::elf_header::EM_386)
+          {
+            switch (type)
+            {
+              case ::elf::elf_rel::R_386_NONE:
+                return relocation_action::none;
+              case ::elf::elf_rel::R_386_RELATIVE:
+                return relocation_action::relative;
+              case ::elf::elf_rel::R_386_32:
+                return relocation_action::absolute;
+              case ::elf::elf_rel::R_386_GLOB_DAT:
+              case ::elf::elf_rel::R_386_JUMP_SLOT:
+                return relocation_action::symbol;
+              default:
+                return relocation_action::unsupported;
+            }
+          }
+          return relocation_action::unsupported;
+        }
+
+        static int get_protection(std::uint32_t flags)
+        {
+          return (flags & ::elf::elf_program_header::PF_R ? PROT_READ : 0) | (flags & ::elf::elf_program_header::PF_W ? PROT_WRITE : 0) |
+                 (flags & ::elf::elf_program_header::PF_X ? PROT_EXEC : 0);
+        }
+
+        /*
+         * Get size bytes at a virtual address of the file, or nullptr if
+         * they aren't all in the image
+         */
+        std::byte *get_range(std::uint64_t virtual_address, std::uint64_t size) const
+        {
+          const std::uint64_t offset = virtual_address - this->lowest_address;
+          if (virtual_address < this->lowest_address || offset > this->mapping_size || size > this->mapping_size - offset)
+          {
+            return nullptr;
+          }
+          return static_cast<std::byte *>(this->mapping) + offset;
+        }
+
+        bool load(const ::elf::elf_file &file, int fd, std::span<const std::byte> contents, const ::elf::image_options &options)
+        {
+          if (file.error())
+          {
+            this->last_error = "File has an error: " + file.error_message();
+            return false;
+          }
+          std::vector<segment_protection> segments;
+          if (!this->map_segments(file, fd, contents, options, segments))
+          {
+            this->unmap();
+            return false;
+          }
+
+          const auto &program_headers = file.get_program_headers();
+          const bool dynamic = std::any_of(program_headers.begin(), program_headers.end(), [](const ::elf::elf_program_header &program_header) {
+              return program_header.p_type == ::elf::elf_program_header::PT_DYNAMIC;
+          });
+          if (dynamic && options.relocate && file.get_dynamic_entries().empty())
+          {
+            this->last_error = "Dynamic segment is not parsed";
+            this->unmap();
+            return false;
+          }
+
+          dynamic_tables tables;
+          for (const auto &entry: file.get_dynamic_entries())
+          {
+            const std::uint64_t value = entry.d_un.d_val;
+            switch (entry.d_tag)
+            {
+              case ::elf::elf_dynamic::DT_REL: tables.rel = value; break;
+              case ::elf::elf_dynamic::DT_RELSZ: tables.rel_size = value; break;
+              case ::elf::elf_dynamic::DT_RELA: tables.rela = value; break;
+              case ::elf::elf_dynamic::DT_RELASZ: tables.rela_size = value; break;
+              case ::elf::elf_dynamic::DT_JMPREL: tables.jmprel = value; break;
+              case ::elf::elf_dynamic::DT_PLTRELSZ: tables.jmprel_size = value; break;
+              case ::elf::elf_dynamic::DT_PLTREL: tables.jmprel_addend = value == ::elf::elf_dynamic::DT_RELA; break;
+              case ::elf::elf_dynamic::DT_RELR: tables.relr = value; break;
+              case ::elf::elf_dynamic::DT_RELRSZ: tables.relr_size = value; break;
+              case ::elf::elf_dynamic::DT_INIT: tables.init = value; break;
+              case ::elf::elf_dynamic::DT_FINI: tables.fini = value; break;
+              case ::elf::elf_dynamic::DT_PREINIT_ARRAY: tables.preinit_array = value; break;
+              case ::elf::elf_dynamic::DT_PREINIT_ARRAYSZ: tables.preinit_array_size = value; break;
+              case ::elf::elf_dynamic::DT_INIT_ARRAY: tables.init_array = value; break;
+              case ::elf::elf_dynamic::DT_INIT_ARRAYSZ: tables.init_array_size = value; break;
+              case ::elf::elf_dynamic::DT_FINI_ARRAY: tables.fini_array = value; break;
+              case ::elf::elf_dynamic::DT_FINI_ARRAYSZ: tables.fini_array_size = value; break;
+              default: break;
+            }
+          }
+
+          const bool loaded = this->visit_layout(file, [&](auto layout) {
+              using Layout = decltype(layout);
+              if (options.relocate && !this->relocate<Layout>(file, tables, options))
+              {
+                return false;
+              }
+              for (const auto &segment: segments)
+              {
+                if (::mprotect(this->get_range(segment.start, 0), segment.size, segment.protection) != 0)
+                {
+                  this->last_error = "Failed to protect segment";
+                  return false;
+                }
+              }
+              this->protect_relro(file);
+              return this->find_functions<Layout>(file, tables, options.relocate);
+          });
+          if (!loaded)
+          {
+            this->unmap();
+          }
+          return loaded;
+        }
+
+        template<typename Visitor>
+        bool visit_layout(const ::elf::elf_file &file, Visitor &&visitor)
+        {
+          if (file.is_64_bit())
+          {
+            return file.is_big_endian() ? visitor(::elf::elf_layout<::elf::elf_ident::ELFCLASS64, std::endian::big>{})
+                                        : visitor(::elf::elf_layout<::elf::elf_ident::ELFCLASS64, std::endian::little>{});
+          }
+          if (file.is_32_bit())
+          {
+            return file.is_big_endian() ? visitor(::elf::elf_layout<::elf::elf_ident::ELFCLASS32, std::endian::big>{})
+                                        : visitor(::elf::elf_layout<::elf::elf_ident::ELFCLASS32, std::endian::little>{});
+          }
+          this->last_error = "Invalid ELF class";
+          return false;
+        }
+
+        /*
+         * Reserve the whole range the segments cover, then map each one
+         * over it writable. Pages past a segment's file contents are the
+         * zeroed pages of the reservation
+         */
+        bool map_segments(const ::elf::elf_file &file, int fd, std::span<const std::byte> contents, const ::elf::image_options &options,
+                          std::vector<segment_protection> &segments)
+        {
+          const auto page_size = static_cast<std::uint64_t>(::sysconf(_SC_PAGESIZE));
+          const auto page_floor = [page_size](std::uint64_t value) { return value & ~(page_size - 1); };
+          const auto page_ceil = [page_size](std::uint64_t value) { return (value + page_size - 1) & ~(page_size - 1); };
+
+          std::uint64_t lowest = std::numeric_limits<std::uint64_t>::max(), highest = 0, alignment = page_size;
+          for (const auto &program_header: file.get_program_headers())
+          {
+            if (program_header.p_type != ::elf::elf_program_header::PT_LOAD || program_header.p_memsz == 0)
+            {
+              continue;
+            }
+            if (program_header.p_filesz > program_header.p_memsz || program_header.p_vaddr + program_header.p_memsz < program_header.p_vaddr ||
+                (program_header.p_vaddr - program_header.p_offset) % page_size != 0)
+            {
+              this->last_error = "Invalid loadable segment";
+              return false;
+            }
+            lowest = std::min(lowest, page_floor(program_header.p_vaddr));
+            highest = std::max(highest, page_ceil(program_header.p_vaddr + program_header.p_memsz));
+            if (std::has_single_bit(program_header.p_align))
+            {
+              alignment = std::max(alignment, program_header.p_align);
+            }
+          }
+          if (highest == 0)
+          {
+            this->last_error = "No loadable segments";
+            return false;
+          }
+          const bool position_independent = file.get_header().e_type == ::elf::elf_header::ET_DYN;
+          if (options.base % page_size != 0 || (!position_independent && options.base != 0 && options.base != lowest))
+          {
+            this->last_error = position_independent ? "Base address is not page aligned" : "Executables can only be mapped at their own address";
+            return false;
+          }
+
+          /*
+           * Reserve
+           */
+          const std::uint64_t size = highest - lowest;
+          std::uint64_t start = position_independent ? options.base : lowest;
+          if (start != 0)
+          {
+            int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#if defined(MAP_FIXED_NOREPLACE)
+            flags |= MAP_FIXED_NOREPLACE;
+#endif
+            void *address = ::mmap(reinterpret_cast<void *>(start), size, PROT_NONE, flags, -1, 0);
+            if (address == MAP_FAILED || address != reinterpret_cast<void *>(start))
+            {
+              if (address != MAP_FAILED)
+              {
+                ::munmap(address, size);
+              }
+              this->last_error = "Failed to map the image at its base address";
+              return false;
+            }
+            this->mapping = address;
+          } else
+          {
+            /*
+             * Over-reserve so the start can honour the largest segment
+             * alignment, then give back both ends
+             */
+            const std::uint64_t reserved = size + alignment - page_size;
+            void *address = ::mmap(nullptr, reserved, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (address == MAP_FAILED)
+            {
+              this->last_error = "Failed to reserve memory for the image";
+              return false;
+            }
+            const auto reserved_start = reinterpret_cast<std::uint64_t>(address);
+            start = (reserved_start + alignment - 1) & ~(alignment - 1);
+            if (start != reserved_start)
+            {
+              ::munmap(address, start - reserved_start);
+            }
+            if (reserved_start + reserved != start + size)
+            {
+              ::munmap(reinterpret_cast<void *>(start + size), reserved_start + reserved - (start + size));
+            }
+            this->mapping = reinterpret_cast<void *>(start);
+          }
+          this->mapping_size = size;
+          this->lowest_address = lowest;
+          this->load_bias = start - lowest;
+
+          /*
+           * Map each segment
+           */
+          for (const auto &program_header: file.get_program_headers())
+          {
+            if (program_header.p_type != ::elf::elf_program_header::PT_LOAD || program_header.p_memsz == 0)
+            {
+              continue;
+            }
+            const std::uint64_t segment_start = page_floor(program_header.p_vaddr);
+            const std::uint64_t file_end = program_header.p_vaddr + program_header.p_filesz;
+            const std::uint64_t segment_end = page_ceil(program_header.p_vaddr + program_header.p_memsz);
+            const int protection = get_protection(program_header.p_flags);
+            std::byte *address = this->get_range(segment_start, segment_end - segment_start);
+            if (::mprotect(address, segment_end - segment_start, PROT_READ | PROT_WRITE) != 0)
+            {
+              this->last_error = "Failed to map segment";
+              return false;
+            }
+            if (program_header.p_filesz != 0)
+            {
+              const std::uint64_t file_offset = page_floor(program_header.p_offset);
+              const std::uint64_t length = page_ceil(file_end) - segment_start;
+              if (fd >= 0)
+              {
+                if (::mmap(address, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, static_cast<off_t>(file_offset)) == MAP_FAILED)
+                {
+                  this->last_error = "Failed to map segment";
+                  return false;
+                }
+              } else
+              {
+                if (program_header.p_offset > contents.size() || program_header.p_filesz > contents.size() - program_header.p_offset)
+                {
+                  this->last_error = "Segment is outside the file";
+                  return false;
+                }
+                std::memcpy(address, contents.data() + file_offset, std::min<std::uint64_t>(length, contents.size() - file_offset));
+              }
+
+              /*
+               * The rest of the page holding the end of the file contents is
+               * the start of the zero-filled part
+               */
+              if (program_header.p_memsz > program_header.p_filesz)
+              {
+                std::memset(this->get_range(file_end, 0), 0, std::min(page_ceil(file_end), segment_end) - file_end);
+              }
+            }
+            segments.push_back({segment_start, segment_end - segment_start, protection});
+          }
+          return true;
+        }
+
+        void protect_relro(const ::elf::elf_file &file)
+        {
+          const auto page_size = static_cast<std::uint64_t>(::sysconf(_SC_PAGESIZE));
+          for (const auto &program_header: file.get_program_headers())
+          {
+            if (program_header.p_type != ::elf::elf_program_header::PT_GNU_RELRO)
+            {
+              continue;
+            }
+            const std::uint64_t start = program_header.p_vaddr & ~(page_size - 1);
+            const std::uint64_t end = (program_header.p_vaddr + program_header.p_memsz) & ~(page_size - 1);
+            std::byte *address = this->get_range(start, end > start ? end - start : 0);
+            if (address != nullptr && end > start)
+            {
+              ::mprotect(address, end - start, PROT_READ);
+            }
+          }
+        }
+
+        template<typename Layout>
+        bool relocate(const ::elf::elf_file &file, const dynamic_tables &tables, const ::elf::image_options &options)
+        {
+          symbol_cache cache;
+          if (tables.relr_size != 0 && !this->apply_relr<Layout>(tables.relr, tables.relr_size))
+          {
+            return false;
+          }
+          if (tables.rela_size != 0 && !this->apply_table<Layout, true>(file, tables.rela, tables.rela_size, cache, options))
+          {
+            return false;
+          }
+          if (tables.rel_size != 0 && !this->apply_table<Layout, false>(file, tables.rel, tables.rel_size, cache, options))
+          {
+            return false;
+          }
+          if (tables.jmprel_size != 0 && !(tables.jmprel_addend ? this->apply_table<Layout, true>(file, tables.jmprel, tables.jmprel_size, cache, options)
+                                                                : this->apply_table<Layout, false>(file, tables.jmprel, tables.jmprel_size, cache, options)))
+          {
+            return false;
+          }
+          return true;
+        }
+
+        /*
+         * Apply DT_RELR. An even word is an address to relocate and an odd
+         * one a bitmap of the words after it, whose runs of set bits are
+         * each one call to add_to_words
+         */
+        template<typename Layout>
+        bool apply_relr(std::uint64_t table_address, std::uint64_t table_size)
+        {
+          using Addr = typename Layout::Addr;
+          constexpr std::uint64_t word_size = sizeof(Addr);
+          const std::byte *table = this->get_range(table_address, table_size);
+          if (table == nullptr || table_size % word_size != 0)
+          {
+            this->last_error = "Invalid relative relocation table";
+            return false;
+          }
+          const auto bias = static_cast<Addr>(this->load_bias);
+          const ::elf::detail::simd_level level = ::elf::detail::get_simd_level();
+          const auto relocate_words = [&](std::uint64_t address, std::size_t count) {
+              std::byte *words = this->get_range(address, count * word_size);
+              if (words == nullptr)
+              {
+                this->last_error = "Relocation is outside the image";
+                return false;
+              }
+              if constexpr (Layout::is_native)
+              {
+                if (reinterpret_cast<std::uintptr_t>(words) % alignof(Addr) == 0)
+                {
+                  ::elf::detail::add_to_words(reinterpret_cast<Addr *>(words), count, bias, level);
+                  this->relocation_count += count;
+                  return true;
+                }
+              }
+              for (std::size_t i = 0; i < count; i++)
+              {
+                Addr word;
+                std::memcpy(&word, words + i * word_size, word_size);
+                word = Layout::get(static_cast<Addr>(Layout::get(word) + bias));
+                std::memcpy(words + i * word_size, &word, word_size);
+              }
+              this->relocation_count += count;
+              return true;
+          };
+
+          std::uint64_t base = 0;
+          for (std::uint64_t position = 0; position < table_size; position += word_size)
+          {
+            Addr raw_word;
+            std::memcpy(&raw_word, table + position, word_size);
+            const std::uint64_t word = Layout::get(raw_word);
+            if ((word & 1) == 0)
+            {
+              if (!relocate_words(word, 1))
+              {
+                return false;
+              }
+              base = word + word_size;
+              continue;
+            }
+            for (std::uint64_t bitmap = word >> 1; bitmap != 0;)
+            {
+              const int first = std::countr_zero(bitmap);
+              const int run = std::countr_one(bitmap >> first);
+              if (!relocate_words(base + static_cast<std::uint64_t>(first) * word_size, static_cast<std::size_t>(run)))
+              {
+                return false;
+              }
+              bitmap = run + first >= 64 ? 0 : bitmap & ~((std::uint64_t{1} << (first + run)) - 1);
+            }
+            base += (word_size * 8 - 1) * word_size;
+          }
+          return true;
+        }
+
+        /*
+         * Apply a DT_REL, DT_RELA or DT_JMPREL table. Relative entries, most
+         * of any table, take the first branch
+         */
+        template<typename Layout, bool Addend>
+        bool apply_table(const ::elf::elf_file &file, std::uint64_t table_address, std::uint64_t table_size, symbol_cache &cache,
+                         const ::elf::image_options &options)
+        {
+          using Addr = typename Layout::Addr;
+          using Real = std::conditional_t<Addend, typename Layout::Rela, typename Layout::Rel>;
+          const std::byte *table = this->get_range(table_address, table_size);
+          if (table == nullptr || table_size % sizeof(Real) != 0)
+          {
+            this->last_error = "Invalid relocation table";
+            return false;
+          }
+          const std::uint16_t machine = file.get_header().e_machine;
+          const std::uint32_t relative_type = machine == ::elf::elf_header::EM_386 ? ::elf::elf_rel::R_386_RELATIVE : ::elf::elf_rel::R_X86_64_RELATIVE;
+          const bool relative_supported = machine == ::elf::elf_header::EM_386 || machine == ::elf::elf_header::EM_X86_64;
+          const auto bias = static_cast<Addr>(this->load_bias);
+
+          for (std::uint64_t position = 0; position < table_size; position += sizeof(Real))
+          {
+            Real relocation;
+            std::memcpy(&relocation, table + position, sizeof(Real));
+            const auto info = Layout::get(relocation.r_info);
+            const std::uint32_t type = Layout::r_type(info);
+            std::byte *target = this->get_range(Layout::get(relocation.r_offset), sizeof(Addr));
+            if (target == nullptr)
+            {
+              this->last_error = "Relocation is outside the image";
+              return false;
+            }
+            Addr addend;
+            if constexpr (Addend)
+            {
+              addend = static_cast<Addr>(Layout::get(relocation.r_addend));
+            } else
+            {
+              std::memcpy(&addend, target, sizeof(Addr));
+              addend = Layout::get(addend);
+            }
+
+            Addr value;
+            if (type == relative_type && relative_supported)
+            {
+              value = bias + addend;
+            } else
+            {
+              const relocation_action action = get_action(machine, type);
+              if (action == relocation_action::none)
+              {
+                continue;
+              }
+              std::uint64_t address = 0;
+              if (action == relocation_action::unsupported || !this->resolve(file, Layout::r_sym(info), cache, options, address))
+              {
+                if (!this->error() && options.skip_unsupported)
+                {
+                  this->skipped_count++;
+                  continue;
+                }
+                if (!this->error())
+                {
+                  this->last_error = "Unsupported relocation type " + std::to_string(type);
+                }
+                return false;
+              }
+              value = static_cast<Addr>(action == relocation_action::absolute ? address + addend : address);
+            }
+            value = Layout::get(value);
+            std::memcpy(target, &value, sizeof(Addr));
+            this->relocation_count++;
+          }
+          return true;
+        }
+
+        /*
+         * Find the address of a relocation's symbol. Returns false without
+         * an error for symbols image can't resolve, such as IFUNC or TLS
+         * ones, and with one for missing definitions
+         */
+        bool resolve(const ::elf::elf_file &file, std::uint32_t symbol_index, symbol_cache &cache, const ::elf::image_options &options,
+                     std::uint64_t &address)
+        {
+          const auto &symbols = file.get_dynamic_symbols();
+          if (symbol_index >= symbols.size())
+          {
+            this->last_error = "Invalid relocation symbol";
+            return false;
+          }
+          if (cache.states.empty())
+          {
+            cache.addresses.resize(symbols.size());
+            cache.states.resize(symbols.size());
+          }
+          if (cache.states[symbol_index] != 0)
+          {
+            address = cache.addresses[symbol_index];
+            return cache.states[symbol_index] == 1;
+          }
+
+          const ::elf::elf_symbol &symbol = symbols[symbol_index];
+          bool resolved;
+          if (options.resolver)
+          {
+            resolved = options.resolver(symbol, address);
+          } else
+          {
+            const ::elf::elf_symbol *definition = &symbol;
+            if (symbol.st_shndx == ::elf::elf_section_header::SHN_UNDEF)
+            {
+              const auto found = file.get_symbol(symbol.get_name());
+              definition = found != symbols.cend() && found->st_shndx != ::elf::elf_section_header::SHN_UNDEF ? &*found : nullptr;
+            }
+            if (definition != nullptr && (definition->get_type() == ::elf::elf_symbol::STT_GNU_IFUNC || definition->get_type() == ::elf::elf_symbol::STT_TLS))
+            {
+              cache.states[symbol_index] = 2;
+              return false;
+            }
+            resolved = definition != nullptr;
+            if (resolved)
+            {
+              address = definition->st_shndx == ::elf::elf_section_header::SHN_ABS ? definition->st_value : this->load_bias + definition->st_value;
+            }
+          }
+          if (!resolved)
+          {
+            if (symbol.get_binding() != ::elf::elf_symbol::STB_WEAK)
+            {
+              this->last_error = "Unresolved symbol " + std::string(symbol.get_name());
+              return false;
+            }
+            address = 0;
+          }
+          cache.addresses[symbol_index] = address;
+          cache.states[symbol_index] = 1;
+          return true;
+        }
+
+        /*
+         * Collect the run-time addresses of the init and fini functions.
+         * The arrays are read from the image once it is relocated, since
+         * position independent files only have their values as addends
+         */
+        template<typename Layout>
+        bool find_functions(const ::elf::elf_file &file, const dynamic_tables &tables, bool relocated)
+        {
+          if (!relocated)
+          {
+            for (const std::uint64_t address: file.get_init_functions())
+            {
+              this->init_functions.push_back(address + this->load_bias);
+            }
+            for (const std::uint64_t address: file.get_fini_functions())
+            {
+              this->fini_functions.push_back(address + this->load_bias);
+            }
+            return true;
+          }
+
+          using Addr = typename Layout::Addr;
+          const auto read_array = [this](std::uint64_t address, std::uint64_t size, std::vector<std::uint64_t> &functions) {
+              if (size == 0)
+              {
+                return true;
+              }
+              const std::byte *array = this->get_range(address, size);
+              if (array == nullptr || size % sizeof(Addr) != 0)
+              {
+                this->last_error = "Invalid function array";
+                return false;
+              }
+              for (std::uint64_t position = 0; position < size; position += sizeof(Addr))
+              {
+                Addr function;
+                std::memcpy(&function, array + position, sizeof(Addr));
+                functions.push_back(Layout::get(function));
+              }
+              return true;
+          };
+          if (!read_array(tables.preinit_array, tables.preinit_array_size, this->init_functions))
+          {
+            return false;
+          }
+          if (tables.init != 0)
+          {
+            this->init_functions.push_back(tables.init + this->load_bias);
+          }
+          if (!read_array(tables.init_array, tables.init_array_size, this->init_functions) ||
+              !read_array(tables.fini_array, tables.fini_array_size, this->fini_functions))
+          {
+            return false;
+          }
+          std::reverse(this->fini_functions.begin(), this->fini_functions.end());
+          if (tables.fini != 0)
+          {
+            this->fini_functions.push_back(tables.fini + this->load_bias);
+          }
+          return true;
+        }
+    };
+#endif
+
+#if defined(ELF_HPP_INOTIFY)
+    /*
+     * Refreshes elf_files when their files are written or replaced, using
+     * inotify on the directories they are in so linkers that write a new
+     * file and rename it into place are followed. Files are refreshed on
+     * the thread that calls poll, so nothing else may use them meanwhile,
+     * and they must be unwatched before they are destroyed
+     */
+    class file_watcher
+    {
+    public:
+        file_watcher()
+        {
+          this->descriptor = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+          if (this->descriptor < 0)
+          {
+            this->last_error = "Failed to initialise inotify";
+          }
+        }
+
+        ~file_watcher()
+        {
+          if (this->descriptor >= 0)
+          {
+            ::close(this->descriptor);
+          }
+        }
+
+        file_watcher(const file_watcher &) = delete;
+        file_watcher &operator=(const file_watcher &) = delete;
+
+        /*
+         * Check if an error occurred
+         */
+        bool error() const
+        {
+          return !this->last_error.empty();
+        }
+
+        /*
+         * Get a message for the last error that occurred
+         */
+        const std::string &error_message() const
+        {
+          return this->last_error;
+        }
+
+        /*
+         * Refresh file whenever it changes from now on. Memory images have
+         * nothing to watch
+         */
+        bool watch(::elf::elf_file &file)
+        {
+          if (this->descriptor < 0)
+          {
+            this->last_error = "Failed to initialise inotify";
+            return false;
+          }
+          if (file.get_path().empty())
+          {
+            this->last_error = "Memory images can't be watched";
+            return false;
+          }
+          this->unwatch(file);
+          std::filesystem::path directory = file.get_path().parent_path();
+          if (directory.empty())
+          {
+            directory = ".";
+          }
+          const int watch = ::inotify_add_watch(this->descriptor, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+          if (watch < 0)
+          {
+            this->last_error = "Failed to watch directory";
+            return false;
+          }
+          this->files.push_back({&file, watch, file.get_path().filename().string()});
+          return true;
+        }
+
+        /*
+         * Stop refreshing file, removing the watch on its directory once no
+         * other file needs it
+         */
+        void unwatch(const ::elf::elf_file &file)
+        {
+          const auto watched = std::find_if(this->files.begin(), this->files.end(), [&file](const watched_file &entry) { return entry.file == &file; });
+          if (watched == this->files.end())
+          {
+            return;
+          }
+          const int watch = watched->watch;
+          this->files.erase(watched);
+          if (std::none_of(this->files.begin(), this->files.end(), [watch](const watched_file &entry) { return entry.watch == watch; }))
+          {
+            ::inotify_rm_watch(this->descriptor, watch);
+          }
+        }
+
+        /*
+         * Wait up to timeout milliseconds (-1 for ever) for files to change
+         * and refresh every file that did, once however many events it had.
+         * Returns how many files were updated. Errors refreshing a file are
+         * left on that file
+         */
+        std::size_t poll(int timeout = 0)
+        {
+          if (this->descriptor < 0 || this->files.empty())
+          {
+            return 0;
+          }
+          ::pollfd request{this->descriptor, POLLIN, 0};
+          if (::poll(&request, 1, timeout) <= 0)
+          {
+            return 0;
+          }
+
+          std::vector<bool> changed(this->files.size());
+          alignas(::inotify_event) char events[4096];
+          for (;;)
+          {
+            const ::ssize_t length = ::read(this->descriptor, events, sizeof(events));
+            if (length <= 0)
+            {
+              break;
+            }
+            for (::ssize_t position = 0; position < length;)
+            {
+              const auto *event = reinterpret_cast<const ::inotify_event *>(events + position);
+              position += static_cast<::ssize_t>(sizeof(::inotify_event) + event->len);
+              for (std::size_t i = 0; i < this->files.size(); i++)
+              {
+                /*
+                 * Anything could have changed if events were dropped
+                 */
+                if ((event->mask & IN_Q_OVERFLOW) != 0 || (event->wd == this->files[i].watch && event->len != 0 && this->files[i].name == event->name))
+                {
+                  changed[i] = true;
+                }
+              }
+            }
+          }
+
+          std::size_t updated = 0;
+          for (std::size_t i = 0; i < this->files.size(); i++)
+          {
+            if (changed[i] && this->files[i].file->refresh() == ::elf::refresh_result::updated)
+            {
+              updated++;
+            }
+          }
+          return updated;
+        }
+
+        /*
+         * Get the inotify descriptor, which is readable when poll has work,
+         * for waiting on alongside others
+         */
+        int get_descriptor() const
+        {
+          return this->descriptor;
+        }
+
+    private:
+        typedef struct watched_file
+        {
+            ::elf::elf_file *file;
+            int watch;         /* Watch descriptor of the directory */
+            std::string name;  /* File name within the directory */
+        } watched_file;
+
+        int descriptor = -1;
+        std::vector<watched_file> files;
+        std::string last_error;
+    };
+#endif
+
+    /*
+     * Options controlling scan_paths and scan_directory
+     */
+    typedef struct scan_options
+    {
+        /*
+         * How each file is parsed. Stream-backed files are read whole into
+         * a buffer owned by the worker and reused for its next file, mapped
+         * files are mapped for as long as the callback runs. Unless a
+         * memory resource is given, each worker allocates tables from its
+         * own arena which is reset after every file
+         */
+        ::elf::load_options load = {};
+        bool parse_dynamic_segment = true;     /* Parse the dynamic segment before calling back */
+        bool skip_non_elf = true;              /* Don't call back for unreadable files or ones without the ELF magic */
+        std::size_t max_open_files = 16;       /* Files being read at once across all workers */
+        bool recursive = true;                 /* scan_directory descends into subdirectories */
+        bool follow_symlinks = false;          /* scan_directory includes symlinks to files and directories */
+        ::elf::executor *executor = nullptr;   /* Runs the parsing, default_executor() when null */
+    } scan_options;
+
+    namespace detail
+    {
+        /*
+         * Read a whole file into buffer, reusing its capacity
+         */
+        inline bool read_file(const std::filesystem::path &path, std::vector<std::byte> &buffer)
+        {
+#if defined(ELF_HPP_POSIX)
+          const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+          if (fd < 0)
+          {
+            return false;
+          }
+          struct stat file_status{};
+          if (::fstat(fd, &file_status) != 0 || !S_ISREG(file_status.st_mode))
+          {
+            ::close(fd);
+            return false;
+          }
+          buffer.resize(static_cast<std::size_t>(file_status.st_size));
+          std::size_t done = 0;
+          while (done < buffer.size())
+          {
+            const ssize_t count = ::read(fd, buffer.data() + done, buffer.size() - done);
+            if (count <= 0)
+            {
+              break;
+            }
+            done += static_cast<std::size_t>(count);
+          }
+          ::close(fd);
+          buffer.resize(done);
+          return true;
+#else
+          std::ifstream file(path, std::ios::binary | std::ios::in | std::ios::ate);
+          if (!file.is_open())
+          {
+            return false;
+          }
+          buffer.resize(static_cast<std::size_t>(file.tellg()));
+          file.seekg(0);
+          file.read(reinterpret_cast<char *>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+          buffer.resize(static_cast<std::size_t>(file.gcount()));
+          return true;
+#endif
+        }
+
+        inline bool has_elf_magic(std::span<const std::byte> image)
+        {
+          return image.size() >= 4 && std::memcmp(image.data(), "\x7f" "ELF", 4) == 0;
+        }
+
+        /*
+         * Load one file of a scan and hand it to callback. Only the loading
+         * holds an I/O slot
+         */
+        template<typename Callback>
+        void scan_file(const std::filesystem::path &path, std::vector<std::byte> &buffer, std::counting_semaphore<> &io_slots,
+                       const ::elf::scan_options &options, const ::elf::load_options &load_options, Callback &&callback)
+        {
+          ::elf::mapped_file mapping;
+          std::span<const std::byte> image;
+          io_slots.acquire();
+          if (options.load.backend == ::elf::backend::mapped)
+          {
+            mapping.open(path);
+            image = mapping.data();
+          } else if (::elf::detail::read_file(path, buffer))
+          {
+            image = buffer;
+          }
+          if (options.skip_non_elf && !::elf::detail::has_elf_magic(image))
+          {
+            io_slots.release();
+            return;
+          }
+          ::elf::elf_file file(image, load_options);
+          if (!file.error() && options.parse_dynamic_segment)
+          {
+            file.parse_dynamic_segment();
+          }
+          io_slots.release();
+          callback(path, file);
+        }
+    }
+
+    /*
+     * Parse many files in parallel and call callback(path, file) for each.
+     * Calls happen concurrently from the executor's workers and file is
+     * only valid for the duration of the call. A callback that returns a
+     * value makes this return a vector of those values in path order,
+     * default constructed for skipped files
+     */
+    template<typename Callback>
+    auto scan_paths(std::span<const std::filesystem::path> paths, Callback &&callback, const ::elf::scan_options &options = {})
+    {
+      using result_type = std::invoke_result_t<Callback &, const std::filesystem::path &, const ::elf::elf_file &>;
+      ::elf::executor &executor = options.executor != nullptr ? *options.executor : ::elf::default_executor();
+      ::exec::worker_local<std::vector<std::byte>> buffers(executor);
+      std::counting_semaphore<> io_slots(static_cast<std::ptrdiff_t>(std::max<std::size_t>(options.max_open_files, 1)));
+
+      /*
+       * Without a caller supplied resource each worker parses into its own
+       * arena, reset after every file
+       */
+      ::exec::worker_local<::elf::arena> arenas(options.load.memory_resource == nullptr ? executor.concurrency() : 0);
+      const auto scan_one = [&](std::size_t i, std::size_t worker, auto &&on_file) {
+          ::elf::load_options load_options = options.load;
+          if (!arenas.empty())
+          {
+            load_options.memory_resource = &arenas[worker];
+          }
+          ::elf::detail::scan_file(paths[i], buffers[worker], io_slots, options, load_options, on_file);
+          if (!arenas.empty())
+          {
+            arenas[worker].reset();
+          }
+      };
+
+      if constexpr (std::is_void_v<result_type>)
+      {
+        executor.for_each(paths.size(), [&](std::size_t i, std::size_t worker) { scan_one(i, worker, callback); });
+      } else
+      {
+        std::vector<result_type> results(paths.size());
+        executor.for_each(paths.size(), [&](std::size_t i, std::size_t worker) {
+            scan_one(i, worker, [&](const std::filesystem::path &path, const ::elf::elf_file &file) { results[i] = callback(path, file); });
+        });
+        return results;
+      }
+    }
+
+    /*
+     * scan_paths over every regular file in a directory. Entries that
+     * can't be read are skipped
+     */
+    template<typename Callback>
+    auto scan_directory(const std::filesystem::path &directory, Callback &&callback, const ::elf::scan_options &options = {})
+    {
+      std::vector<std::filesystem::path> paths;
+      std::error_code ec;
+      auto directory_options = std::filesystem::directory_options::skip_permission_denied;
+      if (options.follow_symlinks)
+      {
+        directory_options |= std::filesystem::directory_options::follow_directory_symlink;
+      }
+      for (std::filesystem::recursive_directory_iterator it(directory, directory_options, ec), end; !ec && it != end; it.increment(ec))
+      {
+        if (!options.recursive)
+        {
+          it.disable_recursion_pending();
+        }
+        std::error_code entry_ec;
+        const bool is_file = it->is_regular_file(entry_ec) && (options.follow_symlinks || !it->is_symlink(entry_ec));
+        if (is_file)
+        {
+          paths.push_back(it->path());
+        }
+      }
+      return ::elf::scan_paths(paths, std::forward<Callback>(callback), options);
+    }
+
+    /*
+     * Options controlling async_loader
+     */
+    typedef struct async_load_options
+    {
+        /*
+         * How each file is parsed. Files are always parsed from a mapping
+         * of the file, so the backend is ignored. Unless a memory resource
+         * is given, tables are allocated from an arena reset after every
+         * file
+         */
+        ::elf::load_options load = {};
+        bool parse_dynamic_segment = true;     /* Parse the dynamic segment before calling back */
+        bool skip_non_elf = true;              /* Don't call back for unreadable files or ones without the ELF magic */
+        std::size_t max_open_files = 64;       /* Files being read at once */
+        bool io_uring = true;                  /* Use io_uring where it is available, otherwise load synchronously */
+    } async_load_options;
+
+#if defined(ELF_HPP_IO_URING)
+    namespace detail
+    {
+        /*
+         * The parts of io_uring async_loader uses, through the system calls
+         * directly so nothing needs linking
+         */
+        class io_ring
+        {
+        public:
+            io_ring() = default;
+
+            ~io_ring()
+            {
+              this->close();
+            }
+
+            io_ring(const io_ring &copy) = delete;
+            io_ring &operator=(const io_ring &copy) = delete;
+
+            bool open(unsigned entries)
+            {
+              this->close();
+              ::io_uring_params params{};
+              const long descriptor = ::syscall(__NR_io_uring_setup, entries, &params);
+              if (descriptor < 0)
+              {
+                return false;
+              }
+              this->descriptor = static_cast<int>(descriptor);
+
+              this->sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+              this->cq_size = params.cq_off.cqes + params.cq_entries * sizeof(::io_uring_cqe);
+              const bool single_mapping = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+              if (single_mapping)
+              {
+                this->sq_size = this->cq_size = std::max(this->sq_size, this->cq_size);
+              }
+              this->sq_ring = ::mmap(nullptr, this->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->descriptor, IORING_OFF_SQ_RING);
+              this->cq_ring = single_mapping ? this->sq_ring : ::mmap(nullptr, this->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->descriptor, IORING_OFF_CQ_RING);
+              this->sqes_size = params.sq_entries * sizeof(::io_uring_sqe);
+              void *sqes = ::mmap(nullptr, this->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->descriptor, IORING_OFF_SQES);
+              if (this->sq_ring == MAP_FAILED || this->cq_ring == MAP_FAILED || sqes == MAP_FAILED)
+              {
+                if (sqes != MAP_FAILED)
+                {
+                  ::munmap(sqes, this->sqes_size);
+                }
+                this->close();
+                return false;
+              }
+
+              auto *sq = static_cast<std::byte *>(this->sq_ring);
+              auto *cq = static_cast<std::byte *>(this->cq_ring);
+              this->sq_head = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+              this->sq_tail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+              this->sq_mask = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+              this->sq_array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+              this->cq_head = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+              this->cq_tail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+              this->cq_mask = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+              this->cqes = reinterpret_cast<::io_uring_cqe *>(cq + params.cq_off.cqes);
+              this->sqes = static_cast<::io_uring_sqe *>(sqes);
+              this->entries = params.sq_entries;
+              this->local_tail = *this->sq_tail;
+              return true;
+            }
+
+            void close()
+            {
+              if (this->sqes != nullptr)
+              {
+                ::munmap(this->sqes, this->sqes_size);
+              }
+              if (this->cq_ring != nullptr && this->cq_ring != MAP_FAILED && this->cq_ring != this->sq_ring)
+              {
+                ::munmap(this->cq_ring, this->cq_size);
+              }
+              if (this->sq_ring != nullptr && this->sq_ring != MAP_FAILED)
+              {
+                ::munmap(this->sq_ring, this->sq_size);
+              }
+              if (this->descriptor >= 0)
+              {
+                ::close(this->descriptor);
+              }
+              this->sq_ring = this->cq_ring = nullptr;
+              this->sqes = nullptr;
+              this->descriptor = -1;
+              this->entries = 0;
+              this->queued = 0;
+            }
+
+            bool is_open() const
+            {
+              return this->descriptor >= 0;
+            }
+
+            /*
+             * Submission entries in the ring, and so the most requests that
+             * can be in flight without the completion ring overflowing
+             */
+            unsigned capacity() const
+            {
+              return this->entries;
+            }
+
+            /*
+             * Get a cleared submission entry to fill in, nullptr when the
+             * ring is full
+             */
+            ::io_uring_sqe *next()
+            {
+              const unsigned head = std::atomic_ref<unsigned>(*this->sq_head).load(std::memory_order_acquire);
+              if (this->local_tail - head >= this->entries)
+              {
+                return nullptr;
+              }
+              const unsigned index = this->local_tail & this->sq_mask;
+              ::io_uring_sqe *sqe = &this->sqes[index];
+              std::memset(sqe, 0, sizeof(::io_uring_sqe));
+              this->sq_array[index] = index;
+              this->local_tail++;
+              this->queued++;
+              return sqe;
+            }
+
+            /*
+             * Submit the entries filled in since the last call, blocking
+             * until at least wait_for requests have completed
+             */
+            bool submit(unsigned wait_for)
+            {
+              if (this->queued == 0 && wait_for == 0)
+              {
+                return true;
+              }
+              std::atomic_ref<unsigned>(*this->sq_tail).store(this->local_tail, std::memory_order_release);
+              for (;;)
+              {
+                const long submitted = ::syscall(__NR_io_uring_enter, this->descriptor, this->queued, wait_for,
+                                                 wait_for != 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+                if (submitted >= 0)
+                {
+                  this->queued -= std::min(this->queued, static_cast<unsigned>(submitted));
+                  return true;
+                }
+                if (errno != EINTR)
+                {
+                  return false;
+                }
+              }
+            }
+
+            /*
+             * Call callback(cqe) for every completion waiting, returning how
+             * many there were
+             */
+            template<typename Callback>
+            unsigned reap(Callback &&callback)
+            {
+              unsigned head = *this->cq_head;
+              const unsigned tail = std::atomic_ref<unsigned>(*this->cq_tail).load(std::memory_order_acquire);
+              const unsigned count = tail - head;
+              for (; head != tail; head++)
+              {
+                callback(this->cqes[head & this->cq_mask]);
+              }
+              std::atomic_ref<unsigned>(*this->cq_head).store(head, std::memory_order_release);
+              return count;
+            }
+
+        private:
+            int descriptor = -1;
+            void *sq_ring = nullptr;
+            void *cq_ring = nullptr;
+            std::size_t sq_size = 0;
+            std::size_t cq_size = 0;
+            std::size_t sqes_size = 0;
+            unsigned *sq_head = nullptr;
+            unsigned *sq_tail = nullptr;
+            unsigned *sq_array = nullptr;
+            unsigned sq_mask = 0;
+            unsigned *cq_head = nullptr;
+            unsigned *cq_tail = nullptr;
+            unsigned cq_mask = 0;
+            ::io_uring_cqe *cqes = nullptr;
+            ::io_uring_sqe *sqes = nullptr;
+            unsigned entries = 0;
+            unsigned local_tail = 0;
+            unsigned queued = 0;
+        };
+    }
+#endif
+
+    /*
+     * Loads many files at once and calls back as each one is parsed. Where
+     * io_uring is available every file is read as a pipeline of dependent
+     * stages, the ELF header, then the program and section header tables,
+     * then the dynamic segment and the sections holding the tables elf_file
+     * parses, with the stages of every open file in flight together. The
+     * reads only bring the file into the page cache, it is then parsed from
+     * a mapping, so a table the stages didn't predict costs a page fault
+     * rather than being wrong. Without io_uring, or when the kernel refuses
+     * it, each file is mapped and parsed synchronously when it is polled
+     * for. Not thread safe
+     */
+    class async_loader
+    {
+    public:
+        explicit async_loader(const ::elf::async_load_options &options = {}) : options(options)
+        {
+          this->options.max_open_files = std::max<std::size_t>(this->options.max_open_files, 1);
+#if defined(ELF_HPP_IO_URING)
+          if (this->options.io_uring)
+          {
+            const std::size_t entries = std::bit_ceil(std::clamp<std::size_t>(this->options.max_open_files * 4, 8, 4096));
+            if (this->ring.open(static_cast<unsigned>(entries)))
+            {
+              this->slots.resize(this->options.max_open_files);
+              this->sink.resize(sink_size);
+              for (std::size_t i = this->slots.size(); i > 0; i--)
+              {
+                this->free_slots.push_back(i - 1);
+              }
+            } else
+            {
+              this->last_error = std::string("io_uring is unavailable, loading synchronously: ") + std::strerror(errno);
+            }
+          }
+#endif
+        }
+
+        ~async_loader()
+        {
+#if defined(ELF_HPP_IO_URING)
+          /*
+           * Requests still in flight write into the sink, so wait for them
+           * before it is freed
+           */
+          while (this->in_flight != 0 && this->ring.submit(1))
+          {
+            this->reap();
+          }
+          for (open_file &file: this->slots)
+          {
+            file.close();
+          }
+#endif
+        }
+
+        async_loader(const async_loader &copy) = delete;
+        async_loader &operator=(const async_loader &copy) = delete;
+
+        /*
+         * Check if an error occurred. Only set when io_uring was asked for
+         * and couldn't be set up, which doesn't stop files loading
+         */
+        bool error() const
+        {
+          return !this->last_error.empty();
+        }
+
+        const std::string &error_message() const
+        {
+          return this->last_error;
+        }
+
+        /*
+         * Check if files are read through io_uring rather than synchronously
+         */
+        bool is_async() const
+        {
+#if defined(ELF_HPP_IO_URING)
+          return this->ring.is_open();
+#else
+          return false;
+#endif
+        }
+
+        /*
+         * Queue a file to be loaded. Reading starts straight away when
+         * fewer than max_open_files are being read
+         */
+        void submit(std::filesystem::path path)
+        {
+          this->queued.push_back(std::move(path));
+          this->pending_count++;
+#if defined(ELF_HPP_IO_URING)
+          if (this->ring.is_open())
+          {
+            this->start_queued();
+            this->ring.submit(0);
+          }
+#endif
+        }
+
+        /*
+         * Files submitted that haven't been called back for, or skipped, yet
+         */
+        std::size_t pending() const
+        {
+          return this->pending_count;
+        }
+
+        /*
+         * Call callback(path, file) for every file that has finished
+         * loading, without blocking, and return how many there were. file
+         * is only valid for the duration of the call. Loading synchronously
+         * this loads one file
+         */
+        template<typename Callback>
+        std::size_t poll(Callback &&callback)
+        {
+          return this->deliver(callback, false);
+        }
 
-                break;
-              }
-            }
-          }
+        /*
+         * poll, blocking until at least one file has finished unless none
+         * are pending
+         */
+        template<typename Callback>
+        std::size_t wait(Callback &&callback)
+        {
+          return this->deliver(callback, true);
+        }
 
-          return true;
+        /*
+         * Load everything submitted, calling back for each file, and return
+         * how many were called back for
+         */
+        template<typename Callback>
+        std::size_t wait_all(Callback &&callback)
+        {
+          std::size_t delivered = 0;
+          while (this->pending_count != 0)
+          {
+            delivered += this->wait(callback);
+          }
+          return delivered;
         }
 
-        bool parse_relocations()
+    private:
+        /*
+         * The largest read, and the size of the buffer every read lands in
+         */
+        inline static constexpr std::size_t sink_size = 1 << 20;
+
+        /*
+         * Call back for a parsed file, unless it isn't one and those are
+         * skipped
+         */
+        template<typename Callback>
+        bool parse(const std::filesystem::path &path, std::span<const std::byte> image, Callback &callback)
         {
-          if (!this->binary_file.is_open())
+          if (this->options.skip_non_elf && !::elf::detail::has_elf_magic(image))
           {
-            this->last_error = "Binary file is not open";
             return false;
           }
+          ::elf::load_options load_options = this->options.load;
+          if (load_options.memory_resource == nullptr)
+          {
+            load_options.memory_resource = &this->arena;
+          }
+          {
+            ::elf::elf_file file(image, load_options);
+            if (!file.error() && this->options.parse_dynamic_segment)
+            {
+              file.parse_dynamic_segment();
+            }
+            callback(path, static_cast<const ::elf::elf_file &>(file));
+          }
+          this->arena.reset();
+          return true;
+        }
 
-          for (const auto &section_header: this->get_section_headers())
+        template<typename Callback>
+        std::size_t deliver(Callback &callback, bool block)
+        {
+#if defined(ELF_HPP_IO_URING)
+          if (this->ring.is_open())
           {
-            switch (section_header.sh_type)
+            std::size_t delivered = 0;
+            while (this->pending_count != 0)
             {
-              case ::elf::elf_section_header::SHT_REL:
+              this->reap();
+              while (!this->loaded.empty())
               {
-                this->binary_file.seekg(static_cast<std::streamoff>(section_header.sh_offset));
-                if (this->is_64_bit())
-                {
-                  if (section_header.sh_entsize != sizeof(::elf::types::Elf64_Rel))
-                  {
-                    this->last_error = "Invalid relocation entry size";
-                    return false;
-                  }
-                  std::size_t relocation_entries_count = section_header.sh_size / section_header.sh_entsize;
-
-                  if (std::strcmp(section_header.sh_name_str, ".rel.plt") == 0)
-                  {
-                    this->plt_rel_entries.resize(relocation_entries_count);
-                    this->binary_file.read(reinterpret_cast<char *>(this->plt_rel_entries.data()), static_cast<std::streamsize>(section_header.sh_size));
-                  } else if (std::strcmp(section_header.sh_name_str, ".rel.dyn") == 0)
-                  {
-                    this->dyn_rel_entries.resize(relocation_entries_count);
-                    this->binary_file.read(reinterpret_cast<char *>(this->dyn_rel_entries.data()), static_cast<std::streamsize>(section_header.sh_size));
-                  } else
-                  {
-                    this->last_error = "Invalid relocation section name";
-                    return false;
-                  }
-
-                  if (this->binary_file.gcount() != section_header.sh_size)
-                  {
-                    this->last_error = "Failed to read relocation entries";
-                    return false;
-                  }
-                } else
-                {
-                  if (section_header.sh_entsize != sizeof(::elf::types::Elf32_Rel))
-                  {
-                    this->last_error = "Invalid relocation entry size";
-                    return false;
-                  }
-                  std::size_t relocation_entries_count = section_header.sh_size / section_header.sh_entsize;
-                  std::vector<::elf::types::Elf32_Rel> real_relocation_entries(relocation_entries_count);
-                  this->binary_file.read(reinterpret_cast<char *>(real_relocation_entries.data()), static_cast<std::streamsize>(section_header.sh_size));
-                  if (this->binary_file.gcount() != section_header.sh_size)
-                  {
-                    this->last_error = "Failed to read relocation entries";
-                    return false;
-                  }
-
-                  if (std::strcmp(section_header.sh_name_str, ".rel.plt") == 0)
-                  {
-                    this->plt_rel_entries.resize(relocation_entries_count);
-                    for (std::size_t i = 0; i < relocation_entries_count; i++)
-                    {
-                      this->plt_rel_entries[i].r_offset = real_relocation_entries[i].r_offset;
-                      this->plt_rel_entries[i].r_type = real_relocation_entries[i].r_info & 0xff;
-                      this->plt_rel_entries[i].r_sym = real_relocation_entries[i].r_info >> 8;
-                    }
-                  } else if (std::strcmp(section_header.sh_name_str, ".rel.dyn") == 0)
-                  {
-                    this->dyn_rel_entries.resize(relocation_entries_count);
-                    for (std::size_t i = 0; i < relocation_entries_count; i++)
-                    {
-                      this->dyn_rel_entries[i].r_offset = real_relocation_entries[i].r_offset;
-                      this->dyn_rel_entries[i].r_type = real_relocation_entries[i].r_info & 0xff;
-                      this->dyn_rel_entries[i].r_sym = real_relocation_entries[i].r_info >> 8;
-                    }
-                  } else
-                  {
-                    this->last_error = "Invalid relocation section name";
-                    return false;
-                  }
-                }
+                const std::size_t index = this->loaded.front();
+                this->loaded.pop_front();
+                open_file &file = this->slots[index];
+                delivered += this->parse(file.path, file.mapping.data(), callback);
+                file.close();
+                this->free_slots.push_back(index);
+                this->pending_count--;
+              }
+              this->start_queued();
+              if (delivered != 0 || !block || this->pending_count == 0 || this->in_flight == 0)
+              {
+                this->ring.submit(0);
                 break;
               }
-              case ::elf::elf_section_header::SHT_RELA:
+              if (!this->ring.submit(1))
               {
-                this->binary_file.seekg(static_cast<std::streamoff>(section_header.sh_offset));
-                if (this->is_64_bit())
-                {
-                  if (section_header.sh_entsize != sizeof(::elf::types::Elf64_Rela))
-                  {
-                    this->last_error = "Invalid relocation entry size";
-                    return false;
-                  }
-                  std::size_t relocation_entries_count = section_header.sh_size / section_header.sh_entsize;
+                break;
+              }
+            }
+            return delivered;
+          }
+#endif
+          static_cast<void>(block);
+          while (!this->queued.empty())
+          {
+            const std::filesystem::path path = std::move(this->queued.front());
+            this->queued.pop_front();
+            this->pending_count--;
+            const ::elf::mapped_file mapping(path);
+            if (this->parse(path, mapping.data(), callback))
+            {
+              return 1;
+            }
+          }
+          return 0;
+        }
 
-                  if (std::strcmp(section_header.sh_name_str, ".rela.plt") == 0)
-                  {
-                    this->plt_rela_entries.resize(relocation_entries_count);
-                    this->binary_file.read(reinterpret_cast<char *>(this->plt_rela_entries.data()),
-                                           static_cast<std::streamsize>(section_header.sh_size));
-                  } else if (std::strcmp(section_header.sh_name_str, ".rela.dyn") == 0)
-                  {
-                    this->dyn_rela_entries.resize(relocation_entries_count);
-                    this->binary_file.read(reinterpret_cast<char *>(this->dyn_rela_entries.data()),
-                                           static_cast<std::streamsize>(section_header.sh_size));
-                  } else
-                  {
-                    this->last_error = "Invalid relocation section name";
-                    return false;
-                  }
+#if defined(ELF_HPP_IO_URING)
+        enum class load_step
+        {
+            opening = 0,
+            header,       /* The ELF header and the file's size */
+            tables,       /* Program and section header tables */
+            contents,     /* The dynamic segment and the sections with tables in */
+            loaded
+        };
 
-                  if (this->binary_file.gcount() != section_header.sh_size)
-                  {
-                    this->last_error = "Failed to read relocation entries";
-                    return false;
-                  }
-                } else
-                {
-                  if (section_header.sh_entsize != sizeof(::elf::types::Elf32_Rela))
-                  {
-                    this->last_error = "Invalid relocation entry size";
-                    return false;
-                  }
-                  std::size_t relocation_entries_count = section_header.sh_size / section_header.sh_entsize;
-                  std::vector<::elf::types::Elf32_Rela> real_relocation_entries(relocation_entries_count);
-                  this->binary_file.read(reinterpret_cast<char *>(real_relocation_entries.data()), static_cast<std::streamsize>(section_header.sh_size));
-                  if (this->binary_file.gcount() != section_header.sh_size)
-                  {
-                    this->last_error = "Failed to read relocation entries";
-                    return false;
-                  }
+        /*
+         * What a completion was for, kept in the low bits of its user data
+         * with the slot in the rest
+         */
+        enum request_kind
+        {
+            request_open = 0,
+            request_status,
+            request_read
+        };
 
-                  if (std::strcmp(section_header.sh_name_str, ".rela.plt") == 0)
-                  {
-                    this->plt_rela_entries.resize(relocation_entries_count);
-                    for (std::size_t i = 0; i < relocation_entries_count; i++)
-                    {
-                      this->plt_rela_entries[i].r_offset = real_relocation_entries[i].r_offset;
-                      this->plt_rela_entries[i].r_type = real_relocation_entries[i].r_info & 0xff;
-                      this->plt_rela_entries[i].r_sym = real_relocation_entries[i].r_info >> 8;
-                      this->plt_rela_entries[i].r_addend = real_relocation_entries[i].r_addend;
-                    }
-                  } else if (std::strcmp(section_header.sh_name_str, ".rela.dyn") == 0)
-                  {
-                    this->dyn_rela_entries.resize(relocation_entries_count);
-                    for (std::size_t i = 0; i < relocation_entries_count; i++)
-                    {
-                      this->dyn_rela_entries[i].r_offset = real_relocation_entries[i].r_offset;
-                      this->dyn_rela_entries[i].r_type = real_relocation_entries[i].r_info & 0xff;
-                      this->dyn_rela_entries[i].r_sym = real_relocation_entries[i].r_info >> 8;
-                      this->dyn_rela_entries[i].r_addend = real_relocation_entries[i].r_addend;
-                    }
-                  } else
-                  {
-                    this->last_error = "Invalid relocation section name";
-                    return false;
-                  }
-                }
-                break;
+        typedef struct read_range
+        {
+            std::uint64_t offset;
+            std::uint64_t size;
+        } read_range;
+
+        typedef struct open_file
+        {
+            std::filesystem::path path;
+            int descriptor = -1;
+            load_step step = load_step::opening;
+            bool failed = false;
+            struct statx status{};
+            ::elf::mapped_file mapping;
+            std::vector<read_range> reads;
+            std::size_t next_read = 0;
+            unsigned outstanding = 0;
+
+            void close()
+            {
+              this->mapping.close();
+              if (this->descriptor >= 0)
+              {
+                ::close(this->descriptor);
               }
+              this->descriptor = -1;
+              this->reads.clear();
             }
-          }
+        } open_file;
 
-          return true;
+        /*
+         * Move queued paths into free slots and start opening them
+         */
+        void start_queued()
+        {
+          while (!this->queued.empty() && !this->free_slots.empty() && this->in_flight < this->ring.capacity())
+          {
+            const std::size_t index = this->free_slots.back();
+            this->free_slots.pop_back();
+            open_file &file = this->slots[index];
+            file.path = std::move(this->queued.front());
+            this->queued.pop_front();
+            file.descriptor = -1;
+            file.step = load_step::opening;
+            file.failed = false;
+            file.reads.clear();
+            file.next_read = 0;
+            file.outstanding = 0;
+
+            ::io_uring_sqe *sqe = this->next_sqe();
+            sqe->opcode = IORING_OP_OPENAT;
+            sqe->fd = AT_FDCWD;
+            sqe->addr = reinterpret_cast<std::uintptr_t>(file.path.c_str());
+            sqe->open_flags = O_RDONLY | O_CLOEXEC;
+            sqe->user_data = index << 2 | request_open;
+            file.outstanding++;
+          }
+          this->issue_waiting();
         }
 
-        bool read_init_functions()
+        /*
+         * A submission entry once in_flight has been checked against the
+         * ring's capacity. Full rings are submitted to make room
+         */
+        ::io_uring_sqe *next_sqe()
         {
-          if (!this->binary_file.is_open())
+          ::io_uring_sqe *sqe = this->ring.next();
+          while (sqe == nullptr)
           {
-            this->last_error = "Binary file is not open";
-            return false;
+            this->ring.submit(0);
+            sqe = this->ring.next();
           }
+          this->in_flight++;
+          return sqe;
+        }
 
-          const auto preinit_array_section_header = std::find_if(this->section_headers.cbegin(), this->section_headers.cend(),
-                                                                 [](const elf::elf_section_header &hdr) {
-                                                                     return std::strcmp(hdr.sh_name_str, ".preinit_array") == 0;
-                                                                 });
-          if (preinit_array_section_header != this->section_headers.cend())
+        /*
+         * Queue as many of a file's reads as there is room in the ring for,
+         * returning false if some are left
+         */
+        bool issue_reads(std::size_t index)
+        {
+          open_file &file = this->slots[index];
+          while (file.next_read < file.reads.size())
           {
-            std::size_t preinit_entry_size = this->is_64_bit() ? 8 : 4;
-            if (preinit_array_section_header->sh_size % preinit_entry_size != 0)
+            if (this->in_flight >= this->ring.capacity())
             {
-              this->last_error = "Invalid preinit array size";
               return false;
             }
-            std::size_t preinit_entry_count = preinit_array_section_header->sh_size / preinit_entry_size;
-            this->binary_file.seekg(static_cast<std::streamoff>(preinit_array_section_header->sh_offset));
-            if (this->is_64_bit())
-            {
-              this->init_functions.resize(preinit_entry_count);
-              this->binary_file.read(reinterpret_cast<char *>(this->init_functions.data()),
-                                     static_cast<std::streamsize>(preinit_array_section_header->sh_size));
-              if (this->binary_file.gcount() != preinit_array_section_header->sh_size)
-              {
-                this->last_error = "Failed to read preinit array";
-                return false;
-              }
-            } else
-            {
-              std::vector<std::uint32_t> real_preinit_functions(preinit_entry_count);
-              this->binary_file.read(reinterpret_cast<char *>(real_preinit_functions.data()),
-                                     static_cast<std::streamsize>(preinit_array_section_header->sh_size));
-              if (this->binary_file.gcount() != preinit_array_section_header->sh_size)
-              {
-                this->last_error = "Failed to read preinit array";
-                return false;
-              }
-              this->init_functions.resize(preinit_entry_count);
-              for (std::size_t i = 0; i < preinit_entry_count; i++)
-              {
-                this->init_functions[i] = real_preinit_functions[i];
-              }
-            }
+            const read_range &range = file.reads[file.next_read++];
+            ::io_uring_sqe *sqe = this->next_sqe();
+            sqe->opcode = IORING_OP_READ;
+            sqe->fd = file.descriptor;
+            sqe->addr = reinterpret_cast<std::uintptr_t>(this->sink.data());
+            sqe->len = static_cast<std::uint32_t>(range.size);
+            sqe->off = range.offset;
+            sqe->user_data = index << 2 | request_read;
+            file.outstanding++;
           }
+          return true;
+        }
 
-          const auto init_section_header = std::find_if(this->section_headers.cbegin(), this->section_headers.cend(),
-                                                        [](const elf::elf_section_header &hdr) {
-                                                            return std::strcmp(hdr.sh_name_str, ".init") == 0;
-                                                        });
-          if (init_section_header != this->section_headers.cend())
+        /*
+         * Issue the reads of files that ran out of room in the ring first
+         */
+        void issue_waiting()
+        {
+          while (!this->waiting.empty() && this->issue_reads(this->waiting.front()))
           {
-            this->init_functions.emplace_back(init_section_header->sh_addr);
+            this->waiting.pop_front();
           }
+        }
 
-          const auto init_array_section_header = std::find_if(this->section_headers.cbegin(), this->section_headers.cend(),
-                                                              [](const elf::elf_section_header &hdr) {
-                                                                  return std::strcmp(hdr.sh_name_str, ".init_array") == 0;
-                                                              });
-          if (init_array_section_header != this->section_headers.cend())
+        void issue_or_wait(std::size_t index)
+        {
+          if (!this->waiting.empty() || !this->issue_reads(index))
           {
-            std::size_t init_entry_size = this->is_64_bit() ? 8 : 4;
-            if (init_array_section_header->sh_size % init_entry_size != 0)
-            {
-              this->last_error = "Invalid preinit array size";
-              return false;
-            }
-            std::size_t init_entry_count = init_array_section_header->sh_size / init_entry_size;
-            this->binary_file.seekg(static_cast<std::streamoff>(init_array_section_header->sh_offset));
-            if (this->is_64_bit())
-            {
-              this->init_functions.resize(this->init_functions.size() + init_entry_count);
-              this->binary_file.read(reinterpret_cast<char *>(this->init_functions.data() + this->init_functions.size() - init_entry_count),
-                                     static_cast<std::streamsize>(init_array_section_header->sh_size));
-              if (this->binary_file.gcount() != init_array_section_header->sh_size)
+            this->waiting.push_back(index);
+          }
+        }
+
+        void reap()
+        {
+          this->ring.reap([this](const ::io_uring_cqe &cqe) {
+              const std::size_t index = static_cast<std::size_t>(cqe.user_data >> 2);
+              open_file &file = this->slots[index];
+              this->in_flight--;
+              file.outstanding--;
+              switch (static_cast<request_kind>(cqe.user_data & 3))
               {
-                this->last_error = "Failed to read preinit array";
-                return false;
+                case request_open:
+                  if (cqe.res < 0)
+                  {
+                    file.failed = true;
+                  } else
+                  {
+                    file.descriptor = cqe.res;
+                  }
+                  break;
+                case request_status:
+                  file.failed |= cqe.res < 0;
+                  break;
+                case request_read:
+                  /*
+                   * The data isn't used, a failed read only means the
+                   * parse will fault those pages in itself
+                   */
+                  break;
               }
-            } else
-            {
-              std::vector<std::uint32_t> real_init_functions(init_entry_count);
-              this->binary_file.read(reinterpret_cast<char *>(real_init_functions.data()), static_cast<std::streamsize>(init_array_section_header->sh_size));
-              if (this->binary_file.gcount() != init_array_section_header->sh_size)
+              if (file.outstanding == 0 && file.next_read == file.reads.size())
               {
-                this->last_error = "Failed to read preinit array";
-                return false;
+                this->advance(index);
               }
-              this->init_functions.reserve(this->init_functions.size() + init_entry_count);
-              std::copy(real_init_functions.cbegin(), real_init_functions.cend(), std::back_inserter(this->init_functions));
-            }
-          }
-
-          return true;
+          });
+          this->issue_waiting();
         }
 
-        bool read_term_functions()
+        /*
+         * Start the next stage of a file once everything the last one asked
+         * for has completed
+         */
+        void advance(std::size_t index)
         {
-          const auto fini_array_section_header = std::find_if(this->section_headers.cbegin(), this->section_headers.cend(),
-                                                              [](const elf::elf_section_header &hdr) {
-                                                                  return std::strcmp(hdr.sh_name_str, ".fini_array") == 0;
-                                                              });
-          if (fini_array_section_header != this->section_headers.cend())
+          open_file &file = this->slots[index];
+          file.reads.clear();
+          file.next_read = 0;
+          if (file.failed)
+          {
+            file.step = load_step::loaded;
+            this->loaded.push_back(index);
+            return;
+          }
+
+          switch (file.step)
           {
-            std::size_t fini_entry_size = this->is_64_bit() ? 8 : 4;
-            if (fini_array_section_header->sh_size % fini_entry_size != 0)
+            case load_step::opening:
             {
-              this->last_error = "Invalid fini array size";
-              return false;
+              file.step = load_step::header;
+              ::io_uring_sqe *sqe = this->next_sqe();
+              sqe->opcode = IORING_OP_STATX;
+              sqe->fd = file.descriptor;
+              sqe->addr = reinterpret_cast<std::uintptr_t>("");
+              sqe->len = STATX_TYPE | STATX_SIZE;
+              sqe->off = reinterpret_cast<std::uintptr_t>(&file.status);
+              sqe->statx_flags = AT_EMPTY_PATH;
+              sqe->user_data = index << 2 | request_status;
+              file.outstanding++;
+              file.reads.push_back({0, sizeof(::elf::types::Elf64_Ehdr)});
+              this->issue_or_wait(index);
+              return;
             }
-            std::size_t fini_entry_count = fini_array_section_header->sh_size / fini_entry_size;
-            this->binary_file.seekg(static_cast<std::streamoff>(fini_array_section_header->sh_offset));
-            if (this->is_64_bit())
-            {
-              this->fini_functions.resize(fini_entry_count);
-              this->binary_file.read(reinterpret_cast<char *>(this->fini_functions.data()),
-                                     static_cast<std::streamsize>(fini_array_section_header->sh_size));
-              if (this->binary_file.gcount() != fini_array_section_header->sh_size)
+            case load_step::header:
+              if (!S_ISREG(file.status.stx_mode) || !file.mapping.open(file.descriptor, static_cast<std::size_t>(file.status.stx_size)))
               {
-                this->last_error = "Failed to read fini array";
-                return false;
+                file.failed = true;
+                break;
               }
-              std::reverse(this->fini_functions.begin(), this->fini_functions.end());
-            } else
-            {
-              std::vector<std::uint32_t> real_fini_functions(fini_entry_count);
-              this->binary_file.read(reinterpret_cast<char *>(real_fini_functions.data()),
-                                     static_cast<std::streamsize>(fini_array_section_header->sh_size));
-              if (this->binary_file.gcount() != fini_array_section_header->sh_size)
+              if (!::elf::detail::has_elf_magic(file.mapping.data()))
               {
-                this->last_error = "Failed to read fini array";
-                return false;
+                file.step = load_step::loaded;
+                break;
               }
-              this->fini_functions.reserve(fini_entry_count);
-              std::copy(real_fini_functions.crbegin(), real_fini_functions.crend(), std::back_inserter(this->fini_functions));
-            }
+              file.step = load_step::tables;
+              visit_header_layout(file.mapping.data(), [&](auto layout) { add_table_reads(layout, file); });
+              break;
+            case load_step::tables:
+              file.step = load_step::contents;
+              visit_header_layout(file.mapping.data(), [&](auto layout) { add_content_reads(layout, file); });
+              break;
+            case load_step::contents:
+            case load_step::loaded:
+              file.step = load_step::loaded;
+              break;
           }
 
-          const auto fini_section_header = std::find_if(this->section_headers.cbegin(), this->section_headers.cend(),
-                                                        [](const elf::elf_section_header &hdr) {
-                                                            return std::strcmp(hdr.sh_name_str, ".fini") == 0;
-                                                        });
-          if (fini_section_header != this->section_headers.cend())
+          if (file.failed || file.step == load_step::loaded)
           {
-            this->fini_functions.emplace_back(fini_section_header->sh_addr);
+            file.step = load_step::loaded;
+            this->loaded.push_back(index);
+            return;
           }
-
-          return true;
+          this->split_reads(file);
+          if (file.reads.empty())
+          {
+            this->advance(index);
+            return;
+          }
+          this->issue_or_wait(index);
         }
 
-        std::vector<::elf::elf_symbol>::const_iterator lookup_elf_symbol(const char *name) const
+        template<typename Visitor>
+        static void visit_header_layout(std::span<const std::byte> image, Visitor &&visitor)
         {
-          if (this->hash_buckets.empty())
+          if (image.size() <= offsetof(::elf::elf_ident, ei_data))
           {
-            return this->dynamic_symbols.cend();
+            return;
           }
-          const std::uint32_t hash = elf_hash(name);
-          std::uint32_t index = this->hash_buckets[hash % this->hash_buckets.size()];
-          while (true)
+          const auto elf_class = static_cast<::elf::byte>(image[offsetof(::elf::elf_ident, ei_class)]);
+          const auto elf_data = static_cast<::elf::byte>(image[offsetof(::elf::elf_ident, ei_data)]);
+          const bool big_endian = elf_data == ::elf::elf_ident::ELFDATA2MSB;
+          if (elf_data != ::elf::elf_ident::ELFDATA2LSB && !big_endian)
           {
-            if (index == ::elf::elf_symbol::STN_UNDEF)
-            {
-              return this->dynamic_symbols.cend();
-            }
-            auto symbol_it = this->dynamic_symbols.cbegin();
-            std::advance(symbol_it, index);
-            if (std::strcmp(symbol_it->st_name_str, name) == 0)
-            {
-              return symbol_it;
-            }
-            index = this->hash_chains.at(index);
+            return;
+          }
+          if (elf_class == ::elf::elf_ident::ELFCLASS32)
+          {
+            big_endian ? visitor(::elf::elf_layout<::elf::elf_ident::ELFCLASS32, std::endian::big>{})
+                       : visitor(::elf::elf_layout<::elf::elf_ident::ELFCLASS32, std::endian::little>{});
+          } else if (elf_class == ::elf::elf_ident::ELFCLASS64)
+          {
+            big_endian ? visitor(::elf::elf_layout<::elf::elf_ident::ELFCLASS64, std::endian::big>{})
+                       : visitor(::elf::elf_layout<::elf::elf_ident::ELFCLASS64, std::endian::little>{});
           }
         }
 
-        std::vector<::elf::elf_symbol>::const_iterator lookup_gnu_symbol(const char *name) const
+        template<typename T>
+        static bool read_entry(std::span<const std::byte> image, std::uint64_t offset, T &entry)
         {
-          if (this->gnu_hash_buckets.empty())
+          if (offset > image.size() || sizeof(T) > image.size() - offset)
           {
-            return this->dynamic_symbols.cend();
+            return false;
           }
-          std::uint32_t hash1 = gnu_hash(name);
-          std::uint32_t hash2 = hash1 >> this->gnu_hash_bloom_shift;
-          const std::uint64_t bloom_word_size = sizeof(std::uint64_t) * 8;
-          const std::uint64_t bitmask = (static_cast<std::uint64_t>(1) << (hash1 % bloom_word_size)) |
-                                        (static_cast<std::uint64_t>(1) << (hash2 % bloom_word_size));
-          const std::uint64_t bloom_size_bitmask = this->gnu_hash_bloom_words.size() - 1;
+          std::memcpy(&entry, image.data() + offset, sizeof(T));
+          return true;
+        }
 
-          if ((this->gnu_hash_bloom_words.at((hash1 / bloom_word_size) & bloom_size_bitmask) & bitmask) != bitmask)
+        template<typename Layout>
+        static void add_table_reads(Layout, open_file &file)
+        {
+          typename Layout::Ehdr header;
+          if (!read_entry(file.mapping.data(), 0, header))
           {
-            return this->dynamic_symbols.cend();
+            return;
+          }
+          file.reads.push_back({Layout::get(header.e_phoff), std::uint64_t{Layout::get(header.e_phnum)} * Layout::get(header.e_phentsize)});
+          if (Layout::get(header.e_shoff) != 0)
+          {
+            /*
+             * With extended numbering the count is in the first entry, the
+             * rest are read with the contents
+             */
+            const std::uint64_t count = std::max<std::uint64_t>(Layout::get(header.e_shnum), 1);
+            file.reads.push_back({Layout::get(header.e_shoff), count * Layout::get(header.e_shentsize)});
           }
+        }
 
-          std::size_t start_idx = this->gnu_hash_buckets.at(hash1 % this->gnu_hash_buckets.size());
-          if (start_idx == ::elf::elf_symbol::STN_UNDEF)
+        template<typename Layout>
+        static void add_content_reads(Layout, open_file &file)
+        {
+          const std::span<const std::byte> image = file.mapping.data();
+          typename Layout::Ehdr header;
+          if (!read_entry(image, 0, header))
           {
-            return this->dynamic_symbols.cend();
+            return;
           }
 
-          auto current_symbol = this->dynamic_symbols.cbegin();
-          std::advance(current_symbol, start_idx);
-          auto current_value = this->gnu_hash_values.cbegin();
-          std::advance(current_value, start_idx - this->gnu_hash_omitted_symbols_count);
+          for (std::uint64_t i = 0; i < Layout::get(header.e_phnum); i++)
+          {
+            typename Layout::Phdr program_header;
+            if (Layout::get(header.e_phentsize) != sizeof(program_header) ||
+                !read_entry(image, Layout::get(header.e_phoff) + i * sizeof(program_header), program_header))
+            {
+              break;
+            }
+            const std::uint32_t type = Layout::get(program_header.p_type);
+            if (type == ::elf::elf_program_header::PT_DYNAMIC || type == ::elf::elf_program_header::PT_NOTE)
+            {
+              file.reads.push_back({Layout::get(program_header.p_offset), Layout::get(program_header.p_filesz)});
+            }
+          }
 
-          hash1 &= ~1;
-          for (; current_symbol != this->dynamic_symbols.cend() && current_value != this->gnu_hash_values.cend(); current_symbol++, current_value++)
+          /*
+           * The sections parsing and parse_dynamic_segment read through.
+           * Relocations and the static symbol table are viewed in place or
+           * parsed on demand, so are left to be faulted in if they are used
+           */
+          typename Layout::Shdr section_header;
+          if (Layout::get(header.e_shoff) == 0 || Layout::get(header.e_shentsize) != sizeof(section_header) ||
+              !read_entry(image, Layout::get(header.e_shoff), section_header))
           {
-            hash2 = *current_value;
+            return;
+          }
+          const std::uint64_t count = Layout::get(header.e_shnum) != 0 ? Layout::get(header.e_shnum) : Layout::get(section_header.sh_size);
+          const std::uint64_t names_index = Layout::get(header.e_shstrndx) == ::elf::elf_section_header::SHN_XINDEX ? Layout::get(section_header.sh_link)
+                                                                                                                   : Layout::get(header.e_shstrndx);
+          file.reads.push_back({Layout::get(header.e_shoff), count * sizeof(section_header)});
+          for (std::uint64_t i = 0; i < count; i++)
+          {
+            if (!read_entry(image, Layout::get(header.e_shoff) + i * sizeof(section_header), section_header))
+            {
+              break;
+            }
+            bool parsed = false;
+            switch (Layout::get(section_header.sh_type))
+            {
+              case ::elf::elf_section_header::SHT_DYNAMIC:
+              case ::elf::elf_section_header::SHT_DYNSYM:
+              case ::elf::elf_section_header::SHT_HASH:
+              case ::elf::elf_section_header::SHT_GNU_HASH:
+              case ::elf::elf_section_header::SHT_NOTE:
+              case ::elf::elf_section_header::SHT_INIT_ARRAY:
+              case ::elf::elf_section_header::SHT_FINI_ARRAY:
+              case ::elf::elf_section_header::SHT_PREINIT_ARRAY:
+                parsed = true;
+                break;
+              case ::elf::elf_section_header::SHT_STRTAB:
+                parsed = i == names_index || (Layout::get(section_header.sh_flags) & ::elf::elf_section_header::SHF_ALLOC) != 0;
+                break;
+              default:
+                break;
+            }
+            if (parsed)
+            {
+              file.reads.push_back({Layout::get(section_header.sh_offset), Layout::get(section_header.sh_size)});
+            }
+          }
+        }
 
-            if (hash1 != (hash2 & ~1))
+        /*
+         * Clamp a stage's reads to the file, merge the ones that touch the
+         * same pages, drop the pages already in the page cache and split
+         * what is left into reads no larger than the sink
+         */
+        void split_reads(open_file &file)
+        {
+          const auto page_size = static_cast<std::uint64_t>(::sysconf(_SC_PAGESIZE));
+          const std::span<const std::byte> image = file.mapping.data();
+          const std::uint64_t file_size = image.size();
+          std::vector<read_range> ranges;
+          for (const read_range &range: file.reads)
+          {
+            if (range.size != 0 && range.offset < file_size)
             {
-              continue;
+              const std::uint64_t start = range.offset & ~(page_size - 1);
+              ranges.push_back({start, std::min(range.size, file_size - range.offset) + (range.offset - start)});
             }
+          }
+          std::sort(ranges.begin(), ranges.end(), [](const read_range &a, const read_range &b) { return a.offset < b.offset; });
 
-            if (std::strcmp(current_symbol->st_name_str, name) == 0)
+          file.reads.clear();
+          for (std::size_t i = 0; i < ranges.size();)
+          {
+            std::uint64_t start = ranges[i].offset;
+            std::uint64_t end = start + ranges[i].size;
+            for (i++; i < ranges.size() && ranges[i].offset <= end + page_size; i++)
             {
-              return current_symbol;
+              end = std::max(end, ranges[i].offset + ranges[i].size);
             }
+            end = std::min(end, file_size);
 
-            if (hash2 & 1)
+            const std::uint64_t pages = (end - start + page_size - 1) / page_size;
+            this->residency.resize(static_cast<std::size_t>(pages));
+            if (::mincore(const_cast<std::byte *>(image.data()) + start, static_cast<std::size_t>(end - start), this->residency.data()) != 0)
+            {
+              std::fill(this->residency.begin(), this->residency.end(), static_cast<unsigned char>(0));
+            }
+            for (std::uint64_t page = 0; page < pages;)
             {
-              return this->dynamic_symbols.cend();
+              if (this->residency[page] & 1)
+              {
+                page++;
+                continue;
+              }
+              const std::uint64_t first = page;
+              while (page < pages && !(this->residency[page] & 1) && (page - first) * page_size < sink_size)
+              {
+                page++;
+              }
+              const std::uint64_t offset = start + first * page_size;
+              file.reads.push_back({offset, std::min(end, start + page * page_size) - offset});
             }
           }
-
-          return this->dynamic_symbols.cend();
         }
+
+        ::elf::detail::io_ring ring;
+        std::vector<open_file> slots;
+        std::vector<std::size_t> free_slots;
+        std::deque<std::size_t> waiting;
+        std::deque<std::size_t> loaded;
+        std::vector<std::byte> sink;
+        std::vector<unsigned char> residency;
+        unsigned in_flight = 0;
+#endif
+
+        ::elf::async_load_options options;
+        std::deque<std::filesystem::path> queued;
+        std::size_t pending_count = 0;
+        ::elf::arena arena;
+        std::string last_error;
     };
 }
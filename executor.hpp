@@ -0,0 +1,513 @@
+/*
+ * ISC License
+ *
+ * Copyright 2023 Charley Wright
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+ * granted, provided that the above copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#define EXECUTOR_HPP_AFFINITY 1
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+/*
+ * The task executor shared by elf.hpp and luhns.hpp. Both run their
+ * parallel work through an exec::executor, by default the one process-wide
+ * pool default_executor() returns, so a program using both libraries has
+ * one set of worker threads. A program with its own pool can implement
+ * executor over it and pass it to set_default_executor() before using
+ * either library, and the built-in pool is then never started
+ */
+namespace exec
+{
+    /*
+     * Size of the blocks worker_local pads its slots to, so workers
+     * writing to neighbouring slots don't share a cache line
+     */
+    inline constexpr std::size_t cache_line_size = 64;
+
+    /*
+     * CPUs this process may run on, empty where that can't be queried
+     */
+    inline std::vector<unsigned> allowed_cpus()
+    {
+      std::vector<unsigned> cpus;
+#if defined(EXECUTOR_HPP_AFFINITY)
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      if (::sched_getaffinity(0, sizeof(set), &set) == 0)
+      {
+        for (unsigned cpu = 0; cpu < CPU_SETSIZE; cpu++)
+        {
+          if (CPU_ISSET(cpu, &set))
+          {
+            cpus.push_back(cpu);
+          }
+        }
+      }
+#endif
+      return cpus;
+    }
+
+    /*
+     * Hardware threads this process may run on, at least one. Unlike
+     * std::thread::hardware_concurrency this respects an affinity mask set
+     * by taskset or a container, so a pool sized by it doesn't oversubscribe
+     * the cores it was given
+     */
+    inline std::size_t hardware_threads()
+    {
+      const std::size_t allowed = ::exec::allowed_cpus().size();
+      if (allowed != 0)
+      {
+        return allowed;
+      }
+      return std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+    }
+
+    /*
+     * Runs batches of independent tasks
+     */
+    class executor
+    {
+    public:
+        virtual ~executor() = default;
+
+        /*
+         * Number of distinct worker indices for_each passes to tasks
+         */
+        virtual std::size_t concurrency() const = 0;
+
+        /*
+         * Call task(i, worker) for every i in [0, count) and return once all
+         * of them have finished. worker is below concurrency() and tasks of
+         * one call running at the same time never share it, so per-worker
+         * state can be indexed by it. Tasks must not throw
+         */
+        virtual void for_each(std::size_t count, const std::function<void(std::size_t, std::size_t)> &task) = 0;
+    };
+
+    /*
+     * Runs every task on the calling thread, in order
+     */
+    class inline_executor : public executor
+    {
+    public:
+        std::size_t concurrency() const override
+        {
+          return 1;
+        }
+
+        void for_each(std::size_t count, const std::function<void(std::size_t, std::size_t)> &task) override
+        {
+          for (std::size_t i = 0; i < count; i++)
+          {
+            task(i, 0);
+          }
+        }
+    };
+
+    /*
+     * One T per worker of an executor, indexed by the worker argument of
+     * for_each, for scratch buffers and arenas that are reused from task
+     * to task without locking. Each is padded to its own cache line
+     */
+    template<typename T>
+    class worker_local
+    {
+    public:
+        explicit worker_local(std::size_t workers) : slots(new slot[workers]), count(workers)
+        {
+        }
+
+        explicit worker_local(const ::exec::executor &executor) : worker_local(executor.concurrency())
+        {
+        }
+
+        T &operator[](std::size_t worker)
+        {
+          return this->slots[worker].value;
+        }
+
+        const T &operator[](std::size_t worker) const
+        {
+          return this->slots[worker].value;
+        }
+
+        std::size_t size() const
+        {
+          return this->count;
+        }
+
+        bool empty() const
+        {
+          return this->count == 0;
+        }
+
+    private:
+        typedef struct alignas(cache_line_size) slot
+        {
+            T value{};
+        } slot;
+
+        std::unique_ptr<slot[]> slots;
+        std::size_t count;
+    };
+
+    /*
+     * Options controlling the workers of a thread_pool
+     */
+    typedef struct pool_options
+    {
+        std::size_t threads = 0;     /* Workers to start, hardware_threads() when 0 */
+        bool pin_threads = false;    /* Pin each worker to one CPU */
+        std::vector<unsigned> cpus;  /* CPUs workers are pinned to in turn, allowed_cpus() when empty */
+    } pool_options;
+
+    /*
+     * A fixed set of worker threads, each with its own task queue. Workers
+     * take from the back of their own queue and steal from the front of
+     * the others when it runs dry. for_each called from a worker queues
+     * onto that worker and helps run tasks until its batch is done, so
+     * nested batches don't deadlock. While it waits it only runs tasks of
+     * that batch, as a task of any other batch would reuse the worker index
+     * of the task that is suspended. Other callers block until the batch
+     * completes
+     */
+    class thread_pool : public executor
+    {
+    public:
+        /*
+         * Start threads workers, at least one
+         */
+        explicit thread_pool(std::size_t threads = ::exec::hardware_threads())
+        {
+          this->start(threads, {});
+        }
+
+        explicit thread_pool(const ::exec::pool_options &options)
+        {
+          std::vector<unsigned> cpus;
+          if (options.pin_threads)
+          {
+            cpus = options.cpus.empty() ? ::exec::allowed_cpus() : options.cpus;
+          }
+          this->start(options.threads != 0 ? options.threads : ::exec::hardware_threads(), cpus);
+        }
+
+        ~thread_pool() override
+        {
+          {
+            std::lock_guard<std::mutex> lock(this->sleep_mutex);
+            this->stopping = true;
+          }
+          this->wake.notify_all();
+          for (auto &worker: this->workers)
+          {
+            worker.join();
+          }
+        }
+
+        thread_pool(const thread_pool &copy) = delete;
+        thread_pool &operator=(const thread_pool &copy) = delete;
+
+        std::size_t concurrency() const override
+        {
+          return this->workers.size();
+        }
+
+        void for_each(std::size_t count, const std::function<void(std::size_t, std::size_t)> &task) override
+        {
+          if (count == 0)
+          {
+            return;
+          }
+          batch current_batch(&task, count);
+          const std::size_t worker = this->current_worker();
+
+          /*
+           * A worker keeps its batch to itself for others to steal, anyone
+           * else spreads it evenly over the queues
+           */
+          const std::size_t queue_count = this->queues.size();
+          for (std::size_t q = 0; q < queue_count; q++)
+          {
+            const std::size_t begin = worker == npos ? count * q / queue_count : (q == 0 ? 0 : count);
+            const std::size_t end = worker == npos ? count * (q + 1) / queue_count : count;
+            if (begin == end)
+            {
+              continue;
+            }
+            worker_queue &queue = *this->queues[worker == npos ? q : worker];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            for (std::size_t i = begin; i < end; i++)
+            {
+              queue.tasks.push_back({&current_batch, i});
+            }
+            this->queued.fetch_add(end - begin, std::memory_order_release);
+          }
+          {
+            std::lock_guard<std::mutex> lock(this->sleep_mutex);
+          }
+          this->wake.notify_all();
+
+          if (worker != npos)
+          {
+            while (current_batch.remaining.load(std::memory_order_acquire) != 0)
+            {
+              if (!this->run_one(worker, &current_batch))
+              {
+                std::this_thread::yield();
+              }
+            }
+          }
+          std::unique_lock<std::mutex> lock(current_batch.mutex);
+          current_batch.finished.wait(lock, [&current_batch] { return current_batch.done; });
+        }
+
+        /*
+         * Index of the calling thread within this pool, npos for threads
+         * that don't belong to it
+         */
+        std::size_t current_worker() const
+        {
+          return current_pool == this ? current_index : npos;
+        }
+
+        /*
+         * Whether every worker was pinned to a CPU. False when pinning
+         * wasn't asked for, isn't supported here or a CPU was refused
+         */
+        bool is_pinned() const
+        {
+          return this->pinned;
+        }
+
+        inline static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+    private:
+        typedef struct batch
+        {
+            batch(const std::function<void(std::size_t, std::size_t)> *task, std::size_t count) : task(task), remaining(count)
+            {
+            }
+
+            const std::function<void(std::size_t, std::size_t)> *task;
+            std::atomic<std::size_t> remaining;
+            std::mutex mutex;
+            std::condition_variable finished;
+            bool done = false;
+        } batch;
+
+        typedef struct queued_task
+        {
+            batch *owner;
+            std::size_t index;
+        } queued_task;
+
+        typedef struct worker_queue
+        {
+            std::mutex mutex;
+            std::deque<queued_task> tasks;
+        } worker_queue;
+
+        inline static thread_local const thread_pool *current_pool = nullptr;
+        inline static thread_local std::size_t current_index = 0;
+
+        std::vector<std::unique_ptr<worker_queue>> queues;
+        std::vector<std::thread> workers;
+        std::atomic<std::size_t> queued = 0;
+        std::mutex sleep_mutex;
+        std::condition_variable wake;
+        bool stopping = false;
+        bool pinned = false;
+
+        /*
+         * Start threads workers, pinning worker i to cpus[i % cpus.size()]
+         * unless cpus is empty
+         */
+        void start(std::size_t threads, const std::vector<unsigned> &cpus)
+        {
+          threads = std::max<std::size_t>(threads, 1);
+          for (std::size_t i = 0; i < threads; i++)
+          {
+            this->queues.push_back(std::make_unique<worker_queue>());
+          }
+          this->pinned = !cpus.empty();
+          for (std::size_t i = 0; i < threads; i++)
+          {
+            this->workers.emplace_back([this, i] { this->run_worker(i); });
+            if (!cpus.empty())
+            {
+              this->pinned = pin_thread(this->workers.back(), cpus[i % cpus.size()]) && this->pinned;
+            }
+          }
+        }
+
+        static bool pin_thread(std::thread &thread, unsigned cpu)
+        {
+#if defined(EXECUTOR_HPP_AFFINITY)
+          if (cpu >= CPU_SETSIZE)
+          {
+            return false;
+          }
+          cpu_set_t set;
+          CPU_ZERO(&set);
+          CPU_SET(cpu, &set);
+          return ::pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) == 0;
+#else
+          static_cast<void>(thread);
+          static_cast<void>(cpu);
+          return false;
+#endif
+        }
+
+        void run_worker(std::size_t index)
+        {
+          current_pool = this;
+          current_index = index;
+          while (true)
+          {
+            if (this->run_one(index))
+            {
+              continue;
+            }
+            std::unique_lock<std::mutex> lock(this->sleep_mutex);
+            this->wake.wait(lock, [this] { return this->stopping || this->queued.load(std::memory_order_acquire) != 0; });
+            if (this->stopping && this->queued.load(std::memory_order_acquire) == 0)
+            {
+              return;
+            }
+          }
+        }
+
+        /*
+         * Run one task from our own queue or, failing that, stolen from
+         * another. With only set, just run a task of that batch from our
+         * own queue, where all of a worker's batch is queued. Returns false
+         * if there was no task to run
+         */
+        bool run_one(std::size_t index, const batch *only = nullptr)
+        {
+          queued_task task{};
+          if (only != nullptr ? !this->take_from_batch(index, only, task) : !this->take(index, task))
+          {
+            return false;
+          }
+          (*task.owner->task)(task.index, index);
+
+          /*
+           * The batch lives on the stack of its for_each, which can return
+           * as soon as done is set, so it must not be touched after unlocking
+           */
+          if (task.owner->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+          {
+            std::lock_guard<std::mutex> lock(task.owner->mutex);
+            task.owner->done = true;
+            task.owner->finished.notify_all();
+          }
+          return true;
+        }
+
+        /*
+         * The task of owner queued last on our own queue. Tasks queued after
+         * it by other callers are left for the workers to take in turn
+         */
+        bool take_from_batch(std::size_t index, const batch *owner, queued_task &task)
+        {
+          worker_queue &own = *this->queues[index];
+          std::lock_guard<std::mutex> lock(own.mutex);
+          const auto it = std::find_if(own.tasks.rbegin(), own.tasks.rend(), [owner](const queued_task &queued) { return queued.owner == owner; });
+          if (it == own.tasks.rend())
+          {
+            return false;
+          }
+          task = *it;
+          own.tasks.erase(std::next(it).base());
+          this->queued.fetch_sub(1, std::memory_order_relaxed);
+          return true;
+        }
+
+        bool take(std::size_t index, queued_task &task)
+        {
+          {
+            worker_queue &own = *this->queues[index];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty())
+            {
+              task = own.tasks.back();
+              own.tasks.pop_back();
+              this->queued.fetch_sub(1, std::memory_order_relaxed);
+              return true;
+            }
+          }
+          for (std::size_t offset = 1; offset < this->queues.size(); offset++)
+          {
+            worker_queue &victim = *this->queues[(index + offset) % this->queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty())
+            {
+              task = victim.tasks.front();
+              victim.tasks.pop_front();
+              this->queued.fetch_sub(1, std::memory_order_relaxed);
+              return true;
+            }
+          }
+          return false;
+        }
+    };
+
+    namespace detail
+    {
+        inline std::atomic<::exec::executor *> installed_executor = nullptr;
+    }
+
+    /*
+     * Make default_executor() return executor, or the built-in pool again
+     * when null. executor must outlive every use of it through either
+     * library, so install it before starting work and reset it after
+     */
+    inline void set_default_executor(::exec::executor *executor)
+    {
+      ::exec::detail::installed_executor.store(executor, std::memory_order_release);
+    }
+
+    /*
+     * The executor installed with set_default_executor, otherwise a
+     * process-wide thread pool of hardware_threads() workers started on
+     * first use
+     */
+    inline ::exec::executor &default_executor()
+    {
+      ::exec::executor *const installed = ::exec::detail::installed_executor.load(std::memory_order_acquire);
+      if (installed != nullptr)
+      {
+        return *installed;
+      }
+      static ::exec::thread_pool pool;
+      return pool;
+    }
+}
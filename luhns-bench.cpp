@@ -0,0 +1,344 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "luhns.hpp"
+
+/*
+ * Benchmarks for luhns.hpp: card_number and check_card over a vector of
+ * strings, validate_batch over packed buffers at every SIMD level this
+ * machine has, and file_validator over CSV held in memory and read as a
+ * stream with different thread counts.
+ *
+ * Every run covers numbers of 15, 16 and 19 digits and a mix of the three,
+ * each all valid, half valid and all invalid. Every path is checked against
+ * a copy of the original card_number arithmetic before it is timed.
+ *
+ * Usage: luhns-bench [-n iterations] [-c count] [-t threads]...
+ */
+
+/*
+ * Synthetic numbers
+ */
+
+typedef struct number_mix
+{
+    const char *name;
+    std::vector<std::size_t> lengths;  /* Picked in turn */
+    double valid_ratio;
+} number_mix;
+
+typedef struct number_set
+{
+    std::vector<std::string> strings;
+    std::string packed;  /* The numbers back to back */
+    std::vector<std::uint64_t> offsets;  /* Into packed, one more than there are numbers */
+    std::string csv;  /* "id,number,amount" rows */
+    std::size_t reference_valid = 0;
+} number_set;
+
+/*
+ * The check card_number did before the batch paths existed
+ */
+bool reference_valid(const std::string &number)
+{
+  const auto add_digits = [](int num) {
+      int ret = 0;
+      do
+      {
+        ret += num % 10;
+        num /= 10;
+      } while (num > 0);
+      return ret;
+  };
+  std::size_t checksum = 0;
+  for (std::size_t i = 0; i < number.size(); i++)
+  {
+    if (number.size() % 2 == i % 2)
+    {
+      checksum += add_digits(static_cast<int>(number[i] - '0') * 2);
+    } else
+    {
+      checksum += static_cast<int>(number[i] - '0');
+    }
+  }
+  return checksum % 10 == 0;
+}
+
+/*
+ * count numbers from number_generator with prefixes of each network,
+ * those past the valid ratio getting their check digit bumped
+ */
+number_set make_numbers(const number_mix &mix, std::size_t count, std::uint64_t seed)
+{
+  const char *prefixes[] = {"411111", "378282", "555555", "601111"};
+  std::mt19937_64 rng(seed);
+  number_set set;
+  set.strings.reserve(count);
+  for (std::size_t i = 0; i < count; i++)
+  {
+    const std::size_t length = mix.lengths[i % mix.lengths.size()];
+    luhns::number_generator generator(prefixes[i % std::size(prefixes)], length, rng());
+    std::string number(length, '0');
+    generator.fill(number);
+    if (static_cast<double>(rng() % 1000) >= mix.valid_ratio * 1000)
+    {
+      number.back() = static_cast<char>('0' + (number.back() - '0' + 1) % 10);
+    }
+    set.strings.push_back(std::move(number));
+  }
+  std::shuffle(set.strings.begin(), set.strings.end(), rng);
+
+  set.offsets.push_back(0);
+  for (std::size_t i = 0; i < set.strings.size(); i++)
+  {
+    set.packed += set.strings[i];
+    set.offsets.push_back(set.packed.size());
+    set.csv += std::to_string(i) + "," + set.strings[i] + ",12.34\n";
+    set.reference_valid += reference_valid(set.strings[i]);
+  }
+  return set;
+}
+
+/*
+ * Timing
+ */
+
+/*
+ * Best of iterations runs in milliseconds. Negative when a run fails
+ */
+template<typename Run>
+double time_best(std::size_t iterations, Run &&run)
+{
+  double best = -1;
+  for (std::size_t i = 0; i < iterations; i++)
+  {
+    const auto start = std::chrono::steady_clock::now();
+    if (!run())
+    {
+      return -1;
+    }
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    best = best < 0 ? elapsed.count() : std::min(best, elapsed.count());
+  }
+  return best;
+}
+
+void print_case(const std::string &name, double ms, std::size_t numbers, std::size_t bytes = 0)
+{
+  std::cout << "  " << name << ": ";
+  if (ms < 0)
+  {
+    std::cout << "failed" << std::endl;
+    return;
+  }
+  std::cout << ms << " ms (" << ms * 1e6 / static_cast<double>(numbers) << " ns/number, "
+            << static_cast<double>(numbers) / ms / 1e3 << " M numbers/s";
+  if (bytes != 0)
+  {
+    std::cout << ", " << static_cast<double>(bytes) / ms / 1e6 << " GB/s";
+  }
+  std::cout << ")" << std::endl;
+}
+
+/*
+ * Cases
+ */
+
+/*
+ * Whether every path agrees with reference_valid on every number of set
+ */
+bool cross_check(const number_set &set, const std::vector<luhns::detail::simd_level> &levels)
+{
+  const std::size_t count = set.strings.size();
+  const std::unique_ptr<bool[]> valid(new bool[count]);
+  std::size_t mismatches = 0;
+  for (std::size_t i = 0; i < count; i++)
+  {
+    const bool expected = reference_valid(set.strings[i]);
+    mismatches += luhns::card_number(set.strings[i]).is_valid() != expected;
+    mismatches += luhns::check_card(set.strings[i]).valid != expected;
+  }
+  for (const auto level: levels)
+  {
+    luhns::detail::validate_numbers(luhns::detail::offset_numbers<std::uint64_t>{set.packed, set.offsets}, std::span<bool>(valid.get(), count), level);
+    for (std::size_t i = 0; i < count; i++)
+    {
+      mismatches += valid[i] != reference_valid(set.strings[i]);
+    }
+  }
+  luhns::file_options options;
+  options.field = 1;
+  luhns::file_validator validator(options);
+  validator.validate(std::span<const char>(set.csv.data(), set.csv.size()));
+  mismatches += validator.get_stats().valid != set.reference_valid || validator.get_stats().rows != count;
+  if (mismatches != 0)
+  {
+    std::cerr << "  " << mismatches << " results differ from the reference" << std::endl;
+  }
+  return mismatches == 0;
+}
+
+const char *simd_level_str(luhns::detail::simd_level level)
+{
+  switch (level)
+  {
+    case luhns::detail::simd_level::scalar:
+      return "scalar";
+    case luhns::detail::simd_level::sse4_2:
+      return "sse4.2";
+    case luhns::detail::simd_level::avx2:
+      return "avx2";
+    case luhns::detail::simd_level::avx512:
+      return "avx512";
+    case luhns::detail::simd_level::neon:
+      return "neon";
+  }
+  return "unknown";
+}
+
+/*
+ * The levels up to the one detected, which are the ones that can run
+ */
+std::vector<luhns::detail::simd_level> supported_levels()
+{
+  const luhns::detail::simd_level detected = luhns::detail::get_simd_level();
+  std::vector<luhns::detail::simd_level> levels = {luhns::detail::simd_level::scalar};
+  if (detected == luhns::detail::simd_level::neon)
+  {
+    levels.push_back(detected);
+    return levels;
+  }
+  for (const auto level: {luhns::detail::simd_level::sse4_2, luhns::detail::simd_level::avx2, luhns::detail::simd_level::avx512})
+  {
+    if (static_cast<int>(level) <= static_cast<int>(detected))
+    {
+      levels.push_back(level);
+    }
+  }
+  return levels;
+}
+
+bool bench_mix(const number_mix &mix, std::size_t count, std::size_t iterations, const std::vector<std::size_t> &thread_counts)
+{
+  const number_set set = make_numbers(mix, count, 42);
+  const std::vector<luhns::detail::simd_level> levels = supported_levels();
+  std::cout << mix.name << ": " << count << " numbers, " << set.reference_valid << " valid" << std::endl;
+  if (!cross_check(set, levels))
+  {
+    return false;
+  }
+  const std::unique_ptr<bool[]> valid(new bool[count]);
+
+  print_case("Reference, std::string vector", time_best(iterations, [&]() {
+      std::size_t valid_count = 0;
+      for (const auto &number: set.strings)
+      {
+        valid_count += reference_valid(number);
+      }
+      return valid_count == set.reference_valid;
+  }), count);
+  print_case("card_number, std::string vector", time_best(iterations, [&]() {
+      std::size_t valid_count = 0;
+      for (const auto &number: set.strings)
+      {
+        valid_count += luhns::card_number(number).is_valid();
+      }
+      return valid_count == set.reference_valid;
+  }), count);
+  print_case("check_card, std::string vector", time_best(iterations, [&]() {
+      std::size_t valid_count = 0;
+      for (const auto &number: set.strings)
+      {
+        valid_count += luhns::check_card(number).valid;
+      }
+      return valid_count == set.reference_valid;
+  }), count);
+
+  for (const auto level: levels)
+  {
+    print_case(std::string("validate_batch, packed offsets, ") + simd_level_str(level), time_best(iterations, [&]() {
+        const luhns::detail::offset_numbers<std::uint64_t> numbers{set.packed, set.offsets};
+        return luhns::detail::validate_numbers(numbers, std::span<bool>(valid.get(), count), level) == set.reference_valid;
+    }), count, set.packed.size());
+  }
+  if (mix.lengths.size() == 1)
+  {
+    const std::size_t length = mix.lengths.front();
+    for (const auto level: levels)
+    {
+      print_case(std::string("validate_batch, packed stride, ") + simd_level_str(level), time_best(iterations, [&]() {
+          const luhns::detail::strided_numbers numbers{set.packed, length, length};
+          return luhns::detail::validate_numbers(numbers, std::span<bool>(valid.get(), count), level) == set.reference_valid;
+      }), count, set.packed.size());
+    }
+  }
+
+  for (const std::size_t threads: thread_counts)
+  {
+    luhns::file_options options;
+    options.field = 1;
+    options.threads = threads;
+    luhns::file_validator validator(options);
+    print_case("file_validator, CSV in memory, " + std::to_string(threads) + " threads", time_best(iterations, [&]() {
+        return validator.validate(std::span<const char>(set.csv.data(), set.csv.size())) && validator.get_stats().valid == set.reference_valid;
+    }), count, set.csv.size());
+    print_case("file_validator, CSV stream, " + std::to_string(threads) + " threads", time_best(iterations, [&]() {
+        std::istringstream stream(set.csv);
+        return validator.validate(stream) && validator.get_stats().valid == set.reference_valid;
+    }), count, set.csv.size());
+  }
+  return true;
+}
+
+int main(int argc, char *argv[])
+{
+  std::size_t iterations = 5;
+  std::size_t count = 1000000;
+  std::vector<std::size_t> thread_counts;
+  for (int i = 1; i < argc; i++)
+  {
+    const bool has_value = i + 1 < argc;
+    if (std::strcmp(argv[i], "-n") == 0 && has_value)
+    {
+      iterations = std::max(1, std::atoi(argv[++i]));
+    } else if (std::strcmp(argv[i], "-c") == 0 && has_value)
+    {
+      count = std::max(1, std::atoi(argv[++i]));
+    } else if (std::strcmp(argv[i], "-t") == 0 && has_value)
+    {
+      thread_counts.push_back(std::max(1, std::atoi(argv[++i])));
+    } else
+    {
+      std::cerr << "Usage: " << std::filesystem::path(argv[0]).filename().string() << " [-n iterations] [-c count] [-t threads]..." << std::endl;
+      return 1;
+    }
+  }
+  if (thread_counts.empty())
+  {
+    thread_counts = {1, exec::hardware_threads()};
+    thread_counts.erase(std::unique(thread_counts.begin(), thread_counts.end()), thread_counts.end());
+  }
+
+  const number_mix mixes[] = {
+      {"15 digits, all valid", {15}, 1.0},
+      {"16 digits, all valid", {16}, 1.0},
+      {"16 digits, half valid", {16}, 0.5},
+      {"16 digits, none valid", {16}, 0.0},
+      {"19 digits, all valid", {19}, 1.0},
+      {"15/16/19 digits, half valid", {15, 16, 19}, 0.5},
+  };
+  bool agreed = true;
+  for (const auto &mix: mixes)
+  {
+    agreed = bench_mix(mix, count, iterations, thread_counts) && agreed;
+  }
+  return agreed ? 0 : 1;
+}
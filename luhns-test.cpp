@@ -1,9 +1,48 @@
 #include "./luhns.hpp"
+#include <memory>
+#include <string>
+#include <string_view>
 #include <vector>
 #include <iostream>
 
+static_assert(luhns::card_view("4111111111111111").is_valid());
+static_assert(luhns::check_card("378282246310005").provider == luhns::provider::amex);
+static_assert(!luhns::check_card("4111111111111112").valid);
+
 int main(int argc, char **argv)
 {
+  if (argc > 2 && std::string_view(argv[1]) == "--file")
+  {
+    luhns::file_options options;
+    if (argc > 3)
+    {
+      options.field = std::stoul(argv[3]);
+    }
+    if (argc > 4)
+    {
+      options.delimiter = argv[4][0];
+    }
+    luhns::file_validator validator(options);
+    if (!validator.validate(std::filesystem::path(argv[2])))
+    {
+      std::cerr << "Failed to validate file: " << validator.error_message() << std::endl;
+      return 1;
+    }
+    const luhns::file_stats &stats = validator.get_stats();
+    std::cout << "Rows: " << stats.rows << " Valid: " << stats.valid << "\n";
+    for (std::size_t i = 0; i < luhns::provider_count; i++)
+    {
+      const auto p = static_cast<luhns::provider>(i);
+      std::cout << "  " << luhns::provider_str(p) << ": " << stats.of(p).numbers << " numbers, " << stats.of(p).valid << " valid\n";
+    }
+    for (std::size_t i = 0; i < stats.invalid_rows.size() && i < 10; i++)
+    {
+      std::cout << "  Invalid row at byte " << stats.invalid_rows[i] << "\n";
+    }
+    std::cout << "Read " << stats.bytes << " bytes in " << stats.nanoseconds / 1000 << "us, " << stats.bytes_per_second() / 1e9 << " GB/s" << std::endl;
+    return 0;
+  }
+
   if (argc > 1)
   {
     luhns::card_number number(argv[1]);
@@ -59,4 +98,45 @@ int main(int argc, char **argv)
     luhns::card_number number(n);
     std::cout << "Type: " << luhns::provider_str(number.get_provider()) << " Valid: " << number.is_valid() << std::endl;
   }
+
+  std::cout << "Views:\n";
+  for (const auto *numbers : {&amex, &mastercard, &visa})
+  {
+    for (const auto &n : *numbers)
+    {
+      const luhns::card_view number(n);
+      std::cout << "Type: " << luhns::provider_str(number.get_provider()) << " Valid: " << number.is_valid() << std::endl;
+    }
+  }
+
+  std::cout << "Networks:\n";
+  const luhns::iin_table networks = luhns::iin_table::networks();
+  for (const auto &n : {"6011111111111117", "3530111333300000", "36227206271667", "378282246310005"})
+  {
+    luhns::card_number number(n, networks);
+    std::cout << "Type: " << luhns::provider_str(number.get_provider()) << " Valid: " << number.is_valid() << std::endl;
+  }
+
+  std::cout << "Batch:\n";
+  std::string digits;
+  std::vector<std::uint32_t> offsets = {0};
+  for (const auto *numbers : {&amex, &mastercard, &visa})
+  {
+    for (const auto &n : *numbers)
+    {
+      digits += n;
+      offsets.push_back(static_cast<std::uint32_t>(digits.size()));
+    }
+  }
+  const std::size_t count = offsets.size() - 1;
+  const std::unique_ptr<bool[]> valid(new bool[count]);
+  const std::size_t valid_count = luhns::validate_batch(digits, offsets, std::span<bool>(valid.get(), count));
+  std::cout << "Valid: " << valid_count << "/" << count << std::endl;
+
+  std::cout << "Generated:\n";
+  luhns::number_generator generator("411111", 16, 1, '\n');
+  std::string generated(4 * generator.record_size(), '\0');
+  generator.fill(generated);
+  std::cout << generated;
+  std::cout << "Check digit of 411111111111111: " << luhns::compute_check_digit("411111111111111") << std::endl;
 }
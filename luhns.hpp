@@ -3,6 +3,41 @@
 #include <string>
 #include <vector>
 #include <iostream>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include "executor.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define LUHNS_HPP_POSIX 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*
+ * Define LUHNS_HPP_NO_SIMD to build validate_batch without SIMD
+ */
+#if !defined(LUHNS_HPP_NO_SIMD) && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define LUHNS_HPP_X86_SIMD 1
+#include <immintrin.h>
+#elif !defined(LUHNS_HPP_NO_SIMD) && defined(__aarch64__) && defined(__ARM_NEON)
+#define LUHNS_HPP_NEON 1
+#include <arm_neon.h>
+#endif
 
 namespace luhns
 {
@@ -11,9 +46,19 @@ namespace luhns
         invalid = 0,
         visa,
         amex,
-        master_card
+        master_card,
+        discover,
+        diners_club,
+        jcb,
+        unionpay,
+        maestro
     };
 
+    /*
+     * How many values provider has, for tables indexed by it
+     */
+    inline constexpr std::size_t provider_count = 9;
+
     inline const char *provider_str(provider p)
     {
       switch (p)
@@ -26,47 +71,520 @@ namespace luhns
           return "american express";
         case provider::master_card:
           return "mastercard";
+        case provider::discover:
+          return "discover";
+        case provider::diners_club:
+          return "diners club";
+        case provider::jcb:
+          return "jcb";
+        case provider::unionpay:
+          return "unionpay";
+        case provider::maestro:
+          return "maestro";
         default:
           return "unknown";
       }
     }
 
-    class card_number
+    namespace detail
+    {
+        /*
+         * Sum the digits of num. A negative num only gives num % 10
+         */
+        constexpr int add_digits(int num)
+        {
+          int ret = 0;
+          do
+          {
+            ret += num % 10;
+            num /= 10;
+          } while (num > 0);
+          return ret;
+        }
+
+        /*
+         * add_digits(digit * 2) for every digit, what Luhn adds for a
+         * doubled digit
+         */
+        alignas(16) inline constexpr std::array<std::uint8_t, 16> doubled_digit_sums = {0, 2, 4, 6, 8, 1, 3, 5, 7, 9};
+
+        /*
+         * Luhn check of length characters at number. Every digit from the
+         * second to last going left is doubled. Bytes that aren't digits
+         * are summed as their distance from '0', so any input checks the
+         * same as card_number always has
+         */
+        constexpr bool luhn_valid(const char *number, std::size_t length)
+        {
+          std::size_t checksum = 0;
+          for (std::size_t i = 0; i < length; i++)
+          {
+            const int digit = static_cast<int>(number[i] - '0');
+            const bool doubled = ((length - i) & 1) == 0;
+            if (static_cast<unsigned int>(digit) < 10)
+            {
+              checksum += doubled ? doubled_digit_sums[digit] : digit;
+            } else
+            {
+              checksum += doubled ? luhns::detail::add_digits(digit * 2) : digit;
+            }
+          }
+          return checksum % 10 == 0;
+        }
+
+        /*
+         * The provider a number's first digit names
+         */
+        constexpr luhns::provider provider_of(std::string_view number)
+        {
+          if (number.empty())
+          {
+            return luhns::provider::invalid;
+          }
+          switch (number.front())
+          {
+            case '4':
+              return luhns::provider::visa;
+            case '3':
+              return luhns::provider::amex;
+            case '2':
+            case '5':
+              return luhns::provider::master_card;
+            default:
+              return luhns::provider::invalid;
+          }
+        }
+    }
+
+    /*
+     * The provider and validity of a number, found together
+     */
+    typedef struct card_check
+    {
+        luhns::provider provider = luhns::provider::invalid;
+        bool valid = false;
+    } card_check;
+
+    /*
+     * Check number without copying or allocating. Gives the same as
+     * card_number(std::string(number)), and can run at compile time
+     */
+    constexpr luhns::card_check check_card(std::string_view number)
+    {
+      return {luhns::detail::provider_of(number), luhns::detail::luhn_valid(number.data(), number.size())};
+    }
+
+    /*
+     * The digit that makes payload followed by it pass Luhn, doubling
+     * from payload's last digit. '\0' when payload has a byte that isn't
+     * a digit
+     */
+    constexpr char compute_check_digit(std::string_view payload)
+    {
+      std::size_t checksum = 0;
+      for (std::size_t i = 0; i < payload.size(); i++)
+      {
+        const auto digit = static_cast<unsigned char>(payload[i] - '0');
+        if (digit > 9)
+        {
+          return '\0';
+        }
+        checksum += ((payload.size() - i) & 1) != 0 ? luhns::detail::doubled_digit_sums[digit] : digit;
+      }
+      return static_cast<char>('0' + (10 - checksum % 10) % 10);
+    }
+
+    /*
+     * What an IIN range says about the numbers in it
+     */
+    typedef struct iin_entry
+    {
+        luhns::provider provider = luhns::provider::invalid;
+        std::uint8_t min_length = 0;  /* Digits a number may have, 0 for no limit */
+        std::uint8_t max_length = 0;
+        std::string issuer;
+    } iin_entry;
+
+    /*
+     * Issuer identification number ranges indexed by their first 8
+     * digits. Where ranges overlap the narrowest wins, and the later added
+     * of two the same width, so a 6 or 8 digit BIN refines a network's
+     * prefix. Lookups go through a bucket of keys, sized to the table, to
+     * a branchless search of the disjoint segments the ranges flatten into
+     */
+    class iin_table
     {
     public:
-        explicit card_number(std::string number) : number(std::move(number))
+        static constexpr std::size_t key_digits = 8;
+
+        /*
+         * Add the numbers from low to high, prefixes of up to key_digits
+         * digits each. Takes effect on the next build()
+         */
+        bool add(std::string_view low, std::string_view high, luhns::iin_entry entry)
+        {
+          std::uint32_t low_key = 0, high_key = 0;
+          if (!iin_table::parse_key(low, '0', low_key) || !iin_table::parse_key(high, '9', high_key) || low_key > high_key)
+          {
+            this->last_error = "Invalid IIN range";
+            return false;
+          }
+          this->ranges.push_back({low_key, high_key, static_cast<std::uint32_t>(this->entries.size())});
+          this->entries.push_back(std::move(entry));
+          return true;
+        }
+
+        /*
+         * Add the ranges of a table with a line per range of
+         * "low,high,provider,min_length,max_length,issuer", provider being
+         * a provider_str name. Blank lines and those starting with '#' are
+         * skipped. Builds the index when every line was read
+         */
+        bool load(std::istream &stream)
+        {
+          std::string line;
+          for (std::size_t line_number = 1; std::getline(stream, line); line_number++)
+          {
+            if (!line.empty() && line.back() == '\r')
+            {
+              line.pop_back();
+            }
+            if (line.empty() || line.front() == '#')
+            {
+              continue;
+            }
+            std::array<std::string_view, 6> fields;
+            std::string_view rest = line;
+            for (std::size_t i = 0; i < fields.size(); i++)
+            {
+              const std::size_t comma = i + 1 == fields.size() ? std::string_view::npos : rest.find(',');
+              fields[i] = rest.substr(0, comma);
+              rest = comma == std::string_view::npos ? std::string_view() : rest.substr(comma + 1);
+            }
+            luhns::iin_entry entry;
+            int min_length = 0, max_length = 0;
+            if (!iin_table::parse_provider(fields[2], entry.provider) || !iin_table::parse_length(fields[3], min_length) || !iin_table::parse_length(fields[4], max_length) ||
+                !this->add(fields[0], fields[1], {entry.provider, static_cast<std::uint8_t>(min_length), static_cast<std::uint8_t>(max_length), std::string(fields[5])}))
+            {
+              this->last_error = "Invalid IIN range on line " + std::to_string(line_number);
+              return false;
+            }
+          }
+          if (stream.bad())
+          {
+            this->last_error = "Failed to read IIN table";
+            return false;
+          }
+          this->build();
+          return true;
+        }
+
+        bool load(const std::filesystem::path &path)
         {
-          if (this->number.find('4') == 0)
+          std::ifstream file(path, std::ios::in);
+          if (!file.is_open())
           {
-            this->provider = luhns::provider::visa;
-          } else if ((this->number.find('3') == 0))
+            this->last_error = "Failed to open IIN table";
+            return false;
+          }
+          return this->load(file);
+        }
+
+        /*
+         * Flatten the ranges into segments, painting them widest first so
+         * narrower ones cut into those they overlap
+         */
+        void build()
+        {
+          constexpr std::uint32_t none = std::numeric_limits<std::uint32_t>::max();
+          std::vector<range> ordered = this->ranges;
+          std::stable_sort(ordered.begin(), ordered.end(), [](const range &a, const range &b)
           {
-            this->provider = luhns::provider::amex;
-          } else if (
-                  (this->number.find('2') == 0) ||
-                  (this->number.find('5') == 0))
+            return a.high - a.low > b.high - b.low;
+          });
+          std::map<std::uint32_t, std::uint32_t> painted = {{0, none}};
+          for (const auto &r: ordered)
           {
-            this->provider = luhns::provider::master_card;
+            /*
+             * Split at both ends so the segment after the range keeps what
+             * was painted under its end
+             */
+            auto after = painted.end();
+            if (r.high + 1 < iin_table::key_count)
+            {
+              after = std::prev(painted.upper_bound(r.high + 1));
+              if (after->first != r.high + 1)
+              {
+                after = painted.emplace_hint(std::next(after), r.high + 1, after->second);
+              }
+            }
+            painted.erase(painted.lower_bound(r.low), after);
+            painted.emplace(r.low, r.entry);
           }
 
-          std::size_t checksum = 0;
-          for (std::size_t i = 0; i < this->number.size(); i++)
+          this->segments.clear();
+          for (const auto &[start, entry]: painted)
           {
-            if (this->number.size() % 2 == i % 2)
+            if (this->segments.empty() || this->segments.back().entry != entry)
             {
-              checksum += card_number::add_digits(static_cast<int>(this->number[i] - '0') * 2);
-            } else
+              this->segments.push_back({start, entry});
+            }
+          }
+          /*
+           * One or two segments a bucket, so the buckets take half the
+           * memory of the segments and a search takes a step or two
+           */
+          this->bucket_shift = iin_table::key_bits;
+          while (this->bucket_shift > iin_table::min_bucket_shift && (iin_table::key_count >> (this->bucket_shift - 1)) <= this->segments.size())
+          {
+            this->bucket_shift--;
+          }
+          const std::size_t bucket_count = (iin_table::key_count >> this->bucket_shift) + 1;
+          this->buckets.resize(bucket_count + 1);
+          std::size_t segment = 0;
+          for (std::size_t bucket = 0; bucket < bucket_count; bucket++)
+          {
+            const std::size_t first_key = bucket << this->bucket_shift;
+            while (segment + 1 < this->segments.size() && this->segments[segment + 1].start <= first_key)
+            {
+              segment++;
+            }
+            this->buckets[bucket] = static_cast<std::uint32_t>(segment);
+          }
+          this->buckets[bucket_count] = static_cast<std::uint32_t>(this->segments.size() - 1);
+        }
+
+        /*
+         * The entry of the narrowest range holding number, which is
+         * padded with zeros when shorter than key_digits. Null when none
+         * does, the number doesn't start with digits or build() hasn't run
+         */
+        const luhns::iin_entry *find(std::string_view number) const
+        {
+          std::uint32_t key = 0;
+          if (this->segments.empty() || !iin_table::parse_key(number.substr(0, iin_table::key_digits), '0', key))
+          {
+            return nullptr;
+          }
+          const std::size_t bucket = key >> this->bucket_shift;
+          const segment *base = this->segments.data() + this->buckets[bucket];
+          std::size_t count = this->buckets[bucket + 1] - this->buckets[bucket] + 1;
+          while (count > 1)
+          {
+            const std::size_t half = count / 2;
+            base = base[half].start <= key ? base + half : base;
+            count -= half;
+          }
+          return base->entry < this->entries.size() ? &this->entries[base->entry] : nullptr;
+        }
+
+        /*
+         * How many ranges have been added
+         */
+        std::size_t size() const
+        {
+          return this->ranges.size();
+        }
+
+        /*
+         * How many disjoint segments the last build() made
+         */
+        std::size_t segment_count() const
+        {
+          return this->segments.size();
+        }
+
+        /*
+         * The prefixes and lengths the card networks publish, without
+         * issuers
+         */
+        static iin_table networks()
+        {
+          struct network_range
+          {
+              const char *low;
+              const char *high;
+              luhns::provider provider;
+              std::uint8_t min_length;
+              std::uint8_t max_length;
+          };
+          static constexpr network_range network_ranges[] = {
+              {"4", "4", luhns::provider::visa, 13, 19},
+              {"34", "34", luhns::provider::amex, 15, 15},
+              {"37", "37", luhns::provider::amex, 15, 15},
+              {"51", "55", luhns::provider::master_card, 16, 16},
+              {"2221", "2720", luhns::provider::master_card, 16, 16},
+              {"6011", "6011", luhns::provider::discover, 16, 19},
+              {"644", "649", luhns::provider::discover, 16, 19},
+              {"65", "65", luhns::provider::discover, 16, 19},
+              {"36", "36", luhns::provider::diners_club, 14, 19},
+              {"300", "305", luhns::provider::diners_club, 16, 19},
+              {"38", "39", luhns::provider::diners_club, 16, 19},
+              {"3528", "3589", luhns::provider::jcb, 16, 19},
+              {"62", "62", luhns::provider::unionpay, 16, 19},
+              {"50", "50", luhns::provider::maestro, 12, 19},
+              {"56", "58", luhns::provider::maestro, 12, 19},
+              {"6304", "6304", luhns::provider::maestro, 12, 19},
+              {"6759", "6759", luhns::provider::maestro, 12, 19},
+          };
+          iin_table table;
+          for (const auto &r: network_ranges)
+          {
+            table.add(r.low, r.high, {r.provider, r.min_length, r.max_length, ""});
+          }
+          table.build();
+          return table;
+        }
+
+        bool error() const
+        {
+          return !this->last_error.empty();
+        }
+
+        const std::string &error_message() const
+        {
+          return this->last_error;
+        }
+
+    private:
+        static constexpr std::size_t key_count = 100000000;
+        static constexpr unsigned int key_bits = 27;  /* Enough for key_count */
+        static constexpr unsigned int min_bucket_shift = 10;
+
+        typedef struct range
+        {
+            std::uint32_t low;
+            std::uint32_t high;
+            std::uint32_t entry;
+        } range;
+
+        /*
+         * Keys from start up to the next segment's belong to entry, or to
+         * none when it is past the end of entries
+         */
+        typedef struct segment
+        {
+            std::uint32_t start;
+            std::uint32_t entry;
+        } segment;
+
+        /*
+         * The first key_digits digits of digits, padded with pad
+         */
+        static bool parse_key(std::string_view digits, char pad, std::uint32_t &key)
+        {
+          if (digits.empty() || digits.size() > iin_table::key_digits)
+          {
+            return false;
+          }
+          if (digits.size() == iin_table::key_digits)
+          {
+            /*
+             * Check and combine all 8 digits at once, the first being the
+             * lowest byte: pairs, then quads, then the whole
+             */
+            std::uint64_t bytes = 0;
+            for (std::size_t i = 0; i < iin_table::key_digits; i++)
+            {
+              bytes |= static_cast<std::uint64_t>(static_cast<unsigned char>(digits[i])) << (8 * i);
+            }
+            if ((bytes & 0xf0f0f0f0f0f0f0f0ull) != 0x3030303030303030ull || ((bytes + 0x0606060606060606ull) & 0xf0f0f0f0f0f0f0f0ull) != 0x3030303030303030ull)
             {
-              checksum += static_cast<int>(this->number[i] - '0');
+              return false;
             }
+            bytes -= 0x3030303030303030ull;
+            bytes = (bytes * 10 + (bytes >> 8)) & 0x00ff00ff00ff00ffull;
+            bytes = (bytes * 100 + (bytes >> 16)) & 0x0000ffff0000ffffull;
+            key = static_cast<std::uint32_t>(bytes * 10000 + (bytes >> 32));
+            return true;
           }
-          this->valid = checksum % 10 == 0;
+          key = 0;
+          for (std::size_t i = 0; i < iin_table::key_digits; i++)
+          {
+            const char digit = i < digits.size() ? digits[i] : pad;
+            if (digit < '0' || digit > '9')
+            {
+              return false;
+            }
+            key = key * 10 + static_cast<std::uint32_t>(digit - '0');
+          }
+          return true;
+        }
+
+        static bool parse_length(std::string_view digits, int &length)
+        {
+          length = 0;
+          for (const char digit: digits)
+          {
+            if (digit < '0' || digit > '9' || (length = length * 10 + (digit - '0')) > 255)
+            {
+              return false;
+            }
+          }
+          return true;
+        }
+
+        static bool parse_provider(std::string_view name, luhns::provider &p)
+        {
+          for (std::size_t i = 0; i < luhns::provider_count; i++)
+          {
+            if (name == luhns::provider_str(static_cast<luhns::provider>(i)))
+            {
+              p = static_cast<luhns::provider>(i);
+              return true;
+            }
+          }
+          return false;
+        }
+
+        std::vector<luhns::iin_entry> entries;
+        std::vector<range> ranges;
+        std::vector<segment> segments;  /* Sorted by start, the first at 0 */
+        std::vector<std::uint32_t> buckets;  /* The segment holding the first key of each bucket */
+        unsigned int bucket_shift = iin_table::key_bits;  /* Each bucket holds 1 << bucket_shift keys */
+        std::string last_error;
+    };
+
+    /*
+     * check_card with the provider and the lengths it allows from
+     * table. Numbers in no range of it are only checked by Luhn
+     */
+    inline luhns::card_check check_card(std::string_view number, const luhns::iin_table &table)
+    {
+      const luhns::iin_entry *entry = table.find(number);
+      luhns::card_check check = {luhns::provider::invalid, luhns::detail::luhn_valid(number.data(), number.size())};
+      if (entry != nullptr)
+      {
+        check.provider = entry->provider;
+        check.valid = check.valid && (entry->min_length == 0 || number.size() >= entry->min_length) && (entry->max_length == 0 || number.size() <= entry->max_length);
+      }
+      return check;
+    }
+
+    class card_number
+    {
+    public:
+        explicit card_number(std::string number) : number(std::move(number))
+        {
+          const luhns::card_check check = luhns::check_card(this->number);
+          this->provider = check.provider;
+          this->valid = check.valid;
+        }
+
+        /*
+         * Take the provider and length rules from an IIN table
+         */
+        card_number(std::string number, const luhns::iin_table &table) : number(std::move(number))
+        {
+          const luhns::card_check check = luhns::check_card(this->number, table);
+          this->provider = check.provider;
+          this->valid = check.valid;
         }
 
         card_number(const card_number &copy) = default;
         card_number &operator=(const card_number &copy) = default;
-        card_number(card_number &&move) = delete;
-        card_number &operator=(card_number &&move) = delete;
+        card_number(card_number &&move) noexcept = default;
+        card_number &operator=(card_number &&move) noexcept = default;
 
         luhns::provider get_provider() const
         {
@@ -79,19 +597,1492 @@ namespace luhns
         }
 
     private:
-        static int add_digits(int num)
+        std::string number;
+        luhns::provider provider = luhns::provider::invalid;
+        bool valid = false;
+    };
+
+    /*
+     * card_number over characters owned elsewhere, which must outlive it.
+     * Never allocates and is usable in constant expressions
+     */
+    class card_view
+    {
+    public:
+        constexpr explicit card_view(std::string_view number) : number(number), check(luhns::check_card(number))
         {
-          int ret = 0;
-          do
+        }
+
+        constexpr std::string_view get_number() const
+        {
+          return this->number;
+        }
+
+        constexpr luhns::provider get_provider() const
+        {
+          return this->check.provider;
+        }
+
+        constexpr bool is_valid() const
+        {
+          return this->check.valid;
+        }
+
+    private:
+        std::string_view number;
+        luhns::card_check check;
+    };
+
+    namespace detail
+    {
+        /*
+         * Instruction sets validate_batch may use. x86 extensions are
+         * detected at runtime, NEON is part of the aarch64 baseline
+         */
+        enum class simd_level
+        {
+            scalar = 0,
+            sse4_2,
+            avx2,
+            avx512,
+            neon,
+        };
+
+        inline simd_level detect_simd_level()
+        {
+#if defined(LUHNS_HPP_X86_SIMD)
+          __builtin_cpu_init();
+          if (__builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vl"))
+            return simd_level::avx512;
+          if (__builtin_cpu_supports("avx2"))
+            return simd_level::avx2;
+          if (__builtin_cpu_supports("sse4.2"))
+            return simd_level::sse4_2;
+          return simd_level::scalar;
+#elif defined(LUHNS_HPP_NEON)
+          return simd_level::neon;
+#else
+          return simd_level::scalar;
+#endif
+        }
+
+        /*
+         * The level validate_batch dispatches on, detected once
+         */
+        inline simd_level get_simd_level()
+        {
+          static const simd_level level = detect_simd_level();
+          return level;
+        }
+
+        constexpr std::array<std::uint8_t, 64> make_prefix_masks()
+        {
+          std::array<std::uint8_t, 64> masks{};
+          for (std::size_t i = 0; i < 32; i++)
+            masks[i] = 0xff;
+          return masks;
+        }
+
+        constexpr std::array<std::uint8_t, 48> make_parity_masks()
+        {
+          std::array<std::uint8_t, 48> masks{};
+          for (std::size_t i = 0; i < masks.size(); i += 2)
+            masks[i] = 0xff;
+          return masks;
+        }
+
+        /*
+         * 32 bytes set then 32 clear, so the vector at 32 - length has its
+         * first length bytes set
+         */
+        alignas(32) inline constexpr std::array<std::uint8_t, 64> prefix_masks = make_prefix_masks();
+
+        /*
+         * Every even byte set, so the vector at length % 2 has the bytes
+         * of a length digit number that Luhn doubles set
+         */
+        alignas(32) inline constexpr std::array<std::uint8_t, 48> parity_masks = make_parity_masks();
+
+        /*
+         * Numbers of the same length at a fixed stride
+         */
+        typedef struct strided_numbers
+        {
+            strided_numbers(std::span<const char> digits, std::size_t stride, std::size_t length) : digits(digits), stride(stride), length(length)
+            {
+              if (length <= digits.size())
+              {
+                this->count = stride == 0 ? std::numeric_limits<std::size_t>::max() : (digits.size() - length) / stride + 1;
+              }
+            }
+
+            std::span<const char> digits;
+            std::size_t stride;
+            std::size_t length;
+            std::size_t count = 0;  /* How many numbers fit in digits */
+
+            /*
+             * How many numbers from the first can be read width bytes at a
+             * time without going past the end of digits
+             */
+            std::size_t loadable(std::size_t width) const
+            {
+              if (width > this->digits.size())
+              {
+                return 0;
+              }
+              return this->stride == 0 ? this->count : std::min(this->count, (this->digits.size() - width) / this->stride + 1);
+            }
+
+            bool get(std::size_t i, const char *&number, std::size_t &number_length) const
+            {
+              if (i >= this->count)
+              {
+                return false;
+              }
+              number = this->digits.data() + i * this->stride;
+              number_length = this->length;
+              return true;
+            }
+
+            /*
+             * The result for a number the vector kernels can't sum, one
+             * with bytes that aren't digits or too many of them
+             */
+            bool check(const char *number, std::size_t number_length) const
+            {
+              return luhn_valid(number, number_length);
+            }
+        } strided_numbers;
+
+        /*
+         * Numbers between consecutive offsets
+         */
+        template<typename Offset>
+        struct offset_numbers
+        {
+            std::span<const char> digits;
+            std::span<const Offset> offsets;
+
+            bool get(std::size_t i, const char *&number, std::size_t &number_length) const
+            {
+              const Offset begin = this->offsets[i], end = this->offsets[i + 1];
+              if (begin > end || end > this->digits.size())
+              {
+                return false;
+              }
+              number = this->digits.data() + begin;
+              number_length = static_cast<std::size_t>(end - begin);
+              return true;
+            }
+
+            bool check(const char *number, std::size_t number_length) const
+            {
+              return luhn_valid(number, number_length);
+            }
+        };
+
+        template<typename Numbers>
+        std::size_t validate_scalar(const Numbers &numbers, std::span<bool> valid)
+        {
+          std::size_t valid_count = 0;
+          for (std::size_t i = 0; i < valid.size(); i++)
           {
-            ret += num % 10;
-            num /= 10;
-          } while (num > 0);
-          return ret;
+            const char *number = nullptr;
+            std::size_t length = 0;
+            valid[i] = numbers.get(i, number, length) && numbers.check(number, length);
+            valid_count += valid[i];
+          }
+          return valid_count;
         }
 
-        std::string number;
-        luhns::provider provider = luhns::provider::invalid;
-        bool valid = false;
+        /*
+         * Copy up to Width bytes of a number that ends less than Width
+         * bytes before the end of its buffer, so vector loads stay inside it
+         */
+        template<std::size_t Width>
+        const char *padded_number(const char *number, std::size_t length, const char *end, std::array<char, Width> &buffer)
+        {
+          if (static_cast<std::size_t>(end - number) >= Width)
+          {
+            return number;
+          }
+          if (length != 0)
+          {
+            std::memcpy(buffer.data(), number, length);
+          }
+          return buffer.data();
+        }
+
+#if defined(LUHNS_HPP_X86_SIMD)
+        /*
+         * Bytes of a number of up to 16 digits that are in it, and those
+         * of them Luhn doubles
+         */
+        __attribute__((target("sse4.2"))) inline __m128i number_mask_sse4_2(std::size_t length)
+        {
+          return _mm_loadu_si128(reinterpret_cast<const __m128i *>(prefix_masks.data() + 32 - length));
+        }
+
+        __attribute__((target("sse4.2"))) inline __m128i doubled_mask_sse4_2(std::size_t length)
+        {
+          return _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(parity_masks.data() + length % 2)), number_mask_sse4_2(length));
+        }
+
+        /*
+         * Sum of what Luhn adds for the digits of bytes under in_number, or
+         * -1 when one of them isn't a digit
+         */
+        __attribute__((target("sse4.2"))) inline int luhn_sum_sse4_2(__m128i bytes, __m128i in_number, __m128i doubled)
+        {
+          const __m128i nine = _mm_set1_epi8(9);
+          const __m128i digits = _mm_sub_epi8(bytes, _mm_set1_epi8('0'));
+          const __m128i not_digit = _mm_andnot_si128(_mm_cmpeq_epi8(_mm_max_epu8(digits, nine), nine), in_number);
+          if (!_mm_testz_si128(not_digit, not_digit))
+          {
+            return -1;
+          }
+          const __m128i sums = _mm_load_si128(reinterpret_cast<const __m128i *>(doubled_digit_sums.data()));
+          const __m128i values = _mm_and_si128(_mm_blendv_epi8(digits, _mm_shuffle_epi8(sums, digits), doubled), in_number);
+          const __m128i totals = _mm_sad_epu8(values, _mm_setzero_si128());
+          return _mm_cvtsi128_si32(totals) + _mm_extract_epi16(totals, 4);
+        }
+
+        /*
+         * One number of up to 16 digits, which may end within 16 bytes of
+         * the end of its buffer
+         */
+        __attribute__((target("sse4.2"))) inline int luhn_sum_sse4_2(const char *number, std::size_t length, const char *end)
+        {
+          std::array<char, 16> buffer{};
+          const char *readable = padded_number(number, length, end, buffer);
+          return luhn_sum_sse4_2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(readable)), number_mask_sse4_2(length), doubled_mask_sse4_2(length));
+        }
+
+        template<typename Numbers>
+        __attribute__((target("sse4.2"))) std::size_t validate_sse4_2(const Numbers &numbers, std::span<bool> valid)
+        {
+          const char *const end = numbers.digits.data() + numbers.digits.size();
+          std::size_t i = 0, valid_count = 0;
+          if constexpr (std::is_same_v<Numbers, strided_numbers>)
+          {
+            const std::size_t length = numbers.length;
+            if (length <= 16)
+            {
+              const __m128i in_number = number_mask_sse4_2(length), doubled = doubled_mask_sse4_2(length);
+              for (const std::size_t loadable = std::min(valid.size(), numbers.loadable(16)); i < loadable; i++)
+              {
+                const char *number = numbers.digits.data() + i * numbers.stride;
+                const int sum = luhn_sum_sse4_2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(number)), in_number, doubled);
+                valid[i] = sum >= 0 ? sum % 10 == 0 : numbers.check(number, length);
+                valid_count += valid[i];
+              }
+            }
+          }
+          for (; i < valid.size(); i++)
+          {
+            const char *number = nullptr;
+            std::size_t length = 0;
+            if (!numbers.get(i, number, length))
+            {
+              valid[i] = false;
+              continue;
+            }
+            const int sum = length <= 16 ? luhn_sum_sse4_2(number, length, end) : -1;
+            valid[i] = sum >= 0 ? sum % 10 == 0 : numbers.check(number, length);
+            valid_count += valid[i];
+          }
+          return valid_count;
+        }
+
+        /*
+         * Sums of each 8 bytes of what Luhn adds for the digits of bytes
+         * under in_number, setting not_digit to the movemask of bytes under
+         * it that aren't digits. Those add nothing, so each sum stays
+         * within a byte
+         */
+        __attribute__((target("avx2"))) inline __m256i luhn_totals_avx2(__m256i bytes, __m256i in_number, __m256i doubled, std::uint32_t &not_digit)
+        {
+          const __m256i nine = _mm256_set1_epi8(9);
+          const __m256i digits = _mm256_sub_epi8(bytes, _mm256_set1_epi8('0'));
+          const __m256i is_digit = _mm256_cmpeq_epi8(_mm256_max_epu8(digits, nine), nine);
+          not_digit = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_andnot_si256(is_digit, in_number)));
+          const __m256i sums = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i *>(doubled_digit_sums.data())));
+          const __m256i values = _mm256_and_si256(_mm256_blendv_epi8(digits, _mm256_shuffle_epi8(sums, digits), doubled), _mm256_and_si256(is_digit, in_number));
+          return _mm256_sad_epu8(values, _mm256_setzero_si256());
+        }
+
+        /*
+         * Add the two 8 byte sums in each half of totals
+         */
+        __attribute__((target("avx2"))) inline void half_sums_avx2(__m256i totals, int &low, int &high)
+        {
+          const __m128i low_totals = _mm256_castsi256_si128(totals), high_totals = _mm256_extracti128_si256(totals, 1);
+          low = _mm_cvtsi128_si32(low_totals) + _mm_extract_epi16(low_totals, 4);
+          high = _mm_cvtsi128_si32(high_totals) + _mm_extract_epi16(high_totals, 4);
+        }
+
+        /*
+         * One number of 17 to 32 digits, which may end within 32 bytes of
+         * the end of its buffer
+         */
+        __attribute__((target("avx2"))) inline int luhn_sum_avx2(const char *number, std::size_t length, const char *end)
+        {
+          std::array<char, 32> buffer{};
+          const char *readable = padded_number(number, length, end, buffer);
+          const __m256i in_number = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(prefix_masks.data() + 32 - length));
+          const __m256i doubled = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(parity_masks.data() + length % 2)), in_number);
+          std::uint32_t not_digit = 0;
+          const __m256i totals = luhn_totals_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(readable)), in_number, doubled, not_digit);
+          int low = 0, high = 0;
+          half_sums_avx2(totals, low, high);
+          return not_digit != 0 ? -1 : low + high;
+        }
+
+        /*
+         * Which of 16 sums, one a byte, are multiples of ten, as 0 or 1 bytes
+         */
+        __attribute__((target("avx2"))) inline __m128i multiples_of_ten_avx2(__m128i sums)
+        {
+          const __m256i wide = _mm256_cvtepu8_epi16(sums);
+          const __m256i tenths = _mm256_mulhi_epu16(wide, _mm256_set1_epi16(6554));
+          const __m256i multiples = _mm256_cmpeq_epi16(wide, _mm256_mullo_epi16(tenths, _mm256_set1_epi16(10)));
+          return _mm_and_si128(_mm_packs_epi16(_mm256_castsi256_si128(multiples), _mm256_extracti128_si256(multiples, 1)), _mm_set1_epi8(1));
+        }
+
+        /*
+         * Fixed length numbers of up to 16 digits go two to a vector and 16
+         * at a time, the sums of eight vectors packed into bytes so they
+         * are checked together. Others go one to a vector up to 32 digits
+         * and through luhn_valid beyond
+         */
+        template<typename Numbers>
+        __attribute__((target("avx2"))) std::size_t validate_avx2(const Numbers &numbers, std::span<bool> valid)
+        {
+          const char *const end = numbers.digits.data() + numbers.digits.size();
+          std::size_t i = 0, valid_count = 0;
+          if constexpr (std::is_same_v<Numbers, strided_numbers>)
+          {
+            const std::size_t length = numbers.length, stride = numbers.stride;
+            if (length <= 16)
+            {
+              const __m256i in_number = _mm256_broadcastsi128_si256(number_mask_sse4_2(length));
+              const __m256i doubled = _mm256_broadcastsi128_si256(doubled_mask_sse4_2(length));
+              const std::size_t loadable = std::min(valid.size(), numbers.loadable(16));
+              for (; i + 16 <= loadable; i += 16)
+              {
+                /*
+                 * Number 2g + h has its sum in the first byte of half h,
+                 * shifted to byte g
+                 */
+                const char *first = numbers.digits.data() + i * stride;
+                __m256i packed = _mm256_setzero_si256();
+                std::uint32_t not_digit[8], any_not_digit = 0;
+                for (std::size_t g = 0; g < 8; g++)
+                {
+                  const char *number = first + 2 * g * stride;
+                  const __m256i bytes = _mm256_loadu2_m128i(reinterpret_cast<const __m128i *>(number + stride), reinterpret_cast<const __m128i *>(number));
+                  __m256i totals = luhn_totals_avx2(bytes, in_number, doubled, not_digit[g]);
+                  totals = _mm256_add_epi64(totals, _mm256_bsrli_epi128(totals, 8));
+                  packed = _mm256_or_si256(packed, _mm256_sll_epi64(totals, _mm_cvtsi32_si128(static_cast<int>(8 * g))));
+                  any_not_digit |= not_digit[g];
+                }
+                const __m128i sums = _mm_unpacklo_epi8(_mm256_castsi256_si128(packed), _mm256_extracti128_si256(packed, 1));
+                const __m128i multiples = multiples_of_ten_avx2(sums);
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(valid.data() + i), multiples);
+                valid_count += static_cast<std::size_t>(__builtin_popcount(static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi8(multiples, _mm_set1_epi8(1))))));
+                for (std::size_t g = 0; any_not_digit != 0 && g < 8; g++)
+                {
+                  for (std::size_t h = 0; h < 2; h++)
+                  {
+                    if (((not_digit[g] >> (h * 16)) & 0xffff) != 0)
+                    {
+                      bool &number_valid = valid[i + 2 * g + h];
+                      valid_count -= number_valid;
+                      number_valid = numbers.check(first + (2 * g + h) * stride, length);
+                      valid_count += number_valid;
+                    }
+                  }
+                }
+              }
+              for (; i + 2 <= loadable; i += 2)
+              {
+                const char *number = numbers.digits.data() + i * stride;
+                const __m256i bytes = _mm256_loadu2_m128i(reinterpret_cast<const __m128i *>(number + stride), reinterpret_cast<const __m128i *>(number));
+                std::uint32_t not_digit = 0;
+                int sums[2] = {};
+                half_sums_avx2(luhn_totals_avx2(bytes, in_number, doubled, not_digit), sums[0], sums[1]);
+                valid[i] = (not_digit & 0xffff) == 0 ? sums[0] % 10 == 0 : numbers.check(number, length);
+                valid[i + 1] = (not_digit >> 16) == 0 ? sums[1] % 10 == 0 : numbers.check(number + stride, length);
+                valid_count += valid[i] + valid[i + 1];
+              }
+            }
+          }
+          for (; i < valid.size(); i++)
+          {
+            const char *number = nullptr;
+            std::size_t length = 0;
+            if (!numbers.get(i, number, length))
+            {
+              valid[i] = false;
+              continue;
+            }
+            const int sum = length <= 16 ? luhn_sum_sse4_2(number, length, end) : length <= 32 ? luhn_sum_avx2(number, length, end) : -1;
+            valid[i] = sum >= 0 ? sum % 10 == 0 : numbers.check(number, length);
+            valid_count += valid[i];
+          }
+          return valid_count;
+        }
+
+        /*
+         * Sums of each 8 bytes of what Luhn adds for the digits of bytes
+         * under in_number, setting not_digit to the bytes under it that
+         * aren't digits. Those add nothing, so each sum stays within a byte
+         */
+        __attribute__((target("avx512bw,avx512vl"))) inline __m512i luhn_totals_avx512(__m512i bytes, __mmask64 in_number, __mmask64 doubled, __mmask64 &not_digit)
+        {
+          const __m512i offsets = _mm512_sub_epi8(bytes, _mm512_set1_epi8('0'));
+          not_digit = _mm512_mask_cmpgt_epu8_mask(in_number, offsets, _mm512_set1_epi8(9));
+          const __m512i digits = _mm512_maskz_mov_epi8(in_number & ~not_digit, offsets);
+          const __m512i sums = _mm512_maskz_broadcast_i32x4(0xffff, _mm_load_si128(reinterpret_cast<const __m128i *>(doubled_digit_sums.data())));
+          return _mm512_sad_epu8(_mm512_mask_shuffle_epi8(digits, doubled, sums, digits), _mm512_setzero_si512());
+        }
+
+        /*
+         * Bits of the digits of a number of up to 64 digits, and those of
+         * them Luhn doubles
+         */
+        inline std::uint64_t number_bits(std::size_t length)
+        {
+          return length >= 64 ? ~std::uint64_t{0} : (std::uint64_t{1} << length) - 1;
+        }
+
+        inline std::uint64_t doubled_bits(std::size_t length)
+        {
+          return number_bits(length) & (length % 2 != 0 ? 0xaaaaaaaaaaaaaaaa : 0x5555555555555555);
+        }
+
+        /*
+         * One number of up to 64 digits. Masked loads never touch the bytes
+         * past it, so it can end anywhere
+         */
+        __attribute__((target("avx512bw,avx512vl"))) inline int luhn_sum_avx512(const char *number, std::size_t length)
+        {
+          const __mmask64 in_number = number_bits(length);
+          __mmask64 not_digit = 0;
+          alignas(64) std::uint64_t totals[8];
+          _mm512_store_si512(totals, luhn_totals_avx512(_mm512_maskz_loadu_epi8(in_number, number), in_number, doubled_bits(length), not_digit));
+          return not_digit != 0 ? -1 : static_cast<int>(totals[0] + totals[1] + totals[2] + totals[3] + totals[4] + totals[5] + totals[6] + totals[7]);
+        }
+
+        /*
+         * Four numbers of up to 16 digits stride bytes apart, one to each
+         * quarter, with the bytes outside lane cleared
+         */
+        __attribute__((target("avx512bw,avx512vl"))) inline __m512i load_numbers_avx512(const char *number, std::size_t stride, __mmask16 lane)
+        {
+          if (stride == 16)
+          {
+            return _mm512_maskz_loadu_epi8(static_cast<__mmask64>(lane) * 0x0001000100010001ull, number);
+          }
+          const __m256i low = _mm256_set_m128i(_mm_maskz_loadu_epi8(lane, number + stride), _mm_maskz_loadu_epi8(lane, number));
+          const __m256i high = _mm256_set_m128i(_mm_maskz_loadu_epi8(lane, number + 3 * stride), _mm_maskz_loadu_epi8(lane, number + 2 * stride));
+          return _mm512_maskz_inserti64x4(0xff, _mm512_maskz_inserti64x4(0xff, _mm512_setzero_si512(), low, 0), high, 1);
+        }
+
+        /*
+         * Which of 32 sums, one a byte, are multiples of ten
+         */
+        __attribute__((target("avx512bw,avx512vl"))) inline __mmask32 multiples_of_ten_avx512(__m256i sums)
+        {
+          const __m512i wide = _mm512_cvtepu8_epi16(sums);
+          const __m512i tenths = _mm512_mulhi_epu16(wide, _mm512_set1_epi16(6554));
+          return _mm512_cmpeq_epi16_mask(wide, _mm512_mullo_epi16(tenths, _mm512_set1_epi16(10)));
+        }
+
+        /*
+         * Fixed length numbers of up to 16 digits go four to a vector and
+         * 32 at a time, the sums of eight vectors packed into bytes so they
+         * are checked together. Other numbers of up to 64 digits go one to
+         * a vector
+         */
+        template<typename Numbers>
+        __attribute__((target("avx512bw,avx512vl"))) std::size_t validate_avx512(const Numbers &numbers, std::span<bool> valid)
+        {
+          const char *const end = numbers.digits.data() + numbers.digits.size();
+          std::size_t i = 0, valid_count = 0;
+          if constexpr (std::is_same_v<Numbers, strided_numbers>)
+          {
+            const std::size_t length = numbers.length, stride = numbers.stride;
+            if (length <= 16)
+            {
+              const __mmask16 lane = static_cast<__mmask16>(number_bits(length));
+              const __mmask64 in_number = lane * 0x0001000100010001ull, doubled = (doubled_bits(length) & 0xffff) * 0x0001000100010001ull;
+              const std::size_t count = std::min(valid.size(), numbers.count);
+              for (; i + 32 <= count; i += 32)
+              {
+                /*
+                 * Number 4g + q has its sum in the first byte of quarter
+                 * q, shifted to byte g
+                 */
+                const char *first = numbers.digits.data() + i * stride;
+                __m512i packed = _mm512_setzero_si512();
+                __mmask64 not_digit[8], any_not_digit = 0;
+                for (std::size_t g = 0; g < 8; g++)
+                {
+                  __m512i totals = luhn_totals_avx512(load_numbers_avx512(first + 4 * g * stride, stride, lane), in_number, doubled, not_digit[g]);
+                  totals = _mm512_add_epi64(totals, _mm512_bsrli_epi128(totals, 8));
+                  packed = _mm512_or_si512(packed, _mm512_maskz_sll_epi64(0xff, totals, _mm_cvtsi32_si128(static_cast<int>(8 * g))));
+                  any_not_digit |= not_digit[g];
+                }
+                const __m128i pairs_low = _mm_unpacklo_epi8(_mm512_maskz_extracti32x4_epi32(0xf, packed, 0), _mm512_maskz_extracti32x4_epi32(0xf, packed, 1));
+                const __m128i pairs_high = _mm_unpacklo_epi8(_mm512_maskz_extracti32x4_epi32(0xf, packed, 2), _mm512_maskz_extracti32x4_epi32(0xf, packed, 3));
+                const __m256i sums = _mm256_set_m128i(_mm_unpackhi_epi16(pairs_low, pairs_high), _mm_unpacklo_epi16(pairs_low, pairs_high));
+                const __mmask32 multiples = multiples_of_ten_avx512(sums);
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(valid.data() + i), _mm256_maskz_set1_epi8(multiples, 1));
+                valid_count += static_cast<std::size_t>(__builtin_popcount(multiples));
+                for (std::size_t g = 0; any_not_digit != 0 && g < 8; g++)
+                {
+                  for (std::size_t q = 0; q < 4; q++)
+                  {
+                    if (((not_digit[g] >> (q * 16)) & 0xffff) != 0)
+                    {
+                      bool &number_valid = valid[i + 4 * g + q];
+                      valid_count -= number_valid;
+                      number_valid = numbers.check(first + (4 * g + q) * stride, length);
+                      valid_count += number_valid;
+                    }
+                  }
+                }
+              }
+              for (; i + 4 <= count; i += 4)
+              {
+                const char *number = numbers.digits.data() + i * stride;
+                __mmask64 not_digit = 0;
+                alignas(64) std::uint64_t totals[8];
+                _mm512_store_si512(totals, luhn_totals_avx512(load_numbers_avx512(number, stride, lane), in_number, doubled, not_digit));
+                for (std::size_t k = 0; k < 4; k++)
+                {
+                  valid[i + k] = ((not_digit >> (k * 16)) & 0xffff) == 0 ? (totals[k * 2] + totals[k * 2 + 1]) % 10 == 0
+                                                                        : numbers.check(number + k * stride, length);
+                  valid_count += valid[i + k];
+                }
+              }
+            }
+          }
+          for (; i < valid.size(); i++)
+          {
+            const char *number = nullptr;
+            std::size_t length = 0;
+            if (!numbers.get(i, number, length))
+            {
+              valid[i] = false;
+              continue;
+            }
+            /*
+             * Plain loads of the shorter numbers beat masked ones
+             */
+            const int sum = length <= 16 ? luhn_sum_sse4_2(number, length, end) : length <= 32 ? luhn_sum_avx2(number, length, end) : length <= 64 ? luhn_sum_avx512(number, length) : -1;
+            valid[i] = sum >= 0 ? sum % 10 == 0 : numbers.check(number, length);
+            valid_count += valid[i];
+          }
+          return valid_count;
+        }
+#endif
+
+#if defined(LUHNS_HPP_NEON)
+        /*
+         * luhn_sum_sse4_2 with NEON
+         */
+        inline int luhn_sum_neon(uint8x16_t bytes, std::size_t length)
+        {
+          const uint8x16_t in_number = vld1q_u8(prefix_masks.data() + 32 - length);
+          const uint8x16_t doubled = vandq_u8(vld1q_u8(parity_masks.data() + length % 2), in_number);
+          const uint8x16_t digits = vsubq_u8(bytes, vdupq_n_u8('0'));
+          if (vmaxvq_u8(vandq_u8(vcgtq_u8(digits, vdupq_n_u8(9)), in_number)) != 0)
+          {
+            return -1;
+          }
+          const uint8x16_t values = vandq_u8(vbslq_u8(doubled, vqtbl1q_u8(vld1q_u8(doubled_digit_sums.data()), digits), digits), in_number);
+          return static_cast<int>(vaddlvq_u8(values));
+        }
+
+        template<typename Numbers>
+        std::size_t validate_neon(const Numbers &numbers, std::span<bool> valid)
+        {
+          const char *const end = numbers.digits.data() + numbers.digits.size();
+          std::array<char, 16> buffer{};
+          std::size_t valid_count = 0;
+          for (std::size_t i = 0; i < valid.size(); i++)
+          {
+            const char *number = nullptr;
+            std::size_t length = 0;
+            if (!numbers.get(i, number, length))
+            {
+              valid[i] = false;
+              continue;
+            }
+            int sum = -1;
+            if (length <= 16)
+            {
+              const char *readable = padded_number(number, length, end, buffer);
+              sum = luhn_sum_neon(vld1q_u8(reinterpret_cast<const std::uint8_t *>(readable)), length);
+            }
+            valid[i] = sum >= 0 ? sum % 10 == 0 : numbers.check(number, length);
+            valid_count += valid[i];
+          }
+          return valid_count;
+        }
+#endif
+
+        template<typename Numbers>
+        std::size_t validate_numbers(const Numbers &numbers, std::span<bool> valid, simd_level level)
+        {
+          switch (level)
+          {
+#if defined(LUHNS_HPP_X86_SIMD)
+            case simd_level::avx512:
+              return validate_avx512(numbers, valid);
+            case simd_level::avx2:
+              return validate_avx2(numbers, valid);
+            case simd_level::sse4_2:
+              return validate_sse4_2(numbers, valid);
+#endif
+#if defined(LUHNS_HPP_NEON)
+            case simd_level::neon:
+              return validate_neon(numbers, valid);
+#endif
+            default:
+              return validate_scalar(numbers, valid);
+          }
+        }
+    }
+
+    /*
+     * Check valid.size() numbers of length digits each, stride bytes
+     * apart in digits, so fixed width records are validated where they
+     * are. valid[i] is what card_number(number).is_valid() gives for the
+     * i-th, false when it runs past the end of digits. Returns how many
+     * are valid
+     */
+    inline std::size_t validate_batch(std::span<const char> digits, std::size_t stride, std::size_t length, std::span<bool> valid)
+    {
+      return luhns::detail::validate_numbers(luhns::detail::strided_numbers{digits, stride, length}, valid, luhns::detail::get_simd_level());
+    }
+
+    namespace detail
+    {
+        template<typename Offset>
+        std::size_t validate_offsets(std::span<const char> digits, std::span<const Offset> offsets, std::span<bool> valid)
+        {
+          const std::size_t count = std::min(valid.size(), offsets.empty() ? 0 : offsets.size() - 1);
+          std::fill(valid.begin() + count, valid.end(), false);
+          return validate_numbers(offset_numbers<Offset>{digits, offsets}, valid.first(count), get_simd_level());
+        }
+    }
+
+    /*
+     * Check the numbers digits[offsets[i], offsets[i + 1]), as laid out
+     * by columnar formats. A number whose offsets are out of order or past
+     * the end of digits is invalid, as are entries of valid beyond the
+     * last number. Returns how many are valid
+     */
+    inline std::size_t validate_batch(std::span<const char> digits, std::span<const std::uint32_t> offsets, std::span<bool> valid)
+    {
+      return luhns::detail::validate_offsets(digits, offsets, valid);
+    }
+
+    /*
+     * validate_batch for 64-bit offsets
+     */
+    inline std::size_t validate_batch(std::span<const char> digits, std::span<const std::uint64_t> offsets, std::span<bool> valid)
+    {
+      return luhns::detail::validate_offsets(digits, offsets, valid);
+    }
+
+    namespace detail
+    {
+        /*
+         * Eight xorshift32 generators stepped together, giving 32 bytes a
+         * step in the order a vector of them would be stored
+         */
+        typedef struct digit_generator
+        {
+            std::array<std::uint32_t, 8> lanes{};
+
+            void seed(std::uint64_t seed)
+            {
+              for (auto &lane: this->lanes)
+              {
+                /*
+                 * splitmix64, which never leaves a lane at zero for long
+                 */
+                seed += 0x9e3779b97f4a7c15ull;
+                std::uint64_t z = seed;
+                z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+                z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+                lane = static_cast<std::uint32_t>(z ^ (z >> 31)) | 1;
+              }
+            }
+
+            /*
+             * 32 digit characters, each byte b of the step mapped to
+             * b * 10 / 256
+             */
+            void step(char *out)
+            {
+              for (std::size_t i = 0; i < this->lanes.size(); i++)
+              {
+                std::uint32_t x = this->lanes[i];
+                x ^= x << 13;
+                x ^= x >> 17;
+                x ^= x << 5;
+                this->lanes[i] = x;
+                for (std::size_t b = 0; b < 4; b++)
+                {
+                  out[4 * i + b] = static_cast<char>('0' + (((x >> (8 * b)) & 0xff) * 10 >> 8));
+                }
+              }
+            }
+        } digit_generator;
+
+        /*
+         * Fill size bytes of out with digits, whole steps at a time, the
+         * last step's extra digits being dropped
+         */
+        inline void fill_digits_scalar(digit_generator &generator, char *out, std::size_t size)
+        {
+          std::array<char, 32> step{};
+          for (std::size_t i = 0; i < size; i += step.size())
+          {
+            generator.step(step.data());
+            std::memcpy(out + i, step.data(), std::min(step.size(), size - i));
+          }
+        }
+
+        /*
+         * Set the check digit of length digits at number, the rest of which
+         * are already digits
+         */
+        inline void set_check_digit_scalar(char *number, std::size_t length)
+        {
+          number[length - 1] = compute_check_digit(std::string_view(number, length - 1));
+        }
+
+#if defined(LUHNS_HPP_X86_SIMD)
+        /*
+         * fill_digits_scalar with the eight generators in one register
+         */
+        __attribute__((target("avx2"))) inline void fill_digits_avx2(digit_generator &generator, char *out, std::size_t size)
+        {
+          __m256i lanes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(generator.lanes.data()));
+          const __m256i low_bytes = _mm256_set1_epi16(0x00ff), ten = _mm256_set1_epi16(10), zero = _mm256_set1_epi8('0');
+          for (std::size_t i = 0; i < size; i += 32)
+          {
+            lanes = _mm256_xor_si256(lanes, _mm256_slli_epi32(lanes, 13));
+            lanes = _mm256_xor_si256(lanes, _mm256_srli_epi32(lanes, 17));
+            lanes = _mm256_xor_si256(lanes, _mm256_slli_epi32(lanes, 5));
+            const __m256i even = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_and_si256(lanes, low_bytes), ten), 8);
+            const __m256i odd = _mm256_andnot_si256(low_bytes, _mm256_mullo_epi16(_mm256_srli_epi16(lanes, 8), ten));
+            const __m256i digits = _mm256_add_epi8(_mm256_or_si256(even, odd), zero);
+            if (size - i >= 32)
+            {
+              _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), digits);
+            } else
+            {
+              alignas(32) std::array<char, 32> step;
+              _mm256_store_si256(reinterpret_cast<__m256i *>(step.data()), digits);
+              std::memcpy(out + i, step.data(), size - i);
+            }
+          }
+          _mm256_storeu_si256(reinterpret_cast<__m256i *>(generator.lanes.data()), lanes);
+        }
+
+        /*
+         * Write the prefix, check digit and separator of count numbers of
+         * 2 to 32 digits, record bytes apart from first. Each is summed
+         * from its random digits with the prefix blended in, before
+         * anything is stored to it, so no load waits on a store
+         */
+        __attribute__((target("avx2"))) inline void finish_numbers_avx2(char *first, std::size_t count, std::size_t record, std::size_t length, std::string_view prefix, char separator)
+        {
+          alignas(32) std::array<char, 32> prefix_bytes{};
+          std::memcpy(prefix_bytes.data(), prefix.data(), prefix.size());
+          const __m256i prefix_vector = _mm256_load_si256(reinterpret_cast<const __m256i *>(prefix_bytes.data()));
+          const __m256i in_prefix = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(prefix_masks.data() + 32 - prefix.size()));
+          const __m256i in_payload = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(prefix_masks.data() + 32 - (length - 1)));
+          const __m256i doubled = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(parity_masks.data() + length % 2)), in_payload);
+          const char *const end = first + count * record;
+          std::array<char, 32> buffer{};
+          for (std::size_t i = 0; i < count; i++)
+          {
+            char *number = first + i * record;
+            const char *readable = padded_number(number, length, end, buffer);
+            const __m256i bytes = _mm256_blendv_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(readable)), prefix_vector, in_prefix);
+            std::uint32_t not_digit = 0;
+            int low = 0, high = 0;
+            half_sums_avx2(luhn_totals_avx2(bytes, in_payload, doubled, not_digit), low, high);
+            std::memcpy(number, prefix.data(), prefix.size());
+            number[length - 1] = static_cast<char>('0' + (10 - (low + high) % 10) % 10);
+            if (separator != '\0')
+            {
+              number[length] = separator;
+            }
+          }
+        }
+#endif
+    }
+
+    /*
+     * Fills buffers with valid numbers of one length that start with a
+     * prefix, such as a BIN. The digits between are drawn from a seeded
+     * generator, so the same seed gives the same numbers on every machine
+     */
+    class number_generator
+    {
+    public:
+        /*
+         * Numbers are written length digits each, followed by separator
+         * unless it is '\0'
+         */
+        number_generator(std::string prefix, std::size_t length, std::uint64_t seed = 0, char separator = '\0') : prefix(std::move(prefix)), length(length), separator(separator)
+        {
+          if (this->length == 0 || this->prefix.size() >= this->length || luhns::compute_check_digit(this->prefix) == '\0')
+          {
+            this->last_error = "Prefix must be digits shorter than the numbers";
+          }
+          this->generator.seed(seed);
+        }
+
+        /*
+         * Bytes each number takes in a buffer, with its separator
+         */
+        std::size_t record_size() const
+        {
+          return this->length + (this->separator != '\0' ? 1 : 0);
+        }
+
+        /*
+         * Write as many numbers as fit in out from its start, leaving the
+         * bytes after them alone. Returns how many were written
+         */
+        std::size_t fill(std::span<char> out)
+        {
+          if (this->error())
+          {
+            return 0;
+          }
+          const std::size_t record = this->record_size(), count = out.size() / record;
+          char *const first = out.data();
+#if defined(LUHNS_HPP_X86_SIMD)
+          const luhns::detail::simd_level level = luhns::detail::get_simd_level();
+          if (level == luhns::detail::simd_level::avx2 || level == luhns::detail::simd_level::avx512)
+          {
+            luhns::detail::fill_digits_avx2(this->generator, first, count * record);
+            if (this->length >= 2 && this->length <= 32)
+            {
+              luhns::detail::finish_numbers_avx2(first, count, record, this->length, this->prefix, this->separator);
+              return count;
+            }
+          } else
+#endif
+          {
+            luhns::detail::fill_digits_scalar(this->generator, first, count * record);
+          }
+          for (std::size_t i = 0; i < count; i++)
+          {
+            char *number = first + i * record;
+            std::memcpy(number, this->prefix.data(), this->prefix.size());
+            if (this->separator != '\0')
+            {
+              number[this->length] = this->separator;
+            }
+            luhns::detail::set_check_digit_scalar(number, this->length);
+          }
+          return count;
+        }
+
+        bool error() const
+        {
+          return !this->last_error.empty();
+        }
+
+        const std::string &error_message() const
+        {
+          return this->last_error;
+        }
+
+    private:
+        std::string prefix;
+        std::size_t length;
+        char separator;
+        luhns::detail::digit_generator generator;
+        std::string last_error;
+    };
+
+    /*
+     * How many numbers of a provider a file held, and how many of them
+     * were valid
+     */
+    typedef struct provider_stats
+    {
+        std::size_t numbers = 0;
+        std::size_t valid = 0;
+    } provider_stats;
+
+    typedef struct file_stats
+    {
+        std::array<luhns::provider_stats, luhns::provider_count> providers{};  /* Indexed by provider, rows without a number count as invalid */
+        std::size_t rows = 0;
+        std::size_t valid = 0;
+        std::vector<std::uint64_t> invalid_rows;  /* Byte offsets of the rows with invalid numbers, in file order */
+        std::uint64_t bytes = 0;
+        std::uint64_t nanoseconds = 0;
+
+        const luhns::provider_stats &of(luhns::provider p) const
+        {
+          return this->providers.at(static_cast<std::size_t>(p));
+        }
+
+        double bytes_per_second() const
+        {
+          return this->nanoseconds == 0 ? 0.0 : static_cast<double>(this->bytes) * 1e9 / static_cast<double>(this->nanoseconds);
+        }
+    } file_stats;
+
+    typedef struct file_options
+    {
+        char delimiter = ',';  /* Between the fields of a row. Rows end at '\n' */
+        std::size_t field = 0;  /* Which field of a row holds the number, from 0 */
+        /*
+         * Read fixed width records instead when non-zero: the number is the
+         * field_width bytes at field_offset in each row, and delimiter and
+         * field are ignored
+         */
+        std::size_t field_offset = 0;
+        std::size_t field_width = 0;
+        bool skip_header = false;
+        std::size_t threads = 0;  /* Pieces a file is split into, one per executor worker when 0 */
+        exec::executor *executor = nullptr;  /* Runs the pieces, exec::default_executor() when null */
+        std::size_t chunk_size = 1 << 26;  /* Bytes read at a time from files that can't be mapped */
+        std::size_t max_invalid_rows = std::numeric_limits<std::size_t>::max();  /* Most offsets kept in invalid_rows */
+    } file_options;
+
+    namespace detail
+    {
+        /*
+         * Fields found by a file scan. Unlike card_number, one with bytes
+         * that aren't digits is invalid, as is an empty one
+         */
+        struct field_numbers
+        {
+            std::span<const char> digits;
+            std::span<const std::uint64_t> begins;
+            std::span<const std::uint32_t> lengths;
+
+            bool get(std::size_t i, const char *&number, std::size_t &number_length) const
+            {
+              if (this->lengths[i] == 0)
+              {
+                return false;
+              }
+              number = this->digits.data() + this->begins[i];
+              number_length = this->lengths[i];
+              return true;
+            }
+
+            bool check(const char *number, std::size_t number_length) const
+            {
+              for (std::size_t i = 0; i < number_length; i++)
+              {
+                if (static_cast<unsigned char>(number[i] - '0') > 9)
+                {
+                  return false;
+                }
+              }
+              return luhn_valid(number, number_length);
+            }
+        };
+
+        /*
+         * Which of 64 bytes end rows and which separate fields. Bits from
+         * the size of a short block on are clear
+         */
+        typedef struct structural_bits
+        {
+            std::uint64_t newlines = 0;
+            std::uint64_t delimiters = 0;
+        } structural_bits;
+
+        inline structural_bits find_structural_scalar(const char *block, std::size_t size, char delimiter)
+        {
+          structural_bits bits;
+          for (std::size_t i = 0; i < size; i++)
+          {
+            bits.newlines |= static_cast<std::uint64_t>(block[i] == '\n') << i;
+            bits.delimiters |= static_cast<std::uint64_t>(block[i] == delimiter) << i;
+          }
+          return bits;
+        }
+
+#if defined(LUHNS_HPP_X86_SIMD)
+        __attribute__((target("sse4.2"))) inline structural_bits find_structural_sse4_2(const char *block, char delimiter)
+        {
+          const __m128i newline = _mm_set1_epi8('\n'), separator = _mm_set1_epi8(delimiter);
+          structural_bits bits;
+          for (std::size_t i = 0; i < 4; i++)
+          {
+            const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + 16 * i));
+            bits.newlines |= static_cast<std::uint64_t>(static_cast<std::uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, newline)))) << (16 * i);
+            bits.delimiters |= static_cast<std::uint64_t>(static_cast<std::uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, separator)))) << (16 * i);
+          }
+          return bits;
+        }
+
+        __attribute__((target("avx2"))) inline structural_bits find_structural_avx2(const char *block, char delimiter)
+        {
+          const __m256i newline = _mm256_set1_epi8('\n'), separator = _mm256_set1_epi8(delimiter);
+          const __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block));
+          const __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block + 32));
+          structural_bits bits;
+          bits.newlines = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, newline))) |
+                          static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, newline)))) << 32;
+          bits.delimiters = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, separator))) |
+                            static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, separator)))) << 32;
+          return bits;
+        }
+
+        __attribute__((target("avx512bw,avx512vl"))) inline structural_bits find_structural_avx512(const char *block, char delimiter)
+        {
+          const __m512i bytes = _mm512_loadu_si512(block);
+          structural_bits bits;
+          bits.newlines = _mm512_cmpeq_epi8_mask(bytes, _mm512_set1_epi8('\n'));
+          bits.delimiters = _mm512_cmpeq_epi8_mask(bytes, _mm512_set1_epi8(delimiter));
+          return bits;
+        }
+#endif
+
+#if defined(LUHNS_HPP_NEON)
+        /*
+         * One bit per byte of four comparison results, weighting each
+         * byte by its bit and adding neighbours together
+         */
+        inline std::uint64_t movemask_neon(uint8x16_t first, uint8x16_t second, uint8x16_t third, uint8x16_t fourth)
+        {
+          const uint8x16_t weights = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+          uint8x16_t sums = vpaddq_u8(vpaddq_u8(vandq_u8(first, weights), vandq_u8(second, weights)),
+                                      vpaddq_u8(vandq_u8(third, weights), vandq_u8(fourth, weights)));
+          sums = vpaddq_u8(sums, sums);
+          return vgetq_lane_u64(vreinterpretq_u64_u8(sums), 0);
+        }
+
+        inline structural_bits find_structural_neon(const char *block, char delimiter)
+        {
+          const uint8_t *bytes = reinterpret_cast<const uint8_t *>(block);
+          const uint8x16_t first = vld1q_u8(bytes), second = vld1q_u8(bytes + 16), third = vld1q_u8(bytes + 32), fourth = vld1q_u8(bytes + 48);
+          const uint8x16_t newline = vdupq_n_u8('\n'), separator = vdupq_n_u8(static_cast<uint8_t>(delimiter));
+          structural_bits bits;
+          bits.newlines = movemask_neon(vceqq_u8(first, newline), vceqq_u8(second, newline), vceqq_u8(third, newline), vceqq_u8(fourth, newline));
+          bits.delimiters = movemask_neon(vceqq_u8(first, separator), vceqq_u8(second, separator), vceqq_u8(third, separator), vceqq_u8(fourth, separator));
+          return bits;
+        }
+#endif
+
+        inline structural_bits find_structural(const char *block, std::size_t size, char delimiter, simd_level level)
+        {
+          if (size < 64)
+          {
+            return find_structural_scalar(block, size, delimiter);
+          }
+          switch (level)
+          {
+#if defined(LUHNS_HPP_X86_SIMD)
+            case simd_level::avx512:
+              return find_structural_avx512(block, delimiter);
+            case simd_level::avx2:
+              return find_structural_avx2(block, delimiter);
+            case simd_level::sse4_2:
+              return find_structural_sse4_2(block, delimiter);
+#endif
+#if defined(LUHNS_HPP_NEON)
+            case simd_level::neon:
+              return find_structural_neon(block, delimiter);
+#endif
+            default:
+              return find_structural_scalar(block, size, delimiter);
+          }
+        }
+
+        /*
+         * Check the number in each row of data[begin, end), which starts a
+         * row, adding to stats. Offsets are given from base. Fields are
+         * gathered into batches for validate_numbers, which may read any
+         * byte of data
+         */
+        inline void scan_rows(std::span<const char> data, std::size_t begin, std::size_t end, std::uint64_t base, const luhns::file_options &options, luhns::file_stats &stats)
+        {
+          constexpr std::size_t batch_size = 4096;
+          constexpr std::size_t none = std::numeric_limits<std::size_t>::max();
+          const simd_level level = get_simd_level();
+          const bool fixed_width = options.field_width != 0;
+          std::vector<std::uint64_t> rows(batch_size), begins(batch_size);
+          std::vector<std::uint32_t> lengths(batch_size);
+          const std::unique_ptr<bool[]> valid(new bool[batch_size]);
+          std::size_t batched = 0;
+
+          const auto flush = [&]()
+          {
+            validate_numbers(field_numbers{data, {begins.data(), batched}, {lengths.data(), batched}}, std::span<bool>(valid.get(), batched), level);
+            for (std::size_t i = 0; i < batched; i++)
+            {
+              const luhns::provider provider = lengths[i] == 0 ? luhns::provider::invalid : provider_of(std::string_view(data.data() + begins[i], 1));
+              luhns::provider_stats &counts = stats.providers[static_cast<std::size_t>(provider)];
+              counts.numbers++;
+              if (valid[i])
+              {
+                counts.valid++;
+                stats.valid++;
+              } else if (stats.invalid_rows.size() < options.max_invalid_rows)
+              {
+                stats.invalid_rows.push_back(base + rows[i]);
+              }
+            }
+            stats.rows += batched;
+            batched = 0;
+          };
+
+          /*
+           * A field of row, without the spaces around it or the '\r' of a
+           * CRLF line ending. An empty one marks a missing number
+           */
+          const auto add_row = [&](std::size_t row, std::size_t field_begin, std::size_t field_end)
+          {
+            while (field_end > field_begin && (data[field_end - 1] == '\r' || data[field_end - 1] == ' '))
+            {
+              field_end--;
+            }
+            while (field_begin < field_end && data[field_begin] == ' ')
+            {
+              field_begin++;
+            }
+            const std::size_t length = field_end - field_begin;
+            rows[batched] = row;
+            begins[batched] = field_begin;
+            lengths[batched] = length > std::numeric_limits<std::uint32_t>::max() ? 0 : static_cast<std::uint32_t>(length);
+            if (++batched == batch_size)
+            {
+              flush();
+            }
+          };
+
+          std::size_t row = begin, field_index = 0, field_begin = options.field == 0 ? begin : none, field_end = none;
+          const auto end_row = [&](std::size_t position)
+          {
+            const bool blank = position == row || (position == row + 1 && data[row] == '\r');
+            if (!blank && fixed_width)
+            {
+              const std::size_t number = row + options.field_offset;
+              if (number < position)
+              {
+                add_row(row, number, number + std::min(options.field_width, position - number));
+              } else
+              {
+                add_row(row, 0, 0);
+              }
+            } else if (!blank)
+            {
+              if (field_end == none && field_index == options.field)
+              {
+                field_end = position;
+              }
+              if (field_end == none)
+              {
+                add_row(row, 0, 0);
+              } else
+              {
+                add_row(row, field_begin, field_end);
+              }
+            }
+            row = position + 1;
+            field_index = 0;
+            field_begin = options.field == 0 ? row : none;
+            field_end = none;
+          };
+
+          for (std::size_t block = begin; block < end; block += 64)
+          {
+            const structural_bits bits = find_structural(data.data() + block, std::min<std::size_t>(64, end - block), options.delimiter, level);
+            for (std::uint64_t events = fixed_width ? bits.newlines : bits.newlines | bits.delimiters; events != 0; events &= events - 1)
+            {
+              const int bit = std::countr_zero(events);
+              const std::size_t position = block + static_cast<std::size_t>(bit);
+              if ((bits.newlines >> bit) & 1)
+              {
+                end_row(position);
+                continue;
+              }
+              if (field_index == options.field)
+              {
+                /*
+                 * The rest of the row's delimiters don't matter
+                 */
+                field_end = position;
+                const std::uint64_t later = ~((2ull << bit) - 1), later_newlines = bits.newlines & later;
+                events &= ~(bits.delimiters & later & (later_newlines == 0 ? ~0ull : (later_newlines & (~later_newlines + 1)) - 1));
+              }
+              field_index++;
+              if (field_index == options.field)
+              {
+                field_begin = position + 1;
+              }
+            }
+          }
+          if (row < end)
+          {
+            end_row(end);
+          }
+          if (batched != 0)
+          {
+            flush();
+          }
+        }
+    }
+
+    /*
+     * Checks the card numbers of delimited or fixed width files, one per
+     * row. Files are mapped where possible and read in chunks otherwise,
+     * and each mapping or chunk is split over threads at row boundaries
+     */
+    class file_validator
+    {
+    public:
+        explicit file_validator(luhns::file_options options = {}) : options(options)
+        {
+        }
+
+        /*
+         * Check every row of a file, replacing the stats of the last one
+         */
+        bool validate(const std::filesystem::path &path)
+        {
+          const auto start = this->begin();
+#if defined(LUHNS_HPP_POSIX)
+          const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+          if (fd < 0)
+          {
+            this->last_error = "Failed to open file";
+            return false;
+          }
+          struct stat file_status{};
+          if (::fstat(fd, &file_status) == 0 && S_ISREG(file_status.st_mode))
+          {
+            const auto size = static_cast<std::size_t>(file_status.st_size);
+            void *address = size == 0 ? nullptr : ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+            if (size == 0 || address != MAP_FAILED)
+            {
+              if (size != 0)
+              {
+                ::madvise(address, size, MADV_SEQUENTIAL);
+                this->validate_block({static_cast<const char *>(address), size}, 0, this->options.skip_header);
+                ::munmap(address, size);
+              }
+              this->stats.bytes = size;
+              this->finish(start);
+              return true;
+            }
+          } else
+          {
+            ::close(fd);
+          }
+#endif
+          std::ifstream file(path, std::ios::binary | std::ios::in);
+          if (!file.is_open())
+          {
+            this->last_error = "Failed to open file";
+            return false;
+          }
+          return this->read_stream(file, start);
+        }
+
+        /*
+         * Check every row read from stream, chunk_size bytes at a time
+         */
+        bool validate(std::istream &stream)
+        {
+          return this->read_stream(stream, this->begin());
+        }
+
+        /*
+         * Check every row of a file already in memory
+         */
+        bool validate(std::span<const char> contents)
+        {
+          const auto start = this->begin();
+          this->validate_block(contents, 0, this->options.skip_header);
+          this->stats.bytes = contents.size();
+          this->finish(start);
+          return true;
+        }
+
+        const luhns::file_stats &get_stats() const
+        {
+          return this->stats;
+        }
+
+        bool error() const
+        {
+          return !this->last_error.empty();
+        }
+
+        const std::string &error_message() const
+        {
+          return this->last_error;
+        }
+
+    private:
+        std::chrono::steady_clock::time_point begin()
+        {
+          this->stats = {};
+          this->last_error = "";
+          return std::chrono::steady_clock::now();
+        }
+
+        void finish(std::chrono::steady_clock::time_point start)
+        {
+          this->stats.nanoseconds = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+        }
+
+        bool read_stream(std::istream &stream, std::chrono::steady_clock::time_point start)
+        {
+          this->reserve_chunk(std::max<std::size_t>(this->options.chunk_size, 64), 0);
+          char *buffer = this->chunk.get();
+          std::size_t kept = 0;
+          std::uint64_t base = 0;
+          bool first = true;
+          while (true)
+          {
+            stream.read(buffer + kept, static_cast<std::streamsize>(this->chunk_capacity - kept));
+            if (stream.bad())
+            {
+              this->last_error = "Failed to read file";
+              return false;
+            }
+            const std::size_t size = kept + static_cast<std::size_t>(stream.gcount());
+            const bool last = size < this->chunk_capacity;
+            std::size_t rows_end = size;
+            if (!last)
+            {
+              /*
+               * Hold back the row running past the chunk, growing the
+               * buffer when it is the only one
+               */
+              rows_end = std::string_view(buffer, size).rfind('\n') + 1;
+              if (rows_end == 0)
+              {
+                kept = size;
+                this->reserve_chunk(this->chunk_capacity * 2, kept);
+                buffer = this->chunk.get();
+                continue;
+              }
+            }
+            this->validate_block({buffer, rows_end}, base, first && this->options.skip_header);
+            first = false;
+            kept = size - rows_end;
+            std::memmove(buffer, buffer + rows_end, kept);
+            base += rows_end;
+            if (last)
+            {
+              break;
+            }
+          }
+          this->stats.bytes = base;
+          this->finish(start);
+          return true;
+        }
+
+        /*
+         * Make the chunk buffer at least capacity bytes, keeping its first
+         * kept. It is left uninitialised and kept between files, so reading
+         * a small stream only touches the pages it fills
+         */
+        void reserve_chunk(std::size_t capacity, std::size_t kept)
+        {
+          if (this->chunk_capacity >= capacity)
+          {
+            return;
+          }
+          std::unique_ptr<char[]> grown(new char[capacity]);
+          if (kept != 0)
+          {
+            std::memcpy(grown.get(), this->chunk.get(), kept);
+          }
+          this->chunk = std::move(grown);
+          this->chunk_capacity = capacity;
+        }
+
+        /*
+         * Check the rows of data, skipping the first when skip_header is
+         * set, by splitting it into pieces run on the executor. Blocks too
+         * small to split, or a threads option of 1, run on the caller
+         */
+        void validate_block(std::span<const char> data, std::uint64_t base, bool skip_header)
+        {
+          constexpr std::size_t min_piece_size = 1 << 20;
+          const std::string_view contents(data.data(), data.size());
+          std::size_t start = 0;
+          if (skip_header)
+          {
+            start = std::min(contents.find('\n'), contents.size() - 1) + 1;
+          }
+          const std::size_t max_pieces = (contents.size() - start) / min_piece_size;
+          exec::executor *executor = this->options.executor;
+          if (executor == nullptr && this->options.threads != 1 && max_pieces > 1)
+          {
+            executor = &exec::default_executor();
+          }
+          std::size_t threads = this->options.threads != 0 || executor == nullptr ? this->options.threads : executor->concurrency();
+          threads = std::max<std::size_t>(1, std::min(threads, max_pieces));
+
+          std::vector<std::size_t> bounds = {start};
+          for (std::size_t i = 1; i < threads; i++)
+          {
+            const std::size_t split = std::max(bounds.back(), start + (contents.size() - start) * i / threads);
+            bounds.push_back(std::min(contents.find('\n', split), contents.size() - 1) + 1);
+          }
+          bounds.push_back(contents.size());
+
+          std::vector<luhns::file_stats> results(threads);
+          if (threads == 1)
+          {
+            luhns::detail::scan_rows(data, bounds[0], bounds[1], base, this->options, results[0]);
+          } else
+          {
+            executor->for_each(threads, [&](std::size_t i, std::size_t)
+                               {
+                                 luhns::detail::scan_rows(data, bounds[i], bounds[i + 1], base, this->options, results[i]);
+                               });
+          }
+
+          for (const auto &result: results)
+          {
+            for (std::size_t i = 0; i < result.providers.size(); i++)
+            {
+              this->stats.providers[i].numbers += result.providers[i].numbers;
+              this->stats.providers[i].valid += result.providers[i].valid;
+            }
+            this->stats.rows += result.rows;
+            this->stats.valid += result.valid;
+            const std::size_t room = this->options.max_invalid_rows - std::min(this->options.max_invalid_rows, this->stats.invalid_rows.size());
+            this->stats.invalid_rows.insert(this->stats.invalid_rows.end(), result.invalid_rows.begin(),
+                                            result.invalid_rows.begin() + static_cast<std::ptrdiff_t>(std::min(room, result.invalid_rows.size())));
+          }
+        }
+
+        luhns::file_options options;
+        luhns::file_stats stats;
+        std::unique_ptr<char[]> chunk;
+        std::size_t chunk_capacity = 0;
+        std::string last_error;
     };
 }